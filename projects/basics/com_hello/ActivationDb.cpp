@@ -0,0 +1,675 @@
+#include "ActivationDb.h"
+#include "ActivationProbe.h"
+#include <string.h>
+#include <new>
+#include <string>
+
+// Seeds tried per bucket before the writer gives up. With two keys per bucket on average
+// the biggest buckets need a few hundred at most.
+static const UINT32 kMaxSeed = 1 << 24;
+
+// FNV-1a, finished with the MurmurHash3 mix so that the low bits depend on every input bit
+static UINT32 Mix(UINT32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+// A code unit of a ProgID, from the caller as wchar_t or from the file as char16_t
+template <class Char>
+static UINT32 FoldAscii(Char c)
+{
+    UINT32 u = static_cast<UINT32>(c);
+    return (u >= 'A' && u <= 'Z') ? u - 'A' + 'a' : u;
+}
+
+UINT32 ActivationDbHashProgId(const wchar_t* progId, UINT32 seed)
+{
+    UINT32 h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (; *progId != 0; ++progId)
+    {
+        h ^= FoldAscii(*progId);
+        h *= 16777619u;
+    }
+    return Mix(h);
+}
+
+UINT32 ActivationDbHashClsid(REFCLSID clsid, UINT32 seed)
+{
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(&clsid);
+    UINT32 h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (size_t i = 0; i < sizeof(CLSID); ++i)
+    {
+        h ^= bytes[i];
+        h *= 16777619u;
+    }
+    return Mix(h);
+}
+
+template <class CharA, class CharB>
+static bool ProgIdEquals(const CharA* a, const CharB* b)
+{
+    for (; *a != 0 && FoldAscii(*a) == FoldAscii(*b); ++a, ++b)
+    {
+    }
+    return FoldAscii(*a) == FoldAscii(*b);
+}
+
+ActivationDb::ActivationDb()
+    : m_view(NULL), m_size(0), m_header(NULL), m_classes(NULL), m_entryPoints(NULL)
+{
+}
+
+ActivationDb::~ActivationDb()
+{
+    delete[] m_entryPoints;
+    if (m_view != NULL)
+    {
+        UnmapViewOfFile(m_view);
+    }
+}
+
+HRESULT ActivationDb::Open(LPCWSTR path, ActivationDb** ppDb)
+{
+    if (ppDb == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppDb = NULL;
+
+    ActivationDb* db = new (std::nothrow) ActivationDb;
+    if (db == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = db->Map(path);
+    if (SUCCEEDED(hr))
+    {
+        hr = db->Validate();
+    }
+    if (SUCCEEDED(hr))
+    {
+        db->m_entryPoints = new (std::nothrow) std::atomic<ActivationDbGetClassObject>[db->m_header->classCount];
+        if (db->m_entryPoints == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+        }
+        else
+        {
+            for (UINT32 i = 0; i < db->m_header->classCount; ++i)
+            {
+                db->m_entryPoints[i].store(NULL, std::memory_order_relaxed);
+            }
+        }
+    }
+    if (FAILED(hr))
+    {
+        delete db;
+        return hr;
+    }
+    *ppDb = db;
+    return S_OK;
+}
+
+// The view keeps the file and the mapping open, their handles aren't needed afterwards
+HRESULT ActivationDb::Map(LPCWSTR path)
+{
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    HRESULT hr = S_OK;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+    else if (size.QuadPart < static_cast<LONGLONG>(sizeof(ActivationDbHeader)) || size.QuadPart > 0x7FFFFFFF)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+    }
+    else
+    {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            m_view = static_cast<const BYTE*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (m_view == NULL)
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_size = static_cast<UINT32>(size.QuadPart);
+    m_header = reinterpret_cast<const ActivationDbHeader*>(m_view);
+    return S_OK;
+}
+
+// Checks everything a lookup relies on once, so lookups don't have to. A damaged or
+// truncated file is refused instead of read out of bounds.
+HRESULT ActivationDb::Validate()
+{
+    const HRESULT badFormat = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+    const ActivationDbHeader& header = *m_header;
+    if (header.magic != kActivationDbMagic || header.version != kActivationDbVersion || header.fileSize != m_size ||
+        header.classCount == 0 || header.bucketCount == 0)
+    {
+        return badFormat;
+    }
+
+    // Every table has to lie within the file, at an aligned offset
+    const struct
+    {
+        UINT32 offset;
+        UINT64 size;
+    } tables[] = {
+        { header.progIdSeeds, header.bucketCount * 4ull },
+        { header.progIdSlots, header.classCount * 4ull },
+        { header.clsidSeeds, header.bucketCount * 4ull },
+        { header.clsidSlots, header.classCount * 4ull },
+        { header.classes, header.classCount * static_cast<UINT64>(sizeof(ActivationDbClass)) },
+    };
+    for (size_t i = 0; i < ARRAYSIZE(tables); ++i)
+    {
+        if (tables[i].offset % 4 != 0 || tables[i].offset < sizeof(ActivationDbHeader) || tables[i].offset + tables[i].size > m_size)
+        {
+            return badFormat;
+        }
+    }
+
+    const UINT32* progIdSlots = reinterpret_cast<const UINT32*>(m_view + header.progIdSlots);
+    const UINT32* clsidSlots = reinterpret_cast<const UINT32*>(m_view + header.clsidSlots);
+    for (UINT32 i = 0; i < header.classCount; ++i)
+    {
+        if (progIdSlots[i] >= header.classCount || clsidSlots[i] >= header.classCount)
+        {
+            return badFormat;
+        }
+    }
+
+    // And every string has to end within it
+    const ActivationDbClass* classes = reinterpret_cast<const ActivationDbClass*>(m_view + header.classes);
+    for (UINT32 i = 0; i < header.classCount; ++i)
+    {
+        const ActivationDbClass& entry = classes[i];
+        if (entry.threading > ActivationDbNeutral)
+        {
+            return badFormat;
+        }
+        const UINT32 wide[] = { entry.progId, entry.module };
+        for (size_t j = 0; j < ARRAYSIZE(wide); ++j)
+        {
+            if (wide[j] % sizeof(char16_t) != 0 || wide[j] >= m_size ||
+                std::char_traits<char16_t>::find(String(wide[j]), (m_size - wide[j]) / sizeof(char16_t), 0) == NULL)
+            {
+                return badFormat;
+            }
+        }
+        if (entry.entryPoint >= m_size || memchr(m_view + entry.entryPoint, 0, m_size - entry.entryPoint) == NULL)
+        {
+            return badFormat;
+        }
+    }
+
+    m_classes = classes;
+    return S_OK;
+}
+
+HRESULT ActivationDb::FindProgId(LPCWSTR progId, CLSID* pclsid) const
+{
+    if (progId == NULL || pclsid == NULL)
+    {
+        return E_POINTER;
+    }
+
+    const UINT32* seeds = reinterpret_cast<const UINT32*>(m_view + m_header->progIdSeeds);
+    const UINT32* slots = reinterpret_cast<const UINT32*>(m_view + m_header->progIdSlots);
+    UINT32 seed = seeds[ActivationDbHashProgId(progId, 0) % m_header->bucketCount];
+    const ActivationDbClass& entry = m_classes[slots[ActivationDbHashProgId(progId, seed) % m_header->classCount]];
+    if (!ProgIdEquals(String(entry.progId), progId))
+    {
+        *pclsid = CLSID_NULL;
+        return CO_E_CLASSSTRING;
+    }
+    *pclsid = entry.clsid;
+    return S_OK;
+}
+
+const ActivationDbClass* ActivationDb::FindClsid(REFCLSID clsid) const
+{
+    const UINT32* seeds = reinterpret_cast<const UINT32*>(m_view + m_header->clsidSeeds);
+    const UINT32* slots = reinterpret_cast<const UINT32*>(m_view + m_header->clsidSlots);
+    UINT32 seed = seeds[ActivationDbHashClsid(clsid, 0) % m_header->bucketCount];
+    const ActivationDbClass& entry = m_classes[slots[ActivationDbHashClsid(clsid, seed) % m_header->classCount]];
+    return (entry.clsid == clsid) ? &entry : NULL;
+}
+
+// WCHAR is UTF-16 on Windows and the path in the file is passed as it is. Where WCHAR is
+// wider, the path is widened first.
+static HMODULE LoadModule(const char16_t* path)
+{
+    if (sizeof(WCHAR) == sizeof(char16_t))
+    {
+        return LoadLibraryExW(reinterpret_cast<LPCWSTR>(path), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+    }
+    size_t length = std::char_traits<char16_t>::length(path);
+    WCHAR* wide = new (std::nothrow) WCHAR[length + 1];
+    if (wide == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    for (size_t i = 0; i <= length; ++i)
+    {
+        wide[i] = path[i];
+    }
+    HMODULE module = LoadLibraryExW(wide, NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+    delete[] wide;
+    return module;
+}
+
+// Two threads activating the same class for the first time may both load the module.
+// LoadLibrary counts, so that only costs the second one some time.
+HRESULT ActivationDb::GetEntryPoint(UINT32 index, ActivationDbGetClassObject* pfn)
+{
+    ActivationDbGetClassObject entryPoint = m_entryPoints[index].load(std::memory_order_acquire);
+    if (entryPoint == NULL)
+    {
+        const ActivationDbClass& entry = m_classes[index];
+        HELLOWORLD_PROBE_BEGIN(moduleLoad);
+        HMODULE module = LoadModule(String(entry.module));
+        if (module == NULL)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        entryPoint = reinterpret_cast<ActivationDbGetClassObject>(
+            GetProcAddress(module, reinterpret_cast<const char*>(m_view + entry.entryPoint)));
+        HELLOWORLD_PROBE_END(moduleLoad, ActivationStageModuleLoad);
+        if (entryPoint == NULL)
+        {
+            HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+            FreeLibrary(module);
+            return hr;
+        }
+        m_entryPoints[index].store(entryPoint, std::memory_order_release);
+    }
+    *pfn = entryPoint;
+    return S_OK;
+}
+
+HRESULT ActivationDb::GetClassObject(REFCLSID clsid, REFIID riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+
+    const ActivationDbClass* entry = FindClsid(clsid);
+    if (entry == NULL)
+    {
+        return REGDB_E_CLASSNOTREG;
+    }
+    ActivationDbGetClassObject entryPoint;
+    HRESULT hr = GetEntryPoint(static_cast<UINT32>(entry - m_classes), &entryPoint);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    return entryPoint(clsid, riid, ppv);
+}
+
+HRESULT ActivationDb::CreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, REFIID riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+
+    const ActivationDbClass* entry = FindClsid(clsid);
+    if (entry == NULL)
+    {
+        return REGDB_E_CLASSNOTREG;
+    }
+
+    bool here;
+    HRESULT hr = CanCreateHere(static_cast<ActivationDbThreading>(entry->threading), &here);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    if (!here)
+    {
+        return CoCreateInstance(clsid, pUnkOuter, CLSCTX_INPROC_SERVER, riid, ppv);
+    }
+
+    IClassFactory* pFactory = NULL;
+    hr = GetClassObject(clsid, IID_IClassFactory, reinterpret_cast<void**>(&pFactory));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    hr = pFactory->CreateInstance(pUnkOuter, riid, ppv);
+    pFactory->Release();
+    return hr;
+}
+
+// Fails with CO_E_NOTINITIALIZED outside an apartment, as CoCreateInstance would
+HRESULT ActivationDb::CanCreateHere(ActivationDbThreading threading, bool* here)
+{
+    APTTYPE type;
+    APTTYPEQUALIFIER qualifier;
+    HRESULT hr = CoGetApartmentType(&type, &qualifier);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    switch (threading)
+    {
+    case ActivationDbBoth:
+        *here = true;
+        break;
+    case ActivationDbApartment:
+        *here = (type == APTTYPE_STA || type == APTTYPE_MAINSTA);
+        break;
+    case ActivationDbFree:
+        *here = (type == APTTYPE_MTA);
+        break;
+    default:
+        *here = (type == APTTYPE_NA);
+        break;
+    }
+    return S_OK;
+}
+
+// Whether every character of 's' is one char16_t. A 32-bit wchar_t may hold more.
+static bool FitsUtf16(const wchar_t* s)
+{
+    for (; *s != 0; ++s)
+    {
+        if (static_cast<UINT32>(*s) > 0xFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies 's' with its terminator as char16_t, returns the bytes copied
+static size_t CopyUtf16(BYTE* to, const wchar_t* s)
+{
+    char16_t* chars = reinterpret_cast<char16_t*>(to);
+    size_t i = 0;
+    do
+    {
+        chars[i] = static_cast<char16_t>(s[i]);
+    } while (s[i++] != 0);
+    return i * sizeof(char16_t);
+}
+
+ActivationDbWriter::ActivationDbWriter() : m_entries(NULL), m_count(0), m_capacity(0)
+{
+}
+
+ActivationDbWriter::~ActivationDbWriter()
+{
+    delete[] m_entries;
+}
+
+HRESULT ActivationDbWriter::Add(REFCLSID clsid, const wchar_t* progId, const wchar_t* module, const char* entryPoint, ActivationDbThreading threading)
+{
+    if (progId == NULL || module == NULL || entryPoint == NULL)
+    {
+        return E_POINTER;
+    }
+    if (!FitsUtf16(progId) || !FitsUtf16(module))
+    {
+        return E_INVALIDARG;
+    }
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        if (m_entries[i].clsid == clsid || ProgIdEquals(m_entries[i].progId, progId))
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    if (m_count == m_capacity)
+    {
+        UINT32 capacity = (m_capacity == 0) ? 8 : m_capacity * 2;
+        Entry* entries = new (std::nothrow) Entry[capacity];
+        if (entries == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            entries[i] = m_entries[i];
+        }
+        delete[] m_entries;
+        m_entries = entries;
+        m_capacity = capacity;
+    }
+    Entry& entry = m_entries[m_count++];
+    entry.clsid = clsid;
+    entry.progId = progId;
+    entry.module = module;
+    entry.entryPoint = entryPoint;
+    entry.threading = threading;
+    return S_OK;
+}
+
+// Hash and displace: the keys are put in buckets by their first hash, and the buckets,
+// biggest first, each get the first seed that sends all their keys to free slots
+HRESULT ActivationDbWriter::BuildIndex(bool progIds, UINT32 bucketCount, UINT32* seeds, UINT32* slots) const
+{
+    UINT32* bucketOf = new (std::nothrow) UINT32[m_count];
+    UINT32* order = new (std::nothrow) UINT32[bucketCount];
+    UINT32* sizes = new (std::nothrow) UINT32[bucketCount];
+    bool* taken = new (std::nothrow) bool[m_count];
+    UINT32* trial = new (std::nothrow) UINT32[m_count];
+    HRESULT hr = S_OK;
+    if (bucketOf == NULL || order == NULL || sizes == NULL || taken == NULL || trial == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+
+    for (UINT32 b = 0; SUCCEEDED(hr) && b < bucketCount; ++b)
+    {
+        seeds[b] = 0;
+        sizes[b] = 0;
+        order[b] = b;
+    }
+    for (UINT32 i = 0; SUCCEEDED(hr) && i < m_count; ++i)
+    {
+        UINT32 h = progIds ? ActivationDbHashProgId(m_entries[i].progId, 0) : ActivationDbHashClsid(m_entries[i].clsid, 0);
+        bucketOf[i] = h % bucketCount;
+        ++sizes[bucketOf[i]];
+        taken[i] = false;
+    }
+
+    // Insertion sort, the writer runs once per build
+    for (UINT32 b = 1; SUCCEEDED(hr) && b < bucketCount; ++b)
+    {
+        UINT32 bucket = order[b];
+        UINT32 j = b;
+        for (; j > 0 && sizes[order[j - 1]] < sizes[bucket]; --j)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = bucket;
+    }
+
+    for (UINT32 b = 0; SUCCEEDED(hr) && b < bucketCount && sizes[order[b]] > 0; ++b)
+    {
+        UINT32 bucket = order[b];
+        UINT32 seed = 1;
+        for (; seed < kMaxSeed; ++seed)
+        {
+            // The slots this seed gives the keys of the bucket, which must be free and
+            // distinct
+            UINT32 count = 0;
+            bool fits = true;
+            for (UINT32 i = 0; fits && i < m_count; ++i)
+            {
+                if (bucketOf[i] != bucket)
+                {
+                    continue;
+                }
+                UINT32 h = progIds ? ActivationDbHashProgId(m_entries[i].progId, seed) : ActivationDbHashClsid(m_entries[i].clsid, seed);
+                UINT32 slot = h % m_count;
+                fits = !taken[slot];
+                for (UINT32 k = 0; fits && k < count; ++k)
+                {
+                    fits = (trial[k] != slot);
+                }
+                trial[count++] = slot;
+            }
+            if (fits)
+            {
+                break;
+            }
+        }
+        if (seed == kMaxSeed)
+        {
+            hr = E_FAIL;
+            break;
+        }
+
+        seeds[bucket] = seed;
+        UINT32 count = 0;
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            if (bucketOf[i] == bucket)
+            {
+                taken[trial[count]] = true;
+                slots[trial[count++]] = i;
+            }
+        }
+    }
+
+    delete[] trial;
+    delete[] taken;
+    delete[] sizes;
+    delete[] order;
+    delete[] bucketOf;
+    return hr;
+}
+
+HRESULT ActivationDbWriter::Write(LPCWSTR path) const
+{
+    if (m_count == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Two keys per bucket on average
+    UINT32 bucketCount = m_count / 2 + 1;
+
+    ActivationDbHeader header = {};
+    header.magic = kActivationDbMagic;
+    header.version = kActivationDbVersion;
+    header.classCount = m_count;
+    header.bucketCount = bucketCount;
+    header.progIdSeeds = sizeof(ActivationDbHeader);
+    header.progIdSlots = header.progIdSeeds + bucketCount * 4;
+    header.clsidSeeds = header.progIdSlots + m_count * 4;
+    header.clsidSlots = header.clsidSeeds + bucketCount * 4;
+    header.classes = header.clsidSlots + m_count * 4;
+
+    UINT64 size = header.classes + static_cast<UINT64>(m_count) * sizeof(ActivationDbClass);
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        size += (wcslen(m_entries[i].progId) + 1 + wcslen(m_entries[i].module) + 1) * sizeof(char16_t);
+    }
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        size += strlen(m_entries[i].entryPoint) + 1;
+    }
+    if (size > 0x7FFFFFFF)
+    {
+        return E_INVALIDARG;
+    }
+    header.fileSize = static_cast<UINT32>(size);
+
+    BYTE* buffer = new (std::nothrow) BYTE[header.fileSize];
+    if (buffer == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    memset(buffer, 0, header.fileSize);
+    memcpy(buffer, &header, sizeof(header));
+
+    HRESULT hr = BuildIndex(true, bucketCount, reinterpret_cast<UINT32*>(buffer + header.progIdSeeds), reinterpret_cast<UINT32*>(buffer + header.progIdSlots));
+    if (SUCCEEDED(hr))
+    {
+        hr = BuildIndex(false, bucketCount, reinterpret_cast<UINT32*>(buffer + header.clsidSeeds), reinterpret_cast<UINT32*>(buffer + header.clsidSlots));
+    }
+
+    // The wide strings first, so they stay aligned
+    if (SUCCEEDED(hr))
+    {
+        ActivationDbClass* classes = reinterpret_cast<ActivationDbClass*>(buffer + header.classes);
+        UINT32 offset = header.classes + m_count * sizeof(ActivationDbClass);
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            classes[i].progId = offset;
+            offset += static_cast<UINT32>(CopyUtf16(buffer + offset, m_entries[i].progId));
+            classes[i].module = offset;
+            offset += static_cast<UINT32>(CopyUtf16(buffer + offset, m_entries[i].module));
+
+            classes[i].clsid = m_entries[i].clsid;
+            classes[i].threading = m_entries[i].threading;
+        }
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            size_t bytes = strlen(m_entries[i].entryPoint) + 1;
+            memcpy(buffer + offset, m_entries[i].entryPoint, bytes);
+            classes[i].entryPoint = offset;
+            offset += static_cast<UINT32>(bytes);
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            DWORD written = 0;
+            if (!WriteFile(file, buffer, header.fileSize, &written, NULL))
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            else if (written != header.fileSize)
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+            }
+            CloseHandle(file);
+        }
+    }
+
+    delete[] buffer;
+    return hr;
+}
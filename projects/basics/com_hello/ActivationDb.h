@@ -0,0 +1,160 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+
+// Activation without the registry. CLSIDFromProgID and CoCreateInstance look a class up
+// key by key in the registry that DllRegisterServer fills. An activation database holds
+// the same facts in one file that is mapped into memory as it is, and is searched through
+// two minimal perfect hash indexes, one over ProgIDs and one over CLSIDs, so a lookup is
+// a couple of hashes and one comparison, with no system call and no allocation.
+//
+//     ActivationDb* db;
+//     ActivationDb::Open(L"HelloWorld.actdb", &db);
+//     CLSID clsid;
+//     db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+//     db->CreateInstance(clsid, NULL, IID_IHelloWorld, (void**)&pHelloWorld);
+//
+// The file is written at build time by HelloWorldActivationDb.exe with ActivationDbWriter.
+// Everything in it is little-endian and addressed by offsets from the start of the file.
+//
+//     ActivationDbHeader
+//     UINT32 seeds[bucketCount]        ProgID index
+//     UINT32 slots[classCount]
+//     UINT32 seeds[bucketCount]        CLSID index
+//     UINT32 slots[classCount]
+//     ActivationDbClass classes[classCount]
+//     char16_t strings[]               ProgIDs and module paths, UTF-16
+//     char strings[]                   entry points, ANSI
+//
+// The UTF-16 strings are char16_t rather than WCHAR, which is as wide as wchar_t and so
+// 32 bits where it isn't Windows, and the same file reads the same everywhere.
+//
+// An index hashes a key once to find its bucket, and once more with the seed of the
+// bucket to find its slot, which holds the number of the class. The writer picks the seeds
+// so that no two keys share a slot. Keys that are not in the file land on some class too,
+// so a lookup always compares the key with the class it found.
+const UINT32 kActivationDbMagic = 0x42445441;   // "ATDB"
+const UINT32 kActivationDbVersion = 1;
+
+enum ActivationDbThreading
+{
+    ActivationDbApartment,
+    ActivationDbFree,
+    ActivationDbBoth,
+    ActivationDbNeutral,
+};
+
+struct ActivationDbHeader
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT32 fileSize;
+    UINT32 classCount;
+    UINT32 bucketCount;             // per index
+    UINT32 progIdSeeds;
+    UINT32 progIdSlots;
+    UINT32 clsidSeeds;
+    UINT32 clsidSlots;
+    UINT32 classes;
+};
+
+// What the registry keeps under CLSID\{...} and its InprocServer32 key
+struct ActivationDbClass
+{
+    CLSID clsid;
+    UINT32 progId;                  // offset of a NUL-terminated UTF-16 string
+    UINT32 module;                  // offset of a NUL-terminated UTF-16 path
+    UINT32 entryPoint;              // offset of the NUL-terminated ANSI name of the DllGetClassObject export
+    UINT32 threading;               // ActivationDbThreading
+};
+
+typedef HRESULT (__stdcall *ActivationDbGetClassObject)(REFCLSID clsid, REFIID iid, void** ppv);
+
+// A mapped database. Lookups may be made from any thread.
+class ActivationDb
+{
+    const BYTE* m_view;
+    UINT32 m_size;
+    const ActivationDbHeader* m_header;
+    const ActivationDbClass* m_classes;
+
+    // The entry point of every class, resolved on its first activation. Modules are
+    // loaded once and stay loaded, the way COM keeps them until CoFreeUnusedLibraries.
+    std::atomic<ActivationDbGetClassObject>* m_entryPoints;
+
+    ActivationDb();
+
+    ActivationDb(const ActivationDb&) = delete;
+    ActivationDb& operator=(const ActivationDb&) = delete;
+
+    HRESULT Map(LPCWSTR path);
+    HRESULT Validate();
+    const char16_t* String(UINT32 offset) const { return reinterpret_cast<const char16_t*>(m_view + offset); }
+    HRESULT GetEntryPoint(UINT32 index, ActivationDbGetClassObject* pfn);
+
+public:
+    // Maps the database at 'path' and checks that it is well formed
+    static HRESULT Open(LPCWSTR path, ActivationDb** ppDb);
+    ~ActivationDb();
+
+    UINT32 ClassCount() const { return m_header->classCount; }
+
+    // Like CLSIDFromProgID. ProgIDs compare without regard to ASCII case, as in the
+    // registry. CO_E_CLASSSTRING if the database doesn't know the ProgID.
+    HRESULT FindProgId(LPCWSTR progId, CLSID* pclsid) const;
+
+    // The record of a class, or NULL. It stays valid as long as the database is open.
+    const ActivationDbClass* FindClsid(REFCLSID clsid) const;
+
+    const char16_t* ProgId(const ActivationDbClass* entry) const { return String(entry->progId); }
+    const char16_t* Module(const ActivationDbClass* entry) const { return String(entry->module); }
+
+    // Like CoGetClassObject with CLSCTX_INPROC_SERVER
+    HRESULT GetClassObject(REFCLSID clsid, REFIID riid, void** ppv);
+
+    // Like CoCreateInstance with CLSCTX_INPROC_SERVER. The object is created on the calling
+    // thread, so a class whose threading model doesn't allow that in the caller's
+    // apartment is left to CoCreateInstance, which knows how to create it elsewhere.
+    HRESULT CreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, REFIID riid, void** ppv);
+
+    // Whether an object of 'threading' may be created on the calling thread without a
+    // proxy. CO_E_NOTINITIALIZED outside an apartment.
+    static HRESULT CanCreateHere(ActivationDbThreading threading, bool* here);
+};
+
+// Builds a database in memory and writes it out
+class ActivationDbWriter
+{
+    struct Entry
+    {
+        CLSID clsid;
+        const wchar_t* progId;
+        const wchar_t* module;
+        const char* entryPoint;
+        ActivationDbThreading threading;
+    };
+
+    Entry* m_entries;
+    UINT32 m_count;
+    UINT32 m_capacity;
+
+    ActivationDbWriter(const ActivationDbWriter&) = delete;
+    ActivationDbWriter& operator=(const ActivationDbWriter&) = delete;
+
+    HRESULT BuildIndex(bool progIds, UINT32 bucketCount, UINT32* seeds, UINT32* slots) const;
+
+public:
+    ActivationDbWriter();
+    ~ActivationDbWriter();
+
+    // The strings must outlive the writer. E_INVALIDARG for a CLSID or ProgID that was
+    // added before, or for a character beyond U+FFFF in a 32-bit wchar_t string, which
+    // would take two char16_t in the file.
+    HRESULT Add(REFCLSID clsid, const wchar_t* progId, const wchar_t* module, const char* entryPoint, ActivationDbThreading threading);
+
+    HRESULT Write(LPCWSTR path) const;
+};
+
+// The hashes both sides use. 'seed' 0 picks the bucket, the seed of the bucket the slot.
+UINT32 ActivationDbHashProgId(const wchar_t* progId, UINT32 seed);
+UINT32 ActivationDbHashClsid(REFCLSID clsid, UINT32 seed);
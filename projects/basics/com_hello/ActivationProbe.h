@@ -0,0 +1,220 @@
+#pragma once
+
+// Where activation time goes. Probes time each stage of creating a HelloWorld with the
+// time stamp counter and count the times in a histogram per stage:
+//
+//     ActivationStageProgId          CLSIDFromProgID or FindProgId, in the client
+//     ActivationStageModuleLoad      LoadLibrary and GetProcAddress, in ActivationDb and
+//                                    ClassManifestLoader; CoCreateInstance does it out of sight
+//     ActivationStageGetClassObject  DllGetClassObject, in the DLL
+//     ActivationStageCreateInstance  HelloWorldFactory::CreateInstance, in the DLL
+//     ActivationStageQueryInterface  the QueryInterface CreateInstance makes, in the DLL
+//     ActivationStageActivation      CoCreateInstance or its equivalent, as the client sees it
+//
+// Probes are compiled in only with /DHELLOWORLD_ACTIVATION_PROBES and /std:c++17. Without
+// it every macro below expands to nothing, not even a time stamp is read.
+//
+//     HELLOWORLD_PROBE(ActivationStageGetClassObject);        // from here to the end of the scope
+//
+//     HELLOWORLD_PROBE_BEGIN(progId);
+//     hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+//     HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
+//
+//     HELLOWORLD_PROBE_DUMP();                                 // before the process exits
+//
+// Every module has histograms of its own. The dump adds those of HelloWorld.dll, which
+// hands them out through DllGetActivationProbes, to the client's. It prints the count, p50,
+// p99 and maximum of each stage in nanoseconds, as a table, or as JSON when
+// HELLOWORLD_PROBE_FORMAT is "json". HelloWorldClient_activationprobe prints it on Windows,
+// tests/ActivationProbeBenchmark elsewhere.
+
+#ifdef HELLOWORLD_ACTIVATION_PROBES
+
+#include "LatencyBuckets.h"
+#include <atomic>
+#include <ostream>
+#include <new>
+
+enum ActivationStage
+{
+    ActivationStageProgId,
+    ActivationStageModuleLoad,
+    ActivationStageGetClassObject,
+    ActivationStageCreateInstance,
+    ActivationStageQueryInterface,
+    ActivationStageActivation,
+    kActivationStageCount
+};
+
+// Counts values in buckets whose width grows with the value, 16 buckets per power of two,
+// so a value is known to within 1/16 whatever its size, in less than 8 KB. Recording is one
+// relaxed increment, from any thread.
+class ActivationHistogram
+{
+public:
+    typedef LatencyBuckets<4> Buckets;
+    static const UINT32 kBuckets = Buckets::Count(64);
+
+private:
+    std::atomic<UINT64> m_counts[kBuckets];
+    std::atomic<UINT64> m_count;
+    std::atomic<UINT64> m_max;
+
+public:
+    void Record(UINT64 value)
+    {
+        m_counts[Buckets::Index(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        UINT64 max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Add(const ActivationHistogram& other)
+    {
+        for (UINT32 i = 0; i < kBuckets; ++i)
+        {
+            m_counts[i].fetch_add(other.m_counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        m_count.fetch_add(other.Count(), std::memory_order_relaxed);
+        if (other.Max() > Max())
+        {
+            m_max.store(other.Max(), std::memory_order_relaxed);
+        }
+    }
+
+    UINT64 Count() const { return m_count.load(std::memory_order_relaxed); }
+    UINT64 Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    // The value 'percent' of the recorded values are at or below, to bucket precision
+    UINT64 Percentile(double percent) const
+    {
+        UINT64 count = Count();
+        if (count == 0)
+        {
+            return 0;
+        }
+        UINT64 rank = static_cast<UINT64>(percent / 100.0 * count + 0.5);
+        rank = (rank == 0) ? 1 : rank;
+        UINT64 seen = 0;
+        for (UINT32 i = 0; i < kBuckets; ++i)
+        {
+            seen += m_counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                UINT64 bound = Buckets::UpperBound(i);
+                return (bound < Max()) ? bound : Max();
+            }
+        }
+        return Max();
+    }
+};
+
+struct ActivationProbeSet
+{
+    ActivationHistogram stages[kActivationStageCount];
+};
+
+// This module's histograms, in static storage so they start out zero
+inline ActivationProbeSet g_activationProbes;
+
+// Records the ticks from its construction to its destruction
+class ActivationProbeScope
+{
+    ActivationStage m_stage;
+    UINT64 m_start;
+
+public:
+    explicit ActivationProbeScope(ActivationStage stage) : m_stage(stage), m_start(__rdtsc()) {}
+    ~ActivationProbeScope() { g_activationProbes.stages[m_stage].Record(__rdtsc() - m_start); }
+
+    ActivationProbeScope(const ActivationProbeScope&) = delete;
+    ActivationProbeScope& operator=(const ActivationProbeScope&) = delete;
+};
+
+typedef HRESULT (__stdcall *ActivationProbeGetter)(const ActivationProbeSet** ppProbes);
+
+inline void ActivationProbeDump(std::ostream& out)
+{
+    static const char* const names[kActivationStageCount] = {
+        "ProgId", "ModuleLoad", "GetClassObject", "CreateInstance", "QueryInterface", "Activation"
+    };
+
+    ActivationProbeSet* set = new (std::nothrow) ActivationProbeSet();
+    if (set == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < kActivationStageCount; ++i)
+    {
+        set->stages[i].Add(g_activationProbes.stages[i]);
+    }
+
+    // The DLL's, unless it was built without probes or is the module we are in
+    HMODULE server = GetModuleHandleW(L"HelloWorld.dll");
+    ActivationProbeGetter getProbes = (server != NULL) ? reinterpret_cast<ActivationProbeGetter>(GetProcAddress(server, "DllGetActivationProbes")) : NULL;
+    const ActivationProbeSet* serverProbes = NULL;
+    if (getProbes != NULL && SUCCEEDED(getProbes(&serverProbes)) && serverProbes != &g_activationProbes)
+    {
+        for (int i = 0; i < kActivationStageCount; ++i)
+        {
+            set->stages[i].Add(serverProbes->stages[i]);
+        }
+    }
+
+    WCHAR format[8];
+    DWORD cch = GetEnvironmentVariableW(L"HELLOWORLD_PROBE_FORMAT", format, ARRAYSIZE(format));
+    bool json = (cch > 0 && cch < ARRAYSIZE(format) && _wcsicmp(format, L"json") == 0);
+
+    double ticksPerNanosecond = LatencyTicksPerNanosecond();
+    if (json)
+    {
+        out << "{\"unit\":\"ns\",\"stages\":[";
+    }
+    else
+    {
+        out << "stage                count      p50 ns      p99 ns      max ns\n";
+    }
+    for (int i = 0; i < kActivationStageCount; ++i)
+    {
+        const ActivationHistogram& stage = set->stages[i];
+        UINT64 p50 = static_cast<UINT64>(stage.Percentile(50) / ticksPerNanosecond);
+        UINT64 p99 = static_cast<UINT64>(stage.Percentile(99) / ticksPerNanosecond);
+        UINT64 max = static_cast<UINT64>(stage.Max() / ticksPerNanosecond);
+        if (json)
+        {
+            out << (i > 0 ? "," : "") << "{\"stage\":\"" << names[i] << "\",\"count\":" << stage.Count()
+                << ",\"p50\":" << p50 << ",\"p99\":" << p99 << ",\"max\":" << max << "}";
+        }
+        else
+        {
+            char line[96];
+            sprintf_s(line, sizeof(line), "%-16s %9llu %11llu %11llu %11llu\n", names[i], stage.Count(), p50, p99, max);
+            out << line;
+        }
+    }
+    if (json)
+    {
+        out << "]}\n";
+    }
+    delete set;
+}
+
+#define HELLOWORLD_PROBE_CONCAT2(a, b) a##b
+#define HELLOWORLD_PROBE_CONCAT(a, b) HELLOWORLD_PROBE_CONCAT2(a, b)
+#define HELLOWORLD_PROBE(stage) ActivationProbeScope HELLOWORLD_PROBE_CONCAT(helloWorldProbe, __LINE__)(stage)
+#define HELLOWORLD_PROBE_BEGIN(name) UINT64 helloWorldProbe_##name = __rdtsc()
+#define HELLOWORLD_PROBE_END(name, stage) g_activationProbes.stages[stage].Record(__rdtsc() - helloWorldProbe_##name)
+#define HELLOWORLD_PROBE_DUMP() ActivationProbeDump(std::cout)
+
+#else
+
+struct ActivationProbeSet;
+
+#define HELLOWORLD_PROBE(stage)
+#define HELLOWORLD_PROBE_BEGIN(name)
+#define HELLOWORLD_PROBE_END(name, stage)
+#define HELLOWORLD_PROBE_DUMP()
+
+#endif
@@ -0,0 +1,212 @@
+#include "BiasedRefCount.h"
+#include <new>
+
+// Every thread that owns biased counts has one of these. It lives until the thread is gone
+// and the last object it owned is destroyed, so a thread that starts later can never be
+// mistaken for the owner, and a thread that merges for the owner can still look at 'busy'.
+struct BiasedOwner
+{
+    std::atomic<LONG> refs;     // objects owned, plus one while the thread runs
+    std::atomic<LONG> busy;     // 1 while the owner touches the biased count of one of its objects
+
+    void Release()
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+};
+
+namespace
+{
+    // Gives up the thread's owner record when the thread exits. Objects it still owns are
+    // merged by whichever thread releases them last.
+    struct OwnerSlot
+    {
+        BiasedOwner* owner = NULL;
+
+        ~OwnerSlot()
+        {
+            if (owner != NULL)
+            {
+                BiasedOwner* old = owner;
+                owner = NULL;
+                old->Release();
+            }
+        }
+    };
+
+    thread_local OwnerSlot t_owner;
+
+    BiasedOwner* CurrentOwner()
+    {
+        if (t_owner.owner == NULL)
+        {
+            BiasedOwner* owner = new (std::nothrow) BiasedOwner;
+            if (owner != NULL)
+            {
+                owner->refs.store(1, std::memory_order_relaxed);
+                owner->busy.store(0, std::memory_order_relaxed);
+                t_owner.owner = owner;
+            }
+        }
+        return t_owner.owner;
+    }
+}
+
+BiasedRefCount::BiasedRefCount(void (*destroy)(void* context), void* context)
+    : m_owner(CurrentOwner()), m_biased(1), m_shared(0), m_destroy(destroy), m_context(context)
+{
+    if (m_owner != NULL)
+    {
+        m_owner->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        // Out of memory for the owner record, fall back to a plain shared count
+        m_biased.store(0, std::memory_order_relaxed);
+        m_shared.store(kOne | kMerged, std::memory_order_relaxed);
+    }
+}
+
+BiasedRefCount::~BiasedRefCount()
+{
+    if (m_owner != NULL)
+    {
+        m_owner->Release();
+    }
+}
+
+// Returns the owner record, marked busy, if the calling thread may use the biased count.
+// The caller clears 'busy' once it is done with m_biased.
+//
+// This is one half of a Dekker handshake with Merge: we store 'busy', then load m_shared;
+// Merge stores kMerging into m_shared, then loads 'busy'. Only the compiler is kept from
+// reordering our side. The processor may still let the load overtake the store, until
+// Merge calls FlushProcessWriteBuffers, which drains the store buffers of every processor.
+// After that either Merge sees us busy and waits, or we see kMerging and keep our hands off
+// m_biased.
+BiasedOwner* BiasedRefCount::Enter()
+{
+    BiasedOwner* current = t_owner.owner;
+    if (current == NULL || current != m_owner)
+    {
+        return NULL;
+    }
+
+    current->busy.store(1, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if ((m_shared.load(std::memory_order_relaxed) & (kMerged | kMerging)) != 0)
+    {
+        current->busy.store(0, std::memory_order_relaxed);
+        return NULL;
+    }
+    return current;
+}
+
+ULONG BiasedRefCount::AddRef()
+{
+    BiasedOwner* owner = Enter();
+    if (owner != NULL)
+    {
+        LONG biased = m_biased.load(std::memory_order_relaxed) + 1;
+        m_biased.store(biased, std::memory_order_relaxed);
+        owner->busy.store(0, std::memory_order_release);
+        return biased;
+    }
+    return (m_shared.fetch_add(kOne, std::memory_order_relaxed) + kOne) / kOne;
+}
+
+ULONG BiasedRefCount::Release()
+{
+    BiasedOwner* owner = Enter();
+    if (owner == NULL)
+    {
+        return ReleaseShared();
+    }
+
+    LONG biased = m_biased.load(std::memory_order_relaxed) - 1;
+    m_biased.store(biased, std::memory_order_relaxed);
+    if (biased > 0)
+    {
+        owner->busy.store(0, std::memory_order_release);
+        return biased;
+    }
+
+    // The owner is done with the object, hand the count over to the shared word. If
+    // another thread has started merging meanwhile, destroying the object is left to it.
+    LONG old = m_shared.fetch_or(kMerged, std::memory_order_acq_rel);
+    owner->busy.store(0, std::memory_order_release);
+    if (old < kOne && (old & kMerging) == 0)
+    {
+        m_destroy(m_context);
+        return 0;
+    }
+    return (old < kOne) ? 0 : old / kOne;
+}
+
+// Release for everybody but the owner, and for the owner once the object is merged or
+// being merged. If the shared count of an unmerged object goes negative, kMerging is set in
+// the same step, so the owner can't destroy the object while we merge it.
+ULONG BiasedRefCount::ReleaseShared()
+{
+    LONG old = m_shared.load(std::memory_order_relaxed);
+    LONG shared;
+    do
+    {
+        shared = old - kOne;
+        if ((shared & (kMerged | kMerging)) == 0 && shared < 0)
+        {
+            shared |= kMerging;
+        }
+    } while (!m_shared.compare_exchange_weak(old, shared, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+    if ((shared & kMerged) != 0)
+    {
+        if (shared < kOne && (shared & kMerging) == 0)
+        {
+            m_destroy(m_context);
+            return 0;
+        }
+        return (shared < kOne) ? 0 : shared / kOne;
+    }
+
+    if ((shared & kMerging) != 0 && (old & kMerging) == 0)
+    {
+        return Merge();
+    }
+    // Not merged, so the owner or the thread merging still holds the rest of the references
+    return 1;
+}
+
+// Adds the owner's count to the shared word, sets kMerged and clears kMerging. Runs on the
+// thread that set kMerging, whatever the owner is doing; see Enter for why the owner can't
+// change m_biased under our feet. That is at most once per object: kMerging is only set on
+// an object that is neither merged nor merging, and we leave kMerged behind for good. So
+// is the FlushProcessWriteBuffers; an object its owner merges never needs one.
+ULONG BiasedRefCount::Merge()
+{
+    FlushProcessWriteBuffers();
+    while (m_owner->busy.load(std::memory_order_acquire) != 0)
+    {
+        // The owner is in the middle of a few instructions, unless it was preempted there
+        YieldProcessor();
+        SwitchToThread();
+    }
+    LONG biased = m_biased.load(std::memory_order_relaxed);
+
+    LONG old = m_shared.load(std::memory_order_relaxed);
+    LONG merged;
+    do
+    {
+        merged = ((old & ~kMerging) + biased * kOne) | kMerged;
+    } while (!m_shared.compare_exchange_weak(old, merged, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if (merged < kOne)
+    {
+        m_destroy(m_context);
+        return 0;
+    }
+    return merged / kOne;
+}
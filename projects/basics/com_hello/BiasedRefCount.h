@@ -0,0 +1,61 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+
+struct BiasedOwner;
+
+// A reference count for objects that are mostly used by the thread that created them, but
+// get shared with other threads now and then.
+//
+// The creating thread (the owner) counts its references in a field that no other thread
+// writes, with plain loads and stores. All other threads count in a shared atomic word. As
+// long as the owner does most of the AddRef/Release calls, the shared word is left alone
+// and its cache line doesn't bounce between cores.
+//
+// The object is alive while the two counts add up to more than zero. That sum is only
+// known after the counts are merged:
+//
+//   * When the owner's count drops to zero, the owner merges: from then on everybody,
+//     the owner included, counts in the shared word.
+//   * When the shared count of an unmerged object drops below zero, another thread has
+//     released references the owner handed to it. That thread merges the object itself,
+//     right away, whether the owner is busy elsewhere, idle or gone. It marks the object,
+//     then makes sure the owner either sees the mark or has finished touching its count,
+//     and only then reads the owner's count (see BiasedRefCount::Merge).
+//
+// The owner pays for that with two plain stores and a load per AddRef or Release; there is
+// no interlocked instruction and no fence on its side. The thread that merges for it pays
+// for a FlushProcessWriteBuffers, which interrupts every processor of the process, but
+// only once per object.
+//
+// Whoever brings the merged count to zero destroys the object through the callback that
+// was passed to the constructor.
+class BiasedRefCount
+{
+    // The shared word: the count in steps of kOne, plus two flags
+    static constexpr LONG kMerged = 1;   // the owner's count has been added to the shared count
+    static constexpr LONG kMerging = 2;  // another thread is adding the owner's count
+    static constexpr LONG kOne = 4;
+
+    BiasedOwner* m_owner;               // NULL if the object was merged from the start
+    std::atomic<LONG> m_biased;         // the owner's count, only the owner writes it
+    std::atomic<LONG> m_shared;
+    void (*m_destroy)(void* context);
+    void* m_context;
+
+    BiasedRefCount(const BiasedRefCount&) = delete;
+    BiasedRefCount& operator=(const BiasedRefCount&) = delete;
+
+    BiasedOwner* Enter();
+    ULONG ReleaseShared();
+    ULONG Merge();
+
+public:
+    // Starts with one reference, held by the calling thread, which becomes the owner.
+    BiasedRefCount(void (*destroy)(void* context), void* context);
+    ~BiasedRefCount();
+
+    // Like IUnknown::AddRef and Release, the return values are only meant for debugging
+    ULONG AddRef();
+    ULONG Release();
+};
@@ -0,0 +1,81 @@
+#include "BstrAlloc.h"
+#include "PerThreadCounters.h"
+
+// Counter slots: the size classes first, then the totals
+enum
+{
+    CounterFailures = BstrSizeClasses,
+    CounterBytes,
+    CounterHeld,
+    CounterHeldBytes,
+    CounterCount
+};
+
+struct BstrCountersTag;
+typedef PerThreadCounters<BstrCountersTag, CounterCount> BstrCounters;
+
+static BstrSizeClass SizeClassOf(UINT cch)
+{
+    if (cch <= 16) return BstrSize16;
+    if (cch <= 32) return BstrSize32;
+    if (cch <= 64) return BstrSize64;
+    if (cch <= 128) return BstrSize128;
+    return BstrSizeLarger;
+}
+
+BSTR BstrAllocLen(const OLECHAR* psz, UINT cch)
+{
+    BSTR bstr = SysAllocStringLen(psz, cch);
+    if (bstr == NULL)
+    {
+        BstrCounters::Add(CounterFailures, 1);
+        return NULL;
+    }
+
+    BstrCounters::Add(SizeClassOf(cch), 1);
+    BstrCounters::Add(CounterBytes, static_cast<LONG64>(cch) * sizeof(OLECHAR));
+    return bstr;
+}
+
+// Holding and handing out may happen on different threads, so a thread's own counts can go
+// below zero. Only their sum means anything.
+void BstrHold(BSTR bstr)
+{
+    if (bstr != NULL)
+    {
+        BstrCounters::Add(CounterHeld, 1);
+        BstrCounters::Add(CounterHeldBytes, SysStringByteLen(bstr));
+    }
+}
+
+void BstrHandOut(BSTR bstr)
+{
+    if (bstr != NULL)
+    {
+        BstrCounters::Add(CounterHeld, -1);
+        BstrCounters::Add(CounterHeldBytes, -static_cast<LONG64>(SysStringByteLen(bstr)));
+    }
+}
+
+void BstrFreeHeld(BSTR bstr)
+{
+    BstrHandOut(bstr);
+    SysFreeString(bstr);
+}
+
+void GetBstrAllocStats(BstrAllocStats* stats)
+{
+    LONG64 counters[CounterCount];
+    BstrCounters::Read(counters);
+
+    stats->allocations = 0;
+    for (int i = 0; i < BstrSizeClasses; ++i)
+    {
+        stats->bySizeClass[i] = counters[i];
+        stats->allocations += counters[i];
+    }
+    stats->failures = counters[CounterFailures];
+    stats->bytes = counters[CounterBytes];
+    stats->held = counters[CounterHeld];
+    stats->heldBytes = counters[CounterHeldBytes];
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Windows.h>
+
+// Every BSTR the server hands out to a client is allocated through these functions.
+//
+// The strings are ordinary BSTRs from SysAllocStringLen, so clients free them with
+// SysFreeString as usual. OLEAUT32 already keeps a per-thread cache of recently freed
+// BSTRs, so the allocations themselves are cheap. What we add is:
+//
+//   * allocation by explicit length, so nothing has to scan a string for its terminator
+//   * counters that show how many strings and bytes the server allocates, per size class
+//   * counters of the strings the server keeps for itself, see BstrHold
+
+enum BstrSizeClass
+{
+    BstrSize16,     // up to 16 characters
+    BstrSize32,     // up to 32 characters
+    BstrSize64,     // up to 64 characters
+    BstrSize128,    // up to 128 characters
+    BstrSizeLarger, // anything longer
+    BstrSizeClasses
+};
+
+struct BstrAllocStats
+{
+    LONG64 allocations;                   // BSTRs successfully allocated
+    LONG64 failures;                      // allocations that ran out of memory
+    LONG64 bytes;                         // characters allocated, in bytes, without terminators
+    LONG64 bySizeClass[BstrSizeClasses];  // allocations per BstrSizeClass
+    LONG64 held;                          // BSTRs the server holds now, see BstrHold
+    LONG64 heldBytes;                     // their characters, in bytes, without terminators
+};
+
+// Allocates a BSTR of cch characters and copies them from psz. With psz == NULL the
+// characters are left for the caller to fill in; the terminator is always written.
+BSTR BstrAllocLen(const OLECHAR* psz, UINT cch);
+
+// Allocates a copy of a string literal. Its length is known at compile time.
+template <UINT N>
+inline BSTR BstrAllocLiteral(const OLECHAR (&literal)[N])
+{
+    return BstrAllocLen(literal, N - 1);
+}
+
+// A BSTR the server keeps for a while, rather than hand it to a client right away, is held
+// from BstrHold until it is either handed out with BstrHandOut or freed with BstrFreeHeld.
+// Clients free what they are given with SysFreeString, which the server never sees, so
+// only the strings still in the server's hands can be told apart as outstanding. NULL is
+// accepted and ignored by all three.
+void BstrHold(BSTR bstr);
+void BstrHandOut(BSTR bstr);
+void BstrFreeHeld(BSTR bstr);
+
+// Returns the allocation counters of all threads added up.
+void GetBstrAllocStats(BstrAllocStats* stats);
@@ -0,0 +1,245 @@
+#include "ClassManifest.h"
+#include "ActivationDb.h"
+#include "ActivationProbe.h"
+#include <new>
+
+static_assert(ActivationDbApartment == 0 && ActivationDbFree == 1 && ActivationDbBoth == 2 && ActivationDbNeutral == 3,
+              "kClassManifestThreadingModels follows ActivationDbThreading");
+
+ClassManifestLoader::ClassManifestLoader() : m_classes(NULL), m_byProgId(NULL), m_count(0)
+{
+}
+
+ClassManifestLoader::~ClassManifestLoader()
+{
+    delete[] m_byProgId;
+    delete[] m_classes;
+}
+
+HRESULT ClassManifestLoader::Create(const LPCWSTR* modules, UINT32 moduleCount, ClassManifestLoader** ppLoader)
+{
+    if (modules == NULL || ppLoader == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppLoader = NULL;
+
+    // Every module first, to know how many classes there are
+    const ClassManifest** manifests = new (std::nothrow) const ClassManifest*[moduleCount];
+    GetClassObjectFn* entryPoints = new (std::nothrow) GetClassObjectFn[moduleCount];
+    HMODULE* loaded = new (std::nothrow) HMODULE[moduleCount];
+    ClassManifestLoader* loader = new (std::nothrow) ClassManifestLoader;
+    HRESULT hr = S_OK;
+    if (manifests == NULL || entryPoints == NULL || loaded == NULL || loader == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    UINT32 count = 0;
+    UINT32 loadedCount = 0;
+    for (UINT32 i = 0; SUCCEEDED(hr) && i < moduleCount; ++i)
+    {
+        HELLOWORLD_PROBE_BEGIN(moduleLoad);
+        HMODULE module = LoadLibraryExW(modules[i], NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+        if (module == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            break;
+        }
+        loaded[loadedCount++] = module;
+        ClassManifestGetter getManifest = reinterpret_cast<ClassManifestGetter>(GetProcAddress(module, "DllGetClassManifest"));
+        entryPoints[i] = reinterpret_cast<GetClassObjectFn>(GetProcAddress(module, "DllGetClassObject"));
+        HELLOWORLD_PROBE_END(moduleLoad, ActivationStageModuleLoad);
+        if (getManifest == NULL || entryPoints[i] == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            break;
+        }
+        hr = getManifest(&manifests[i]);
+        if (SUCCEEDED(hr) && manifests[i]->version != kClassManifestVersion)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+        }
+        if (FAILED(hr))
+        {
+            break;
+        }
+        count += manifests[i]->classCount;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        loader->m_classes = new (std::nothrow) Class[count];
+        loader->m_byProgId = new (std::nothrow) UINT32[count];
+        if (loader->m_classes == NULL || loader->m_byProgId == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    if (SUCCEEDED(hr))
+    {
+        for (UINT32 i = 0; i < moduleCount; ++i)
+        {
+            for (UINT32 j = 0; j < manifests[i]->classCount; ++j)
+            {
+                Class& entry = loader->m_classes[loader->m_count++];
+                entry.info = &manifests[i]->classes[j];
+                entry.clsid = entry.info->clsid;
+                entry.getClassObject = entryPoints[i];
+            }
+        }
+        hr = loader->Index();
+    }
+
+    // Without a loader nothing uses the modules, every one loaded so far goes again
+    if (FAILED(hr))
+    {
+        for (UINT32 i = 0; i < loadedCount; ++i)
+        {
+            FreeLibrary(loaded[i]);
+        }
+    }
+    delete[] loaded;
+    delete[] entryPoints;
+    delete[] manifests;
+    if (FAILED(hr))
+    {
+        delete loader;
+        return hr;
+    }
+    *ppLoader = loader;
+    return S_OK;
+}
+
+// Sorts the classes by CLSID and their ProgIDs alongside. Insertion sort, there are only
+// as many classes as the modules serve.
+HRESULT ClassManifestLoader::Index()
+{
+    for (UINT32 i = 1; i < m_count; ++i)
+    {
+        Class entry = m_classes[i];
+        UINT32 j = i;
+        for (; j > 0 && entry.clsid < m_classes[j - 1].clsid; --j)
+        {
+            m_classes[j] = m_classes[j - 1];
+        }
+        if (j > 0 && m_classes[j - 1].clsid == entry.clsid)
+        {
+            return E_INVALIDARG;
+        }
+        m_classes[j] = entry;
+    }
+
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        const wchar_t* progId = m_classes[i].info->progId;
+        UINT32 j = i;
+        int order = 1;
+        for (; j > 0 && (order = _wcsicmp(progId, m_classes[m_byProgId[j - 1]].info->progId)) < 0; --j)
+        {
+            m_byProgId[j] = m_byProgId[j - 1];
+        }
+        if (j > 0 && order == 0)
+        {
+            return E_INVALIDARG;
+        }
+        m_byProgId[j] = i;
+    }
+    return S_OK;
+}
+
+const ClassManifestLoader::Class* ClassManifestLoader::Find(REFCLSID clsid) const
+{
+    ClassObjectKey key = ClassObjectKey::FromGuid(clsid);
+    UINT32 first = 0, last = m_count;
+    while (first < last)
+    {
+        UINT32 mid = first + (last - first) / 2;
+        if (m_classes[mid].clsid < key)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    return (first < m_count && m_classes[first].clsid == key) ? &m_classes[first] : NULL;
+}
+
+HRESULT ClassManifestLoader::FindProgId(LPCWSTR progId, CLSID* pclsid) const
+{
+    if (progId == NULL || pclsid == NULL)
+    {
+        return E_POINTER;
+    }
+
+    UINT32 first = 0, last = m_count;
+    while (first < last)
+    {
+        UINT32 mid = first + (last - first) / 2;
+        if (_wcsicmp(m_classes[m_byProgId[mid]].info->progId, progId) < 0)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    if (first == m_count || _wcsicmp(m_classes[m_byProgId[first]].info->progId, progId) != 0)
+    {
+        *pclsid = CLSID_NULL;
+        return CO_E_CLASSSTRING;
+    }
+    memcpy(pclsid, &m_classes[m_byProgId[first]].clsid, sizeof(CLSID));
+    return S_OK;
+}
+
+const ClassManifestClass* ClassManifestLoader::FindClsid(REFCLSID clsid) const
+{
+    const Class* entry = Find(clsid);
+    return (entry != NULL) ? entry->info : NULL;
+}
+
+HRESULT ClassManifestLoader::GetClassObject(REFCLSID clsid, REFIID riid, void** ppv) const
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+
+    const Class* entry = Find(clsid);
+    if (entry == NULL)
+    {
+        return REGDB_E_CLASSNOTREG;
+    }
+    return entry->getClassObject(clsid, riid, ppv);
+}
+
+HRESULT ClassManifestLoader::CreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, REFIID riid, void** ppv) const
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+
+    const Class* entry = Find(clsid);
+    if (entry == NULL)
+    {
+        return REGDB_E_CLASSNOTREG;
+    }
+    bool here;
+    HRESULT hr = ActivationDb::CanCreateHere(static_cast<ActivationDbThreading>(entry->info->threading), &here);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    if (!here)
+    {
+        return CoCreateInstance(clsid, pUnkOuter, CLSCTX_INPROC_SERVER, riid, ppv);
+    }
+
+    IClassFactory* pFactory = NULL;
+    hr = entry->getClassObject(clsid, IID_IClassFactory, reinterpret_cast<void**>(&pFactory));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    hr = pFactory->CreateInstance(pUnkOuter, riid, ppv);
+    pFactory->Release();
+    return hr;
+}
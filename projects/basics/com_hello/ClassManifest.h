@@ -0,0 +1,128 @@
+#pragma once
+#include <Windows.h>
+#include "ClassObjectTable.h"
+
+// What a module says about its coclasses, so nobody has to find it in the registry. A DLL
+// declares its manifest as a constant and hands it out through an export:
+//
+//     static constexpr ClassObjectKey s_helloWorldInterfaces[] = {
+//         ClassObjectKey::Parse(L"{A851A7FE-4903-48AF-A694-51FEB755EE5B}"),     // IHelloWorld
+//     };
+//     static constexpr ClassManifestClass s_classes[] = {
+//         ClassManifestClass::Make(L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", L"HelloWorldLib.HelloWorld",
+//                                  L"HelloWorld", L"Both", s_helloWorldInterfaces),
+//     };
+//
+//     extern "C" HRESULT __stdcall DllGetClassManifest(const ClassManifest** ppManifest);
+//
+// GUIDs are parsed and threading models checked at compile time, a typo is a compile
+// error. DllRegisterServer writes the registry from the same manifest, and
+// ClassManifestLoader activates from it without the registry.
+const UINT32 kClassManifestVersion = 1;
+
+// The ThreadingModel values of the registry, in the order of ActivationDbThreading
+constexpr const wchar_t* kClassManifestThreadingModels[] = { L"Apartment", L"Free", L"Both", L"Neutral" };
+
+struct ClassManifestClass
+{
+    ClassObjectKey clsid;
+    const wchar_t* clsidString;     // "{...}", the way the registry spells it
+    const wchar_t* progId;
+    const wchar_t* name;            // the default value of CLSID\{...}
+    UINT32 threading;               // index into kClassManifestThreadingModels
+    UINT32 interfaceCount;
+    const ClassObjectKey* interfaces;   // what QueryInterface answers besides IUnknown
+
+    template <size_t N>
+    static constexpr ClassManifestClass Make(const wchar_t* clsid, const wchar_t* progId, const wchar_t* name,
+                                             const wchar_t* threadingModel, const ClassObjectKey (&interfaces)[N])
+    {
+        return { ClassObjectKey::Parse(clsid), clsid, progId, name, Threading(threadingModel), static_cast<UINT32>(N), interfaces };
+    }
+
+    const wchar_t* ThreadingModel() const { return kClassManifestThreadingModels[threading]; }
+
+private:
+    static constexpr bool Equals(const wchar_t* a, const wchar_t* b)
+    {
+        for (; *a != 0 && *a == *b; ++a, ++b)
+        {
+        }
+        return *a == *b;
+    }
+
+    static constexpr UINT32 Threading(const wchar_t* model)
+    {
+        for (UINT32 i = 0; i < ARRAYSIZE(kClassManifestThreadingModels); ++i)
+        {
+            if (Equals(model, kClassManifestThreadingModels[i]))
+                return i;
+        }
+        throw "ClassManifestClass: unknown threading model";
+    }
+};
+
+struct ClassManifest
+{
+    UINT32 version;                 // kClassManifestVersion
+    UINT32 classCount;
+    const ClassManifestClass* classes;
+};
+
+// The DllGetClassManifest export. The manifest lives as long as the module is loaded.
+typedef HRESULT (__stdcall *ClassManifestGetter)(const ClassManifest** ppManifest);
+
+// The class objects of modules activated from their manifests. The modules are loaded and
+// their manifests indexed once, when the loader is created. Lookups after that are binary
+// searches over memory, and the loader may be used from any thread.
+//
+//     ClassManifestLoader* loader;
+//     LPCWSTR modules[] = { L"HelloWorld.dll" };
+//     ClassManifestLoader::Create(modules, 1, &loader);
+//     CLSID clsid;
+//     loader->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+//     loader->CreateInstance(clsid, NULL, IID_IHelloWorld, (void**)&pHelloWorld);
+class ClassManifestLoader
+{
+    typedef HRESULT (__stdcall *GetClassObjectFn)(REFCLSID clsid, REFIID iid, void** ppv);
+
+    struct Class
+    {
+        ClassObjectKey clsid;
+        const ClassManifestClass* info;
+        GetClassObjectFn getClassObject;
+    };
+
+    Class* m_classes;               // sorted by CLSID
+    UINT32* m_byProgId;             // indexes into m_classes, sorted by ProgID
+    UINT32 m_count;
+
+    ClassManifestLoader();
+
+    ClassManifestLoader(const ClassManifestLoader&) = delete;
+    ClassManifestLoader& operator=(const ClassManifestLoader&) = delete;
+
+    HRESULT Index();
+    const Class* Find(REFCLSID clsid) const;
+
+public:
+    // Loads the modules and reads their manifests. Modules stay loaded for as long as the
+    // process runs, the way COM keeps them until CoFreeUnusedLibraries, unless Create fails,
+    // which frees every module it loaded. E_INVALIDARG if two classes share a CLSID or a
+    // ProgID.
+    static HRESULT Create(const LPCWSTR* modules, UINT32 moduleCount, ClassManifestLoader** ppLoader);
+    ~ClassManifestLoader();
+
+    UINT32 ClassCount() const { return m_count; }
+
+    // Like CLSIDFromProgID. CO_E_CLASSSTRING if no manifest has the ProgID.
+    HRESULT FindProgId(LPCWSTR progId, CLSID* pclsid) const;
+
+    // What the manifest says about the class, or NULL
+    const ClassManifestClass* FindClsid(REFCLSID clsid) const;
+
+    // Like CoGetClassObject and CoCreateInstance with CLSCTX_INPROC_SERVER, see
+    // ActivationDb::CreateInstance for the threading models
+    HRESULT GetClassObject(REFCLSID clsid, REFIID riid, void** ppv) const;
+    HRESULT CreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, REFIID riid, void** ppv) const;
+};
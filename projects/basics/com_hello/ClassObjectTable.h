@@ -0,0 +1,134 @@
+#pragma once
+#include <Windows.h>
+#include <string.h>
+
+// A CLSID as two 64-bit words with the same bytes as the GUID in memory, so a key made
+// from a GUID at run time matches one parsed from a string at compile time.
+struct ClassObjectKey
+{
+    unsigned long long lo; // Data1, Data2, Data3
+    unsigned long long hi; // Data4
+
+    constexpr bool operator<(const ClassObjectKey& other) const
+    {
+        return lo < other.lo || (lo == other.lo && hi < other.hi);
+    }
+    constexpr bool operator==(const ClassObjectKey& other) const
+    {
+        return lo == other.lo && hi == other.hi;
+    }
+
+    static ClassObjectKey FromGuid(REFGUID guid)
+    {
+        ClassObjectKey key;
+        memcpy(&key, &guid, sizeof(key));
+        return key;
+    }
+
+    // Parses "{DC0F3891-93F3-42E9-A117-729B4F3C775A}", the form the registry uses.
+    // Malformed strings throw, which is a compile error in a constant expression.
+    static constexpr ClassObjectKey Parse(const wchar_t* s)
+    {
+        // Positions of the 16 bytes in the string, in the order they appear
+        constexpr int offsets[16] = { 1, 3, 5, 7, 10, 12, 15, 17, 20, 22, 25, 27, 29, 31, 33, 35 };
+        if (s[0] != L'{' || s[9] != L'-' || s[14] != L'-' || s[19] != L'-' || s[24] != L'-' || s[37] != L'}' || s[38] != 0)
+            throw "ClassObjectKey: malformed CLSID string";
+
+        unsigned char b[16] = {};
+        for (int i = 0; i < 16; ++i)
+            b[i] = static_cast<unsigned char>(HexDigit(s[offsets[i]]) << 4 | HexDigit(s[offsets[i] + 1]));
+
+        // Data1, Data2 and Data3 are little-endian in memory, Data4 is a plain byte array
+        unsigned long long data1 = static_cast<unsigned long long>(b[0]) << 24 | b[1] << 16 | b[2] << 8 | b[3];
+        unsigned long long data2 = static_cast<unsigned long long>(b[4]) << 8 | b[5];
+        unsigned long long data3 = static_cast<unsigned long long>(b[6]) << 8 | b[7];
+
+        ClassObjectKey key = { data1 | data2 << 32 | data3 << 48, 0 };
+        for (int i = 0; i < 8; ++i)
+            key.hi |= static_cast<unsigned long long>(b[8 + i]) << (8 * i);
+        return key;
+    }
+
+private:
+    static constexpr int HexDigit(wchar_t c)
+    {
+        if (c >= L'0' && c <= L'9') return c - L'0';
+        if (c >= L'A' && c <= L'F') return c - L'A' + 10;
+        if (c >= L'a' && c <= L'f') return c - L'a' + 10;
+        throw "ClassObjectKey: malformed CLSID string";
+    }
+};
+
+// One coclass served by this module: its CLSID and its class object. Class objects live
+// in static storage for as long as the module is loaded; they are never created or
+// deleted on the activation path.
+struct ClassObjectEntry
+{
+    const wchar_t* clsid;
+    IClassFactory* factory;
+};
+
+// Maps CLSIDs to class objects, sorted at compile time so DllGetClassObject can find a
+// class object with a binary search over 128-bit keys and without allocating anything.
+// A duplicate CLSID throws, which turns into a compile error because the table is always
+// declared constexpr:
+//
+//     static HelloWorldFactory s_helloWorldFactory;
+//     static constexpr ClassObjectTable s_classObjects({
+//         { L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", &s_helloWorldFactory },
+//     });
+template <size_t N>
+class ClassObjectTable
+{
+    struct Slot
+    {
+        ClassObjectKey key;
+        IClassFactory* factory;
+    };
+
+    Slot m_slots[N];
+
+public:
+    constexpr ClassObjectTable(const ClassObjectEntry (&entries)[N]) : m_slots{}
+    {
+        // Insertion sort, the table only lists a handful of coclasses
+        for (size_t i = 0; i < N; ++i)
+        {
+            Slot slot = { ClassObjectKey::Parse(entries[i].clsid), entries[i].factory };
+            size_t j = i;
+            for (; j > 0 && slot.key < m_slots[j - 1].key; --j)
+                m_slots[j] = m_slots[j - 1];
+            if (j > 0 && m_slots[j - 1].key == slot.key)
+                throw "ClassObjectTable: duplicate CLSID";
+            m_slots[j] = slot;
+        }
+    }
+
+    // Whether the table has a class object for 'key', for static_asserts
+    constexpr bool Contains(const ClassObjectKey& key) const
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (m_slots[i].key == key)
+                return true;
+        }
+        return false;
+    }
+
+    // Returns the class object for the CLSID, or NULL if this module doesn't serve it.
+    // The class object is not AddRef'ed.
+    IClassFactory* Find(REFCLSID clsid) const
+    {
+        ClassObjectKey key = ClassObjectKey::FromGuid(clsid);
+        size_t first = 0, last = N;
+        while (first < last)
+        {
+            size_t mid = first + (last - first) / 2;
+            if (m_slots[mid].key < key)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return (first < N && m_slots[first].key == key) ? m_slots[first].factory : NULL;
+    }
+};
@@ -0,0 +1,313 @@
+#pragma once
+#include <Windows.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "DispatchNames.h"
+
+// A generic IDispatch::Invoke built from a compile-time method table.
+//
+// Instead of a hand-written switch that unpacks DISPPARAMS for every method, each
+// dispatchable method is described once:
+//
+//     typedef DispatchImpl<HelloWorld,
+//         DispMethod<&HelloWorld::SayHello,    1>,
+//         DispMethod<&HelloWorld::SayHelloStr, 2>,
+//         DispMethod<&HelloWorld::SayHelloTo,  3>> HelloWorldDispatch;
+//
+// and the engine derives everything else from the method's signature: how many [in]
+// arguments it takes, their VARTYPEs, whether it wants the caller's LCID (DispLcid) and
+// whether the last parameter is an [out, retval] pointer whose value goes into pVarResult.
+//
+// Arguments whose VARTYPE already matches the parameter are passed straight through,
+// without copying. Only a mismatching argument is converted with VariantChangeTypeEx.
+
+// Binds a DISPID to a member function of the implementing class.
+template <auto Method, DISPID Id>
+struct DispMethod
+{
+    typedef decltype(Method) Type;
+
+    static constexpr Type method = Method;
+    static constexpr DISPID id = Id;
+};
+
+// Maps a C++ parameter type to its VARTYPE and to the VARIANT field that holds it.
+// Accepts() tells which argument VARTYPEs can be used in place, without conversion.
+// Add a specialization here to allow a new parameter type in a dispatch method.
+template <class T> struct VariantType;
+
+template <> struct VariantType<BSTR>
+{
+    static constexpr VARTYPE vt = VT_BSTR;
+    static bool Accepts(VARTYPE argVt) { return argVt == vt; }
+    static BSTR& Field(VARIANT* v) { return V_BSTR(v); }
+    static void Free(BSTR value) { SysFreeString(value); }
+};
+
+template <> struct VariantType<LONG>
+{
+    static constexpr VARTYPE vt = VT_I4;
+    static bool Accepts(VARTYPE argVt) { return argVt == vt; }
+    static LONG& Field(VARIANT* v) { return V_I4(v); }
+    static void Free(LONG) {}
+};
+
+// Arrays are handed over as they are. VariantChangeType can't convert between array
+// types, so the method itself checks the element type, see HelloWorld::SayHelloToMany.
+// An array passed by reference holds a SAFEARRAY** and goes through the by-reference path
+// of DispArg::Bind instead.
+template <> struct VariantType<SAFEARRAY*>
+{
+    static constexpr VARTYPE vt = VT_ARRAY | VT_BSTR;
+    static bool Accepts(VARTYPE argVt) { return (argVt & (VT_ARRAY | VT_BYREF)) == VT_ARRAY; }
+    static SAFEARRAY*& Field(VARIANT* v) { return V_ARRAY(v); }
+    static void Free(SAFEARRAY* value) { SafeArrayDestroy(value); }
+};
+
+// Holds one [in] argument for the duration of the call.
+template <class T>
+class DispArg
+{
+    VARIANT m_coerced;
+    T m_value;
+
+    DispArg(const DispArg&) = delete;
+    DispArg& operator=(const DispArg&) = delete;
+
+public:
+    DispArg() : m_value() { VariantInit(&m_coerced); }
+    ~DispArg() { VariantClear(&m_coerced); }
+
+    HRESULT Bind(VARIANTARG* arg, LCID lcid)
+    {
+        // VB passes arguments ByRef by default, often wrapped in a VARIANT*
+        if (V_VT(arg) == (VT_VARIANT | VT_BYREF))
+        {
+            arg = V_VARIANTREF(arg);
+        }
+
+        // Fast path: the caller already passed the right type, use it in place
+        if (VariantType<T>::Accepts(V_VT(arg)))
+        {
+            m_value = VariantType<T>::Field(arg);
+            return S_OK;
+        }
+        if ((V_VT(arg) & VT_BYREF) != 0 && VariantType<T>::Accepts(V_VT(arg) & ~VT_BYREF))
+        {
+            m_value = *static_cast<T*>(V_BYREF(arg));
+            return S_OK;
+        }
+
+        // Slow path: let OLE Automation convert it, using the caller's locale
+        if (FAILED(VariantChangeTypeEx(&m_coerced, arg, lcid, 0, VariantType<T>::vt)))
+        {
+            return DISP_E_TYPEMISMATCH;
+        }
+        m_value = VariantType<T>::Field(&m_coerced);
+        return S_OK;
+    }
+
+    T Get() const { return m_value; }
+};
+
+// Holds the [out, retval] value of a call and hands it over to pVarResult.
+template <class T>
+class DispRetval
+{
+    T m_value;
+
+    DispRetval(const DispRetval&) = delete;
+    DispRetval& operator=(const DispRetval&) = delete;
+
+public:
+    DispRetval() : m_value() {}
+
+    T* Out() { return &m_value; }
+
+    void Store(VARIANT* pVarResult)
+    {
+        if (pVarResult == NULL)
+        {
+            // The caller is not interested in the result, so we must free it ourselves
+            VariantType<T>::Free(m_value);
+            return;
+        }
+        V_VT(pVarResult) = VariantType<T>::vt;
+        VariantType<T>::Field(pVarResult) = m_value;
+    }
+};
+
+// A parameter of this type is not taken from DISPPARAMS. It receives the LCID the caller
+// passed to Invoke, like an [lcid] parameter in IDL, and like [lcid] it must come right
+// after the [in] parameters.
+enum class DispLcid : LCID {};
+
+// Splits a method signature into its [in] parameters, an optional DispLcid and an optional
+// [out, retval] pointer.
+template <class... A> struct DispLastIsPointer : std::false_type {};
+
+template <class A0, class... A>
+struct DispLastIsPointer<A0, A...> : std::is_pointer<std::tuple_element_t<sizeof...(A), std::tuple<A0, A...>>> {};
+
+template <class M> struct DispMethodTraits;
+
+template <class C, class... A>
+struct DispMethodTraits<HRESULT (__stdcall C::*)(A...)>
+{
+    typedef std::tuple<A...> Params;
+
+    static constexpr size_t kParams = sizeof...(A);
+    static constexpr bool kHasRetval = DispLastIsPointer<A...>::value;
+    static constexpr bool kIsLcid[] = { std::is_same<A, DispLcid>::value..., false };
+    static constexpr bool kHasLcid = kParams > (kHasRetval ? 1 : 0) && kIsLcid[kParams - (kHasRetval ? 1 : 0) - 1];
+    static constexpr UINT kInParams = static_cast<UINT>(kParams - (kHasRetval ? 1 : 0) - (kHasLcid ? 1 : 0));
+};
+
+template <class C, class... Methods>
+class DispatchImpl
+{
+    // Finds the VARIANT holding the formal parameter 'index'. Positional arguments come
+    // last in rgvarg and in reverse order, named arguments come first.
+    static VARIANTARG* FindArg(DISPPARAMS* pDispParams, UINT index, UINT* pArgPos)
+    {
+        UINT cPositional = pDispParams->cArgs - pDispParams->cNamedArgs;
+        if (index < cPositional)
+        {
+            *pArgPos = pDispParams->cArgs - 1 - index;
+            return &pDispParams->rgvarg[*pArgPos];
+        }
+        for (UINT i = 0; i < pDispParams->cNamedArgs; ++i)
+        {
+            if (pDispParams->rgdispidNamedArgs[i] == static_cast<DISPID>(index))
+            {
+                *pArgPos = i;
+                return &pDispParams->rgvarg[i];
+            }
+        }
+        return NULL;
+    }
+
+    template <size_t I, class Arg>
+    static HRESULT BindArg(Arg& arg, DISPPARAMS* pDispParams, LCID lcid, UINT* puArgErr)
+    {
+        UINT argPos = 0;
+        VARIANTARG* pArg = FindArg(pDispParams, static_cast<UINT>(I), &argPos);
+        if (pArg == NULL)
+        {
+            return DISP_E_PARAMNOTFOUND;
+        }
+
+        HRESULT hr = arg.Bind(pArg, lcid);
+        if (FAILED(hr) && puArgErr != NULL)
+        {
+            *puArgErr = argPos;
+        }
+        return hr;
+    }
+
+    template <auto Method, size_t... I>
+    static HRESULT Call(C* self, LCID lcid, DISPPARAMS* pDispParams, VARIANT* pVarResult, UINT* puArgErr, std::index_sequence<I...>)
+    {
+        typedef DispMethodTraits<decltype(Method)> Traits;
+
+        // None of our methods has optional parameters
+        if (pDispParams->cArgs != Traits::kInParams)
+        {
+            return DISP_E_BADPARAMCOUNT;
+        }
+
+        std::tuple<DispArg<std::tuple_element_t<I, typename Traits::Params>>...> args;
+        HRESULT hr = S_OK;
+        if (!(... && SUCCEEDED(hr = BindArg<I>(std::get<I>(args), pDispParams, lcid, puArgErr))))
+        {
+            return hr;
+        }
+
+        if constexpr (Traits::kHasRetval)
+        {
+            typedef std::remove_pointer_t<std::tuple_element_t<Traits::kParams - 1, typename Traits::Params>> Retval;
+
+            DispRetval<Retval> retval;
+            if constexpr (Traits::kHasLcid)
+            {
+                hr = (self->*Method)(std::get<I>(args).Get()..., static_cast<DispLcid>(lcid), retval.Out());
+            }
+            else
+            {
+                hr = (self->*Method)(std::get<I>(args).Get()..., retval.Out());
+            }
+            if (SUCCEEDED(hr))
+            {
+                retval.Store(pVarResult);
+            }
+            return hr;
+        }
+        else if constexpr (Traits::kHasLcid)
+        {
+            return (self->*Method)(std::get<I>(args).Get()..., static_cast<DispLcid>(lcid));
+        }
+        else
+        {
+            return (self->*Method)(std::get<I>(args).Get()...);
+        }
+    }
+
+    template <class M>
+    static bool TryCall(C* self, DISPID dispIdMember, LCID lcid, DISPPARAMS* pDispParams, VARIANT* pVarResult, UINT* puArgErr, HRESULT* phr)
+    {
+        if (dispIdMember != M::id)
+        {
+            return false;
+        }
+        *phr = Call<M::method>(self, lcid, pDispParams, pVarResult, puArgErr,
+                               std::make_index_sequence<DispMethodTraits<typename M::Type>::kInParams>());
+        return true;
+    }
+
+    template <class M, size_t N>
+    static constexpr bool IsDescribed(const DispatchMember (&members)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (members[i].dispid == M::id)
+                return members[i].cParams == DispMethodTraits<typename M::Type>::kInParams;
+        }
+        return false;
+    }
+
+public:
+    // Implements IDispatch::Invoke on behalf of 'self'.
+    static HRESULT Invoke(C* self, DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams, VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr)
+    {
+        // riid is reserved and must always be IID_NULL
+        if (riid != IID_NULL)
+        {
+            return DISP_E_UNKNOWNINTERFACE;
+        }
+        if (pDispParams == NULL)
+        {
+            return E_INVALIDARG;
+        }
+
+        // We only expose methods. Script hosts may also ask for a property get when a method
+        // without arguments is used like a property (greeting = hw.SayHelloStr), which is fine.
+        if ((wFlags & (DISPATCH_METHOD | DISPATCH_PROPERTYGET)) == 0 ||
+            (wFlags & (DISPATCH_PROPERTYPUT | DISPATCH_PROPERTYPUTREF)) != 0)
+        {
+            return DISP_E_MEMBERNOTFOUND;
+        }
+
+        HRESULT hr = DISP_E_MEMBERNOTFOUND;
+        (... || TryCall<Methods>(self, dispIdMember, lcid, pDispParams, pVarResult, puArgErr, &hr));
+        return hr;
+    }
+
+    // True if the name table used by GetIDsOfNames lists exactly our methods, with matching
+    // parameter counts. Meant for a static_assert next to the two tables.
+    template <size_t N>
+    static constexpr bool Describes(const DispatchMember (&members)[N])
+    {
+        return N == sizeof...(Methods) && (... && IsDescribed<Methods>(members));
+    }
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <Windows.h>
+
+// One member of a dispatch interface, written down the way IHelloWorld.idl declares it:
+// the method name, its id(...) and the names of its parameters (in declaration order).
+// The parameter names are what script clients use for named arguments, e.g.
+// hw.SayHelloTo(name:="John Doe") in VBA.
+struct DispatchMember
+{
+    const wchar_t* name;
+    DISPID dispid;
+    const wchar_t* const* params;
+    UINT cParams;
+};
+
+namespace DispatchNames
+{
+    // IDispatch names are case-insensitive. Our member names are plain ASCII, so folding
+    // 'A'..'Z' is enough. Anything outside ASCII simply never matches.
+    constexpr wchar_t FoldCase(wchar_t c)
+    {
+        return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c - L'A' + L'a') : c;
+    }
+
+    // FNV-1a over the case-folded characters, mixed with a seed so we can search
+    // for a seed that gives every member its own slot.
+    constexpr unsigned int Hash(const wchar_t* s, unsigned int seed)
+    {
+        unsigned int h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (; *s; ++s)
+        {
+            h ^= static_cast<unsigned int>(FoldCase(*s));
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    constexpr bool EqualsNoCase(const wchar_t* a, const wchar_t* b)
+    {
+        for (; *a && *b; ++a, ++b)
+        {
+            if (FoldCase(*a) != FoldCase(*b))
+                return false;
+        }
+        return *a == *b;
+    }
+
+    // Smallest power of two that leaves the table at most half full.
+    constexpr size_t SlotCount(size_t n)
+    {
+        size_t slots = 1;
+        while (slots < 2 * n)
+            slots <<= 1;
+        return slots;
+    }
+}
+
+// A perfect-hash table from member names to DISPIDs, built entirely at compile time.
+//
+// The constructor tries seeds until every member lands in its own slot, so a lookup is
+// one hash over the name, one slot read and one case-insensitive compare to rule out
+// names that are not ours. The cost stays the same no matter how many methods the
+// interface grows. If no seed works the constructor throws, which turns into a compile
+// error because the map is always declared constexpr.
+template <size_t N>
+class DispatchNameMap
+{
+    static constexpr size_t kSlots = DispatchNames::SlotCount(N);
+    static constexpr unsigned int kMaxSeed = 4096;
+
+    const DispatchMember* m_members;
+    unsigned int m_seed;
+    unsigned char m_slots[kSlots]; // member index + 1, or 0 for an empty slot
+
+public:
+    constexpr DispatchNameMap(const DispatchMember (&members)[N]) : m_members(members), m_seed(0), m_slots{}
+    {
+        static_assert(N < 255, "DispatchNameMap stores member indexes in a byte");
+
+        for (unsigned int seed = 0; seed < kMaxSeed; ++seed)
+        {
+            for (size_t i = 0; i < kSlots; ++i)
+                m_slots[i] = 0;
+
+            bool perfect = true;
+            for (size_t i = 0; i < N && perfect; ++i)
+            {
+                size_t slot = DispatchNames::Hash(members[i].name, seed) & (kSlots - 1);
+                if (m_slots[slot] != 0)
+                    perfect = false;
+                else
+                    m_slots[slot] = static_cast<unsigned char>(i + 1);
+            }
+
+            if (perfect)
+            {
+                m_seed = seed;
+                return;
+            }
+        }
+        throw "DispatchNameMap: no perfect hash seed found";
+    }
+
+    // Returns the member with the given name, or NULL if there is none.
+    const DispatchMember* Find(const wchar_t* name) const
+    {
+        unsigned char index = m_slots[DispatchNames::Hash(name, m_seed) & (kSlots - 1)];
+        if (index == 0)
+            return NULL;
+
+        const DispatchMember* member = &m_members[index - 1];
+        return DispatchNames::EqualsNoCase(member->name, name) ? member : NULL;
+    }
+
+    // Returns the member with the given DISPID, or NULL if there is none.
+    const DispatchMember* FindById(DISPID dispid) const
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (m_members[i].dispid == dispid)
+                return &m_members[i];
+        }
+        return NULL;
+    }
+
+    // Implements IDispatch::GetIDsOfNames. The first name is the member, every other name
+    // is one of its parameters, which maps to the parameter's position in the IDL.
+    HRESULT GetIDsOfNames(LPOLESTR* rgszNames, UINT cNames, DISPID* rgDispId) const
+    {
+        if (rgszNames == NULL || rgDispId == NULL)
+            return E_POINTER;
+        if (cNames == 0)
+            return E_INVALIDARG;
+
+        const DispatchMember* member = rgszNames[0] ? Find(rgszNames[0]) : NULL;
+        if (member == NULL)
+        {
+            // We can't resolve any parameter names without knowing the member
+            for (UINT i = 0; i < cNames; ++i)
+                rgDispId[i] = DISPID_UNKNOWN;
+            return DISP_E_UNKNOWNNAME;
+        }
+
+        HRESULT hr = S_OK;
+        rgDispId[0] = member->dispid;
+        for (UINT i = 1; i < cNames; ++i)
+        {
+            rgDispId[i] = DISPID_UNKNOWN;
+            for (UINT p = 0; rgszNames[i] && p < member->cParams; ++p)
+            {
+                if (DispatchNames::EqualsNoCase(member->params[p], rgszNames[i]))
+                {
+                    rgDispId[i] = static_cast<DISPID>(p);
+                    break;
+                }
+            }
+            if (rgDispId[i] == DISPID_UNKNOWN)
+                hr = DISP_E_UNKNOWNNAME;
+        }
+        return hr;
+    }
+};
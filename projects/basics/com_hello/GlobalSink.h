@@ -0,0 +1,262 @@
+#pragma once
+#include "./midl/IHelloWorld.h"
+#include <olectl.h>
+#include <atomic>
+#include <new>
+
+EXTERN_C IMAGE_DOS_HEADER __ImageBase;
+
+// How HelloWorld holds on to an event sink, so that any thread may call it.
+//
+// A HelloWorld aggregates the free-threaded marshaler, so it greets, and fires its events,
+// on whatever thread its caller is on: MTA threads, an STA thread that got it without a
+// proxy, the greeter pool (HelloWorldGreeter.h). Queued sinks are called on pool threads,
+// by the drain callbacks of HelloWorldEventQueue.h.
+//
+// An agile sink, one that implements IAgileObject or aggregates the free-threaded
+// marshaler, may be called on any thread, and is kept as the pointer the client advised.
+// Any other sink belongs to the apartment that advised it, usually an STA, and only that
+// apartment may call it directly. It goes into the process's global interface table (GIT),
+// which gives every apartment a pointer it may call: the sink itself in its own apartment,
+// a proxy anywhere else. Nearly every thread that fires is in the MTA, so the pointer the
+// MTA gets is asked for once and kept. A thread in an STA of its own asks the GIT on every
+// call.
+//
+// The first sink registered keeps the MTA up for the rest of the process. Threads that are
+// in no apartment, like the pool threads, are then in the MTA implicitly and need not join
+// it to fire.
+//
+// IHelloWorldEvents is dual. A sink that implements it is called through its vtable. The
+// sinks of script engines only implement IDispatch, and are called through Invoke.
+//
+//     GlobalSink sink;
+//     GlobalSink::Register(pUnkSink, &sink);     // on the thread that advises
+//     sink.OnGreeted(greeting);                  // on the thread that fires
+//     sink.Revoke();                             // on any thread, once nobody fires anymore
+struct GlobalSink
+{
+    IUnknown* agile;                    // the sink, if any thread may call it
+    DWORD cookie;                       // in the GIT, if the sink belongs to an apartment
+    std::atomic<IUnknown*>* mta;        // what MTA threads call it through, once one did
+    bool dispatch;                      // registered as IDispatch, called through Invoke
+
+private:
+    // The GIT is one object per process and may be called from any apartment. The first
+    // thread that needs it creates it, and it is kept until the process exits.
+    static IGlobalInterfaceTable* Table()
+    {
+        static IGlobalInterfaceTable* volatile s_pTable = NULL;
+        IGlobalInterfaceTable* pTable = s_pTable;
+        if (pTable == NULL)
+        {
+            if (FAILED(CoCreateInstance(CLSID_StdGlobalInterfaceTable, NULL, CLSCTX_INPROC_SERVER, IID_IGlobalInterfaceTable,
+                                        reinterpret_cast<void**>(&pTable))))
+            {
+                return NULL;
+            }
+            IGlobalInterfaceTable* pOther = static_cast<IGlobalInterfaceTable*>(
+                InterlockedCompareExchangePointer(reinterpret_cast<void* volatile*>(&s_pTable), pTable, NULL));
+            if (pOther != NULL)
+            {
+                pTable->Release();
+                pTable = pOther;
+            }
+        }
+        return pTable;
+    }
+
+    // Once per process, like the GIT
+    static HRESULT KeepMta()
+    {
+        static volatile LONG s_kept = 0;
+        if (s_kept != 0)
+        {
+            return S_OK;
+        }
+        CO_MTA_USAGE_COOKIE usage;
+        HRESULT hr = CoIncrementMTAUsage(&usage);
+        if (SUCCEEDED(hr) && InterlockedCompareExchange(&s_kept, 1, 0) != 0)
+        {
+            CoDecrementMTAUsage(usage);
+        }
+        return hr;
+    }
+
+    static bool InMta()
+    {
+        APTTYPE type;
+        APTTYPEQUALIFIER qualifier;
+        return SUCCEEDED(CoGetApartmentType(&type, &qualifier)) && type == APTTYPE_MTA;
+    }
+
+    static bool IsAgile(IUnknown* pUnk)
+    {
+        IUnknown* pAgile;
+        if (SUCCEEDED(pUnk->QueryInterface(IID_IAgileObject, reinterpret_cast<void**>(&pAgile))))
+        {
+            pAgile->Release();
+            return true;
+        }
+        IMarshal* pMarshal;
+        if (FAILED(pUnk->QueryInterface(IID_IMarshal, reinterpret_cast<void**>(&pMarshal))))
+        {
+            return false;
+        }
+        CLSID clsid;
+        HRESULT hr = pMarshal->GetUnmarshalClass(IID_IUnknown, pUnk, MSHCTX_INPROC, NULL, MSHLFLAGS_NORMAL, &clsid);
+        pMarshal->Release();
+        return SUCCEEDED(hr) && clsid == CLSID_InProcFreeMarshaler;
+    }
+
+    HRESULT Call(IUnknown* pInterface, BSTR greeting) const
+    {
+        if (!dispatch)
+        {
+            return static_cast<IHelloWorldEvents*>(pInterface)->OnGreeted(greeting);
+        }
+
+        // OnGreeted is DISPID 1, see IHelloWorld.idl
+        VARIANTARG arg;
+        VariantInit(&arg);
+        V_VT(&arg) = VT_BSTR;
+        V_BSTR(&arg) = greeting;
+        DISPPARAMS params = { &arg, NULL, 1, 0 };
+        return static_cast<IDispatch*>(pInterface)->Invoke(1, IID_NULL, LOCALE_USER_DEFAULT, DISPATCH_METHOD, &params, NULL, NULL, NULL);
+    }
+
+    // A pointer from the MTA is released in the MTA
+    static void CALLBACK ReleaseInMta(PTP_CALLBACK_INSTANCE, PVOID context)
+    {
+        static_cast<IUnknown*>(context)->Release();
+    }
+
+public:
+    // Keeps a reference on the sink until it is revoked. CONNECT_E_CANNOTCONNECT if
+    // 'pUnkSink' implements neither IHelloWorldEvents nor IDispatch.
+    static HRESULT Register(IUnknown* pUnkSink, GlobalSink* pSink)
+    {
+        pSink->agile = NULL;
+        pSink->cookie = 0;
+        pSink->mta = NULL;
+        pSink->dispatch = false;
+        IUnknown* pInterface = NULL;
+        if (FAILED(pUnkSink->QueryInterface(IID_IHelloWorldEvents, reinterpret_cast<void**>(&pInterface))))
+        {
+            if (FAILED(pUnkSink->QueryInterface(IID_IDispatch, reinterpret_cast<void**>(&pInterface))))
+            {
+                return CONNECT_E_CANNOTCONNECT;
+            }
+            pSink->dispatch = true;
+        }
+
+        HRESULT hr = KeepMta();
+        if (SUCCEEDED(hr) && IsAgile(pUnkSink))
+        {
+            pSink->agile = pInterface;
+            return S_OK;
+        }
+
+        IGlobalInterfaceTable* pTable = Table();
+        pSink->mta = new (std::nothrow) std::atomic<IUnknown*>(NULL);
+        if (SUCCEEDED(hr) && (pTable == NULL || pSink->mta == NULL))
+        {
+            hr = E_OUTOFMEMORY;
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = pTable->RegisterInterfaceInGlobal(pInterface, pSink->dispatch ? IID_IDispatch : IID_IHelloWorldEvents, &pSink->cookie);
+        }
+        if (FAILED(hr))
+        {
+            delete pSink->mta;
+            pSink->mta = NULL;
+        }
+        pInterface->Release();
+        return hr;
+    }
+
+    bool Registered() const
+    {
+        return agile != NULL || cookie != 0;
+    }
+
+    // Fails if the sink can't be reached from here anymore, e.g. because its apartment is
+    // gone
+    HRESULT OnGreeted(BSTR greeting) const
+    {
+        if (agile != NULL)
+        {
+            return Call(agile, greeting);
+        }
+
+        IGlobalInterfaceTable* pTable = Table();
+        if (pTable == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        const IID& riid = dispatch ? IID_IDispatch : IID_IHelloWorldEvents;
+        IUnknown* pInterface;
+        HRESULT hr;
+        if (!InMta())
+        {
+            hr = pTable->GetInterfaceFromGlobal(cookie, riid, reinterpret_cast<void**>(&pInterface));
+            if (SUCCEEDED(hr))
+            {
+                hr = Call(pInterface, greeting);
+                pInterface->Release();
+            }
+            return hr;
+        }
+
+        // The first MTA thread to get here asks the GIT for everyone
+        pInterface = mta->load(std::memory_order_acquire);
+        if (pInterface == NULL)
+        {
+            hr = pTable->GetInterfaceFromGlobal(cookie, riid, reinterpret_cast<void**>(&pInterface));
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+            IUnknown* pOther = NULL;
+            if (!mta->compare_exchange_strong(pOther, pInterface, std::memory_order_acq_rel))
+            {
+                pInterface->Release();
+                pInterface = pOther;
+            }
+        }
+        return Call(pInterface, greeting);
+    }
+
+    void Revoke() const
+    {
+        if (agile != NULL)
+        {
+            agile->Release();
+            return;
+        }
+
+        IUnknown* pInterface = (mta != NULL) ? mta->exchange(NULL) : NULL;
+        delete mta;
+        if (pInterface != NULL && !InMta())
+        {
+            // The pool keeps the module loaded until the callback has returned
+            TP_CALLBACK_ENVIRON environment;
+            InitializeThreadpoolEnvironment(&environment);
+            SetThreadpoolCallbackLibrary(&environment, &__ImageBase);
+            if (TrySubmitThreadpoolCallback(ReleaseInMta, pInterface, &environment))
+            {
+                pInterface = NULL;
+            }
+            DestroyThreadpoolEnvironment(&environment);
+        }
+        if (pInterface != NULL)
+        {
+            pInterface->Release();
+        }
+        IGlobalInterfaceTable* pTable = Table();
+        if (pTable != NULL)
+        {
+            pTable->RevokeInterfaceFromGlobal(cookie);
+        }
+    }
+};
@@ -0,0 +1,78 @@
+#include "GreetingFormatter.h"
+#include "BstrAlloc.h"
+
+struct GreetingTemplate
+{
+    WORD language;          // primary language, e.g. LANG_GERMAN
+    const OLECHAR* prefix;  // text before the name
+    UINT cchPrefix;
+    const OLECHAR* suffix;  // text after the name
+    UINT cchSuffix;
+};
+
+template <UINT P, UINT S>
+constexpr GreetingTemplate MakeTemplate(WORD language, const OLECHAR (&prefix)[P], const OLECHAR (&suffix)[S])
+{
+    return { language, prefix, P - 1, suffix, S - 1 };
+}
+
+// The first entry is the fallback for any language not listed here
+static constexpr GreetingTemplate s_templates[] =
+{
+    MakeTemplate(LANG_ENGLISH,    L"Hello, ",           L"!\n"),
+    MakeTemplate(LANG_GERMAN,     L"Hallo, ",           L"!\n"),
+    MakeTemplate(LANG_FRENCH,     L"Bonjour, ",         L" !\n"),
+    MakeTemplate(LANG_SPANISH,    L"\u00A1Hola, ",      L"!\n"),
+    MakeTemplate(LANG_ITALIAN,    L"Ciao, ",            L"!\n"),
+    MakeTemplate(LANG_PORTUGUESE, L"Ol\u00E1, ",        L"!\n"),
+    MakeTemplate(LANG_DUTCH,      L"Hallo, ",           L"!\n"),
+    MakeTemplate(LANG_POLISH,     L"Cze\u015B\u0107, ", L"!\n"),
+};
+
+// Primary language ids are 10 bits wide, so a direct index into the template table
+// fits in 1 KB and costs a single load
+struct GreetingIndex
+{
+    unsigned char slots[0x400];
+
+    constexpr GreetingIndex() : slots{}
+    {
+        for (UINT i = 0; i < ARRAYSIZE(s_templates); ++i)
+        {
+            slots[s_templates[i].language] = static_cast<unsigned char>(i);
+        }
+    }
+};
+
+static constexpr GreetingIndex s_index;
+
+static const GreetingTemplate& TemplateFor(LCID lcid)
+{
+    // Turn LOCALE_USER_DEFAULT and friends into the actual locale first
+    if (lcid == LOCALE_USER_DEFAULT || lcid == LOCALE_SYSTEM_DEFAULT || lcid == LOCALE_NEUTRAL)
+    {
+        lcid = ConvertDefaultLocale(lcid);
+    }
+    return s_templates[s_index.slots[PRIMARYLANGID(LANGIDFROMLCID(lcid))]];
+}
+
+BSTR FormatGreeting(LCID lcid, const OLECHAR* name, UINT cchName)
+{
+    const GreetingTemplate& t = TemplateFor(lcid);
+
+    // Reserve the exact length once, then copy the parts straight into place
+    BSTR greeting = BstrAllocLen(NULL, t.cchPrefix + cchName + t.cchSuffix);
+    if (greeting != NULL)
+    {
+        OLECHAR* p = greeting;
+        memcpy(p, t.prefix, t.cchPrefix * sizeof(OLECHAR));
+        p += t.cchPrefix;
+        if (cchName > 0)
+        {
+            memcpy(p, name, cchName * sizeof(OLECHAR));
+            p += cchName;
+        }
+        memcpy(p, t.suffix, t.cchSuffix * sizeof(OLECHAR));
+    }
+    return greeting;
+}
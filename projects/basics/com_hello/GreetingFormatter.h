@@ -0,0 +1,13 @@
+#pragma once
+#include <Windows.h>
+
+// Builds "Hello, <name>!" in the language of a locale.
+//
+// Every language has a template that is split into the text before and after the name.
+// The templates and their lengths are fixed at compile time, so formatting a greeting is:
+// look up the template by language, compute the exact length, allocate one BSTR and copy
+// the three parts into it. There are no temporary strings, whatever the language.
+//
+// Languages without a template of their own get the English greeting, and so does
+// LOCALE_INVARIANT: that is the neutral greeting, for callers that have no locale.
+BSTR FormatGreeting(LCID lcid, const OLECHAR* name, UINT cchName);
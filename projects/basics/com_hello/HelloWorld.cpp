@@ -1,30 +1,266 @@
 #include "HelloWorld.h"
+#include "DispatchImpl.h"
+#include "BstrAlloc.h"
+#include "GreetingFormatter.h"
+#include "ObjectPool.h"
+#include "ModuleLock.h"
+#include "ModuleAccounting.h"
+#include "InterfaceMap.h"
+#include "TypeInfo.h"
+#include "HelloWorldGreeter.h"
+#include "HelloWorldEvents.h"
+#include "HelloWorldStats.h"
+#include "gen/IHelloWorld_dispatch.h"
+#include <olectl.h>
 #include <iostream>
-#include <string>
 
-// Constructor to initialize the reference count
-HelloWorld::HelloWorld() : m_cRef(1) {}
+// The late-bound view of IHelloWorld is generated from IHelloWorld.idl by idlgen
+static constexpr DispatchNameMap s_dispatchNames(IHelloWorld_DispatchMembers);
+
+// The methods Invoke can call, by DISPID. The greetings go to the *InLocale variants,
+// so a late-bound caller gets them in the language of the LCID it passes to Invoke.
+// None of them counts the call, Invoke does.
+typedef DispatchImpl<HelloWorld,
+    DispMethod<&HelloWorld::SayHelloUntimed,        1>,
+    DispMethod<&HelloWorld::SayHelloStrUntimed,     2>,
+    DispMethod<&HelloWorld::SayHelloToInLocale,     3>,
+    DispMethod<&HelloWorld::SayHelloToManyInLocale, 4>> HelloWorldDispatch;
+
+// Invoke counts a call under the HelloWorldMethod of its DISPID less one
+static_assert(HelloWorldMethodSayHello == 0 && HelloWorldMethodSayHelloStr == 1 &&
+              HelloWorldMethodSayHelloTo == 2 && HelloWorldMethodSayHelloToMany == 3,
+              "HelloWorldMethod is out of sync with the DISPIDs");
+
+static_assert(HelloWorldDispatch::Describes(IHelloWorld_DispatchMembers), "IHelloWorld.idl is out of sync with HelloWorldDispatch");
+
+// The interfaces QueryInterface hands out. IHelloWorld is a dual interface, so it also
+// serves as IDispatch and as the object's IUnknown. All but IUnknown are in
+// HelloWorld::s_interfaces too.
+typedef InterfaceMap<HelloWorld,
+    InterfaceEntry<IHelloWorld, &IID_IUnknown>,
+    InterfaceEntry<IHelloWorld, &IID_IHelloWorld>,
+    InterfaceEntry<IHelloWorld, &IID_IDispatch>> HelloWorldInterfaces;
+
+// IDispatch shares the vtable of the dual IHelloWorld, so late binding costs an object no
+// bytes at all: one vtable pointer, the reference count, the marshaler pointer and the
+// connection point pointer. Moving IDispatch into a tear-off would add a pointer to the
+// tear-off, not save one.
+#ifndef HELLOWORLD_BIASED_REFCOUNT
+static_assert(sizeof(HelloWorld) <= 4 * sizeof(void*), "HelloWorld has grown, mind the per-object footprint");
+#endif
+
+// Clients that create and release objects at a high rate can set HELLOWORLD_POOL to the
+// number of freed instances the server may keep for reuse. Only the memory is reused, the
+// constructor below still initializes every new instance from scratch.
+struct HelloWorldPoolTag
+{
+    static constexpr const wchar_t* setting = L"HELLOWORLD_POOL";
+};
+typedef ObjectPool<HelloWorldPoolTag, sizeof(HelloWorld)> HelloWorldPool;
+
+// Constructor to initialize the reference count. Every live object keeps the DLL loaded.
+#ifdef HELLOWORLD_BIASED_REFCOUNT
+HelloWorld::HelloWorld() : m_refCount(&HelloWorld::Destroy, this), m_pUnkMarshaler(NULL), m_pEvents(NULL)
+#else
+HelloWorld::HelloWorld() : m_cRef(1), m_pUnkMarshaler(NULL), m_pEvents(NULL)
+#endif
+{
+    ModuleLock();
+    ModuleObjectCreated(ModuleObjectHelloWorld, this, sizeof(HelloWorld));
+}
+
+HelloWorld::~HelloWorld()
+{
+    if (m_pUnkMarshaler != NULL)
+    {
+        m_pUnkMarshaler->Release();
+    }
+    delete m_pEvents;
+    ModuleObjectDestroyed(ModuleObjectHelloWorld, this, sizeof(HelloWorld));
+    ModuleUnlock();
+}
+
+// noexcept, so that 'new HelloWorld' yields NULL when out of memory, as the factory expects
+void* HelloWorld::operator new(size_t size) noexcept
+{
+    return HelloWorldPool::Allocate(size);
+}
+
+void HelloWorld::operator delete(void* p) noexcept
+{
+    HelloWorldPool::Free(p);
+}
+
+void HelloWorld::GetPoolStats(ObjectPoolStats* stats)
+{
+    HelloWorldPool::GetStats(stats);
+}
+
+// Frees the instances the pool keeps for reuse, when the DLL is unloaded
+void HelloWorld::DrainPool()
+{
+    HelloWorldPool::Drain();
+}
+
+static bool Published(const IID& riid)
+{
+    ClassObjectKey key = ClassObjectKey::FromGuid(riid);
+    for (const ClassObjectKey& published : HelloWorld::s_interfaces)
+    {
+        if (published == key)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
 // QueryInterface allows a client to obtain pointers to other interfaces on a given object
 HRESULT __stdcall HelloWorld::QueryInterface(const IID& riid, void** ppv)
 {
-    // If the requested interface is IUnknown, IDispatch, or IHelloWorld
-    // we increment the ref count and return a pointer to it
-    if (riid == IID_IUnknown || riid == IID_IDispatch || riid == IID_IHelloWorld)
+    // IUnknown, IDispatch and IHelloWorld come from the interface map, see InterfaceMap.h
+    HRESULT hr = HelloWorldInterfaces::QueryInterface(this, riid, ppv);
+    if (hr != E_NOINTERFACE)
     {
-        *ppv = static_cast<IHelloWorld*>(this);
+        return hr;
     }
-    else
+
+    // The tear-offs and the connection point only if the class manifest lists them, see
+    // s_interfaces. The map above already said no to everything else.
+    if (riid != IID_IMarshal && !Published(riid))
+    {
+        return hr;
+    }
+
+    // IHelloWorldGreeter and its asynchronous calls live on a tear-off, see HelloWorldGreeter.h
+    if (riid == IID_IHelloWorldGreeter || riid == IID_ICallFactory)
+    {
+        return HelloWorldGreeter::Create(this, riid, ppv);
+    }
+
+    // The call statistics, on a tear-off of their own, see HelloWorldStats.h
+    if (riid == IID_IHelloWorldStats)
+    {
+        return HelloWorldStats::Create(this, riid, ppv);
+    }
+
+    // IHelloWorldEvents go out through a connection point, see HelloWorldEvents.h
+    if (riid == IID_IConnectionPointContainer)
+    {
+        HelloWorldEvents* pEvents = GetEvents();
+        if (pEvents == NULL)
+        {
+            *ppv = NULL;
+            return E_OUTOFMEMORY;
+        }
+        *ppv = pEvents->GetContainer();
+        AddRef();
+        return S_OK;
+    }
+    if (riid != IID_IMarshal)
+    {
+        return hr;
+    }
+
+    // HelloWorld is registered as ThreadingModel=Both. Its state is the reference count,
+    // the lazily created marshaler and connection point, published with interlocked
+    // exchanges, and the sinks, which the connection point keeps in the global interface
+    // table rather than as raw pointers (see GlobalSink.h). So any thread may call it
+    // directly, and the free-threaded marshaler hands out the raw pointer to other
+    // apartments in this process instead of a proxy.
+    IUnknown* pUnkMarshaler = GetMarshaler();
+    if (pUnkMarshaler == NULL)
     {
-        // If the requested interface does not exist, return an error
-        *ppv = NULL;
         return E_NOINTERFACE;
     }
-    // Increment the reference count before the pointer is returned
-    reinterpret_cast<IUnknown*>(*ppv)->AddRef();
-    return S_OK;
+    return pUnkMarshaler->QueryInterface(riid, ppv);
+}
+
+// Reads a pointer that another thread may have just published with
+// InterlockedCompareExchangePointer. The acquire makes the object behind it visible too,
+// which a plain read doesn't promise on ARM64.
+template <class T>
+static T* ReadPublished(T* const& pointer)
+{
+    return static_cast<T*>(ReadPointerAcquire(reinterpret_cast<void* const*>(&pointer)));
+}
+
+// Aggregates the free-threaded marshaler the first time someone asks for it. Objects that
+// are never marshaled don't pay for it. Threads racing here may each create one, only the
+// first one is kept.
+IUnknown* HelloWorld::GetMarshaler()
+{
+    IUnknown* pUnkMarshaler = ReadPublished(m_pUnkMarshaler);
+    if (pUnkMarshaler == NULL)
+    {
+        if (FAILED(CoCreateFreeThreadedMarshaler(static_cast<IHelloWorld*>(this), &pUnkMarshaler)))
+        {
+            return NULL;
+        }
+        IUnknown* pOther = static_cast<IUnknown*>(
+            InterlockedCompareExchangePointer(reinterpret_cast<void**>(&m_pUnkMarshaler), pUnkMarshaler, NULL));
+        if (pOther != NULL)
+        {
+            pUnkMarshaler->Release();
+            pUnkMarshaler = pOther;
+        }
+    }
+    return pUnkMarshaler;
+}
+
+HRESULT HelloWorld::GetEventQueueStats(DWORD dwCookie, HelloWorldEventQueueStats* stats)
+{
+    HelloWorldEvents* pEvents = ReadPublished(m_pEvents);
+    if (pEvents == NULL)
+    {
+        return CONNECT_E_NOCONNECTION;
+    }
+    return pEvents->GetQueueStats(dwCookie, stats);
+}
+
+// Creates the connection point the first time a client looks for it, the same way
+// GetMarshaler creates the marshaler
+HelloWorldEvents* HelloWorld::GetEvents()
+{
+    HelloWorldEvents* pEvents = ReadPublished(m_pEvents);
+    if (pEvents == NULL)
+    {
+        pEvents = new (std::nothrow) HelloWorldEvents(this);
+        if (pEvents == NULL)
+        {
+            return NULL;
+        }
+        HelloWorldEvents* pOther = static_cast<HelloWorldEvents*>(
+            InterlockedCompareExchangePointer(reinterpret_cast<void**>(&m_pEvents), pEvents, NULL));
+        if (pOther != NULL)
+        {
+            delete pEvents;
+            pEvents = pOther;
+        }
+    }
+    return pEvents;
+}
+
+#ifdef HELLOWORLD_BIASED_REFCOUNT
+// Objects that are heavily shared between threads can be built with
+// /DHELLOWORLD_BIASED_REFCOUNT. The creating thread then counts its references without
+// interlocked instructions, see BiasedRefCount.h.
+ULONG __stdcall HelloWorld::AddRef()
+{
+    return m_refCount.AddRef();
 }
 
+ULONG __stdcall HelloWorld::Release()
+{
+    return m_refCount.Release();
+}
+
+// Called by m_refCount when the last reference is gone
+void HelloWorld::Destroy(void* self)
+{
+    delete static_cast<HelloWorld*>(self);
+}
+#else
 // AddRef method increments the reference count for an object
 ULONG __stdcall HelloWorld::AddRef()
 {
@@ -37,143 +273,240 @@ ULONG __stdcall HelloWorld::Release()
 {
     // Use interlocked decrement for thread safety
     ULONG ulRefCount = InterlockedDecrement(&m_cRef);
-    // If reference count is 0, delete the object
-    if (0 == m_cRef)
+    // If reference count is 0, delete the object. Only the value returned by the
+    // decrement can tell, m_cRef may already have been changed by another thread.
+    if (0 == ulRefCount)
     {
         delete this;
     }
     return ulRefCount;
 }
+#endif
 
 // GetTypeInfoCount method retrieves the number of type information interfaces that an object provides
 HRESULT __stdcall HelloWorld::GetTypeInfoCount(UINT* pctinfo)
 {
-    // We're not providing any type info, so set the count to 0
-    *pctinfo = 0;
+    // The type information of IHelloWorld comes from the type library in the DLL
+    if (pctinfo == NULL)
+    {
+        return E_POINTER;
+    }
+    *pctinfo = 1;
     return S_OK;
 }
 
 // GetTypeInfo retrieves the type information for an object
 HRESULT __stdcall HelloWorld::GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo)
 {
-    // We're not providing any type info, so set the out parameter to NULL and return an error
-    *ppTInfo = NULL;
-    return DISP_E_BADINDEX;
+    // There is only one type info, for IHelloWorld. It is loaded once and cached, so hosts
+    // can bind to the methods once instead of calling GetIDsOfNames for every call.
+    // The type info is the same for all locales.
+    if (iTInfo != 0)
+    {
+        if (ppTInfo != NULL)
+        {
+            *ppTInfo = NULL;
+        }
+        return DISP_E_BADINDEX;
+    }
+    return GetHelloWorldTypeInfo(ppTInfo);
 }
 
 // GetIDsOfNames method maps a set of names to a corresponding set of dispatch identifiers
 HRESULT __stdcall HelloWorld::GetIDsOfNames(REFIID riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId)
 {
-    // Map the method names to dispatch IDs
-    // If the name matches, set the ID and return S_OK
-    if (_wcsicmp(*rgszNames, L"SayHello") == 0)
-    {
-        *rgDispId = 1;
-        return S_OK;
-    }
-    else if (_wcsicmp(*rgszNames, L"SayHelloStr") == 0)
+    // riid is reserved and must always be IID_NULL
+    if (riid != IID_NULL)
     {
-        *rgDispId = 2;
-        return S_OK;
-    }
-    else if (_wcsicmp(*rgszNames, L"SayHelloTo") == 0)
-    {
-        *rgDispId = 3;
-        return S_OK;
-    }
-    else
-    {
-        // If the name does not match, set the ID to unknown and return an error
-        *rgDispId = DISPID_UNKNOWN;
-        return DISP_E_UNKNOWNNAME;
+        return DISP_E_UNKNOWNINTERFACE;
     }
+
+    // The first name is the method, any further names are its named arguments.
+    // The lookup is a compile-time perfect hash, see DispatchNames.h
+    return s_dispatchNames.GetIDsOfNames(rgszNames, cNames, rgDispId);
 }
 
 // Invoke provides access to properties and methods exposed by an object
 HRESULT __stdcall HelloWorld::Invoke(DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams, VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr)
 {
-    // Dispatch the call to the correct method based on the dispatch ID
-    switch (dispIdMember)
+    // The dispatch engine finds the method by its DISPID, unpacks DISPPARAMS into typed
+    // arguments and calls it directly, see DispatchImpl.h. The time that takes counts
+    // towards the method's dispatch calls.
+    if (dispIdMember < 1 || dispIdMember > static_cast<DISPID>(kHelloWorldMethodCount))
     {
-        case 1: // SayHello
-        {
-            return SayHello();
-        }
-        case 2: // SayHelloStr
-        {
-            BSTR greeting;
-            HRESULT hr = SayHelloStr(&greeting);
+        return HelloWorldDispatch::Invoke(this, dispIdMember, riid, lcid, wFlags, pDispParams, pVarResult, pExcepInfo, puArgErr);
+    }
+    HelloWorldCallTimer timer(static_cast<HelloWorldMethod>(dispIdMember - 1), HelloWorldCallDispatch);
+    return timer.Done(HelloWorldDispatch::Invoke(this, dispIdMember, riid, lcid, wFlags, pDispParams, pVarResult, pExcepInfo, puArgErr));
+}
 
-            // If successful, store the return value
-            if (SUCCEEDED(hr))
-            {
-                pVarResult->vt = VT_BSTR;
-                pVarResult->bstrVal = greeting;
-            }
+HRESULT __stdcall HelloWorld::SayHello()
+{
+    HelloWorldCallTimer timer(HelloWorldMethodSayHello, HelloWorldCallVtable);
+    return timer.Done(SayHelloUntimed());
+}
 
-            return hr;
-        }
-        case 3: // SayHelloTo
-        {
-            // Check for correct number and type of arguments
-            if (pDispParams->cArgs != 1 || pDispParams->rgvarg[0].vt != VT_BSTR)
-                return DISP_E_TYPEMISMATCH;
+HRESULT __stdcall HelloWorld::SayHelloUntimed()
+{
+    // One write for the whole line, so greetings from concurrent callers don't interleave
+    static const char helloWorld[] = "Hello, World!\n";
+    std::cout.write(helloWorld, sizeof(helloWorld) - 1);
+    return S_OK;
+}
 
-            BSTR greeting;
-            HRESULT hr = SayHelloTo(pDispParams->rgvarg[0].bstrVal, &greeting);
+HRESULT __stdcall HelloWorld::SayHelloStr(BSTR* greeting)
+{
+    HelloWorldCallTimer timer(HelloWorldMethodSayHelloStr, HelloWorldCallVtable);
+    return timer.Done(SayHelloStrUntimed(greeting));
+}
 
-            // If successful, store the return value
-            if (SUCCEEDED(hr))
-            {
-                pVarResult->vt = VT_BSTR;
-                pVarResult->bstrVal = greeting;
-            }
+HRESULT __stdcall HelloWorld::SayHelloStrUntimed(BSTR* greeting)
+{
+    // The length of the literal is known at compile time, no need to scan it on every call
+    static const OLECHAR helloWorld[] = L"Hello, World!\n";
 
-            return hr;
-        }
-        default: // Unknown dispatch ID
-        {
-            return DISP_E_MEMBERNOTFOUND;
-        }
+    *greeting = BstrAllocLiteral(helloWorld);
+    if (*greeting == NULL)
+    {
+        return E_OUTOFMEMORY;
     }
+    return S_OK;
 }
 
-HRESULT __stdcall HelloWorld::SayHello()
+HRESULT __stdcall HelloWorld::SayHelloTo(BSTR name, BSTR* greeting)
 {
-    std::cout << "Hello, World!\n";
-    return S_OK;
+    // A vtable call has no LCID, so it gets the neutral greeting whatever the thread's
+    // locale. Only a late-bound caller picks one.
+    HelloWorldCallTimer timer(HelloWorldMethodSayHelloTo, HelloWorldCallVtable);
+    return timer.Done(SayHelloToInLocale(name, static_cast<DispLcid>(LOCALE_INVARIANT), greeting));
 }
 
-HRESULT __stdcall HelloWorld::SayHelloStr(BSTR* greeting)
+HRESULT __stdcall HelloWorld::SayHelloToInLocale(BSTR name, DispLcid lcid, BSTR* greeting)
 {
-    *greeting = SysAllocString(L"Hello, World!\n");
+    // One allocation for the whole greeting, see GreetingFormatter.h.
+    // A NULL BSTR is a valid empty string.
+    *greeting = FormatGreeting(static_cast<LCID>(lcid), name, SysStringLen(name));
     if (*greeting == NULL)
     {
         return E_OUTOFMEMORY;
     }
+
+    // Nobody ever connected to most objects, they don't even have a connection point
+    HelloWorldEvents* pEvents = ReadPublished(m_pEvents);
+    if (pEvents != NULL)
+    {
+        pEvents->FireOnGreeted(*greeting);
+    }
     return S_OK;
 }
 
-HRESULT __stdcall HelloWorld::SayHelloTo(BSTR name, BSTR* greeting)
+// Greets a whole array of names in one call, so a client that needs many greetings
+// pays for the call (and, late-bound, for the IDispatch lookup) only once
+HRESULT __stdcall HelloWorld::SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings)
+{
+    HelloWorldCallTimer timer(HelloWorldMethodSayHelloToMany, HelloWorldCallVtable);
+    return timer.Done(SayHelloToManyInLocale(names, static_cast<DispLcid>(LOCALE_INVARIANT), greetings));
+}
+
+HRESULT __stdcall HelloWorld::SayHelloToManyInLocale(SAFEARRAY* names, DispLcid lcid, SAFEARRAY** greetings)
 {
-    try
+    if (greetings == NULL)
+    {
+        return E_POINTER;
+    }
+    *greetings = NULL;
+
+    if (names == NULL || SafeArrayGetDim(names) != 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Early-bound clients pass SAFEARRAY(BSTR), script clients usually pass an array of VARIANTs
+    VARTYPE vt;
+    HRESULT hr = SafeArrayGetVartype(names, &vt);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    if (vt != VT_BSTR && vt != VT_VARIANT)
+    {
+        return DISP_E_TYPEMISMATCH;
+    }
+
+    LCID locale = static_cast<LCID>(lcid);
+    LONG lBound, uBound;
+    SafeArrayGetLBound(names, 1, &lBound);
+    SafeArrayGetUBound(names, 1, &uBound);
+    ULONG count = (uBound >= lBound) ? static_cast<ULONG>(uBound - lBound + 1) : 0;
+
+    // The result array is created once, with a slot for every greeting
+    SAFEARRAY* result = SafeArrayCreateVector(VT_BSTR, 0, count);
+    if (result == NULL)
     {
-        // Prepare the greeting
-        std::wstring nameWStr(name);
-        std::wstring greetingWStr = L"Hello, " + nameWStr + L"!\n";
+        return E_OUTOFMEMORY;
+    }
 
-        // Allocate a BSTR for the greeting
-        *greeting = SysAllocStringLen(greetingWStr.c_str(), greetingWStr.length());
+    void* pNames;
+    BSTR* pGreetings;
+    hr = SafeArrayAccessData(names, &pNames);
+    if (FAILED(hr))
+    {
+        SafeArrayDestroy(result);
+        return hr;
+    }
+    hr = SafeArrayAccessData(result, reinterpret_cast<void**>(&pGreetings));
+    if (FAILED(hr))
+    {
+        SafeArrayUnaccessData(names);
+        SafeArrayDestroy(result);
+        return hr;
+    }
 
-        if (*greeting == NULL)
+    for (ULONG i = 0; i < count && SUCCEEDED(hr); ++i)
+    {
+        if (vt == VT_BSTR)
         {
-            return E_OUTOFMEMORY;
+            BSTR name = static_cast<BSTR*>(pNames)[i];
+            pGreetings[i] = FormatGreeting(locale, name, SysStringLen(name));
+        }
+        else
+        {
+            VARIANT* pName = &static_cast<VARIANT*>(pNames)[i];
+            if (V_VT(pName) == VT_BSTR)
+            {
+                pGreetings[i] = FormatGreeting(locale, V_BSTR(pName), SysStringLen(V_BSTR(pName)));
+            }
+            else
+            {
+                // Only non-string elements need a conversion
+                VARIANT name;
+                VariantInit(&name);
+                hr = VariantChangeTypeEx(&name, pName, locale, 0, VT_BSTR);
+                if (FAILED(hr))
+                {
+                    break;
+                }
+                pGreetings[i] = FormatGreeting(locale, V_BSTR(&name), SysStringLen(V_BSTR(&name)));
+                VariantClear(&name);
+            }
         }
 
-        return S_OK;
+        if (pGreetings[i] == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+        }
     }
-    catch(...)
+
+    SafeArrayUnaccessData(result);
+    SafeArrayUnaccessData(names);
+
+    if (FAILED(hr))
     {
-        return E_FAIL;
+        // Destroying the array also frees the greetings we managed to allocate
+        SafeArrayDestroy(result);
+        return hr;
     }
+
+    *greetings = result;
+    return S_OK;
 }
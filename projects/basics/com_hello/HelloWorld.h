@@ -1,12 +1,53 @@
 #pragma once
 #include "./midl/IHelloWorld.h"
+#include "DispatchImpl.h"
+#include "ClassObjectTable.h"
+#ifdef HELLOWORLD_BIASED_REFCOUNT
+#include "BiasedRefCount.h"
+#endif
+
+struct ObjectPoolStats;
+struct HelloWorldEventQueueStats;
+class HelloWorldEvents;
 
 class HelloWorld : public IHelloWorld
 {
+#ifdef HELLOWORLD_BIASED_REFCOUNT
+    BiasedRefCount m_refCount;  // see BiasedRefCount.h
+    static void Destroy(void* self);
+#else
     long m_cRef;
+#endif
+    IUnknown* m_pUnkMarshaler; // free-threaded marshaler, created on first QueryInterface(IID_IMarshal)
+    HelloWorldEvents* m_pEvents; // connection point, created on first QueryInterface(IID_IConnectionPointContainer)
+
+    IUnknown* GetMarshaler();
+    HelloWorldEvents* GetEvents();
 
 public:
     HelloWorld();
+    ~HelloWorld();
+
+    // Instances may be recycled by a pool, see HelloWorld.cpp
+    static void* operator new(size_t size) noexcept;
+    static void operator delete(void* p) noexcept;
+    static void GetPoolStats(ObjectPoolStats* stats);
+    static void DrainPool();
+
+    // How far behind the event queue of a sink is, see HelloWorldEventQueue.h
+    HRESULT GetEventQueueStats(DWORD dwCookie, HelloWorldEventQueueStats* stats);
+
+    // What QueryInterface answers besides IUnknown and IMarshal, which the class manifest
+    // publishes (see HelloWorldDll.cpp). QueryInterface hands out nothing else, so an
+    // interface that isn't added here fails right away instead of going unpublished.
+    static constexpr ClassObjectKey s_interfaces[] = {
+        ClassObjectKey::Parse(L"{A851A7FE-4903-48AF-A694-51FEB755EE5B}"),     // IHelloWorld
+        ClassObjectKey::Parse(L"{00020400-0000-0000-C000-000000000046}"),     // IDispatch
+        ClassObjectKey::Parse(L"{4CD5B843-3199-4831-BAF3-F1C4015E21E4}"),     // IHelloWorldGreeter
+        ClassObjectKey::Parse(L"{1C733A30-2A1C-11CE-ADE5-00AA0044773D}"),     // ICallFactory
+        ClassObjectKey::Parse(L"{7D895865-CB86-4EC7-BE8F-9179CC1CAC93}"),     // IHelloWorldStats
+        ClassObjectKey::Parse(L"{B196B284-BAB4-101A-B69C-00AA00341D07}"),     // IConnectionPointContainer
+    };
 
     // IUnknown methods
     HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
@@ -23,4 +64,16 @@ public:
     HRESULT __stdcall SayHello();
     HRESULT __stdcall SayHelloStr(BSTR* greeting);
     HRESULT __stdcall SayHelloTo(BSTR name, BSTR* greeting);
+    HRESULT __stdcall SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings);
+
+    // The same greetings in the language of a given locale. Invoke calls these with the
+    // LCID of the late-bound caller, the vtable methods above use LOCALE_INVARIANT, which
+    // gets the neutral greeting.
+    HRESULT __stdcall SayHelloToInLocale(BSTR name, DispLcid lcid, BSTR* greeting);
+    HRESULT __stdcall SayHelloToManyInLocale(SAFEARRAY* names, DispLcid lcid, SAFEARRAY** greetings);
+
+    // What SayHello and SayHelloStr do. The IHelloWorld methods count their calls as vtable
+    // calls, Invoke counts its own as dispatch calls and then calls these, see HelloWorldStats.h.
+    HRESULT __stdcall SayHelloUntimed();
+    HRESULT __stdcall SayHelloStrUntimed(BSTR* greeting);
 };
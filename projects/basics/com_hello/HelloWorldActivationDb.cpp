@@ -0,0 +1,72 @@
+#include "ActivationDb.h"
+#include "ClassManifest.h"
+#include <iostream>
+
+// Writes the activation database, see ActivationDb.h. Run by compile.ps1 after the DLL is
+// linked:
+//
+//     HelloWorldActivationDb <database> <module> [<module> ...]
+//
+// The classes come from the manifests of the modules, see ClassManifest.h. Module paths
+// are stored in full, the way DllRegisterServer stores its own.
+int wmain(int argc, wchar_t** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: HelloWorldActivationDb <database> <module> [<module> ...]\n";
+        return 1;
+    }
+
+    int moduleCount = argc - 2;
+    WCHAR (*modules)[MAX_PATH] = new WCHAR[moduleCount][MAX_PATH];
+    ActivationDbWriter writer;
+    HRESULT hr = S_OK;
+    for (int i = 0; i < moduleCount && SUCCEEDED(hr); ++i)
+    {
+        const wchar_t* arg = argv[2 + i];
+        const ClassManifest* manifest = NULL;
+        HMODULE module = NULL;
+        if (GetFullPathNameW(arg, MAX_PATH, modules[i], NULL) - 1 >= MAX_PATH - 1)
+        {
+            std::wcerr << L"Bad module path: " << arg << L"\n";
+            hr = E_INVALIDARG;
+            break;
+        }
+        module = LoadLibraryExW(modules[i], NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+        ClassManifestGetter getManifest = (module != NULL) ? reinterpret_cast<ClassManifestGetter>(GetProcAddress(module, "DllGetClassManifest")) : NULL;
+        hr = (getManifest != NULL) ? getManifest(&manifest) : HRESULT_FROM_WIN32(GetLastError());
+        if (SUCCEEDED(hr) && manifest->version != kClassManifestVersion)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+        }
+        if (FAILED(hr))
+        {
+            std::wcerr << L"Failed to read the manifest of " << arg << L". Error code = " << hr << L"\n";
+            break;
+        }
+
+        // The module stays loaded, the writer keeps pointers to its strings
+        for (UINT32 j = 0; j < manifest->classCount && SUCCEEDED(hr); ++j)
+        {
+            const ClassManifestClass& c = manifest->classes[j];
+            CLSID clsid;
+            memcpy(&clsid, &c.clsid, sizeof(clsid));
+            hr = writer.Add(clsid, c.progId, modules[i], "DllGetClassObject", static_cast<ActivationDbThreading>(c.threading));
+            if (FAILED(hr))
+            {
+                std::wcerr << L"Failed to add " << c.progId << L". Error code = " << hr << L"\n";
+            }
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = writer.Write(argv[1]);
+        if (FAILED(hr))
+        {
+            std::wcerr << L"Failed to write " << argv[1] << L". Error code = " << hr << L"\n";
+        }
+    }
+    delete[] modules;
+    return SUCCEEDED(hr) ? 0 : 1;
+}
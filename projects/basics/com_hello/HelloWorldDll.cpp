@@ -3,6 +3,14 @@
 #include <shlwapi.h>
 #include "./midl/IHelloWorld.h"
 #include "HelloWorldFactory.h"
+#include "HelloWorld.h"
+#include "HelloWorldGreeter.h"
+#include "ClassObjectTable.h"
+#include "ClassManifest.h"
+#include "ActivationProbe.h"
+#include "ModuleAccounting.h"
+#include <stdio.h>
+#include "ModuleLock.h"
 
 LONG dllRefCount = 0;
 EXTERN_C IMAGE_DOS_HEADER __ImageBase;
@@ -11,150 +19,178 @@ EXTERN_C IMAGE_DOS_HEADER __ImageBase;
 
 extern "C" BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
+    // FreeLibrary after DllCanUnloadNow said yes. When the process exits instead
+    // (lpvReserved != NULL), the heap goes away with it and other threads may have been
+    // stopped anywhere, so don't touch the pool then.
+    if (fdwReason == DLL_PROCESS_DETACH && lpvReserved == NULL)
+    {
+        HelloWorld::DrainPool();
+        HelloWorldGreeter::ClosePool();
+    }
     return TRUE;
 }
 
-extern "C" HRESULT __stdcall DllGetClassObject(const CLSID &clsid, const IID &iid, void **ppv)
-{
-    if (clsid != CLSID_HelloWorld) {
-        return CLASS_E_CLASSNOTAVAILABLE;
-    }
-    
-    HelloWorldFactory *factory = new HelloWorldFactory();
-    if (factory == NULL) {
-        return E_OUTOFMEMORY;
-    }
+// The class objects live as long as the DLL, so activation never allocates. A reference
+// to a class object keeps the DLL loaded, see HelloWorldFactory::AddRef.
+static HelloWorldFactory s_helloWorldFactory;
 
-    HRESULT hr = factory->QueryInterface(iid, ppv);
-    if (SUCCEEDED(hr)) {
-        InterlockedIncrement(&dllRefCount);
-    }
+// Every coclass this DLL serves, see ClassManifest.h. Registration, the activation
+// database and registration-free activation all come from here. Add a line here and one
+// to s_classObjects for each new coclass.
+static constexpr ClassManifestClass s_classes[] = {
+    ClassManifestClass::Make(L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", L"HelloWorldLib.HelloWorld",
+                             L"HelloWorld", L"Both", HelloWorld::s_interfaces),
+};
 
-    factory->Release();
-    return hr;
-}
+static constexpr ClassManifest s_manifest = { kClassManifestVersion, ARRAYSIZE(s_classes), s_classes };
 
-extern "C" HRESULT __stdcall DllCanUnloadNow()
-{
-    return (dllRefCount == 0) ? S_OK : S_FALSE;
-}
+static constexpr ClassObjectTable s_classObjects({
+    { s_classes[0].clsidString, &s_helloWorldFactory },
+});
 
-extern "C" HRESULT __stdcall DllRegisterServer()
+static constexpr bool ServesEveryClass()
 {
-    HKEY hKey;
-    LONG lResult;
-
-    // Register CLSID
-    lResult = RegCreateKeyExW(HKEY_CLASSES_ROOT, L"CLSID\\{DC0F3891-93F3-42E9-A117-729B4F3C775A}", 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL);
-    if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
-    }
-    
-    lResult = RegSetValueExW(hKey, NULL, 0, REG_SZ, (const BYTE*)L"HelloWorld", (wcslen(L"HelloWorld") + 1) * sizeof(WCHAR));
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
+    for (size_t i = 0; i < ARRAYSIZE(s_classes); ++i)
+    {
+        if (!s_classObjects.Contains(s_classes[i].clsid))
+            return false;
     }
+    return true;
+}
+static_assert(ServesEveryClass(), "a coclass in s_classes has no class object in s_classObjects");
 
-    // Register ProgID under CLSID
-    HKEY hSubKey;
-    lResult = RegCreateKeyExW(hKey, L"ProgID", 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hSubKey, NULL);
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
-    }
+void ModuleLock()
+{
+    InterlockedIncrement(&dllRefCount);
+}
 
-    lResult = RegSetValueExW(hSubKey, NULL, 0, REG_SZ, (const BYTE*)L"HelloWorldLib.HelloWorld", (wcslen(L"HelloWorldLib.HelloWorld") + 1) * sizeof(WCHAR));
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hSubKey);
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
-    }
+void ModuleUnlock()
+{
+    InterlockedDecrement(&dllRefCount);
+}
 
-    RegCloseKey(hSubKey);
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID &clsid, const IID &iid, void **ppv)
+{
+    HELLOWORLD_PROBE(ActivationStageGetClassObject);
 
-    // Register InprocServer32
-    lResult = RegCreateKeyExW(hKey, L"InprocServer32", 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL);
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
+    if (ppv == NULL) {
+        return E_POINTER;
     }
 
-    // Set path
-    WCHAR path[MAX_PATH];
-    GetModuleFileNameW((HMODULE)&__ImageBase, path, MAX_PATH);
-    lResult = RegSetValueExW(hKey, NULL, 0, REG_SZ, (const BYTE*)path, (wcslen(path) + 1) * sizeof(WCHAR));
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
+    IClassFactory *factory = s_classObjects.Find(clsid);
+    if (factory == NULL) {
+        *ppv = NULL;
+        return CLASS_E_CLASSNOTAVAILABLE;
     }
 
-    // Set ThreadingModel
-    lResult = RegSetValueExW(hKey, L"ThreadingModel", 0, REG_SZ, (const BYTE*)L"Apartment", (wcslen(L"Apartment") + 1) * sizeof(WCHAR));
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
-    }
+    // QueryInterface takes the reference that keeps the DLL loaded
+    return factory->QueryInterface(iid, ppv);
+}
 
-    RegCloseKey(hKey);
+extern "C" HRESULT __stdcall DllCanUnloadNow()
+{
+    return (dllRefCount == 0) ? S_OK : S_FALSE;
+}
 
-    // Register ProgID
-    lResult = RegCreateKeyExW(HKEY_CLASSES_ROOT, L"HelloWorldLib.HelloWorld", 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL);
-    if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
+extern "C" HRESULT __stdcall DllGetClassManifest(const ClassManifest** ppManifest)
+{
+    if (ppManifest == NULL) {
+        return E_POINTER;
     }
+    *ppManifest = &s_manifest;
+    return S_OK;
+}
 
-    lResult = RegCreateKeyExW(hKey, L"CLSID", 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL);
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
+// The activation probes of this DLL, see ActivationProbe.h. E_NOTIMPL if they are compiled out.
+extern "C" HRESULT __stdcall DllGetActivationProbes(const ActivationProbeSet** ppProbes)
+{
+    if (ppProbes == NULL) {
+        return E_POINTER;
     }
+#ifdef HELLOWORLD_ACTIVATION_PROBES
+    *ppProbes = &g_activationProbes;
+    return S_OK;
+#else
+    *ppProbes = NULL;
+    return E_NOTIMPL;
+#endif
+}
 
-    lResult = RegSetValueExW(hKey, NULL, 0, REG_SZ, (const BYTE*)L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", (wcslen(L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}") + 1) * sizeof(WCHAR));
-    if (lResult != ERROR_SUCCESS) {
-        RegCloseKey(hKey);
-        return SELFREG_E_CLASS;
+// What the module has alive and the memory it holds, see ModuleAccounting.h
+extern "C" HRESULT __stdcall DllGetMemoryStats(ModuleMemoryStats* stats)
+{
+    if (stats == NULL) {
+        return E_POINTER;
     }
-
-    RegCloseKey(hKey);
+    GetModuleMemoryStats(stats);
+    stats->moduleLocks = dllRefCount;
     return S_OK;
 }
 
-extern "C" HRESULT __stdcall DllUnregisterServer()
+// Where the sampled objects that are still alive were created, see ModuleAccounting.h.
+// S_FALSE if there were more than 'capacity'.
+extern "C" HRESULT __stdcall DllGetAllocationSites(ModuleAllocationSite* sites, UINT32 capacity, UINT32* count)
 {
-    LONG lResult;
-
-    // Unregister ProgID under CLSID
-    lResult = SHDeleteKeyW(HKEY_CLASSES_ROOT, L"CLSID\\{DC0F3891-93F3-42E9-A117-729B4F3C775A}\\ProgID");
-    if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
+    if (count == NULL || (sites == NULL && capacity > 0)) {
+        return E_POINTER;
     }
+    return GetModuleAllocationSites(sites, capacity, count);
+}
 
-    // Unregister InprocServer32 under CLSID
-    lResult = SHDeleteKeyW(HKEY_CLASSES_ROOT, L"CLSID\\{DC0F3891-93F3-42E9-A117-729B4F3C775A}\\InprocServer32");
+// Creates HKEY_CLASSES_ROOT\<key> and sets one of its values, the default one if 'name' is NULL
+static bool SetClassesRootValue(const WCHAR* key, const WCHAR* name, const WCHAR* value)
+{
+    HKEY hKey;
+    LONG lResult = RegCreateKeyExW(HKEY_CLASSES_ROOT, key, 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL);
     if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
+        return false;
     }
+    lResult = RegSetValueExW(hKey, name, 0, REG_SZ, (const BYTE*)value, (DWORD)((wcslen(value) + 1) * sizeof(WCHAR)));
+    RegCloseKey(hKey);
+    return lResult == ERROR_SUCCESS;
+}
 
-    // Unregister CLSID
-    lResult = SHDeleteKeyW(HKEY_CLASSES_ROOT, L"CLSID\\{DC0F3891-93F3-42E9-A117-729B4F3C775A}");
-    if (lResult != ERROR_SUCCESS) {
+extern "C" HRESULT __stdcall DllRegisterServer()
+{
+    WCHAR path[MAX_PATH];
+    DWORD cch = GetModuleFileNameW((HMODULE)&__ImageBase, path, MAX_PATH);
+    if (cch == 0 || cch == MAX_PATH) {
         return SELFREG_E_CLASS;
     }
 
-    // Unregister CLSID under ProgID
-    lResult = SHDeleteKeyW(HKEY_CLASSES_ROOT, L"HelloWorldLib.HelloWorld\\CLSID");
-    if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
+    // CLSID\{...} with its name, ProgID and InprocServer32, and the ProgID pointing back
+    for (size_t i = 0; i < ARRAYSIZE(s_classes); ++i) {
+        const ClassManifestClass& c = s_classes[i];
+        WCHAR clsidKey[64], progIdKey[64], serverKey[64], progIdClsidKey[MAX_PATH];
+        swprintf_s(clsidKey, ARRAYSIZE(clsidKey), L"CLSID\\%ls", c.clsidString);
+        swprintf_s(progIdKey, ARRAYSIZE(progIdKey), L"CLSID\\%ls\\ProgID", c.clsidString);
+        swprintf_s(serverKey, ARRAYSIZE(serverKey), L"CLSID\\%ls\\InprocServer32", c.clsidString);
+        if (swprintf_s(progIdClsidKey, ARRAYSIZE(progIdClsidKey), L"%ls\\CLSID", c.progId) < 0) {
+            return SELFREG_E_CLASS;
+        }
+
+        if (!SetClassesRootValue(clsidKey, NULL, c.name) ||
+            !SetClassesRootValue(progIdKey, NULL, c.progId) ||
+            !SetClassesRootValue(serverKey, NULL, path) ||
+            !SetClassesRootValue(serverKey, L"ThreadingModel", c.ThreadingModel()) ||
+            !SetClassesRootValue(progIdClsidKey, NULL, c.clsidString)) {
+            return SELFREG_E_CLASS;
+        }
     }
+    return S_OK;
+}
 
-    // Unregister ProgID
-    lResult = SHDeleteKeyW(HKEY_CLASSES_ROOT, L"HelloWorldLib.HelloWorld");
-    if (lResult != ERROR_SUCCESS) {
-        return SELFREG_E_CLASS;
+extern "C" HRESULT __stdcall DllUnregisterServer()
+{
+    // SHDeleteKeyW takes the subkeys along
+    for (size_t i = 0; i < ARRAYSIZE(s_classes); ++i) {
+        const ClassManifestClass& c = s_classes[i];
+        WCHAR clsidKey[64];
+        swprintf_s(clsidKey, ARRAYSIZE(clsidKey), L"CLSID\\%ls", c.clsidString);
+        if (SHDeleteKeyW(HKEY_CLASSES_ROOT, clsidKey) != ERROR_SUCCESS ||
+            SHDeleteKeyW(HKEY_CLASSES_ROOT, c.progId) != ERROR_SUCCESS) {
+            return SELFREG_E_CLASS;
+        }
     }
-
     return S_OK;
 }
-
-
@@ -0,0 +1,404 @@
+#include "HelloWorldEventQueue.h"
+#include "ModuleAccounting.h"
+#include <stdlib.h>
+#include <new>
+
+EXTERN_C IMAGE_DOS_HEADER __ImageBase;
+
+// Events a drain callback delivers before it lets other queues have the thread
+static const UINT32 kDrainBatch = 64;
+
+// The largest queue HELLOWORLD_EVENT_QUEUE gets, however much it asks for
+static const DWORD kMaxCapacity = 0x10000;
+
+static HelloWorldEventQueueSettings ReadSettings()
+{
+    HelloWorldEventQueueSettings settings = { 0, HelloWorldEventDropOldest };
+
+    WCHAR value[32];
+    DWORD cch = GetEnvironmentVariableW(L"HELLOWORLD_EVENT_QUEUE", value, ARRAYSIZE(value));
+    if (cch > 0 && cch < ARRAYSIZE(value))
+    {
+        unsigned long requested = wcstoul(value, NULL, 10);
+        DWORD capacity = (requested > kMaxCapacity) ? kMaxCapacity : static_cast<DWORD>(requested);
+        if (capacity > 0)
+        {
+            settings.capacity = 2;
+            while (settings.capacity < capacity)
+            {
+                settings.capacity *= 2;
+            }
+        }
+    }
+
+    cch = GetEnvironmentVariableW(L"HELLOWORLD_EVENT_OVERFLOW", value, ARRAYSIZE(value));
+    if (cch > 0 && cch < ARRAYSIZE(value))
+    {
+        if (_wcsicmp(value, L"coalesce") == 0)
+        {
+            settings.overflow = HelloWorldEventCoalesce;
+        }
+        else if (_wcsicmp(value, L"block") == 0)
+        {
+            settings.overflow = HelloWorldEventBlock;
+        }
+    }
+    return settings;
+}
+
+const HelloWorldEventQueueSettings& GetEventQueueSettings()
+{
+    static const HelloWorldEventQueueSettings s_settings = ReadSettings();
+    return s_settings;
+}
+
+static LONGLONG ReadFrequency()
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return frequency.QuadPart;
+}
+
+static LONGLONG Microseconds(LONGLONG ticks)
+{
+    static const LONGLONG s_frequency = ReadFrequency();
+    return ticks * 1000000 / s_frequency;
+}
+
+HelloWorldEvent* HelloWorldEvent::Create(BSTR greeting)
+{
+    HelloWorldEvent* event = new (std::nothrow) HelloWorldEvent;
+    if (event == NULL)
+    {
+        return NULL;
+    }
+    event->greeting = SysAllocStringLen(greeting, SysStringLen(greeting));
+    if (event->greeting == NULL)
+    {
+        delete event;
+        return NULL;
+    }
+    BstrHold(event->greeting);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    event->fired = now.QuadPart;
+    return event;
+}
+
+HelloWorldEventQueue::HelloWorldEventQueue(HelloWorldEventOverflow overflow)
+    : m_cRef(1), m_cells(NULL), m_mask(0), m_overflow(overflow), m_work(NULL),
+      m_enqueuePos(0), m_dequeuePos(0), m_latest(NULL), m_scheduled(false), m_closed(false), m_blockedNow(0),
+      m_posted(0), m_delivered(0), m_dropped(0), m_coalesced(0), m_blocked(0), m_lastLag(0), m_maxLag(0)
+{
+    m_sink = GlobalSink();
+}
+
+// Runs when neither the connection point nor a drain callback holds the queue anymore, on
+// the thread that let go last
+HelloWorldEventQueue::~HelloWorldEventQueue()
+{
+    HelloWorldEvent* event;
+    while (TryDequeue(&event))
+    {
+        event->Release();
+    }
+    event = m_latest.exchange(NULL);
+    if (event != NULL)
+    {
+        event->Release();
+    }
+    if (m_work != NULL)
+    {
+        // Freed once the callback we may be running on has returned
+        CloseThreadpoolWork(m_work);
+    }
+    if (m_cells != NULL)
+    {
+        ModuleObjectDestroyed(ModuleObjectEventQueue, this, sizeof(*this) + (m_mask + 1) * sizeof(Cell));
+    }
+    delete[] m_cells;
+    if (m_sink.Registered())
+    {
+        m_sink.Revoke();
+    }
+}
+
+HRESULT HelloWorldEventQueue::Create(IUnknown* pUnkSink, const HelloWorldEventQueueSettings& settings, HelloWorldEventQueue** ppQueue)
+{
+    *ppQueue = NULL;
+    HelloWorldEventQueue* queue = new (std::nothrow) HelloWorldEventQueue(settings.overflow);
+    if (queue == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = GlobalSink::Register(pUnkSink, &queue->m_sink);
+    if (FAILED(hr))
+    {
+        queue->Release();
+        return hr;
+    }
+    queue->m_cells = new (std::nothrow) Cell[settings.capacity];
+    if (queue->m_cells == NULL)
+    {
+        queue->Release();
+        return E_OUTOFMEMORY;
+    }
+    queue->m_mask = settings.capacity - 1;
+    ModuleObjectCreated(ModuleObjectEventQueue, queue, sizeof(*queue) + settings.capacity * sizeof(Cell));
+    for (UINT32 i = 0; i < settings.capacity; ++i)
+    {
+        queue->m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        queue->m_cells[i].event = NULL;
+    }
+
+    // The callbacks run on the process's default pool. It keeps the DLL loaded until the
+    // last of them has returned.
+    TP_CALLBACK_ENVIRON environment;
+    InitializeThreadpoolEnvironment(&environment);
+    SetThreadpoolCallbackLibrary(&environment, &__ImageBase);
+    queue->m_work = CreateThreadpoolWork(Drain, queue, &environment);
+    DestroyThreadpoolEnvironment(&environment);
+    if (queue->m_work == NULL)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        queue->Release();
+        return hr;
+    }
+
+    *ppQueue = queue;
+    return S_OK;
+}
+
+// A cell is free for the producer at 'pos' when its sequence is 'pos', and holds an event
+// for the consumer at 'pos' when it is 'pos + 1'
+bool HelloWorldEventQueue::TryEnqueue(HelloWorldEvent* event)
+{
+    UINT64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell& cell = m_cells[pos & m_mask];
+        INT64 diff = static_cast<INT64>(cell.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.event = event;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool HelloWorldEventQueue::TryDequeue(HelloWorldEvent** event)
+{
+    UINT64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell& cell = m_cells[pos & m_mask];
+        INT64 diff = static_cast<INT64>(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0)
+        {
+            // Not relaxed: a blocked greeting checks the position before it goes to sleep
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + 1))
+            {
+                *event = cell.event;
+                cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool HelloWorldEventQueue::Pending()
+{
+    UINT64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+    return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos + 1 || m_latest.load() != NULL;
+}
+
+// Submits the drain callback unless it is submitted already
+void HelloWorldEventQueue::Schedule()
+{
+    if (!m_scheduled.exchange(true))
+    {
+        AddRef();
+        SubmitThreadpoolWork(m_work);
+    }
+}
+
+void HelloWorldEventQueue::Post(HelloWorldEvent* event)
+{
+    if (m_closed.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    event->AddRef();
+
+    // Once an event waits outside the queue, later ones have to as well, or they would
+    // overtake it
+    if (m_overflow == HelloWorldEventCoalesce && m_latest.load() != NULL)
+    {
+        HelloWorldEvent* previous = m_latest.exchange(event);
+        if (previous != NULL)
+        {
+            previous->Release();
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+        Schedule();
+        return;
+    }
+
+    while (!TryEnqueue(event))
+    {
+        if (m_overflow == HelloWorldEventDropOldest)
+        {
+            HelloWorldEvent* oldest;
+            if (TryDequeue(&oldest))
+            {
+                oldest->Release();
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        else if (m_overflow == HelloWorldEventCoalesce)
+        {
+            HelloWorldEvent* previous = m_latest.exchange(event);
+            if (previous != NULL)
+            {
+                previous->Release();
+                m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+        else
+        {
+            // Sleeps until the drain callback moved on, or the sink is unadvised
+            m_blocked.fetch_add(1, std::memory_order_relaxed);
+            m_blockedNow.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            UINT64 seen = m_dequeuePos.load();
+            bool full = !TryEnqueue(event);
+            if (full && !m_closed.load())
+            {
+                WaitOnAddress(&m_dequeuePos, &seen, sizeof(seen), INFINITE);
+            }
+            m_blockedNow.fetch_sub(1);
+            if (!full)
+            {
+                break;
+            }
+            if (m_closed.load())
+            {
+                event->Release();
+                return;
+            }
+        }
+    }
+    Schedule();
+}
+
+void CALLBACK HelloWorldEventQueue::Drain(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK)
+{
+    HelloWorldEventQueue* queue = static_cast<HelloWorldEventQueue*>(context);
+
+    // A pool thread is in the MTA GlobalSink keeps up, unless an earlier callback left it
+    // in an apartment of its own
+    for (UINT32 i = 0; i < kDrainBatch; ++i)
+    {
+        // The queue first. An event only waits outside it once it was full, so what is in
+        // the queue came first.
+        HelloWorldEvent* event;
+        if (!queue->TryDequeue(&event))
+        {
+            event = queue->m_latest.exchange(NULL);
+            if (event == NULL)
+            {
+                break;
+            }
+
+            // Greetings may have filled the queue again since we found it empty, and then
+            // sent the event we hold outside. What they queued goes first, the event waits
+            // again unless a later one took its place.
+            HelloWorldEvent* earlier;
+            if (queue->TryDequeue(&earlier))
+            {
+                HelloWorldEvent* expected = NULL;
+                if (!queue->m_latest.compare_exchange_strong(expected, event))
+                {
+                    event->Release();
+                    queue->m_coalesced.fetch_add(1, std::memory_order_relaxed);
+                }
+                event = earlier;
+            }
+        }
+        // Pairs with the fence of a greeting that goes to sleep: either it sees the room
+        // we just made, or we see it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue->m_blockedNow.load() > 0)
+        {
+            WakeByAddressAll(&queue->m_dequeuePos);
+        }
+
+        if (!queue->m_closed.load(std::memory_order_relaxed))
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            LONGLONG lag = Microseconds(now.QuadPart - event->fired);
+            queue->m_lastLag.store(lag, std::memory_order_relaxed);
+            if (lag > queue->m_maxLag.load(std::memory_order_relaxed))
+            {
+                queue->m_maxLag.store(lag, std::memory_order_relaxed);
+            }
+
+            // A sink whose apartment is gone can't be reached, and misses it
+            queue->m_sink.OnGreeted(event->greeting);
+            queue->m_delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+        event->Release();
+    }
+
+    // An event posted while we were clearing the flag found it still set, so it is ours
+    // to deliver. The exchange makes its event visible to Pending.
+    queue->m_scheduled.exchange(false);
+    if (queue->Pending())
+    {
+        queue->Schedule();
+    }
+    queue->Release();
+}
+
+void HelloWorldEventQueue::Close()
+{
+    m_closed.store(true);
+    WakeByAddressAll(&m_dequeuePos);
+}
+
+void HelloWorldEventQueue::GetStats(HelloWorldEventQueueStats* stats)
+{
+    stats->posted = m_posted.load(std::memory_order_relaxed);
+    stats->delivered = m_delivered.load(std::memory_order_relaxed);
+    stats->dropped = m_dropped.load(std::memory_order_relaxed);
+    stats->coalesced = m_coalesced.load(std::memory_order_relaxed);
+    stats->blocked = m_blocked.load(std::memory_order_relaxed);
+    stats->depth = static_cast<LONG>(m_enqueuePos.load(std::memory_order_relaxed) - m_dequeuePos.load(std::memory_order_relaxed)) +
+                   ((m_latest.load(std::memory_order_relaxed) != NULL) ? 1 : 0);
+    stats->lastLag = m_lastLag.load(std::memory_order_relaxed);
+    stats->maxLag = m_maxLag.load(std::memory_order_relaxed);
+}
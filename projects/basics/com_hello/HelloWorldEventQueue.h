@@ -0,0 +1,149 @@
+#pragma once
+#include "./midl/IHelloWorld.h"
+#include "GlobalSink.h"
+#include "BstrAlloc.h"
+#include <atomic>
+
+// Queued delivery of IHelloWorldEvents, so that a slow sink stalls neither the greeting
+// nor the other sinks.
+//
+// By default a HelloWorld calls its sinks on the greeting thread, one after the other.
+// HELLOWORLD_EVENT_QUEUE makes it give every advised sink a queue of that many events
+// instead (rounded up to a power of two, at most 65536). A greeting only puts the event in the queues,
+// and each queue is drained by a thread pool callback of its own, so a sink is still
+// called by one thread at a time and in order. The pool threads are in the MTA, not in the
+// apartment of the sink: a queue keeps its sink like any other, see GlobalSink.h.
+//
+// When a sink falls so far behind that its queue is full, HELLOWORLD_EVENT_OVERFLOW
+// decides what happens to the next event:
+//
+//     drop-oldest  the oldest event in the queue makes room for it (the default)
+//     coalesce     it waits outside the queue, in place of any event that waits there
+//                  already; the sink gets it once it has caught up
+//     block        the greeting waits until the sink made room. A sink that greets from
+//                  OnGreeted must not be advised this way, it would wait for itself.
+//
+// A sink that is unadvised gets no more events, even if some were still queued.
+
+enum HelloWorldEventOverflow
+{
+    HelloWorldEventDropOldest,
+    HelloWorldEventCoalesce,
+    HelloWorldEventBlock,
+};
+
+struct HelloWorldEventQueueSettings
+{
+    UINT32 capacity;            // 0: deliver on the greeting thread
+    HelloWorldEventOverflow overflow;
+};
+
+// Read from the environment once per process
+const HelloWorldEventQueueSettings& GetEventQueueSettings();
+
+// How far a sink is behind
+struct HelloWorldEventQueueStats
+{
+    LONGLONG posted;            // events that were meant for the sink
+    LONGLONG delivered;
+    LONGLONG dropped;           // pushed out of a full queue, drop-oldest
+    LONGLONG coalesced;         // replaced by a later event, coalesce
+    LONGLONG blocked;           // greetings that had to wait, block
+    LONG depth;                 // events waiting right now
+    LONGLONG lastLag;           // microseconds from the greeting to the delivery of the last event
+    LONGLONG maxLag;
+};
+
+// One greeting on its way to the sinks. All queues share it.
+class HelloWorldEvent
+{
+    std::atomic<LONG> m_cRef;
+
+    HelloWorldEvent() : m_cRef(1), greeting(NULL), fired(0) {}
+    ~HelloWorldEvent() { BstrFreeHeld(greeting); }
+
+public:
+    BSTR greeting;
+    LONGLONG fired;             // performance counter at the greeting
+
+    // Copies 'greeting'. Returns NULL when out of memory.
+    static HelloWorldEvent* Create(BSTR greeting);
+
+    void AddRef() { m_cRef.fetch_add(1, std::memory_order_relaxed); }
+    void Release()
+    {
+        if (m_cRef.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+};
+
+// The queue of one sink. A bounded ring of event pointers, in which every cell carries a
+// sequence number that tells producers and the consumer whose turn it is, so neither takes
+// a lock. The greeting threads produce. The drain callback consumes, and so does a
+// producer that drops the oldest event.
+class HelloWorldEventQueue
+{
+    struct Cell
+    {
+        std::atomic<UINT64> sequence;
+        HelloWorldEvent* event;
+    };
+
+    std::atomic<LONG> m_cRef;
+    GlobalSink m_sink;
+    Cell* m_cells;
+    UINT64 m_mask;
+    HelloWorldEventOverflow m_overflow;
+    PTP_WORK m_work;
+
+    // Producers and the consumer each on a cache line of their own
+    alignas(64) std::atomic<UINT64> m_enqueuePos;
+    alignas(64) std::atomic<UINT64> m_dequeuePos;
+    std::atomic<HelloWorldEvent*> m_latest;     // the event waiting outside the queue, coalesce
+    std::atomic<bool> m_scheduled;              // a drain callback is submitted or running
+    std::atomic<bool> m_closed;
+    std::atomic<LONG> m_blockedNow;             // greetings waiting for room, block
+
+    alignas(64) std::atomic<LONGLONG> m_posted;
+    std::atomic<LONGLONG> m_delivered;
+    std::atomic<LONGLONG> m_dropped;
+    std::atomic<LONGLONG> m_coalesced;
+    std::atomic<LONGLONG> m_blocked;
+    std::atomic<LONGLONG> m_lastLag;
+    std::atomic<LONGLONG> m_maxLag;
+
+    explicit HelloWorldEventQueue(HelloWorldEventOverflow overflow);
+    ~HelloWorldEventQueue();
+    HelloWorldEventQueue(const HelloWorldEventQueue&) = delete;
+    HelloWorldEventQueue& operator=(const HelloWorldEventQueue&) = delete;
+
+    bool TryEnqueue(HelloWorldEvent* event);
+    bool TryDequeue(HelloWorldEvent** event);
+    bool Pending();
+    void Schedule();
+    static void CALLBACK Drain(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WORK work);
+
+public:
+    // The queue keeps the sink until it is gone. Called on the thread that advises, see
+    // GlobalSink::Register.
+    static HRESULT Create(IUnknown* pUnkSink, const HelloWorldEventQueueSettings& settings, HelloWorldEventQueue** ppQueue);
+
+    void AddRef() { m_cRef.fetch_add(1, std::memory_order_relaxed); }
+    void Release()
+    {
+        if (m_cRef.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+    // Queues 'event' for the sink, following the overflow policy if the queue is full
+    void Post(HelloWorldEvent* event);
+
+    // Stops delivering, called when the sink is unadvised
+    void Close();
+
+    void GetStats(HelloWorldEventQueueStats* stats);
+};
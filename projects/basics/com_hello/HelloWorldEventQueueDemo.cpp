@@ -0,0 +1,238 @@
+#include "HelloWorld.h"
+#include "HelloWorldEventQueue.h"
+#include <olectl.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+// Greets with one slow and one fast sink advised, and shows what the slow one costs the
+// greetings and the fast sink under each way of delivering events.
+//
+// Usage: HelloWorldEventQueueDemo [sync | drop-oldest | coalesce | block] [capacity] [greetings]
+//
+// The settings are read once per process, so every policy needs a run of its own.
+
+// The objects live in this process, there is no DLL to keep loaded
+void ModuleLock() {}
+void ModuleUnlock() {}
+
+static const int kGreetings = 2000;
+
+// Hears greetings on whatever thread delivers them, and takes 'delay' milliseconds for each
+class DelayedSink : public IHelloWorldEvents
+{
+    LONG m_cRef;
+    DWORD m_delay;
+
+public:
+    LONG m_greetings;
+
+    explicit DelayedSink(DWORD delay) : m_cRef(1), m_delay(delay), m_greetings(0) {}
+
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv)
+    {
+        if (riid == IID_IUnknown || riid == IID_IDispatch || riid == IID_IHelloWorldEvents)
+        {
+            *ppv = static_cast<IHelloWorldEvents*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+    ULONG __stdcall Release()
+    {
+        LONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    // IHelloWorldEvents is dual. HelloWorld calls a sink that implements it through the
+    // vtable, so this is only for clients that look for the event by DISPID.
+    HRESULT __stdcall GetTypeInfoCount(UINT* pctinfo)
+    {
+        *pctinfo = 0;
+        return S_OK;
+    }
+    HRESULT __stdcall GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo)
+    {
+        *ppTInfo = NULL;
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall GetIDsOfNames(const IID& riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId)
+    {
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall Invoke(DISPID dispIdMember, const IID& riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams,
+                             VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr)
+    {
+        if (dispIdMember != 1)
+        {
+            return DISP_E_MEMBERNOTFOUND;
+        }
+        if (pDispParams->cArgs != 1 || V_VT(&pDispParams->rgvarg[0]) != VT_BSTR)
+        {
+            return DISP_E_BADPARAMCOUNT;
+        }
+        return OnGreeted(V_BSTR(&pDispParams->rgvarg[0]));
+    }
+
+    HRESULT __stdcall OnGreeted(BSTR greeting)
+    {
+        if (m_delay > 0)
+        {
+            Sleep(m_delay);
+        }
+        InterlockedIncrement(&m_greetings);
+        return S_OK;
+    }
+};
+
+static void PrintStats(HelloWorld* pHelloWorld, const char* name, DWORD cookie, DelayedSink* pSink)
+{
+    HelloWorldEventQueueStats stats;
+    HRESULT hr = pHelloWorld->GetEventQueueStats(cookie, &stats);
+    if (hr == S_FALSE)
+    {
+        std::cout << name << " sink: " << pSink->m_greetings << " greetings, called on the greeting thread\n";
+        return;
+    }
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to get the queue stats. Error code = " << hr << "\n";
+        return;
+    }
+    std::cout << name << " sink: " << stats.delivered << " of " << stats.posted << " greetings, "
+              << stats.dropped << " dropped, " << stats.coalesced << " coalesced, " << stats.blocked << " blocked, "
+              << stats.depth << " waiting, lag " << stats.lastLag << " us (max " << stats.maxLag << " us)\n";
+}
+
+// Until every event for the slow sink was delivered, dropped or coalesced, or as long as
+// it would take to deliver them all
+static void WaitForSink(HelloWorld* pHelloWorld, DWORD cookie, int greetings)
+{
+    for (int waited = 0; waited < greetings * 2; ++waited)
+    {
+        HelloWorldEventQueueStats stats;
+        if (pHelloWorld->GetEventQueueStats(cookie, &stats) != S_OK
+            || stats.delivered + stats.dropped + stats.coalesced == stats.posted)
+        {
+            return;
+        }
+        Sleep(1);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int greetings = (argc > 3) ? atoi(argv[3]) : kGreetings;
+    if (greetings <= 0)
+    {
+        std::cerr << "Usage: HelloWorldEventQueueDemo [sync | drop-oldest | coalesce | block] [capacity] [greetings]\n";
+        return 1;
+    }
+
+    // Before anything reads them
+    if (argc > 1 && strcmp(argv[1], "sync") != 0)
+    {
+        wchar_t value[32];
+        MultiByteToWideChar(CP_ACP, 0, argv[1], -1, value, ARRAYSIZE(value));
+        SetEnvironmentVariableW(L"HELLOWORLD_EVENT_OVERFLOW", value);
+        MultiByteToWideChar(CP_ACP, 0, argc > 2 ? argv[2] : "256", -1, value, ARRAYSIZE(value));
+        SetEnvironmentVariableW(L"HELLOWORLD_EVENT_QUEUE", value);
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return 1;
+    }
+
+    HelloWorld* pHelloWorld = new HelloWorld;
+    if (pHelloWorld == NULL)
+    {
+        std::cerr << "Failed to create HelloWorld instance.\n";
+        CoUninitialize();
+        return 1;
+    }
+
+    IConnectionPointContainer* pContainer = NULL;
+    IConnectionPoint* pPoint = NULL;
+    hr = pHelloWorld->QueryInterface(IID_IConnectionPointContainer, (void**)&pContainer);
+    if (SUCCEEDED(hr))
+    {
+        hr = pContainer->FindConnectionPoint(IID_IHelloWorldEvents, &pPoint);
+    }
+
+    DelayedSink* pSlow = new DelayedSink(1);
+    DelayedSink* pFast = new DelayedSink(0);
+    DWORD slowCookie = 0, fastCookie = 0;
+    if (SUCCEEDED(hr))
+    {
+        hr = pPoint->Advise(pSlow, &slowCookie);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pPoint->Advise(pFast, &fastCookie);
+    }
+
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to advise the sinks. Error code = " << hr << "\n";
+    }
+    else
+    {
+        BSTR name = SysAllocString(L"John Doe");
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&start);
+        for (int i = 0; i < greetings; ++i)
+        {
+            BSTR greeting = NULL;
+            pHelloWorld->SayHelloTo(name, &greeting);
+            SysFreeString(greeting);
+        }
+        QueryPerformanceCounter(&end);
+        SysFreeString(name);
+        UINT32 capacity = GetEventQueueSettings().capacity;
+        std::cout << (capacity > 0 ? argv[1] : "sync");
+        if (capacity > 0)
+        {
+            std::cout << ", queues of " << capacity << " events";
+        }
+        std::cout << ": " << (end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart / greetings << " us per greeting\n";
+
+        // Right after the greetings, and once the slow sink had time to catch up
+        PrintStats(pHelloWorld, "slow", slowCookie, pSlow);
+        PrintStats(pHelloWorld, "fast", fastCookie, pFast);
+        WaitForSink(pHelloWorld, slowCookie, greetings);
+        PrintStats(pHelloWorld, "slow", slowCookie, pSlow);
+    }
+
+    if (slowCookie != 0)
+    {
+        pPoint->Unadvise(slowCookie);
+    }
+    if (fastCookie != 0)
+    {
+        pPoint->Unadvise(fastCookie);
+    }
+    pSlow->Release();
+    pFast->Release();
+    if (pPoint != NULL)
+    {
+        pPoint->Release();
+    }
+    if (pContainer != NULL)
+    {
+        pContainer->Release();
+    }
+    pHelloWorld->Release();
+    CoUninitialize();
+    return 0;
+}
@@ -0,0 +1,386 @@
+#include "HelloWorldEvents.h"
+#include "HelloWorld.h"
+#include "ModuleAccounting.h"
+#include <olectl.h>
+#include <new>
+
+HelloWorldEvents::HelloWorldEvents(HelloWorld* pHelloWorld)
+    : m_container(this), m_pHelloWorld(pHelloWorld), m_sinks(NULL), m_firing(0), m_retired(NULL), m_nextCookie(1)
+{
+    InitializeSRWLock(&m_lock);
+    ModuleObjectCreated(ModuleObjectEvents, this, sizeof(*this));
+}
+
+// Only the HelloWorld deletes us, when nobody can be firing anymore
+HelloWorldEvents::~HelloWorldEvents()
+{
+    Free(m_retired.exchange(NULL));
+
+    SinkArray* sinks = m_sinks.exchange(NULL);
+    if (sinks != NULL)
+    {
+        for (UINT32 i = 0; i < sinks->count; ++i)
+        {
+            Disconnect(sinks->connections[i]);
+        }
+        ::operator delete(sinks);
+    }
+    ModuleObjectDestroyed(ModuleObjectEvents, this, sizeof(*this));
+}
+
+void HelloWorldEvents::FireOnGreeted(BSTR greeting)
+{
+    // The count first: a writer that replaces the array afterwards sees us firing and
+    // keeps the old one alive
+    m_firing.fetch_add(1);
+    SinkArray* sinks = m_sinks.load();
+    if (sinks != NULL)
+    {
+        // Queued sinks share one copy of the greeting. Without memory for it they miss
+        // this one.
+        HelloWorldEvent* event = NULL;
+        for (UINT32 i = 0; i < sinks->count; ++i)
+        {
+            const Connection& connection = sinks->connections[i];
+            if (connection.queue == NULL)
+            {
+                // A sink whose apartment is gone can't be reached, and misses it
+                connection.sink.OnGreeted(greeting);
+                continue;
+            }
+            if (event == NULL && (event = HelloWorldEvent::Create(greeting)) == NULL)
+            {
+                continue;
+            }
+            connection.queue->Post(event);
+        }
+        if (event != NULL)
+        {
+            event->Release();
+        }
+    }
+
+    // The last greeting to leave frees what was replaced meanwhile. If a writer holds the
+    // lock, it or the next one does.
+    if (m_firing.fetch_sub(1) == 1 && m_retired.load() != NULL && TryAcquireSRWLockExclusive(&m_lock))
+    {
+        Retired* retired = TakeRetired();
+        ReleaseSRWLockExclusive(&m_lock);
+        Free(retired);
+    }
+}
+
+// Publishes 'sinks' in place of the current array. Called with the lock held, it stays
+// held. The sink that was removed is released along with the old array.
+HRESULT HelloWorldEvents::Replace(SinkArray* sinks, const Connection* removed)
+{
+    Retired* retired = new (std::nothrow) Retired;
+    if (retired == NULL)
+    {
+        ::operator delete(sinks);
+        return E_OUTOFMEMORY;
+    }
+    retired->sinks = m_sinks.exchange(sinks);
+    if (removed != NULL)
+    {
+        retired->removed = *removed;
+    }
+    else
+    {
+        retired->removed.cookie = 0;
+    }
+    retired->next = m_retired.load(std::memory_order_relaxed);
+    m_retired.store(retired);
+    return S_OK;
+}
+
+// Detaches the replaced arrays if no greeting can be using them anymore. Called with the
+// lock held. Freeing them may release sinks, which must happen after the lock is released.
+HelloWorldEvents::Retired* HelloWorldEvents::TakeRetired()
+{
+    // A greeting that starts after this saw the current array, not a replaced one
+    if (m_firing.load() != 0)
+    {
+        return NULL;
+    }
+    return m_retired.exchange(NULL);
+}
+
+void HelloWorldEvents::Free(Retired* retired)
+{
+    while (retired != NULL)
+    {
+        Retired* next = retired->next;
+        if (retired->removed.cookie != 0)
+        {
+            Disconnect(retired->removed);
+        }
+        ::operator delete(retired->sinks);
+        delete retired;
+        retired = next;
+    }
+}
+
+// A queued sink is released by its queue, once the last event for it is through. Whoever
+// releases the last HelloWorld reference gets here, on a thread that may be in no
+// apartment but the MTA GlobalSink keeps up.
+void HelloWorldEvents::Disconnect(const Connection& connection)
+{
+    if (connection.queue != NULL)
+    {
+        connection.queue->Release();
+    }
+    else
+    {
+        connection.sink.Revoke();
+    }
+}
+
+HRESULT HelloWorldEvents::GetQueueStats(DWORD dwCookie, HelloWorldEventQueueStats* stats)
+{
+    if (stats == NULL)
+    {
+        return E_POINTER;
+    }
+
+    // The lock keeps the queue from being released while we read it
+    HRESULT hr = CONNECT_E_NOCONNECTION;
+    AcquireSRWLockExclusive(&m_lock);
+    SinkArray* sinks = m_sinks.load(std::memory_order_relaxed);
+    for (UINT32 i = 0; sinks != NULL && i < sinks->count; ++i)
+    {
+        const Connection& connection = sinks->connections[i];
+        if (connection.cookie != dwCookie)
+        {
+            continue;
+        }
+        if (connection.queue != NULL)
+        {
+            connection.queue->GetStats(stats);
+            hr = S_OK;
+        }
+        else
+        {
+            ZeroMemory(stats, sizeof(*stats));
+            hr = S_FALSE;
+        }
+        break;
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+    return hr;
+}
+
+HRESULT __stdcall HelloWorldEvents::QueryInterface(const IID& riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == IID_IUnknown || riid == IID_IConnectionPoint)
+    {
+        *ppv = static_cast<IConnectionPoint*>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG __stdcall HelloWorldEvents::AddRef()
+{
+    return m_pHelloWorld->AddRef();
+}
+
+ULONG __stdcall HelloWorldEvents::Release()
+{
+    return m_pHelloWorld->Release();
+}
+
+HRESULT __stdcall HelloWorldEvents::GetConnectionInterface(IID* pIID)
+{
+    if (pIID == NULL)
+    {
+        return E_POINTER;
+    }
+    *pIID = IID_IHelloWorldEvents;
+    return S_OK;
+}
+
+HRESULT __stdcall HelloWorldEvents::GetConnectionPointContainer(IConnectionPointContainer** ppCPC)
+{
+    if (ppCPC == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppCPC = &m_container;
+    m_container.AddRef();
+    return S_OK;
+}
+
+HRESULT __stdcall HelloWorldEvents::Advise(IUnknown* pUnkSink, DWORD* pdwCookie)
+{
+    if (pdwCookie == NULL)
+    {
+        return E_POINTER;
+    }
+    *pdwCookie = 0;
+    if (pUnkSink == NULL)
+    {
+        return E_POINTER;
+    }
+
+    // The queue, or the GIT, keeps a reference of its own on the sink
+    GlobalSink sink = {};
+    HelloWorldEventQueue* pQueue = NULL;
+    const HelloWorldEventQueueSettings& settings = GetEventQueueSettings();
+    HRESULT hr = (settings.capacity > 0) ? HelloWorldEventQueue::Create(pUnkSink, settings, &pQueue)
+                                         : GlobalSink::Register(pUnkSink, &sink);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    AcquireSRWLockExclusive(&m_lock);
+    SinkArray* current = m_sinks.load(std::memory_order_relaxed);
+    UINT32 count = (current != NULL) ? current->count : 0;
+    hr = E_OUTOFMEMORY;
+    SinkArray* sinks = static_cast<SinkArray*>(::operator new(sizeof(SinkArray) + count * sizeof(Connection), std::nothrow));
+    if (sinks != NULL)
+    {
+        for (UINT32 i = 0; i < count; ++i)
+        {
+            sinks->connections[i] = current->connections[i];
+        }
+        sinks->connections[count].cookie = m_nextCookie;
+        sinks->connections[count].sink = sink;
+        sinks->connections[count].queue = pQueue;
+        sinks->count = count + 1;
+        hr = Replace(sinks, NULL);
+    }
+    if (SUCCEEDED(hr))
+    {
+        *pdwCookie = m_nextCookie;
+        m_nextCookie = (m_nextCookie == MAXDWORD) ? 1 : m_nextCookie + 1;
+    }
+    Retired* retired = TakeRetired();
+    ReleaseSRWLockExclusive(&m_lock);
+
+    Free(retired);
+    if (FAILED(hr))
+    {
+        Connection connection = { 0, sink, pQueue };
+        Disconnect(connection);
+    }
+    return hr;
+}
+
+HRESULT __stdcall HelloWorldEvents::Unadvise(DWORD dwCookie)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    SinkArray* current = m_sinks.load(std::memory_order_relaxed);
+    UINT32 count = (current != NULL) ? current->count : 0;
+    UINT32 index = 0;
+    while (index < count && current->connections[index].cookie != dwCookie)
+    {
+        ++index;
+    }
+
+    HRESULT hr = CONNECT_E_NOCONNECTION;
+    if (index < count)
+    {
+        // The last sink leaves no array at all, so firing is a single load again
+        SinkArray* sinks = NULL;
+        hr = S_OK;
+        if (count > 1)
+        {
+            sinks = static_cast<SinkArray*>(::operator new(sizeof(SinkArray) + (count - 2) * sizeof(Connection), std::nothrow));
+            if (sinks == NULL)
+            {
+                hr = E_OUTOFMEMORY;
+            }
+            else
+            {
+                UINT32 j = 0;
+                for (UINT32 i = 0; i < count; ++i)
+                {
+                    if (i != index)
+                    {
+                        sinks->connections[j++] = current->connections[i];
+                    }
+                }
+                sinks->count = count - 1;
+            }
+        }
+        if (SUCCEEDED(hr))
+        {
+            // Replace retires the current array, which holds on to 'removed'
+            Connection removed = current->connections[index];
+            hr = Replace(sinks, &removed);
+
+            // A queued sink stops getting events right away, not only once the array is
+            // freed. If it couldn't be removed it stays connected, and keeps its queue open.
+            if (SUCCEEDED(hr) && removed.queue != NULL)
+            {
+                removed.queue->Close();
+            }
+        }
+    }
+    Retired* retired = TakeRetired();
+    ReleaseSRWLockExclusive(&m_lock);
+
+    Free(retired);
+    return hr;
+}
+
+// Enumerating connections is optional, and nobody needs it for a single event interface
+HRESULT __stdcall HelloWorldEvents::EnumConnections(IEnumConnections** ppEnum)
+{
+    if (ppEnum == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppEnum = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT __stdcall HelloWorldEvents::Container::QueryInterface(const IID& riid, void** ppv)
+{
+    return m_pEvents->m_pHelloWorld->QueryInterface(riid, ppv);
+}
+
+ULONG __stdcall HelloWorldEvents::Container::AddRef()
+{
+    return m_pEvents->m_pHelloWorld->AddRef();
+}
+
+ULONG __stdcall HelloWorldEvents::Container::Release()
+{
+    return m_pEvents->m_pHelloWorld->Release();
+}
+
+HRESULT __stdcall HelloWorldEvents::Container::EnumConnectionPoints(IEnumConnectionPoints** ppEnum)
+{
+    if (ppEnum == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppEnum = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT __stdcall HelloWorldEvents::Container::FindConnectionPoint(const IID& riid, IConnectionPoint** ppCP)
+{
+    if (ppCP == NULL)
+    {
+        return E_POINTER;
+    }
+    if (riid != IID_IHelloWorldEvents)
+    {
+        *ppCP = NULL;
+        return CONNECT_E_NOCONNECTION;
+    }
+    *ppCP = m_pEvents;
+    m_pEvents->AddRef();
+    return S_OK;
+}
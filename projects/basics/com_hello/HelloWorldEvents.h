@@ -0,0 +1,117 @@
+#pragma once
+#include "./midl/IHelloWorld.h"
+#include "HelloWorldEventQueue.h"
+#include "GlobalSink.h"
+#include <atomic>
+
+class HelloWorld;
+
+// The connection point through which a HelloWorld calls IHelloWorldEvents::OnGreeted for
+// every greeting SayHelloTo makes. Clients find it the usual way:
+//
+//     IConnectionPointContainer* pContainer;
+//     pHelloWorld->QueryInterface(IID_IConnectionPointContainer, (void**)&pContainer);
+//     IConnectionPoint* pPoint;
+//     pContainer->FindConnectionPoint(IID_IHelloWorldEvents, &pPoint);
+//     pPoint->Advise(pSink, &cookie);
+//
+// A HelloWorld creates its connection point when it is first asked for one, objects
+// nobody listens to pay a single pointer for it. The connection point lives as long as
+// its HelloWorld, and counts its references on it.
+//
+// Firing must be cheap even with many sinks and many greeting threads, while Advise and
+// Unadvise stay rare. So the sinks are kept in an array that is never changed: Advise and
+// Unadvise build a new one and publish it with a single store. A greeting reads the array
+// with one atomic load and calls the sinks without a lock. Sinks called directly cost no
+// allocation either, queued sinks one copy of the greeting that they all share.
+// An array that was replaced may still be in use by a greeting on another thread, so it is
+// only freed, and a sink that was unadvised only released, once no greeting is firing.
+// That also lets a sink unadvise itself from OnGreeted.
+//
+// Sinks are called on the thread that greets. An agile sink is called as it is, one that
+// belongs to another apartment through a proxy, see GlobalSink.h. With
+// HELLOWORLD_EVENT_QUEUE set, every sink is called from a queue of its own instead, see
+// HelloWorldEventQueue.h.
+class HelloWorldEvents : public IConnectionPoint
+{
+    struct Connection
+    {
+        DWORD cookie;                       // what Advise returned, never 0
+        GlobalSink sink;                    // if it is called directly
+        HelloWorldEventQueue* queue;        // NULL if the sink is called directly
+    };
+
+    // 'count' connections, allocated in one piece
+    struct SinkArray
+    {
+        UINT32 count;
+        Connection connections[1];
+    };
+
+    // A replaced array, and the connection it was replaced for if that was an Unadvise. The
+    // cookie of 'removed' is 0 otherwise.
+    struct Retired
+    {
+        SinkArray* sinks;
+        Connection removed;
+        Retired* next;
+    };
+
+    // IConnectionPointContainer is the HelloWorld's, it only lives here to not make every
+    // HelloWorld bigger
+    class Container : public IConnectionPointContainer
+    {
+        HelloWorldEvents* m_pEvents;
+
+    public:
+        explicit Container(HelloWorldEvents* pEvents) : m_pEvents(pEvents) {}
+
+        HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
+        ULONG __stdcall AddRef();
+        ULONG __stdcall Release();
+
+        HRESULT __stdcall EnumConnectionPoints(IEnumConnectionPoints** ppEnum);
+        HRESULT __stdcall FindConnectionPoint(const IID& riid, IConnectionPoint** ppCP);
+    } m_container;
+
+    HelloWorld* m_pHelloWorld;
+    std::atomic<SinkArray*> m_sinks;        // NULL while nobody is connected
+    std::atomic<LONG> m_firing;             // greetings calling the sinks right now
+    std::atomic<Retired*> m_retired;
+    SRWLOCK m_lock;                         // serializes Advise and Unadvise
+    DWORD m_nextCookie;
+
+    HelloWorldEvents(const HelloWorldEvents&) = delete;
+    HelloWorldEvents& operator=(const HelloWorldEvents&) = delete;
+
+    HRESULT Replace(SinkArray* sinks, const Connection* removed);
+    Retired* TakeRetired();
+    static void Free(Retired* retired);
+    static void Disconnect(const Connection& connection);
+
+public:
+    explicit HelloWorldEvents(HelloWorld* pHelloWorld);
+    ~HelloWorldEvents();
+
+    IConnectionPointContainer* GetContainer() { return &m_container; }
+
+    // Calls OnGreeted on every sink, or queues it for them. Their results don't matter to
+    // the greeting.
+    void FireOnGreeted(BSTR greeting);
+
+    // How far behind the queue of the sink advised with 'dwCookie' is. S_FALSE if the sink
+    // is called directly.
+    HRESULT GetQueueStats(DWORD dwCookie, HelloWorldEventQueueStats* stats);
+
+    // IUnknown methods
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
+    ULONG __stdcall AddRef();
+    ULONG __stdcall Release();
+
+    // IConnectionPoint methods
+    HRESULT __stdcall GetConnectionInterface(IID* pIID);
+    HRESULT __stdcall GetConnectionPointContainer(IConnectionPointContainer** ppCPC);
+    HRESULT __stdcall Advise(IUnknown* pUnkSink, DWORD* pdwCookie);
+    HRESULT __stdcall Unadvise(DWORD dwCookie);
+    HRESULT __stdcall EnumConnections(IEnumConnections** ppEnum);
+};
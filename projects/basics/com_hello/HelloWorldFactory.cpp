@@ -1,55 +1,41 @@
 #include "HelloWorld.h"
 #include "HelloWorldFactory.h"
+#include "ModuleLock.h"
+#include "ModuleAccounting.h"
+#include "InterfaceMap.h"
+#include "ActivationProbe.h"
 
-
-HelloWorldFactory::HelloWorldFactory() : m_cRef(1) {}
+typedef InterfaceMap<HelloWorldFactory,
+    InterfaceEntry<IClassFactory, &IID_IUnknown>,
+    InterfaceEntry<IClassFactory, &IID_IClassFactory>> HelloWorldFactoryInterfaces;
 
 HRESULT __stdcall HelloWorldFactory::QueryInterface(const IID& riid, void** ppv)
 {
-    // Check if the requested interface ID either belongs to IUnknown or IClassFactory.
-    if (riid == IID_IUnknown || riid == IID_IClassFactory)
-    {
-        // If it does, we cast 'this' to an IClassFactory pointer, meaning we consider this instance as an IClassFactory.
-        *ppv = static_cast<IClassFactory*>(this);
-    }
-    else
-    {
-        // If it doesn't, then we don't know about this interface. Return an appropriate error code.
-        *ppv = NULL;
-        return E_NOINTERFACE;
-    }
-    
-    // Here, we cast the pointer to IUnknown before calling AddRef.
-    // This is to ensure that we increase the reference count of the IUnknown interface of the object.
-    // It's a standard practice because every COM object must at least support the IUnknown interface,
-    // and IUnknown->AddRef is used to manage the lifecycle of the COM object.
-    // Even though we could call AddRef directly on the IClassFactory pointer,
-    // we do it on the IUnknown pointer to follow this standard practice.
-    // This becomes particularly important with COM objects implementing multiple interfaces,
-    // as each interface implementation has its own IUnknown with reference counting.
-    reinterpret_cast<IUnknown*>(*ppv)->AddRef();
-    
-    // Return S_OK to indicate success.
-    return S_OK;
+    // The factory is an IUnknown and an IClassFactory, see the interface map above
+    return HelloWorldFactoryInterfaces::QueryInterface(this, riid, ppv);
 }
 
+// The factory is never deleted, a reference to it is a reference to the DLL.
+// The return values are only meant for debugging, like with any other object.
+// What is counted of the factory is its references, since there is only ever the one.
 ULONG __stdcall HelloWorldFactory::AddRef()
 {
-    return InterlockedIncrement(&m_cRef);
+    ModuleLock();
+    ModuleObjectCreated(ModuleObjectFactoryReference, NULL, 0);
+    return 2;
 }
 
 ULONG __stdcall HelloWorldFactory::Release()
 {
-    ULONG ulRefCount = InterlockedDecrement(&m_cRef);
-    if (0 == m_cRef)
-    {
-        delete this;
-    }
-    return ulRefCount;
+    ModuleObjectDestroyed(ModuleObjectFactoryReference, NULL, 0);
+    ModuleUnlock();
+    return 1;
 }
 
 HRESULT __stdcall HelloWorldFactory::CreateInstance(IUnknown* pUnkOuter, const IID& riid, void** ppv)
 {
+    HELLOWORLD_PROBE(ActivationStageCreateInstance);
+
     // Ensure the outer unknown (used for aggregation) is NULL. Aggregation is not supported in this example.
     if (pUnkOuter != NULL)
     {
@@ -64,7 +50,9 @@ HRESULT __stdcall HelloWorldFactory::CreateInstance(IUnknown* pUnkOuter, const I
     }
 
     // Attempt to obtain a pointer to the requested interface by calling the object's QueryInterface()
+    HELLOWORLD_PROBE_BEGIN(queryInterface);
     HRESULT hr = pHelloWorld->QueryInterface(riid, ppv);
+    HELLOWORLD_PROBE_END(queryInterface, ActivationStageQueryInterface);
     if (FAILED(hr))
     {
         // QueryInterface() failed, delete the HelloWorld object because no one else has a reference to clean it up
@@ -83,6 +71,17 @@ HRESULT __stdcall HelloWorldFactory::CreateInstance(IUnknown* pUnkOuter, const I
 
 HRESULT __stdcall HelloWorldFactory::LockServer(BOOL fLock)
 {
-    // Do nothing. We are not implementing server locking in this simple example.
+    // A client that holds a lock keeps the DLL loaded, even without any objects alive,
+    // so it can create objects later without loading the DLL again
+    if (fLock)
+    {
+        ModuleLock();
+        ModuleObjectCreated(ModuleObjectFactoryReference, NULL, 0);
+    }
+    else
+    {
+        ModuleObjectDestroyed(ModuleObjectFactoryReference, NULL, 0);
+        ModuleUnlock();
+    }
     return S_OK;
 }
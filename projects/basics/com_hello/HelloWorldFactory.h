@@ -1,12 +1,13 @@
 #pragma once
 #include <Windows.h>
 
+// The class object of HelloWorld. There is only one, in static storage (see
+// HelloWorldDll.cpp), so it doesn't count references to itself. Its references and server
+// locks keep the DLL loaded instead.
 class HelloWorldFactory : public IClassFactory
 {
-    long m_cRef;
-
 public:
-    HelloWorldFactory();
+    constexpr HelloWorldFactory() {}
 
     HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
     ULONG __stdcall AddRef();
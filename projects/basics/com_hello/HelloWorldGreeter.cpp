@@ -0,0 +1,414 @@
+#include "HelloWorldGreeter.h"
+#include "HelloWorld.h"
+#include "BstrAlloc.h"
+#include "HelloWorldStats.h"
+#include "ModuleAccounting.h"
+#include <stdlib.h>
+#include <new>
+
+EXTERN_C IMAGE_DOS_HEADER __ImageBase;
+
+// The thread pool all asynchronous calls run on, created with the first call
+static INIT_ONCE s_poolOnce = INIT_ONCE_STATIC_INIT;
+static PTP_POOL s_pool = NULL;
+static TP_CALLBACK_ENVIRON s_environment;
+static LONG s_maxQueued = 4096;
+static volatile LONG s_queued = 0;
+
+static DWORD ReadSetting(const wchar_t* name, DWORD fallback)
+{
+    WCHAR value[32];
+    DWORD cch = GetEnvironmentVariableW(name, value, ARRAYSIZE(value));
+    if (cch == 0 || cch >= ARRAYSIZE(value))
+    {
+        return fallback;
+    }
+    DWORD number = wcstoul(value, NULL, 10);
+    return (number > 0) ? number : fallback;
+}
+
+static BOOL CALLBACK CreatePool(PINIT_ONCE, PVOID, PVOID*)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    PTP_POOL pool = CreateThreadpool(NULL);
+    if (pool == NULL)
+    {
+        return FALSE;
+    }
+    SetThreadpoolThreadMaximum(pool, ReadSetting(L"HELLOWORLD_ASYNC_THREADS", info.dwNumberOfProcessors));
+    s_maxQueued = static_cast<LONG>(ReadSetting(L"HELLOWORLD_ASYNC_QUEUE", 4096));
+
+    // A callback releases its call object last, which may let the DLL be unloaded while the
+    // callback is still returning into it. The pool keeps the DLL loaded until it has.
+    InitializeThreadpoolEnvironment(&s_environment);
+    SetThreadpoolCallbackPool(&s_environment, pool);
+    SetThreadpoolCallbackLibrary(&s_environment, &__ImageBase);
+    s_pool = pool;
+    return TRUE;
+}
+
+// One asynchronous SayHelloTo. Aggregatable, because when the call comes through a stub
+// the call manager of COM aggregates it and provides its ISynchronize.
+class HelloWorldGreeterCall : public AsyncIHelloWorldGreeter, public ICancelMethodCalls
+{
+    enum State { Idle, Pending, Done };
+
+    // The non-delegating IUnknown, which an aggregating outer object holds
+    class Inner : public IUnknown
+    {
+        HelloWorldGreeterCall* m_pCall;
+
+    public:
+        explicit Inner(HelloWorldGreeterCall* pCall) : m_pCall(pCall) {}
+        HRESULT __stdcall QueryInterface(const IID& riid, void** ppv) { return m_pCall->InnerQueryInterface(riid, ppv); }
+        ULONG __stdcall AddRef() { return InterlockedIncrement(&m_pCall->m_cRef); }
+        ULONG __stdcall Release()
+        {
+            long cRef = InterlockedDecrement(&m_pCall->m_cRef);
+            if (cRef == 0)
+            {
+                delete m_pCall;
+            }
+            return cRef;
+        }
+    } m_inner;
+
+    long m_cRef;
+    IUnknown* m_pUnkOuter;      // the aggregating object, or m_inner
+    IUnknown* m_pUnkEvent;      // the system event we aggregate for ISynchronize, unless aggregated ourselves
+    ISynchronize* m_pSync;      // part of the aggregate, so not a counted reference
+    HelloWorld* m_pHelloWorld;
+    volatile LONG m_state;
+    volatile LONG m_cancelled;
+    BSTR m_name;
+    BSTR m_greeting;
+    HRESULT m_hr;
+
+    HelloWorldGreeterCall(HelloWorld* pHelloWorld, IUnknown* pUnkOuter);
+    ~HelloWorldGreeterCall();
+
+    HRESULT InnerQueryInterface(const IID& riid, void** ppv);
+    static void CALLBACK Run(PTP_CALLBACK_INSTANCE instance, PVOID context);
+
+public:
+    static HRESULT Create(HelloWorld* pHelloWorld, IUnknown* pCtrlUnk, const IID& riid, IUnknown** ppv);
+
+    // IUnknown methods, delegating to the controlling unknown
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv) { return m_pUnkOuter->QueryInterface(riid, ppv); }
+    ULONG __stdcall AddRef() { return m_pUnkOuter->AddRef(); }
+    ULONG __stdcall Release() { return m_pUnkOuter->Release(); }
+
+    // AsyncIHelloWorldGreeter methods
+    HRESULT __stdcall Begin_SayHelloTo(BSTR name);
+    HRESULT __stdcall Finish_SayHelloTo(BSTR* greeting);
+
+    // ICancelMethodCalls methods
+    HRESULT __stdcall Cancel(ULONG ulSeconds);
+    HRESULT __stdcall TestCancel();
+};
+
+HelloWorldGreeterCall::HelloWorldGreeterCall(HelloWorld* pHelloWorld, IUnknown* pUnkOuter)
+    : m_inner(this), m_cRef(1), m_pUnkOuter(pUnkOuter ? pUnkOuter : &m_inner), m_pUnkEvent(NULL), m_pSync(NULL), m_pHelloWorld(pHelloWorld),
+      m_state(Idle), m_cancelled(0), m_name(NULL), m_greeting(NULL), m_hr(S_OK)
+{
+    m_pHelloWorld->AddRef();
+    ModuleObjectCreated(ModuleObjectGreeterCall, this, sizeof(*this));
+}
+
+HelloWorldGreeterCall::~HelloWorldGreeterCall()
+{
+    if (m_pUnkEvent != NULL)
+    {
+        m_pUnkEvent->Release();
+    }
+    BstrFreeHeld(m_name);
+    BstrFreeHeld(m_greeting);
+    m_pHelloWorld->Release();
+    ModuleObjectDestroyed(ModuleObjectGreeterCall, this, sizeof(*this));
+}
+
+HRESULT HelloWorldGreeterCall::Create(HelloWorld* pHelloWorld, IUnknown* pCtrlUnk, const IID& riid, IUnknown** ppv)
+{
+    // An aggregated object hands out its non-delegating IUnknown only
+    if (pCtrlUnk != NULL && riid != IID_IUnknown)
+    {
+        return CLASS_E_NOAGGREGATION;
+    }
+
+    HelloWorldGreeterCall* call = new (std::nothrow) HelloWorldGreeterCall(pHelloWorld, pCtrlUnk);
+    if (call == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // Called in-process there's no call manager, so we bring the event ourselves
+    HRESULT hr = S_OK;
+    if (pCtrlUnk == NULL)
+    {
+        hr = CoCreateInstance(CLSID_ManualResetEvent, &call->m_inner, CLSCTX_INPROC_SERVER, IID_IUnknown, reinterpret_cast<void**>(&call->m_pUnkEvent));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = call->m_pUnkOuter->QueryInterface(IID_ISynchronize, reinterpret_cast<void**>(&call->m_pSync));
+    }
+    if (SUCCEEDED(hr))
+    {
+        // The aggregate holds the event, don't let our own pointer keep ourselves alive
+        call->m_pSync->Release();
+        hr = call->m_inner.QueryInterface(riid, reinterpret_cast<void**>(ppv));
+    }
+    call->m_inner.Release();
+    return hr;
+}
+
+HRESULT HelloWorldGreeterCall::InnerQueryInterface(const IID& riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == IID_IUnknown)
+    {
+        *ppv = static_cast<IUnknown*>(&m_inner);
+    }
+    else if (riid == IID_AsyncIHelloWorldGreeter)
+    {
+        *ppv = static_cast<AsyncIHelloWorldGreeter*>(this);
+    }
+    else if (riid == IID_ICancelMethodCalls)
+    {
+        *ppv = static_cast<ICancelMethodCalls*>(this);
+    }
+    else if (m_pUnkEvent != NULL && (riid == IID_ISynchronize || riid == IID_ISynchronizeHandle))
+    {
+        return m_pUnkEvent->QueryInterface(riid, ppv);
+    }
+    else
+    {
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    reinterpret_cast<IUnknown*>(*ppv)->AddRef();
+    return S_OK;
+}
+
+HRESULT __stdcall HelloWorldGreeterCall::Begin_SayHelloTo(BSTR name)
+{
+    if (!InitOnceExecuteOnce(&s_poolOnce, CreatePool, NULL, NULL))
+    {
+        return E_OUTOFMEMORY;
+    }
+    if (InterlockedCompareExchange(&m_state, Pending, Idle) != Idle)
+    {
+        return RPC_S_CALLPENDING;
+    }
+
+    // [in] arguments only live until Begin_ returns. The greeting is locale-neutral, like
+    // the one of the synchronous call, see Run.
+    HRESULT hr = S_OK;
+    m_name = SysAllocStringLen(name, SysStringLen(name));
+    BstrHold(m_name);
+    if (m_name == NULL && name != NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    else if (InterlockedIncrement(&s_queued) > s_maxQueued)
+    {
+        InterlockedDecrement(&s_queued);
+        hr = RPC_E_SERVER_TOO_BUSY;
+    }
+    else
+    {
+        InterlockedExchange(&m_cancelled, 0);
+        m_pSync->Reset();
+
+        // The pool holds a reference until the call has run
+        AddRef();
+        if (!TrySubmitThreadpoolCallback(Run, this, &s_environment))
+        {
+            InterlockedDecrement(&s_queued);
+            Release();
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        BstrFreeHeld(m_name);
+        m_name = NULL;
+        InterlockedExchange(&m_state, Idle);
+    }
+    return hr;
+}
+
+void CALLBACK HelloWorldGreeterCall::Run(PTP_CALLBACK_INSTANCE, PVOID context)
+{
+    HelloWorldGreeterCall* call = static_cast<HelloWorldGreeterCall*>(context);
+    InterlockedDecrement(&s_queued);
+
+    if (ReadAcquire(&call->m_cancelled))
+    {
+        call->m_hr = RPC_E_CALL_CANCELED;
+    }
+    else
+    {
+        // Neutral, like the SayHelloTo this is the asynchronous form of
+        HelloWorldCallTimer timer(HelloWorldMethodSayHelloTo, HelloWorldCallAsync);
+        call->m_hr = timer.Done(call->m_pHelloWorld->SayHelloToInLocale(call->m_name, static_cast<DispLcid>(LOCALE_INVARIANT), &call->m_greeting));
+    }
+    BstrFreeHeld(call->m_name);
+    call->m_name = NULL;
+
+    // Held until Finish_ hands it to the caller
+    BstrHold(call->m_greeting);
+
+    // Signal last but one: it may hand the call over to Finish_ on another thread
+    InterlockedExchange(&call->m_state, Done);
+    call->m_pSync->Signal();
+    call->Release();
+}
+
+HRESULT __stdcall HelloWorldGreeterCall::Finish_SayHelloTo(BSTR* greeting)
+{
+    if (greeting == NULL)
+    {
+        return E_POINTER;
+    }
+    *greeting = NULL;
+    if (ReadAcquire(&m_state) == Idle)
+    {
+        return E_UNEXPECTED;
+    }
+
+    HRESULT hr = m_pSync->Wait(0, INFINITE);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // The greeting is the caller's now, and the call object is ready for the next call
+    BstrHandOut(m_greeting);
+    *greeting = m_greeting;
+    m_greeting = NULL;
+    hr = m_hr;
+    InterlockedExchange(&m_state, Idle);
+    return hr;
+}
+
+// Cancels the call if it hasn't started yet. A call that is running finishes normally.
+// Cancel and TestCancel may come from any thread while Run reads the flag on the pool.
+HRESULT __stdcall HelloWorldGreeterCall::Cancel(ULONG)
+{
+    if (ReadAcquire(&m_state) != Pending)
+    {
+        return RPC_E_CALL_COMPLETE;
+    }
+    InterlockedExchange(&m_cancelled, 1);
+    return S_OK;
+}
+
+HRESULT __stdcall HelloWorldGreeterCall::TestCancel()
+{
+    if (ReadAcquire(&m_state) != Pending)
+    {
+        return RPC_E_CALL_COMPLETE;
+    }
+    return ReadAcquire(&m_cancelled) ? RPC_E_CALL_CANCELED : RPC_S_CALLPENDING;
+}
+
+HelloWorldGreeter::HelloWorldGreeter(HelloWorld* pHelloWorld) : m_cRef(1), m_pHelloWorld(pHelloWorld)
+{
+    m_pHelloWorld->AddRef();
+    ModuleObjectCreated(ModuleObjectGreeter, this, sizeof(*this));
+}
+
+HelloWorldGreeter::~HelloWorldGreeter()
+{
+    m_pHelloWorld->Release();
+    ModuleObjectDestroyed(ModuleObjectGreeter, this, sizeof(*this));
+}
+
+HRESULT HelloWorldGreeter::Create(HelloWorld* pHelloWorld, const IID& riid, void** ppv)
+{
+    HelloWorldGreeter* pGreeter = new (std::nothrow) HelloWorldGreeter(pHelloWorld);
+    if (pGreeter == NULL)
+    {
+        *ppv = NULL;
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = pGreeter->QueryInterface(riid, ppv);
+    pGreeter->Release();
+    return hr;
+}
+
+HRESULT __stdcall HelloWorldGreeter::QueryInterface(const IID& riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == IID_IHelloWorldGreeter)
+    {
+        *ppv = static_cast<IHelloWorldGreeter*>(this);
+    }
+    else if (riid == IID_ICallFactory)
+    {
+        *ppv = static_cast<ICallFactory*>(this);
+    }
+    else
+    {
+        // Everything else, IUnknown included, is the HelloWorld's, so the tear-off shares
+        // its identity
+        return m_pHelloWorld->QueryInterface(riid, ppv);
+    }
+    AddRef();
+    return S_OK;
+}
+
+ULONG __stdcall HelloWorldGreeter::AddRef()
+{
+    return InterlockedIncrement(&m_cRef);
+}
+
+ULONG __stdcall HelloWorldGreeter::Release()
+{
+    long cRef = InterlockedDecrement(&m_cRef);
+    if (cRef == 0)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+HRESULT __stdcall HelloWorldGreeter::SayHelloTo(BSTR name, BSTR* greeting)
+{
+    return m_pHelloWorld->SayHelloTo(name, greeting);
+}
+
+void HelloWorldGreeter::ClosePool()
+{
+    if (s_pool != NULL)
+    {
+        DestroyThreadpoolEnvironment(&s_environment);
+        CloseThreadpool(s_pool);
+        s_pool = NULL;
+    }
+}
+
+HRESULT __stdcall HelloWorldGreeter::CreateCall(const IID& riid, IUnknown* pCtrlUnk, const IID& riid2, IUnknown** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+    if (riid != IID_AsyncIHelloWorldGreeter)
+    {
+        return E_NOINTERFACE;
+    }
+    return HelloWorldGreeterCall::Create(m_pHelloWorld, pCtrlUnk, riid2, ppv);
+}
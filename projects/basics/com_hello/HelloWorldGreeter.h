@@ -0,0 +1,57 @@
+#pragma once
+#include "./midl/IHelloWorld.h"
+
+class HelloWorld;
+
+// IHelloWorldGreeter, and through ICallFactory its asynchronous twin AsyncIHelloWorldGreeter.
+//
+// HelloWorld hands both out as a tear-off: a small object made on QueryInterface that holds
+// a reference to its HelloWorld. Objects nobody asks for them don't carry a vtable pointer
+// for them, see the footprint note in HelloWorld.cpp.
+//
+// An asynchronous call, the COM way:
+//
+//     ICallFactory* pFactory;
+//     pGreeter->QueryInterface(IID_ICallFactory, (void**)&pFactory);
+//     AsyncIHelloWorldGreeter* pCall;
+//     pFactory->CreateCall(IID_AsyncIHelloWorldGreeter, NULL, IID_AsyncIHelloWorldGreeter, (IUnknown**)&pCall);
+//
+//     pCall->Begin_SayHelloTo(name);          // returns right away
+//     ...
+//     pCall->Finish_SayHelloTo(&greeting);    // waits for the greeting if it isn't there yet
+//
+// The call object is the handle of its call: QueryInterface it for ISynchronize to wait
+// for the completion, or for ICancelMethodCalls to cancel a call that hasn't started yet.
+// After Finish_ it may be used for the next call.
+//
+// The calls of all objects run on one thread pool. HELLOWORLD_ASYNC_THREADS sets how many
+// threads it may have (the number of processors by default), HELLOWORLD_ASYNC_QUEUE how
+// many calls may wait for a thread (4096 by default). Begin_ fails with
+// RPC_E_SERVER_TOO_BUSY beyond that, instead of letting the backlog grow without end.
+class HelloWorldGreeter : public IHelloWorldGreeter, public ICallFactory
+{
+    long m_cRef;
+    HelloWorld* m_pHelloWorld;
+
+    explicit HelloWorldGreeter(HelloWorld* pHelloWorld);
+    ~HelloWorldGreeter();
+
+public:
+    // Makes a tear-off for 'pHelloWorld' and asks it for 'riid'
+    static HRESULT Create(HelloWorld* pHelloWorld, const IID& riid, void** ppv);
+
+    // IUnknown methods
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
+    ULONG __stdcall AddRef();
+    ULONG __stdcall Release();
+
+    // IHelloWorldGreeter methods
+    HRESULT __stdcall SayHelloTo(BSTR name, BSTR* greeting);
+
+    // ICallFactory methods
+    HRESULT __stdcall CreateCall(const IID& riid, IUnknown* pCtrlUnk, const IID& riid2, IUnknown** ppv);
+
+    // Closes the thread pool of the asynchronous calls, if there is one. Only for
+    // DLL_PROCESS_DETACH on FreeLibrary, when no call can be running anymore.
+    static void ClosePool();
+};
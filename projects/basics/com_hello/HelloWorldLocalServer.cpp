@@ -0,0 +1,203 @@
+#include "LocalServer.h"
+#include "SharedMemory.h"
+#include "HelloWorld.h"
+#include "gen/IHelloWorld_wire.h"
+#include <iostream>
+
+// HelloWorld objects lock the module they live in, so a DLL knows when it may be unloaded.
+// This process serves until it is stopped, so there is nothing to count.
+void ModuleLock() {}
+void ModuleUnlock() {}
+
+// Serves one client connection with its own HelloWorld object
+static DWORD WINAPI ServeConnection(LPVOID param)
+{
+    SOCKET s = reinterpret_cast<SOCKET>(param);
+    HelloWorld* pHelloWorld = new HelloWorld;
+    if (pHelloWorld == NULL)
+    {
+        closesocket(s);
+        return 0;
+    }
+
+    LocalServerFrameReader frames;
+    WireWriter reply;
+    WireWriter replies;
+    bool connected = true;
+    while (connected && frames.Receive(s))
+    {
+        // Answer every request that came in with this receive, then send all the replies
+        // with a single write
+        UINT32 id;
+        const BYTE* message;
+        UINT32 size;
+        HRESULT hr;
+        while ((hr = frames.Next(&id, &message, &size)) == S_OK)
+        {
+            WireReader request(message, size);
+            reply.Reset();
+            hr = IHelloWorldWireStub(pHelloWorld, request, reply);
+            if (FAILED(hr))
+            {
+                break;
+            }
+
+            LocalServerFrame frame = { static_cast<UINT32>(reply.Size()), id };
+            replies.PutBytes(&frame, sizeof(frame));
+            replies.PutBytes(reply.Data(), reply.Size());
+        }
+
+        // A request we can't decode leaves us out of step with the client, so drop it.
+        // The replies before it still go out.
+        connected = SUCCEEDED(hr) && !replies.Failed();
+        if (replies.Size() > 0 && !replies.Failed())
+        {
+            connected = LocalServerSendAll(s, replies.Data(), replies.Size()) && connected;
+        }
+        replies.Reset();
+    }
+
+    pHelloWorld->Release();
+    closesocket(s);
+    return 0;
+}
+
+static HRESULT AnswerRequest(void* context, WireReader& request, WireWriter& reply)
+{
+    return IHelloWorldWireStub(static_cast<HelloWorld*>(context), request, reply);
+}
+
+static SharedMemoryServer* s_sharedMemory = NULL;
+
+// Serves one shared memory channel with its own HelloWorld object
+static DWORD WINAPI ServeChannel(LPVOID param)
+{
+    UINT32 channel = static_cast<UINT32>(reinterpret_cast<UINT_PTR>(param));
+    HelloWorld* pHelloWorld = new HelloWorld;
+    if (pHelloWorld != NULL)
+    {
+        s_sharedMemory->Serve(channel, AnswerRequest, pHelloWorld);
+        pHelloWorld->Release();
+    }
+    return 0;
+}
+
+// Serves the channels of a shared memory section, see SharedMemory.h
+static int ServeSharedMemory(const char* name)
+{
+    HRESULT hr = SharedMemoryServer::Create(name, SharedMemoryServer::kDefaultChannels, SharedMemoryServer::kDefaultSlotCount,
+                                            SharedMemoryServer::kDefaultSlotSize, &s_sharedMemory);
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to create the shared memory section. Error code = " << hr << "\n";
+        return 1;
+    }
+
+    UINT32 channels = s_sharedMemory->ChannelCount();
+    for (UINT32 i = 0; i < channels; ++i)
+    {
+        HANDLE thread = CreateThread(NULL, 0, ServeChannel, reinterpret_cast<LPVOID>(static_cast<UINT_PTR>(i)), 0, NULL);
+        if (thread == NULL)
+        {
+            std::cerr << "Failed to start the thread of channel " << i << "\n";
+            return 1;
+        }
+        CloseHandle(thread);
+    }
+
+    std::cout << "HelloWorld is serving " << channels << " shared memory channels as " << (name ? name : "HelloWorld") << "\n";
+    Sleep(INFINITE);
+    return 0;
+}
+
+// Usage: HelloWorldLocalServer [socket path]
+//        HelloWorldLocalServer /shm [section name]
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "/shm") == 0)
+    {
+        HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        if (FAILED(hr))
+        {
+            std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+            return 1;
+        }
+        return ServeSharedMemory(argc > 2 ? argv[2] : NULL);
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (argc > 1)
+    {
+        if (strcpy_s(address.sun_path, sizeof(address.sun_path), argv[1]) != 0)
+        {
+            std::cerr << "Socket path too long: " << argv[1] << "\n";
+            return 1;
+        }
+    }
+    else if (!GetLocalServerDefaultPath(address.sun_path, sizeof(address.sun_path)))
+    {
+        std::cerr << "Failed to determine the socket path\n";
+        return 1;
+    }
+
+    WSADATA wsaData;
+    int error = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (error != 0)
+    {
+        std::cerr << "WSAStartup failed. Error code = " << error << "\n";
+        return 1;
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        WSACleanup();
+        return 1;
+    }
+
+    // A socket file left behind by an earlier run would make bind fail, but one a server
+    // still listens on belongs to that server
+    if (LocalServerPathInUse(address.sun_path))
+    {
+        std::cerr << "Another server is listening on " << address.sun_path << "\n";
+        CoUninitialize();
+        WSACleanup();
+        return 1;
+    }
+    DeleteFileA(address.sun_path);
+
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET ||
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(listener, SOMAXCONN) == SOCKET_ERROR)
+    {
+        std::cerr << "Failed to listen on " << address.sun_path << ". Error code = " << WSAGetLastError() << "\n";
+        if (listener != INVALID_SOCKET)
+        {
+            closesocket(listener);
+        }
+        CoUninitialize();
+        WSACleanup();
+        return 1;
+    }
+
+    std::cout << "HelloWorld is listening on " << address.sun_path << "\n";
+    for (;;)
+    {
+        SOCKET s = accept(listener, NULL, NULL);
+        if (s == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        HANDLE thread = CreateThread(NULL, 0, ServeConnection, reinterpret_cast<LPVOID>(s), 0, NULL);
+        if (thread == NULL)
+        {
+            closesocket(s);
+            continue;
+        }
+        CloseHandle(thread);
+    }
+}
@@ -0,0 +1,228 @@
+#include "HelloWorldStats.h"
+#include "HelloWorld.h"
+#include "ModuleAccounting.h"
+#include <stdlib.h>
+
+// Turns HELLOWORLD_STATS_SAMPLE into the mask the timer uses, on the first call of the
+// process. Threads that race here all read the same setting.
+UINT32 HelloWorldCallTimer::ReadMask()
+{
+    UINT32 interval = 64;
+    WCHAR value[16];
+    DWORD cch = GetEnvironmentVariableW(L"HELLOWORLD_STATS_SAMPLE", value, ARRAYSIZE(value));
+    if (cch > 0 && cch < ARRAYSIZE(value))
+    {
+        interval = wcstoul(value, NULL, 10);
+    }
+
+    UINT32 mask = kMaskOff;
+    if (interval > 0)
+    {
+        // The next power of two, up to 2^31
+        for (mask = 0; mask < interval - 1 && mask < 0x7FFFFFFF; mask = mask * 2 + 1)
+        {
+        }
+    }
+    s_mask.store(mask, std::memory_order_relaxed);
+    return mask;
+}
+
+// Adds what the constructor couldn't know: that the call failed, how long it took
+void HelloWorldCallTimer::Record(HRESULT hr)
+{
+    if (FAILED(hr))
+    {
+        Counters::Add(m_first + kFailures, 1);
+    }
+    if (m_start == 0)
+    {
+        return;
+    }
+
+    UINT64 ticks = __rdtsc() - m_start;
+    UINT32 bucket = Buckets::Index(ticks);
+    Counters::Add(m_first + kFirstBucket + ((bucket < kBuckets) ? bucket : kBuckets - 1), 1);
+
+    std::atomic<UINT64>& maxTicks = s_maxTicks[m_first / kCountersPerMethod];
+    UINT64 max = maxTicks.load(std::memory_order_relaxed);
+    while (ticks > max && !maxTicks.compare_exchange_weak(max, ticks, std::memory_order_relaxed))
+    {
+    }
+}
+
+HelloWorldStats::HelloWorldStats(HelloWorld* pHelloWorld) : m_cRef(1), m_pHelloWorld(pHelloWorld)
+{
+    m_pHelloWorld->AddRef();
+    ModuleObjectCreated(ModuleObjectStats, this, sizeof(*this));
+}
+
+HelloWorldStats::~HelloWorldStats()
+{
+    m_pHelloWorld->Release();
+    ModuleObjectDestroyed(ModuleObjectStats, this, sizeof(*this));
+}
+
+HRESULT HelloWorldStats::Create(HelloWorld* pHelloWorld, const IID& riid, void** ppv)
+{
+    HelloWorldStats* pStats = new (std::nothrow) HelloWorldStats(pHelloWorld);
+    if (pStats == NULL)
+    {
+        *ppv = NULL;
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = pStats->QueryInterface(riid, ppv);
+    pStats->Release();
+    return hr;
+}
+
+HRESULT __stdcall HelloWorldStats::QueryInterface(const IID& riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == IID_IHelloWorldStats)
+    {
+        *ppv = static_cast<IHelloWorldStats*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    // Everything else, IUnknown included, is the HelloWorld's, so the tear-off shares its
+    // identity
+    return m_pHelloWorld->QueryInterface(riid, ppv);
+}
+
+ULONG __stdcall HelloWorldStats::AddRef()
+{
+    return InterlockedIncrement(&m_cRef);
+}
+
+ULONG __stdcall HelloWorldStats::Release()
+{
+    long cRef = InterlockedDecrement(&m_cRef);
+    if (cRef == 0)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+// The counters of one method and path, added up over all threads
+struct HelloWorldCallTotals
+{
+    LONG64 calls;
+    LONG64 failures;
+    LONG64 timed;
+    UINT64 maxTicks;
+    LONG64 buckets[HelloWorldCallTimer::kBuckets];
+};
+
+static HRESULT ReadTotals(HelloWorldMethod method, HelloWorldCallPath path, HelloWorldCallTotals* totals)
+{
+    if (static_cast<UINT32>(method) >= kHelloWorldMethodCount || static_cast<UINT32>(path) >= kHelloWorldCallPathCount)
+    {
+        return E_INVALIDARG;
+    }
+
+    // All counters of all methods, too many for the stack
+    typedef HelloWorldCallTimer::Counters Counters;
+    LONG64 (*all)[Counters::kCount] = new (std::nothrow) LONG64[1][Counters::kCount];
+    if (all == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    Counters::Read(*all);
+
+    UINT32 slot = method * kHelloWorldCallPathCount + path;
+    const LONG64* counters = *all + slot * HelloWorldCallTimer::kCountersPerMethod;
+    totals->calls = counters[HelloWorldCallTimer::kCalls];
+    totals->failures = counters[HelloWorldCallTimer::kFailures];
+    totals->timed = 0;
+    for (UINT32 i = 0; i < HelloWorldCallTimer::kBuckets; ++i)
+    {
+        totals->buckets[i] = counters[HelloWorldCallTimer::kFirstBucket + i];
+        totals->timed += totals->buckets[i];
+    }
+    totals->maxTicks = HelloWorldCallTimer::s_maxTicks[slot].load(std::memory_order_relaxed);
+    delete[] all;
+    return S_OK;
+}
+
+// The latency 'percent' of the timed calls stayed within, to bucket precision
+static LONGLONG Percentile(const HelloWorldCallTotals& totals, double percent)
+{
+    if (totals.timed == 0)
+    {
+        return 0;
+    }
+    LONG64 rank = static_cast<LONG64>(percent / 100.0 * totals.timed + 0.5);
+    rank = (rank == 0) ? 1 : rank;
+    UINT64 ticks = totals.maxTicks;
+    LONG64 seen = 0;
+    for (UINT32 i = 0; i < HelloWorldCallTimer::kBuckets; ++i)
+    {
+        seen += totals.buckets[i];
+        if (seen >= rank)
+        {
+            UINT64 bound = HelloWorldCallTimer::Buckets::UpperBound(i);
+            ticks = (bound < ticks) ? bound : ticks;
+            break;
+        }
+    }
+    return static_cast<LONGLONG>(ticks / LatencyTicksPerNanosecond());
+}
+
+HRESULT __stdcall HelloWorldStats::GetMethodStats(HelloWorldMethod method, HelloWorldCallPath path, HelloWorldMethodStats* stats)
+{
+    if (stats == NULL)
+    {
+        return E_POINTER;
+    }
+
+    HelloWorldCallTotals* totals = new (std::nothrow) HelloWorldCallTotals;
+    if (totals == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = ReadTotals(method, path, totals);
+    if (SUCCEEDED(hr))
+    {
+        stats->calls = totals->calls;
+        stats->failures = totals->failures;
+        stats->timed = totals->timed;
+        stats->p50 = Percentile(*totals, 50);
+        stats->p90 = Percentile(*totals, 90);
+        stats->p99 = Percentile(*totals, 99);
+        stats->max = (totals->timed > 0) ? static_cast<LONGLONG>(totals->maxTicks / LatencyTicksPerNanosecond()) : 0;
+    }
+    delete totals;
+    return hr;
+}
+
+HRESULT __stdcall HelloWorldStats::GetLatencyPercentile(HelloWorldMethod method, HelloWorldCallPath path, double percent, hyper* nanoseconds)
+{
+    if (nanoseconds == NULL)
+    {
+        return E_POINTER;
+    }
+    *nanoseconds = 0;
+    if (!(percent >= 0 && percent <= 100))
+    {
+        return E_INVALIDARG;
+    }
+
+    HelloWorldCallTotals* totals = new (std::nothrow) HelloWorldCallTotals;
+    if (totals == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = ReadTotals(method, path, totals);
+    if (SUCCEEDED(hr))
+    {
+        *nanoseconds = Percentile(*totals, percent);
+    }
+    delete totals;
+    return hr;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "./midl/IHelloWorld.h"
+#include "LatencyBuckets.h"
+#include "PerThreadCounters.h"
+#include <atomic>
+
+class HelloWorld;
+
+// How often the methods of IHelloWorld run and how long they take, for every HelloWorld in
+// the process, told apart by whether the caller came through the vtable, through
+// IDispatch::Invoke or asynchronously through IHelloWorldGreeter. An asynchronous call is
+// counted and timed on the pool thread that runs it, so its latency leaves out the time it
+// waited for a thread; calls the pool turned away or cancelled before they ran aren't
+// counted at all.
+//
+// Every method call is counted, on counters of the calling thread's own (see
+// PerThreadCounters.h), so callers never contend for a cache line. One call in
+// HELLOWORLD_STATS_SAMPLE of every method on every thread (64 by default, rounded up to a
+// power of two) is also timed with the time stamp counter and goes into a log-linear
+// latency histogram of 8 buckets per power of two, kept on the same per-thread counters.
+// HELLOWORLD_STATS_SAMPLE=1 times every call, 0 turns the statistics off, counts included.
+//
+// Readers add up the shards of all threads when they ask, without stopping any caller.
+// What they get may be a few calls behind, never torn:
+//
+//     IHelloWorldStats* pStats;
+//     pHelloWorld->QueryInterface(IID_IHelloWorldStats, (void**)&pStats);
+//     HelloWorldMethodStats stats;
+//     pStats->GetMethodStats(HelloWorldMethodSayHelloTo, HelloWorldCallVtable, &stats);
+//
+// The first read calibrates the time stamp counter, which takes 20 ms.
+const UINT32 kHelloWorldMethodCount = HelloWorldMethodSayHelloToMany + 1;
+const UINT32 kHelloWorldCallPathCount = HelloWorldCallAsync + 1;
+
+// Times one call. Made on entry to the method, Done with its result on the way out:
+//
+//     HelloWorldCallTimer timer(HelloWorldMethodSayHello, HelloWorldCallVtable);
+//     return timer.Done(SayHelloUntimed());
+class HelloWorldCallTimer
+{
+public:
+    typedef LatencyBuckets<3> Buckets;
+    static const UINT32 kBuckets = Buckets::Count(32);     // calls of 2^32 ticks and longer share the last
+    static const UINT32 kCalls = 0;
+    static const UINT32 kFailures = 1;
+    static const UINT32 kFirstBucket = 2;
+    static const UINT32 kCountersPerMethod = kFirstBucket + kBuckets;
+
+    struct CountersTag;
+    typedef PerThreadCounters<CountersTag, kHelloWorldMethodCount * kHelloWorldCallPathCount * kCountersPerMethod> Counters;
+
+    // The longest call so far of each method and path. Written only when a call beats it,
+    // which soon becomes rare, so the line stays shared between the callers.
+    inline static std::atomic<UINT64> s_maxTicks[kHelloWorldMethodCount * kHelloWorldCallPathCount];
+
+private:
+    // A call is timed when the thread's count of calls, masked with this, is zero
+    static const UINT32 kMaskUnread = 0xFFFFFFFF;   // HELLOWORLD_STATS_SAMPLE not read yet
+    static const UINT32 kMaskOff = 0xFFFFFFFE;      // no statistics
+    inline static std::atomic<UINT32> s_mask{kMaskUnread};
+
+    UINT32 m_first;     // the first counter of the method and path
+    UINT32 m_mask;
+    UINT64 m_start;     // 0 if this call isn't timed
+
+    static UINT32 ReadMask();
+    void Record(HRESULT hr);
+
+public:
+    // Counting the call here, on the way in, is what tells whether to time it, so a call
+    // that isn't timed looks up the thread's counters only once
+    HelloWorldCallTimer(HelloWorldMethod method, HelloWorldCallPath path)
+        : m_first((method * kHelloWorldCallPathCount + path) * kCountersPerMethod), m_mask(s_mask.load(std::memory_order_relaxed)), m_start(0)
+    {
+        if (m_mask == kMaskUnread)
+        {
+            m_mask = ReadMask();
+        }
+        if (m_mask != kMaskOff && (Counters::Add(m_first + kCalls, 1) & m_mask) == 0)
+        {
+            m_start = __rdtsc();
+        }
+    }
+
+    HRESULT Done(HRESULT hr)
+    {
+        if (m_start != 0 || (FAILED(hr) && m_mask != kMaskOff))
+        {
+            Record(hr);
+        }
+        return hr;
+    }
+
+    HelloWorldCallTimer(const HelloWorldCallTimer&) = delete;
+    HelloWorldCallTimer& operator=(const HelloWorldCallTimer&) = delete;
+};
+
+// IHelloWorldStats, a tear-off like HelloWorldGreeter: objects nobody asks for it don't
+// carry a vtable pointer for it.
+class HelloWorldStats : public IHelloWorldStats
+{
+    long m_cRef;
+    HelloWorld* m_pHelloWorld;
+
+    explicit HelloWorldStats(HelloWorld* pHelloWorld);
+    ~HelloWorldStats();
+
+public:
+    // Makes a tear-off for 'pHelloWorld' and asks it for 'riid'
+    static HRESULT Create(HelloWorld* pHelloWorld, const IID& riid, void** ppv);
+
+    // IUnknown methods
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv);
+    ULONG __stdcall AddRef();
+    ULONG __stdcall Release();
+
+    // IHelloWorldStats methods
+    HRESULT __stdcall GetMethodStats(HelloWorldMethod method, HelloWorldCallPath path, HelloWorldMethodStats* stats);
+    HRESULT __stdcall GetLatencyPercentile(HelloWorldMethod method, HelloWorldCallPath path, double percent, hyper* nanoseconds);
+};
@@ -0,0 +1,209 @@
+#include "SurrogatePool.h"
+#include <iostream>
+#include <stdlib.h>
+
+// Requests relayed to a worker at once, before we wait for the first reply
+static const UINT32 kMaxBatch = 64;
+
+static SurrogatePool s_pool;
+
+// Relays one client connection to the worker that hosts its object
+static DWORD WINAPI RelayConnection(LPVOID param)
+{
+    SOCKET client = reinterpret_cast<SOCKET>(param);
+
+    UINT32 worker;
+    char path[MAX_PATH];
+    LocalServerConnection* connection = NULL;
+    if (FAILED(s_pool.Activate(&worker, path, MAX_PATH)) || FAILED(LocalServerConnection::Connect(path, &connection)))
+    {
+        closesocket(client);
+        return 0;
+    }
+
+    LocalServerCall* calls[kMaxBatch] = {};
+    UINT32 ids[kMaxBatch];
+    LocalServerFrameReader frames;
+    WireWriter request;
+    WireWriter replies;
+    bool connected = true;
+    while (connected && frames.Receive(client))
+    {
+        HRESULT hr;
+        do
+        {
+            // Pass on every request that came in with this receive, so they are all in
+            // flight on the worker at the same time
+            UINT32 count = 0;
+            UINT32 id;
+            const BYTE* message;
+            UINT32 size;
+            while (connected && count < kMaxBatch && (hr = frames.Next(&id, &message, &size)) == S_OK)
+            {
+                if (calls[count] == NULL)
+                {
+                    calls[count] = new (std::nothrow) LocalServerCall(connection);
+                }
+                request.Reset();
+                request.PutBytes(message, size);
+
+                s_pool.CallStarted(worker);
+                if (calls[count] == NULL || FAILED(calls[count]->Begin(request)))
+                {
+                    s_pool.CallFinished(worker);
+                    connected = false;
+                    break;
+                }
+                ids[count++] = id;
+            }
+
+            // The replies go back with the ids the client chose, all in a single write
+            for (UINT32 i = 0; i < count; ++i)
+            {
+                WireReader reply;
+                HRESULT callHr = calls[i]->End(&reply);
+                s_pool.CallFinished(worker);
+                if (FAILED(callHr))
+                {
+                    // The worker died, and with it the object of this client
+                    connected = false;
+                    continue;
+                }
+                LocalServerFrame frame = { static_cast<UINT32>(reply.Size()), ids[i] };
+                replies.PutBytes(&frame, sizeof(frame));
+                replies.PutBytes(reply.Data(), reply.Size());
+            }
+
+            connected = connected && !replies.Failed();
+            if (replies.Size() > 0 && connected)
+            {
+                connected = LocalServerSendAll(client, replies.Data(), replies.Size());
+            }
+            replies.Reset();
+        } while (connected && hr == S_OK);
+
+        // A request we can't decode leaves us out of step with the client
+        connected = connected && SUCCEEDED(hr);
+    }
+
+    for (UINT32 i = 0; i < kMaxBatch; ++i)
+    {
+        delete calls[i];
+    }
+    delete connection;
+    closesocket(client);
+    return 0;
+}
+
+static const char* StateName(SurrogateWorkerState state)
+{
+    switch (state)
+    {
+    case SurrogateWorkerStandby: return "standby";
+    case SurrogateWorkerActive: return "active";
+    case SurrogateWorkerFailed: return "failed";
+    default: return "starting";
+    }
+}
+
+// Prints the counters of every worker, and the calls per second since the last time
+static DWORD WINAPI PrintStats(LPVOID param)
+{
+    DWORD interval = static_cast<DWORD>(reinterpret_cast<UINT_PTR>(param));
+    SurrogateWorkerStats stats[SurrogatePool::kMaxWorkers];
+    LONGLONG previous[SurrogatePool::kMaxWorkers] = {};
+    for (;;)
+    {
+        Sleep(interval * 1000);
+        UINT32 count = s_pool.GetStats(stats, SurrogatePool::kMaxWorkers);
+        for (UINT32 i = 0; i < count; ++i)
+        {
+            std::cout << "worker " << i << " (" << StateName(stats[i].state) << ", pid " << stats[i].processId << "): "
+                      << stats[i].outstanding << " in flight, " << stats[i].activations << " objects, "
+                      << stats[i].calls << " calls, " << (stats[i].calls - previous[i]) / interval << " calls/s, "
+                      << stats[i].restarts << " restarts\n";
+            previous[i] = stats[i].calls;
+        }
+    }
+}
+
+// Usage: HelloWorldSurrogate [active workers] [standby workers] [stats interval in seconds]
+int main(int argc, char** argv)
+{
+    UINT32 active = (argc > 1) ? strtoul(argv[1], NULL, 10) : 4;
+    UINT32 standby = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1;
+    DWORD interval = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (!GetLocalServerDefaultPath(address.sun_path, sizeof(address.sun_path)))
+    {
+        std::cerr << "Failed to determine the socket path\n";
+        return 1;
+    }
+
+    WSADATA wsaData;
+    int error = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (error != 0)
+    {
+        std::cerr << "WSAStartup failed. Error code = " << error << "\n";
+        return 1;
+    }
+
+    // Another surrogate or local server may have the path. Taking it from them would leave
+    // their clients connected to a server nobody can reach any more.
+    if (LocalServerPathInUse(address.sun_path))
+    {
+        std::cerr << "Another server is listening on " << address.sun_path << "\n";
+        WSACleanup();
+        return 1;
+    }
+
+    HRESULT hr = s_pool.Start(active, standby);
+    if (FAILED(hr))
+    {
+        std::cerr << "Failed to start the workers. Error code = " << hr << "\n";
+        WSACleanup();
+        return 1;
+    }
+
+    // Clients connect to us as if we were a single HelloWorldLocalServer. A socket file left
+    // behind by an earlier run would make bind fail.
+    DeleteFileA(address.sun_path);
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET ||
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(listener, SOMAXCONN) == SOCKET_ERROR)
+    {
+        std::cerr << "Failed to listen on " << address.sun_path << ". Error code = " << WSAGetLastError() << "\n";
+        WSACleanup();
+        return 1;
+    }
+
+    if (interval > 0)
+    {
+        HANDLE thread = CreateThread(NULL, 0, PrintStats, reinterpret_cast<LPVOID>(static_cast<UINT_PTR>(interval)), 0, NULL);
+        if (thread != NULL)
+        {
+            CloseHandle(thread);
+        }
+    }
+
+    std::cout << "HelloWorld surrogate with " << active << " active and " << standby << " standby workers is listening on " << address.sun_path << "\n";
+    for (;;)
+    {
+        SOCKET s = accept(listener, NULL, NULL);
+        if (s == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        HANDLE thread = CreateThread(NULL, 0, RelayConnection, reinterpret_cast<LPVOID>(s), 0, NULL);
+        if (thread == NULL)
+        {
+            closesocket(s);
+            continue;
+        }
+        CloseHandle(thread);
+    }
+}
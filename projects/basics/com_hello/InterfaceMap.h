@@ -0,0 +1,91 @@
+#pragma once
+#include <Windows.h>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define INTERFACEMAP_SSE2
+#endif
+
+// A QueryInterface built from a compile-time list of the interfaces a class implements.
+//
+// Each entry binds an IID to the interface (base class) that QueryInterface hands out for
+// it. Several IIDs may map to the same interface, like IUnknown, IDispatch and IHelloWorld
+// all do for a dual interface. IID_IUnknown must always map to the same interface, that
+// pointer is the object's identity.
+//
+//     typedef InterfaceMap<HelloWorld,
+//         InterfaceEntry<IHelloWorld, &IID_IUnknown>,
+//         InterfaceEntry<IHelloWorld, &IID_IDispatch>,
+//         InterfaceEntry<IHelloWorld, &IID_IHelloWorld>> HelloWorldInterfaces;
+//
+// The requested IID is loaded once and compared to each entry with a single 16-byte vector
+// compare. On a hit the cast to the interface is a constant pointer adjustment and the
+// object's AddRef is called directly instead of through the vtable.
+template <class I, const IID* Iid>
+struct InterfaceEntry
+{
+    typedef I Interface;
+    static constexpr const IID* iid = Iid;
+};
+
+#ifdef INTERFACEMAP_SSE2
+typedef __m128i InterfaceMapKey;
+
+inline InterfaceMapKey InterfaceMapLoad(const IID* iid)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(iid));
+}
+
+inline bool InterfaceMapEquals(InterfaceMapKey key, const IID* iid)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(key, InterfaceMapLoad(iid))) == 0xFFFF;
+}
+#else
+typedef const IID* InterfaceMapKey;
+
+inline InterfaceMapKey InterfaceMapLoad(const IID* iid)
+{
+    return iid;
+}
+
+inline bool InterfaceMapEquals(InterfaceMapKey key, const IID* iid)
+{
+    return InlineIsEqualGUID(*key, *iid) != 0;
+}
+#endif
+
+template <class C, class... Entries>
+class InterfaceMap
+{
+    template <class E>
+    static bool TryEntry(C* self, InterfaceMapKey key, void** ppv)
+    {
+        if (!InterfaceMapEquals(key, E::iid))
+        {
+            return false;
+        }
+        *ppv = static_cast<typename E::Interface*>(self);
+        return true;
+    }
+
+public:
+    // Implements IUnknown::QueryInterface on behalf of 'self'. Returns E_NOINTERFACE for
+    // IIDs that are not in the map, so the caller may still handle them by hand.
+    static HRESULT QueryInterface(C* self, REFIID riid, void** ppv)
+    {
+        if (ppv == NULL)
+        {
+            return E_POINTER;
+        }
+
+        InterfaceMapKey key = InterfaceMapLoad(&riid);
+        if (!(... || TryEntry<Entries>(self, key, ppv)))
+        {
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+
+        // Every entry is implemented by C itself, so its AddRef can be called directly
+        self->C::AddRef();
+        return S_OK;
+    }
+};
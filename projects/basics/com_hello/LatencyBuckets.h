@@ -0,0 +1,71 @@
+#pragma once
+#include <Windows.h>
+#include <intrin.h>
+
+// Log-linear buckets for latencies measured in time stamp counter ticks. Every power of two
+// is split into 2^SubBucketBits buckets of equal width, so a value is known to within
+// 1/2^SubBucketBits whatever its size, and values below 2^SubBucketBits have a bucket each.
+//
+// Both the activation probes (ActivationProbe.h) and the call statistics
+// (HelloWorldStats.h) count their latencies this way.
+template <UINT32 SubBucketBits>
+struct LatencyBuckets
+{
+    static const UINT32 kSubBuckets = 1u << SubBucketBits;
+
+    // How many buckets it takes to hold every value below 2^bits
+    static constexpr UINT32 Count(UINT32 bits)
+    {
+        return (bits - SubBucketBits + 1) * kSubBuckets;
+    }
+
+    // A value goes to the bucket of its highest bit and the SubBucketBits bits below it
+    static UINT32 Index(UINT64 value)
+    {
+        if (value < kSubBuckets)
+        {
+            return static_cast<UINT32>(value);
+        }
+        unsigned long msb;
+        if (_BitScanReverse(&msb, static_cast<unsigned long>(value >> 32)))
+        {
+            msb += 32;
+        }
+        else
+        {
+            _BitScanReverse(&msb, static_cast<unsigned long>(value));
+        }
+        return (msb - SubBucketBits + 1) * kSubBuckets + static_cast<UINT32>((value >> (msb - SubBucketBits)) & (kSubBuckets - 1));
+    }
+
+    // The largest value that goes to 'index'
+    static UINT64 UpperBound(UINT32 index)
+    {
+        if (index < kSubBuckets)
+        {
+            return index;
+        }
+        UINT32 shift = index / kSubBuckets - 1;
+        UINT64 first = static_cast<UINT64>(kSubBuckets + index % kSubBuckets) << shift;
+        return first + ((1ull << shift) - 1);
+    }
+};
+
+// The time stamp counter against the performance counter, measured once, the first time
+// ticks need to become nanoseconds. This takes 20 ms, so it is left to whoever reads the
+// latencies; the code that records them only ever reads the time stamp counter.
+inline double LatencyTicksPerNanosecond()
+{
+    static const double s_ticksPerNanosecond = []
+    {
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&start);
+        UINT64 ticks = __rdtsc();
+        Sleep(20);
+        QueryPerformanceCounter(&end);
+        ticks = __rdtsc() - ticks;
+        return ticks / ((end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart);
+    }();
+    return s_ticksPerNanosecond;
+}
@@ -0,0 +1,243 @@
+#pragma once
+// Winsock must come before Windows.h
+#include <winsock2.h>
+#include <afunix.h>
+#include <Windows.h>
+#include <stdio.h>
+#include "WireFormat.h"
+
+// HelloWorldLocalServer.exe runs HelloWorld objects in a process of their own and serves
+// them over a Unix domain socket (AF_UNIX, available since Windows 10 1803).
+//
+// Both directions carry frames: an 8-byte LocalServerFrame followed by a message in the
+// wire format of WireFormat.h. A request id travels with every frame, so a client may have
+// many calls in flight on one connection and match the replies as they come back. Every
+// connection gets its own HelloWorld object, like one CoCreateInstance.
+struct LocalServerFrame
+{
+    UINT32 size;    // bytes of the message that follows, a multiple of 4
+    UINT32 id;      // request id, echoed in the reply
+};
+
+// Frames beyond this size are treated as a broken connection
+const UINT32 kLocalServerMaxFrame = 64 * 1024 * 1024;
+
+// The socket path both sides use unless told otherwise: HelloWorld.sock in the temp folder
+inline bool GetLocalServerDefaultPath(char* path, size_t cch)
+{
+    char temp[MAX_PATH];
+    DWORD cchTemp = GetTempPathA(MAX_PATH, temp);
+    if (cchTemp == 0 || cchTemp >= MAX_PATH)
+    {
+        return false;
+    }
+    int written = _snprintf_s(path, cch, _TRUNCATE, "%sHelloWorld.sock", temp);
+    return written > 0;
+}
+
+// Whether a server listens on the socket path. A socket file nobody listens on was left
+// behind by a server that ended, and may be deleted. The caller must have called WSAStartup.
+inline bool LocalServerPathInUse(const char* path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (strcpy_s(address.sun_path, sizeof(address.sun_path), path) != 0)
+    {
+        return false;
+    }
+    SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET)
+    {
+        return false;
+    }
+    bool inUse = connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR;
+    closesocket(s);
+    return inUse;
+}
+
+// Sends the whole buffer, however many send calls that takes
+inline bool LocalServerSendAll(SOCKET s, const BYTE* data, size_t size)
+{
+    while (size > 0)
+    {
+        int chunk = (size > 0x40000000) ? 0x40000000 : static_cast<int>(size);
+        int sent = send(s, reinterpret_cast<const char*>(data), chunk, 0);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// Receives frames from a socket. A single recv usually brings several frames, which the
+// caller takes one by one before it receives again.
+class LocalServerFrameReader
+{
+    static const size_t kMinRead = 16 * 1024;
+
+    BYTE* m_data;
+    size_t m_begin;     // start of the first frame not taken yet
+    size_t m_end;       // end of the received bytes
+    size_t m_capacity;
+    size_t m_needed;    // size of the frame at m_begin, once its header is in
+
+    LocalServerFrameReader(const LocalServerFrameReader&) = delete;
+    LocalServerFrameReader& operator=(const LocalServerFrameReader&) = delete;
+
+public:
+    LocalServerFrameReader() : m_data(NULL), m_begin(0), m_end(0), m_capacity(0), m_needed(0) {}
+    ~LocalServerFrameReader() { ::operator delete(m_data); }
+
+    // Waits for more bytes. Returns false when the connection is closed or broken. Messages
+    // returned by Next before are invalid afterwards.
+    bool Receive(SOCKET s)
+    {
+        // Move the partial frame to the front, so the buffer doesn't grow without end.
+        // Frames are multiples of 4 bytes, so messages stay 4-byte aligned.
+        if (m_begin > 0)
+        {
+            memmove(m_data, m_data + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+
+        size_t wanted = m_end + ((m_needed > m_end) ? m_needed - m_end : 0) + kMinRead;
+        if (m_capacity < wanted)
+        {
+            BYTE* data = static_cast<BYTE*>(::operator new(wanted, std::nothrow));
+            if (data == NULL)
+            {
+                return false;
+            }
+            if (m_data != NULL)
+            {
+                memcpy(data, m_data, m_end);
+            }
+            ::operator delete(m_data);
+            m_data = data;
+            m_capacity = wanted;
+        }
+
+        size_t room = m_capacity - m_end;
+        int received = recv(s, reinterpret_cast<char*>(m_data + m_end), (room > 0x40000000) ? 0x40000000 : static_cast<int>(room), 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        m_end += received;
+        return true;
+    }
+
+    // Takes the next complete frame. Returns S_FALSE if more bytes are needed first, and
+    // RPC_E_INVALID_DATA if the stream is broken.
+    HRESULT Next(UINT32* id, const BYTE** message, UINT32* size)
+    {
+        size_t available = m_end - m_begin;
+        if (available < sizeof(LocalServerFrame))
+        {
+            m_needed = sizeof(LocalServerFrame);
+            return S_FALSE;
+        }
+
+        LocalServerFrame frame;
+        memcpy(&frame, m_data + m_begin, sizeof(frame));
+        if (frame.size % 4 != 0 || frame.size > kLocalServerMaxFrame)
+        {
+            return RPC_E_INVALID_DATA;
+        }
+        if (available - sizeof(frame) < frame.size)
+        {
+            m_needed = sizeof(frame) + frame.size;
+            return S_FALSE;
+        }
+
+        *id = frame.id;
+        *message = m_data + m_begin + sizeof(frame);
+        *size = frame.size;
+        m_begin += sizeof(frame) + frame.size;
+        m_needed = 0;
+        return S_OK;
+    }
+};
+
+class LocalServerConnection;
+
+// One call through a LocalServerConnection. Use it as the WireChannel of a generated proxy:
+//
+//     LocalServerCall call(connection);
+//     IHelloWorldWireProxy helloWorld(&call);
+//     helloWorld.SayHelloTo(name, &greeting);
+//
+// or, to have several calls in flight from one thread, Begin a request on each of a few
+// LocalServerCall objects and End them later. Each thread needs its own LocalServerCall.
+class LocalServerCall : public WireChannel
+{
+    friend class LocalServerConnection;
+
+    LocalServerConnection* m_connection;
+    LocalServerCall* m_next;    // in the connection's list of calls in flight
+    UINT32 m_id;
+    HRESULT m_hr;
+    HANDLE m_done;
+    WireWriter m_reply;
+
+    LocalServerCall(const LocalServerCall&) = delete;
+    LocalServerCall& operator=(const LocalServerCall&) = delete;
+
+public:
+    explicit LocalServerCall(LocalServerConnection* connection);
+    ~LocalServerCall();
+
+    // Sends the request and returns without waiting for the reply
+    HRESULT Begin(const WireWriter& request);
+
+    // Waits for the reply of the request started by Begin. The reply stays valid until
+    // the next Begin.
+    HRESULT End(WireReader* reply);
+
+    // WireChannel
+    HRESULT Call(const WireWriter& request, WireReader* reply);
+};
+
+// A connection to HelloWorldLocalServer.exe that any number of threads can share.
+//
+// Calls are pipelined: a thread sends its request and waits for its own reply only, while
+// other threads keep sending. Requests that pile up while a send is in progress are sent
+// together by the next send, so under load many small requests share one write. A reader
+// thread takes the replies off the socket and hands each to its call.
+class LocalServerConnection
+{
+    friend class LocalServerCall;
+
+    SOCKET m_socket;
+    HANDLE m_reader;
+    SRWLOCK m_lock;                 // guards everything below
+    UINT32 m_nextId;
+    bool m_sending;                 // a thread is sending, it also sends what we queue
+    bool m_closed;
+    LocalServerCall* m_first;       // calls in flight, in the order they were sent
+    LocalServerCall* m_last;
+    WireWriter m_buffers[2];
+    WireWriter* m_queued;           // frames waiting to be sent
+
+    LocalServerConnection(SOCKET s);
+    LocalServerConnection(const LocalServerConnection&) = delete;
+    LocalServerConnection& operator=(const LocalServerConnection&) = delete;
+
+    HRESULT Send(LocalServerCall* call, const WireWriter& request);
+    LocalServerCall* Take(UINT32 id);
+    void Fail();
+    static DWORD WINAPI ReaderThread(LPVOID param);
+
+public:
+    // Connects to the server listening on 'path', or on the default path if it is NULL.
+    // The caller must have called WSAStartup.
+    static HRESULT Connect(const char* path, LocalServerConnection** ppConnection);
+
+    // Closes the connection. Calls still in flight fail with RPC_E_DISCONNECTED, but all
+    // LocalServerCall objects must be done with the connection before it is deleted.
+    ~LocalServerConnection();
+};
@@ -0,0 +1,268 @@
+#include "LocalServer.h"
+
+LocalServerCall::LocalServerCall(LocalServerConnection* connection)
+    : m_connection(connection), m_next(NULL), m_id(0), m_hr(S_OK), m_done(CreateEventW(NULL, FALSE, FALSE, NULL))
+{
+}
+
+LocalServerCall::~LocalServerCall()
+{
+    if (m_done != NULL)
+    {
+        CloseHandle(m_done);
+    }
+}
+
+HRESULT LocalServerCall::Begin(const WireWriter& request)
+{
+    if (m_done == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    if (request.Failed())
+    {
+        return E_INVALIDARG;
+    }
+    m_reply.Reset();
+    m_hr = S_OK;
+    return m_connection->Send(this, request);
+}
+
+HRESULT LocalServerCall::End(WireReader* reply)
+{
+    WaitForSingleObject(m_done, INFINITE);
+    if (FAILED(m_hr))
+    {
+        return m_hr;
+    }
+    *reply = WireReader(m_reply.Data(), m_reply.Size());
+    return S_OK;
+}
+
+HRESULT LocalServerCall::Call(const WireWriter& request, WireReader* reply)
+{
+    HRESULT hr = Begin(request);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    return End(reply);
+}
+
+LocalServerConnection::LocalServerConnection(SOCKET s)
+    : m_socket(s), m_reader(NULL), m_nextId(1), m_sending(false), m_closed(false), m_first(NULL), m_last(NULL), m_queued(&m_buffers[0])
+{
+    InitializeSRWLock(&m_lock);
+}
+
+HRESULT LocalServerConnection::Connect(const char* path, LocalServerConnection** ppConnection)
+{
+    if (ppConnection == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppConnection = NULL;
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path == NULL)
+    {
+        if (!GetLocalServerDefaultPath(address.sun_path, sizeof(address.sun_path)))
+        {
+            return E_FAIL;
+        }
+    }
+    else if (strcpy_s(address.sun_path, sizeof(address.sun_path), path) != 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET)
+    {
+        return HRESULT_FROM_WIN32(WSAGetLastError());
+    }
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(WSAGetLastError());
+        closesocket(s);
+        return hr;
+    }
+
+    LocalServerConnection* connection = new (std::nothrow) LocalServerConnection(s);
+    if (connection == NULL)
+    {
+        closesocket(s);
+        return E_OUTOFMEMORY;
+    }
+    connection->m_reader = CreateThread(NULL, 0, ReaderThread, connection, 0, NULL);
+    if (connection->m_reader == NULL)
+    {
+        delete connection;
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    *ppConnection = connection;
+    return S_OK;
+}
+
+LocalServerConnection::~LocalServerConnection()
+{
+    // Wakes up the reader, which fails whatever is still in flight
+    shutdown(m_socket, SD_BOTH);
+    if (m_reader != NULL)
+    {
+        WaitForSingleObject(m_reader, INFINITE);
+        CloseHandle(m_reader);
+    }
+    closesocket(m_socket);
+}
+
+HRESULT LocalServerConnection::Send(LocalServerCall* call, const WireWriter& request)
+{
+    LocalServerFrame frame = { static_cast<UINT32>(request.Size()), 0 };
+
+    AcquireSRWLockExclusive(&m_lock);
+    if (m_closed)
+    {
+        ReleaseSRWLockExclusive(&m_lock);
+        return RPC_E_DISCONNECTED;
+    }
+
+    // The frame goes into the queue and the call into the list in the same order, so the
+    // list is in the order the server sees the requests
+    frame.id = call->m_id = m_nextId++;
+    m_queued->PutBytes(&frame, sizeof(frame));
+    m_queued->PutBytes(request.Data(), request.Size());
+    if (m_queued->Failed())
+    {
+        // Out of memory. Frames queued before ours can't be told apart from a partial
+        // one anymore, so give up the connection.
+        ReleaseSRWLockExclusive(&m_lock);
+        shutdown(m_socket, SD_BOTH);
+        return E_OUTOFMEMORY;
+    }
+
+    call->m_next = NULL;
+    if (m_last != NULL)
+    {
+        m_last->m_next = call;
+    }
+    else
+    {
+        m_first = call;
+    }
+    m_last = call;
+
+    // Somebody else is sending already and will pick up our frame with the next write
+    if (m_sending)
+    {
+        ReleaseSRWLockExclusive(&m_lock);
+        return S_OK;
+    }
+
+    // Send until the queue is empty. While we are in send(), other threads queue their
+    // frames in the other buffer, and they all go out together with the next write.
+    m_sending = true;
+    bool sent = true;
+    while (sent && m_queued->Size() > 0)
+    {
+        WireWriter* sending = m_queued;
+        m_queued = (sending == &m_buffers[0]) ? &m_buffers[1] : &m_buffers[0];
+        ReleaseSRWLockExclusive(&m_lock);
+
+        sent = LocalServerSendAll(m_socket, sending->Data(), sending->Size());
+        sending->Reset();
+
+        AcquireSRWLockExclusive(&m_lock);
+    }
+    m_sending = false;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    if (!sent)
+    {
+        // The reader notices too, and fails every call in flight, ours included
+        shutdown(m_socket, SD_BOTH);
+    }
+    return S_OK;
+}
+
+// Removes the call with the given id from the list. The server answers in order, so it is
+// almost always the first one.
+LocalServerCall* LocalServerConnection::Take(UINT32 id)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    LocalServerCall* previous = NULL;
+    LocalServerCall* call = m_first;
+    while (call != NULL && call->m_id != id)
+    {
+        previous = call;
+        call = call->m_next;
+    }
+    if (call != NULL)
+    {
+        (previous != NULL ? previous->m_next : m_first) = call->m_next;
+        if (m_last == call)
+        {
+            m_last = previous;
+        }
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+    return call;
+}
+
+// Fails every call in flight and every call to come
+void LocalServerConnection::Fail()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    m_closed = true;
+    LocalServerCall* call = m_first;
+    m_first = m_last = NULL;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    while (call != NULL)
+    {
+        LocalServerCall* next = call->m_next;
+        call->m_hr = RPC_E_DISCONNECTED;
+        SetEvent(call->m_done);
+        call = next;
+    }
+}
+
+DWORD WINAPI LocalServerConnection::ReaderThread(LPVOID param)
+{
+    LocalServerConnection* connection = static_cast<LocalServerConnection*>(param);
+    LocalServerFrameReader frames;
+
+    while (frames.Receive(connection->m_socket))
+    {
+        UINT32 id;
+        const BYTE* message;
+        UINT32 size;
+        HRESULT hr;
+        while ((hr = frames.Next(&id, &message, &size)) == S_OK)
+        {
+            LocalServerCall* call = connection->Take(id);
+            if (call == NULL)
+            {
+                hr = RPC_E_INVALID_DATA;
+                break;
+            }
+
+            // The frame buffer is reused by the next Receive, so the reply is copied
+            call->m_reply.PutBytes(message, size);
+            if (call->m_reply.Failed())
+            {
+                call->m_hr = E_OUTOFMEMORY;
+            }
+            SetEvent(call->m_done);
+        }
+        if (FAILED(hr))
+        {
+            break;
+        }
+    }
+
+    connection->Fail();
+    return 0;
+}
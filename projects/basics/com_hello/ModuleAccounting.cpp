@@ -0,0 +1,209 @@
+#include "ModuleAccounting.h"
+#include "PerThreadCounters.h"
+#include <stdlib.h>
+#include <atomic>
+
+// Counter slots: what was created and how many bytes are live, per kind
+enum
+{
+    CounterCreated,
+    CounterBytes,
+    CountersPerKind
+};
+
+struct ModuleCountersTag;
+typedef PerThreadCounters<ModuleCountersTag, ModuleObjectKinds * CountersPerKind> ModuleCounters;
+
+// The live count of a kind is shared by every thread that creates or destroys one, so
+// each kind has a cache line of its own
+struct alignas(64) LiveCount
+{
+    std::atomic<LONG64> live;
+    std::atomic<LONG64> highWater;
+};
+
+static LiveCount s_live[ModuleObjectKinds];
+
+// A creation is sampled when the thread's count of its kind, masked with this, is zero
+static const UINT32 kMaskUnread = 0xFFFFFFFF;   // HELLOWORLD_ALLOC_SITES not read yet
+static const UINT32 kMaskOff = 0xFFFFFFFE;      // no sampling
+static std::atomic<UINT32> s_mask{kMaskUnread};
+
+// The sampled objects that are still alive, found by hashing their address. An object goes
+// to one of the kSiteProbes slots after the one its address hashes to, or is dropped if
+// they are all taken.
+//
+// Adding or removing a site takes the lock exclusively. A destructor first looks for its
+// object without the lock, so only the sampled objects ever take it.
+static const UINT32 kSiteSlots = 1024;
+static const UINT32 kSiteProbes = 8;
+
+struct SiteSlot
+{
+    std::atomic<const void*> object;    // NULL while the slot is free
+    ModuleAllocationSite site;
+};
+
+static SiteSlot s_sites[kSiteSlots];
+static SRWLOCK s_sitesLock = SRWLOCK_INIT;
+static LONG64 s_siteCount;                      // under s_sitesLock
+static std::atomic<LONG64> s_sitesDropped;
+
+// Turns HELLOWORLD_ALLOC_SITES into the mask, on the first creation of the process
+static UINT32 ReadMask()
+{
+    UINT32 interval = 0;
+    WCHAR value[16];
+    DWORD cch = GetEnvironmentVariableW(L"HELLOWORLD_ALLOC_SITES", value, ARRAYSIZE(value));
+    if (cch > 0 && cch < ARRAYSIZE(value))
+    {
+        interval = wcstoul(value, NULL, 10);
+    }
+
+    UINT32 mask = kMaskOff;
+    if (interval > 0)
+    {
+        // The next power of two, up to 2^31
+        for (mask = 0; mask < interval - 1 && mask < 0x7FFFFFFF; mask = mask * 2 + 1)
+        {
+        }
+    }
+    s_mask.store(mask, std::memory_order_relaxed);
+    return mask;
+}
+
+static UINT32 SlotOf(const void* object)
+{
+    // Objects are at least 16 bytes apart, so the lowest bits carry nothing
+    UINT64 address = reinterpret_cast<UINT_PTR>(object) >> 4;
+    return static_cast<UINT32>((address * 0x9E3779B97F4A7C15ull) >> 54) % kSiteSlots;
+}
+
+// Records where 'object' is being created. Not inlined, so the frames it skips are
+// always its own and ModuleObjectCreated's.
+static __declspec(noinline) void RecordSite(ModuleObjectKind kind, const void* object)
+{
+    ModuleAllocationSite site;
+    site.kind = kind;
+    site.object = object;
+    site.tick = GetTickCount64();
+    site.frameCount = CaptureStackBackTrace(2, kModuleAllocationFrames, site.frames, NULL);
+
+    AcquireSRWLockExclusive(&s_sitesLock);
+    UINT32 first = SlotOf(object);
+    UINT32 i = 0;
+    for (; i < kSiteProbes; ++i)
+    {
+        SiteSlot& slot = s_sites[(first + i) % kSiteSlots];
+        if (slot.object.load(std::memory_order_relaxed) == NULL)
+        {
+            slot.site = site;
+            slot.object.store(object, std::memory_order_relaxed);
+            ++s_siteCount;
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&s_sitesLock);
+
+    if (i == kSiteProbes)
+    {
+        s_sitesDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void ForgetSite(const void* object)
+{
+    UINT32 first = SlotOf(object);
+    for (UINT32 i = 0; i < kSiteProbes; ++i)
+    {
+        SiteSlot& slot = s_sites[(first + i) % kSiteSlots];
+        if (slot.object.load(std::memory_order_relaxed) == object)
+        {
+            // Only this object's destructor removes it, so it is still there
+            AcquireSRWLockExclusive(&s_sitesLock);
+            slot.object.store(NULL, std::memory_order_relaxed);
+            --s_siteCount;
+            ReleaseSRWLockExclusive(&s_sitesLock);
+            return;
+        }
+    }
+}
+
+void ModuleObjectCreated(ModuleObjectKind kind, const void* object, size_t bytes)
+{
+    LiveCount& count = s_live[kind];
+    LONG64 live = count.live.fetch_add(1, std::memory_order_relaxed) + 1;
+    LONG64 highWater = count.highWater.load(std::memory_order_relaxed);
+    while (live > highWater && !count.highWater.compare_exchange_weak(highWater, live, std::memory_order_relaxed))
+    {
+    }
+
+    ModuleCounters::Add(kind * CountersPerKind + CounterBytes, static_cast<LONG64>(bytes));
+    LONG64 created = ModuleCounters::Add(kind * CountersPerKind + CounterCreated, 1);
+
+    UINT32 mask = s_mask.load(std::memory_order_relaxed);
+    if (mask == kMaskUnread)
+    {
+        mask = ReadMask();
+    }
+    if (mask != kMaskOff && object != NULL && (created & mask) == 0)
+    {
+        RecordSite(kind, object);
+    }
+}
+
+void ModuleObjectDestroyed(ModuleObjectKind kind, const void* object, size_t bytes)
+{
+    s_live[kind].live.fetch_sub(1, std::memory_order_relaxed);
+    ModuleCounters::Add(kind * CountersPerKind + CounterBytes, -static_cast<LONG64>(bytes));
+
+    // Every creation read the mask before its object could be destroyed
+    UINT32 mask = s_mask.load(std::memory_order_relaxed);
+    if (mask != kMaskOff && mask != kMaskUnread && object != NULL)
+    {
+        ForgetSite(object);
+    }
+}
+
+void GetModuleMemoryStats(ModuleMemoryStats* stats)
+{
+    LONG64 counters[ModuleCounters::kCount];
+    ModuleCounters::Read(counters);
+
+    for (int kind = 0; kind < ModuleObjectKinds; ++kind)
+    {
+        ModuleObjectCounts& objects = stats->objects[kind];
+        objects.live = s_live[kind].live.load(std::memory_order_relaxed);
+        objects.highWater = s_live[kind].highWater.load(std::memory_order_relaxed);
+        objects.created = counters[kind * CountersPerKind + CounterCreated];
+        objects.bytes = counters[kind * CountersPerKind + CounterBytes];
+    }
+    stats->moduleLocks = 0;
+    GetBstrAllocStats(&stats->bstrs);
+
+    AcquireSRWLockShared(&s_sitesLock);
+    stats->sites = s_siteCount;
+    ReleaseSRWLockShared(&s_sitesLock);
+    stats->sitesDropped = s_sitesDropped.load(std::memory_order_relaxed);
+}
+
+HRESULT GetModuleAllocationSites(ModuleAllocationSite* sites, UINT32 capacity, UINT32* count)
+{
+    UINT32 found = 0;
+    AcquireSRWLockShared(&s_sitesLock);
+    for (UINT32 i = 0; i < kSiteSlots; ++i)
+    {
+        if (s_sites[i].object.load(std::memory_order_relaxed) != NULL)
+        {
+            if (found < capacity)
+            {
+                sites[found] = s_sites[i].site;
+            }
+            ++found;
+        }
+    }
+    ReleaseSRWLockShared(&s_sitesLock);
+
+    *count = found;
+    return (found > capacity) ? S_FALSE : S_OK;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <Windows.h>
+#include "BstrAlloc.h"
+
+// What the module has alive and how much memory it holds, for every class it creates
+// objects of, so a leak shows up as a count that keeps climbing.
+//
+// Every constructor reports its object with ModuleObjectCreated and every destructor with
+// ModuleObjectDestroyed. The live count of each class is one interlocked counter, like
+// dllRefCount, which also gives the high-water mark; what was created and how many bytes
+// are live goes on the creating thread's own counters (see PerThreadCounters.h).
+//
+// For leak hunting, HELLOWORLD_ALLOC_SITES=N records the call stack of one creation in N
+// on every thread (rounded up to a power of two) until the object is destroyed. What is
+// left in the table while the process is quiet is what leaked, and where it came from.
+// Without the variable nothing is recorded and a destructor doesn't look at the table.
+//
+// Clients read it all through two exports, see DllGetMemoryStats and DllGetAllocationSites
+// in HelloWorldDll.cpp:
+//
+//     typedef HRESULT (__stdcall *GetMemoryStats)(ModuleMemoryStats*);
+//     GetMemoryStats get = (GetMemoryStats)GetProcAddress(GetModuleHandleW(L"HelloWorld.dll"), "DllGetMemoryStats");
+//     ModuleMemoryStats stats;
+//     get(&stats);
+enum ModuleObjectKind
+{
+    ModuleObjectHelloWorld,         // HelloWorld
+    ModuleObjectFactoryReference,   // references and server locks on the factory, which is never deleted
+    ModuleObjectGreeter,            // HelloWorldGreeter tear-offs
+    ModuleObjectGreeterCall,        // HelloWorldGreeterCall, one per asynchronous call object
+    ModuleObjectStats,              // HelloWorldStats tear-offs
+    ModuleObjectEvents,             // HelloWorldEvents, the connection point of a HelloWorld
+    ModuleObjectEventQueue,         // HelloWorldEventQueue, with its ring of cells
+    ModuleObjectKinds
+};
+
+struct ModuleObjectCounts
+{
+    LONG64 live;        // alive now
+    LONG64 highWater;   // the most that were ever alive at once
+    LONG64 created;     // ever created
+    LONG64 bytes;       // what the live ones take, in bytes
+};
+
+struct ModuleMemoryStats
+{
+    ModuleObjectCounts objects[ModuleObjectKinds];   // per ModuleObjectKind
+    LONG moduleLocks;       // what keeps the DLL loaded, see ModuleLock.h
+    BstrAllocStats bstrs;   // the BSTRs the server allocated, and those it still holds
+    LONG64 sites;           // allocation sites recorded, see DllGetAllocationSites
+    LONG64 sitesDropped;    // creations sampled while the table was full around the object
+};
+
+const UINT32 kModuleAllocationFrames = 16;
+
+// Where a sampled object that is still alive was created
+struct ModuleAllocationSite
+{
+    ModuleObjectKind kind;
+    const void* object;
+    ULONGLONG tick;                             // GetTickCount64 at creation
+    UINT32 frameCount;
+    void* frames[kModuleAllocationFrames];      // return addresses, the creator's caller first
+};
+
+// 'bytes' is what the object takes, besides the memory of other objects it reports itself
+void ModuleObjectCreated(ModuleObjectKind kind, const void* object, size_t bytes);
+void ModuleObjectDestroyed(ModuleObjectKind kind, const void* object, size_t bytes);
+
+// Adds up the counters of all threads. moduleLocks is left for the DLL to fill in.
+void GetModuleMemoryStats(ModuleMemoryStats* stats);
+
+// Copies up to 'capacity' of the recorded sites. S_FALSE if there were more than that;
+// *count is then how many there were.
+HRESULT GetModuleAllocationSites(ModuleAllocationSite* sites, UINT32 capacity, UINT32* count);
@@ -0,0 +1,8 @@
+#pragma once
+#include <Windows.h>
+
+// Counts everything that keeps the DLL in use: live objects, references to class objects
+// and IClassFactory::LockServer locks. DllCanUnloadNow lets COM unload the DLL only when
+// the count is zero.
+void ModuleLock();
+void ModuleUnlock();
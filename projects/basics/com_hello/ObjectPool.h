@@ -0,0 +1,258 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <new>
+#include "PerThreadCounters.h"
+
+struct ObjectPoolStats
+{
+    LONG64 hits;        // allocations served from the pool
+    LONG64 misses;      // allocations that had to go to the heap
+    LONG64 live;        // blocks handed out and not freed yet
+    LONG64 cached;      // freed blocks kept by the pool for reuse
+};
+
+// A pool of fixed-size memory blocks for objects that are created and destroyed at a high
+// rate. It is meant to back a class-specific operator new/delete:
+//
+//     struct HelloWorldPoolTag;
+//     typedef ObjectPool<HelloWorldPoolTag, sizeof(HelloWorld)> HelloWorldPool;
+//
+//     void* HelloWorld::operator new(size_t size) noexcept { return HelloWorldPool::Allocate(size); }
+//     void HelloWorld::operator delete(void* p) noexcept { HelloWorldPool::Free(p); }
+//
+// Because only the memory is recycled, every new object is still built by its constructor,
+// so nothing of the previous object can leak into the next one.
+//
+// Each thread keeps a small magazine of free blocks and serves allocations and frees from
+// it without any locking. Only when a magazine runs empty or full does the thread go to the
+// shared depot, which is protected by a lock and holds at most the configured number of
+// blocks. Anything beyond that goes back to the heap, so the memory the pool can hold on to
+// is bounded.
+//
+// Pooling is off unless the environment variable named by the Tag says otherwise, e.g.
+//
+//     struct HelloWorldPoolTag { static constexpr const wchar_t* setting = L"HELLOWORLD_POOL"; };
+//
+// set to the maximum number of blocks the depot may keep. Pool blocks and heap blocks come
+// from the same allocator, so turning pooling on or off never mixes up who frees what.
+//
+// A DLL that uses a pool calls Drain from DllMain when it is unloaded. The magazines of
+// threads that outlive the DLL are never destroyed, and nobody would free their blocks.
+// After Drain every allocation and free goes straight to the heap.
+template <class Tag, size_t BlockSize>
+class ObjectPool
+{
+    static constexpr UINT kMagazineSize = 32;
+
+    enum { CounterHits, CounterMisses, CounterRecycled, CounterFreed, CounterCount };
+    typedef PerThreadCounters<Tag, CounterCount> Counters;
+
+    struct Depot
+    {
+        SRWLOCK lock;
+        void** blocks;
+        size_t count;
+        size_t capacity;
+    };
+
+    struct Magazine
+    {
+        void* blocks[kMagazineSize];
+        UINT count = 0;
+        Magazine* prev = NULL;      // in s_magazines, under the depot lock
+        Magazine* next = NULL;
+
+        Magazine()
+        {
+            AcquireSRWLockExclusive(&s_depot.lock);
+            next = s_magazines;
+            if (next != NULL)
+            {
+                next->prev = this;
+            }
+            s_magazines = this;
+            ReleaseSRWLockExclusive(&s_depot.lock);
+        }
+
+        // A thread that exits hands its blocks back
+        ~Magazine()
+        {
+            Spill(*this, count);
+
+            AcquireSRWLockExclusive(&s_depot.lock);
+            if (prev != NULL)
+            {
+                prev->next = next;
+            }
+            else
+            {
+                s_magazines = next;
+            }
+            if (next != NULL)
+            {
+                next->prev = prev;
+            }
+            ReleaseSRWLockExclusive(&s_depot.lock);
+        }
+    };
+
+    inline static Depot s_depot = { SRWLOCK_INIT, NULL, 0, 0 };
+    inline static Magazine* s_magazines = NULL;     // of every thread that has used the pool
+    inline static volatile LONG64 s_trimmed = 0;
+    inline static std::atomic<bool> s_drained{false};
+    inline static thread_local Magazine t_magazine;
+
+    static size_t ReadCapacity()
+    {
+        WCHAR value[32];
+        DWORD cch = GetEnvironmentVariableW(Tag::setting, value, ARRAYSIZE(value));
+        if (cch == 0 || cch >= ARRAYSIZE(value))
+        {
+            return 0;
+        }
+
+        size_t capacity = wcstoul(value, NULL, 10);
+        if (capacity > 0)
+        {
+            s_depot.blocks = static_cast<void**>(::operator new(capacity * sizeof(void*), std::nothrow));
+            s_depot.capacity = (s_depot.blocks != NULL) ? capacity : 0;
+        }
+        return s_depot.capacity;
+    }
+
+    static bool Enabled()
+    {
+        // Read once, on first use. Once drained, the magazines must stay empty.
+        static const size_t s_capacity = ReadCapacity();
+        return s_capacity > 0 && !s_drained.load(std::memory_order_relaxed);
+    }
+
+    // Moves up to 'count' blocks from the top of the magazine to the depot. Blocks that
+    // don't fit anymore go back to the heap.
+    static void Spill(Magazine& magazine, UINT count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        AcquireSRWLockExclusive(&s_depot.lock);
+        while (count > 0 && s_depot.count < s_depot.capacity)
+        {
+            s_depot.blocks[s_depot.count++] = magazine.blocks[--magazine.count];
+            --count;
+        }
+        ReleaseSRWLockExclusive(&s_depot.lock);
+
+        if (count > 0)
+        {
+            InterlockedExchangeAdd64(&s_trimmed, count);
+            while (count-- > 0)
+            {
+                ::operator delete(magazine.blocks[--magazine.count]);
+            }
+        }
+    }
+
+    // Fills up to half of an empty magazine from the depot, so the next few frees still fit
+    static void Refill(Magazine& magazine)
+    {
+        AcquireSRWLockExclusive(&s_depot.lock);
+        while (magazine.count < kMagazineSize / 2 && s_depot.count > 0)
+        {
+            magazine.blocks[magazine.count++] = s_depot.blocks[--s_depot.count];
+        }
+        ReleaseSRWLockExclusive(&s_depot.lock);
+    }
+
+public:
+    static void* Allocate(size_t size) noexcept
+    {
+        if (Enabled() && size <= BlockSize)
+        {
+            Magazine& magazine = t_magazine;
+            if (magazine.count == 0)
+            {
+                Refill(magazine);
+            }
+            if (magazine.count > 0)
+            {
+                Counters::Add(CounterHits, 1);
+                return magazine.blocks[--magazine.count];
+            }
+        }
+
+        // Pool blocks are always BlockSize bytes, so any heap block may later join the pool
+        void* p = ::operator new(size > BlockSize ? size : BlockSize, std::nothrow);
+        if (p != NULL)
+        {
+            Counters::Add(CounterMisses, 1);
+        }
+        return p;
+    }
+
+    static void Free(void* p) noexcept
+    {
+        if (p == NULL)
+        {
+            return;
+        }
+        if (!Enabled())
+        {
+            Counters::Add(CounterFreed, 1);
+            ::operator delete(p);
+            return;
+        }
+
+        Magazine& magazine = t_magazine;
+        if (magazine.count == kMagazineSize)
+        {
+            // Keep half, so alternating frees and allocations don't bounce off the depot
+            Spill(magazine, kMagazineSize / 2);
+        }
+        magazine.blocks[magazine.count++] = p;
+        Counters::Add(CounterRecycled, 1);
+    }
+
+    // Frees every cached block, in the depot and in the magazines of all threads, and the
+    // depot itself. The pool still works afterwards, but keeps nothing for reuse anymore.
+    // Only for DLL_PROCESS_DETACH, when no other thread can be inside Allocate or Free.
+    static void Drain() noexcept
+    {
+        s_drained.store(true, std::memory_order_relaxed);
+
+        AcquireSRWLockExclusive(&s_depot.lock);
+        LONG64 freed = 0;
+        for (Magazine* magazine = s_magazines; magazine != NULL; magazine = magazine->next)
+        {
+            while (magazine->count > 0)
+            {
+                ::operator delete(magazine->blocks[--magazine->count]);
+                ++freed;
+            }
+        }
+        while (s_depot.count > 0)
+        {
+            ::operator delete(s_depot.blocks[--s_depot.count]);
+            ++freed;
+        }
+        ::operator delete(s_depot.blocks);
+        s_depot.blocks = NULL;
+        s_depot.capacity = 0;
+        ReleaseSRWLockExclusive(&s_depot.lock);
+
+        InterlockedExchangeAdd64(&s_trimmed, freed);
+    }
+
+    static void GetStats(ObjectPoolStats* stats)
+    {
+        LONG64 counters[CounterCount];
+        Counters::Read(counters);
+
+        stats->hits = counters[CounterHits];
+        stats->misses = counters[CounterMisses];
+        stats->live = counters[CounterHits] + counters[CounterMisses] - counters[CounterRecycled] - counters[CounterFreed];
+        stats->cached = counters[CounterRecycled] - counters[CounterHits] - s_trimmed;
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <new>
+
+// A set of N counters that every thread can bump without touching a shared cache line.
+//
+// Each thread gets its own shard the first time it counts something. The owning thread is
+// the only writer of its shard, so a plain load + store is enough, no interlocked
+// instruction needed. Readers walk all shards and add them up; they may see a count that is
+// a few increments behind, which is fine for statistics.
+//
+// Shards are never freed. When a thread exits its shard is marked free and the next new
+// thread picks it up and keeps counting on top of the old values, so no counts are lost and
+// the number of shards stays at the peak number of threads.
+//
+// Tag only makes each set of counters a distinct type, and so gives it its own shards:
+//
+//     struct BstrCountersTag;
+//     typedef PerThreadCounters<BstrCountersTag, 4> BstrCounters;
+//     BstrCounters::Add(0, 1);
+template <class Tag, size_t N>
+class PerThreadCounters
+{
+    struct alignas(64) Shard
+    {
+        std::atomic<LONG64> values[N];
+        std::atomic<bool> inUse;
+        Shard* next;
+    };
+
+    // Gives the shard back when its thread exits
+    struct ThreadSlot
+    {
+        Shard* shard = nullptr;
+
+        ~ThreadSlot()
+        {
+            if (shard != nullptr)
+            {
+                shard->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    inline static std::atomic<Shard*> s_head{nullptr};
+    inline static thread_local ThreadSlot t_slot;
+
+    static Shard* Claim()
+    {
+        // Reuse the shard of a thread that is gone, if there is one
+        for (Shard* shard = s_head.load(std::memory_order_acquire); shard != nullptr; shard = shard->next)
+        {
+            bool expected = false;
+            if (!shard->inUse.load(std::memory_order_relaxed) &&
+                shard->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return shard;
+            }
+        }
+
+        Shard* shard = new (std::nothrow) Shard;
+        if (shard == nullptr)
+        {
+            return nullptr;
+        }
+        for (size_t i = 0; i < N; ++i)
+        {
+            shard->values[i].store(0, std::memory_order_relaxed);
+        }
+        shard->inUse.store(true, std::memory_order_relaxed);
+
+        // Shards are only ever added, so a plain lock-free push is safe
+        shard->next = s_head.load(std::memory_order_relaxed);
+        while (!s_head.compare_exchange_weak(shard->next, shard, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        return shard;
+    }
+
+public:
+    static const size_t kCount = N;
+
+    // Returns the thread's own count after adding to it
+    static LONG64 Add(size_t counter, LONG64 delta)
+    {
+        Shard* shard = t_slot.shard;
+        if (shard == nullptr)
+        {
+            shard = t_slot.shard = Claim();
+            if (shard == nullptr)
+            {
+                return 0; // out of memory, drop the count rather than fail the caller
+            }
+        }
+
+        // Only this thread writes this shard, so no read-modify-write instruction is needed
+        std::atomic<LONG64>& value = shard->values[counter];
+        LONG64 sum = value.load(std::memory_order_relaxed) + delta;
+        value.store(sum, std::memory_order_relaxed);
+        return sum;
+    }
+
+    // Adds up all shards. Never blocks the threads that are counting.
+    static void Read(LONG64 (&totals)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            totals[i] = 0;
+        }
+        for (Shard* shard = s_head.load(std::memory_order_acquire); shard != nullptr; shard = shard->next)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                totals[i] += shard->values[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
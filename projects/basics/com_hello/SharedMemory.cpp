@@ -0,0 +1,511 @@
+#include "SharedMemory.h"
+#include <stdio.h>
+#include <new>
+
+// The header has a cache line of its own, the channels follow, then the slots of all rings
+static const size_t kHeaderSize = 64;
+
+static const char* const kDefaultName = "HelloWorld";
+
+SharedMemorySection::SharedMemorySection()
+    : m_mapping(NULL), m_view(NULL), m_header(NULL), m_events(NULL), m_eventCount(0), m_channelCount(0), m_slotCount(0), m_slotSize(0)
+{
+}
+
+SharedMemorySection::~SharedMemorySection()
+{
+    for (UINT32 i = 0; i < m_eventCount; ++i)
+    {
+        if (m_events[i] != NULL)
+        {
+            CloseHandle(m_events[i]);
+        }
+    }
+    delete[] m_events;
+    if (m_view != NULL)
+    {
+        UnmapViewOfFile(m_view);
+    }
+    if (m_mapping != NULL)
+    {
+        CloseHandle(m_mapping);
+    }
+}
+
+bool SharedMemorySection::ValidGeometry(UINT32 channelCount, UINT32 slotCount, UINT32 slotSize)
+{
+    return channelCount != 0 && slotCount >= 2 && (slotCount & (slotCount - 1)) == 0 && slotSize % 8 == 0 && slotSize > sizeof(SharedSlot);
+}
+
+size_t SharedMemorySection::SectionSize(UINT32 channelCount, UINT32 slotCount, UINT32 slotSize)
+{
+    return kHeaderSize + channelCount * sizeof(SharedChannel) + static_cast<size_t>(channelCount) * 2 * slotCount * slotSize;
+}
+
+HRESULT SharedMemorySection::Map(const char* name, bool create, size_t size)
+{
+    char sectionName[MAX_PATH];
+    if (_snprintf_s(sectionName, MAX_PATH, _TRUNCATE, "Local\\%s", name) < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (create)
+    {
+        m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                       static_cast<DWORD>(static_cast<ULONGLONG>(size) >> 32), static_cast<DWORD>(size), sectionName);
+        if (m_mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+        }
+    }
+    else
+    {
+        m_mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, sectionName);
+    }
+    if (m_mapping == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_view = static_cast<BYTE*>(MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+    if (m_view == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    m_header = reinterpret_cast<SharedMemoryHeader*>(m_view);
+    return S_OK;
+}
+
+HRESULT SharedMemorySection::MapEvents(const char* name, bool create)
+{
+    UINT32 count = m_channelCount * 2;
+    m_events = new (std::nothrow) HANDLE[count];
+    if (m_events == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (m_eventCount = 0; m_eventCount < count; ++m_eventCount)
+    {
+        char eventName[MAX_PATH];
+        if (_snprintf_s(eventName, MAX_PATH, _TRUNCATE, "Local\\%s.%u.%s", name, m_eventCount / 2, (m_eventCount % 2) ? "replies" : "requests") < 0)
+        {
+            return E_INVALIDARG;
+        }
+
+        // Auto-reset: a wakeup is consumed by the one thread that waits on the ring
+        HANDLE event = create ? CreateEventA(NULL, FALSE, FALSE, eventName)
+                              : OpenEventA(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, eventName);
+        if (event == NULL)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        m_events[m_eventCount] = event;
+    }
+    return S_OK;
+}
+
+SharedChannel* SharedMemorySection::Channel(UINT32 channel) const
+{
+    return reinterpret_cast<SharedChannel*>(m_view + kHeaderSize) + channel;
+}
+
+SharedSlot* SharedMemorySection::Slot(UINT32 channel, bool replies, UINT32 index) const
+{
+    size_t ring = static_cast<size_t>(channel) * 2 + (replies ? 1 : 0);
+    size_t slot = ring * m_slotCount + (index & (m_slotCount - 1));
+    return reinterpret_cast<SharedSlot*>(m_view + kHeaderSize + m_channelCount * sizeof(SharedChannel) + slot * m_slotSize);
+}
+
+void SharedMemorySection::Publish(SharedRing& ring, UINT32 head, HANDLE event)
+{
+    // Both sequentially consistent, so we can't miss a consumer that is going to sleep, see
+    // WaitForMessage
+    ring.head.store(head, std::memory_order_seq_cst);
+    if (ring.sleeping.load(std::memory_order_seq_cst) != 0)
+    {
+        SetEvent(event);
+    }
+}
+
+bool SharedMemorySection::WaitForMessage(SharedRing& ring, UINT32 tail, HANDLE event, HANDLE peer, SharedSpin* spin)
+{
+    for (UINT32 i = 0; i < spin->Limit(); ++i)
+    {
+        if (ring.head.load(std::memory_order_acquire) != tail)
+        {
+            spin->Succeeded();
+            return true;
+        }
+        YieldProcessor();
+    }
+    spin->Failed();
+
+    // Say we're going to sleep, then look once more. A producer that published before it
+    // could see the flag has published before our second look, any later one signals us.
+    // A stale signal from an earlier round only makes us look again.
+    bool alive = true;
+    for (;;)
+    {
+        ring.sleeping.store(1, std::memory_order_seq_cst);
+        if (ring.head.load(std::memory_order_seq_cst) != tail)
+        {
+            break;
+        }
+
+        HANDLE handles[2] = { event, peer };
+        if (WaitForMultipleObjects((peer != NULL) ? 2 : 1, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            alive = false;
+            break;
+        }
+    }
+    ring.sleeping.store(0, std::memory_order_relaxed);
+    return alive;
+}
+
+SharedMemoryChannel::SharedMemoryChannel() : m_channel(0xFFFFFFFF), m_server(NULL), m_outstanding(0), m_holdingReply(false)
+{
+}
+
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    if (m_channel != 0xFFFFFFFF)
+    {
+        Channel(m_channel)->clientProcessId.store(0, std::memory_order_release);
+    }
+    if (m_server != NULL)
+    {
+        CloseHandle(m_server);
+    }
+}
+
+HRESULT SharedMemoryChannel::Open(const char* name, SharedMemoryChannel** ppChannel)
+{
+    if (ppChannel == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppChannel = NULL;
+    if (name == NULL)
+    {
+        name = kDefaultName;
+    }
+
+    SharedMemoryChannel* channel = new (std::nothrow) SharedMemoryChannel;
+    if (channel == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = channel->Map(name, false, 0);
+    if (SUCCEEDED(hr) && channel->m_header->magic.load(std::memory_order_acquire) != kSharedMemoryMagic)
+    {
+        // The server hasn't finished setting up the section yet
+        hr = HRESULT_FROM_WIN32(ERROR_NOT_READY);
+    }
+    if (SUCCEEDED(hr))
+    {
+        // Don't trust the sizes in the header beyond the end of what we mapped
+        const SharedMemoryHeader* header = channel->m_header;
+        channel->m_channelCount = header->channelCount;
+        channel->m_slotCount = header->slotCount;
+        channel->m_slotSize = header->slotSize;
+        MEMORY_BASIC_INFORMATION info;
+        if (!ValidGeometry(channel->m_channelCount, channel->m_slotCount, channel->m_slotSize) ||
+            VirtualQuery(channel->m_view, &info, sizeof(info)) == 0 ||
+            info.RegionSize < SectionSize(channel->m_channelCount, channel->m_slotCount, channel->m_slotSize))
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = channel->MapEvents(name, false);
+    }
+    if (SUCCEEDED(hr))
+    {
+        channel->m_server = OpenProcess(SYNCHRONIZE, FALSE, channel->m_header->serverProcessId);
+        hr = (channel->m_server != NULL) ? channel->Claim() : RPC_E_DISCONNECTED;
+    }
+    if (FAILED(hr))
+    {
+        delete channel;
+        return hr;
+    }
+
+    *ppChannel = channel;
+    return S_OK;
+}
+
+// Takes a channel nobody uses, or one whose client process has died
+HRESULT SharedMemoryChannel::Claim()
+{
+    DWORD self = GetCurrentProcessId();
+    for (UINT32 i = 0; i < m_channelCount; ++i)
+    {
+        SharedChannel* channel = Channel(i);
+        DWORD owner = channel->clientProcessId.load(std::memory_order_acquire);
+        if (owner == self)
+        {
+            continue;
+        }
+        if (owner != 0)
+        {
+            HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, owner);
+            bool alive = process != NULL && WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+            if (process != NULL)
+            {
+                CloseHandle(process);
+            }
+            if (alive)
+            {
+                continue;
+            }
+        }
+        if (!channel->clientProcessId.compare_exchange_strong(owner, self, std::memory_order_acq_rel))
+        {
+            continue;
+        }
+
+        // A client that died may have left requests behind. Let the server answer them,
+        // then skip their replies.
+        while (channel->requests.tail.load(std::memory_order_acquire) != channel->requests.head.load(std::memory_order_relaxed))
+        {
+            if (WaitForSingleObject(m_server, 1) != WAIT_TIMEOUT)
+            {
+                channel->clientProcessId.store(0, std::memory_order_release);
+                return RPC_E_DISCONNECTED;
+            }
+        }
+        channel->replies.tail.store(channel->replies.head.load(std::memory_order_acquire), std::memory_order_release);
+
+        m_channel = i;
+        return S_OK;
+    }
+    return RPC_E_SERVER_TOO_BUSY;
+}
+
+HRESULT SharedMemoryChannel::Begin(const WireWriter& request)
+{
+    if (request.Failed())
+    {
+        return E_INVALIDARG;
+    }
+    // The reply to every request in flight, plus the one the caller may still be reading,
+    // must fit into the reply ring. The server never has to wait for room that way.
+    if (m_outstanding + 1 >= m_slotCount)
+    {
+        return E_PENDING;
+    }
+    if (request.Size() > m_slotSize - sizeof(SharedSlot))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    SharedRing& ring = Channel(m_channel)->requests;
+    UINT32 head = ring.head.load(std::memory_order_relaxed);
+    SharedSlot* slot = Slot(m_channel, false, head);
+    slot->size = static_cast<UINT32>(request.Size());
+    memcpy(slot + 1, request.Data(), request.Size());
+    Publish(ring, head + 1, Event(m_channel, false));
+    ++m_outstanding;
+    return S_OK;
+}
+
+HRESULT SharedMemoryChannel::End(WireReader* reply)
+{
+    if (m_outstanding == 0)
+    {
+        return E_UNEXPECTED;
+    }
+
+    // The server doesn't wait for us to free a reply slot, so there's nobody to wake here
+    SharedRing& ring = Channel(m_channel)->replies;
+    UINT32 tail = ring.tail.load(std::memory_order_relaxed);
+    if (m_holdingReply)
+    {
+        ring.tail.store(++tail, std::memory_order_release);
+        m_holdingReply = false;
+    }
+
+    if (!WaitForMessage(ring, tail, Event(m_channel, true), m_server, &m_spin))
+    {
+        return RPC_E_DISCONNECTED;
+    }
+    --m_outstanding;
+    m_holdingReply = true;
+
+    const SharedSlot* slot = Slot(m_channel, true, tail);
+    UINT32 size = slot->size;
+    if (size > m_slotSize - sizeof(SharedSlot))
+    {
+        return RPC_E_INVALID_DATA;
+    }
+    *reply = WireReader(reinterpret_cast<const BYTE*>(slot + 1), size);
+    return S_OK;
+}
+
+HRESULT SharedMemoryChannel::Call(const WireWriter& request, WireReader* reply)
+{
+    // End returns the oldest reply, which must be the one to this request
+    if (m_outstanding != 0)
+    {
+        return E_PENDING;
+    }
+    HRESULT hr = Begin(request);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    return End(reply);
+}
+
+SharedMemoryServer::SharedMemoryServer() : m_stop(NULL)
+{
+}
+
+SharedMemoryServer::~SharedMemoryServer()
+{
+    if (m_stop != NULL)
+    {
+        CloseHandle(m_stop);
+    }
+}
+
+HRESULT SharedMemoryServer::Create(const char* name, UINT32 channelCount, UINT32 slotCount, UINT32 slotSize, SharedMemoryServer** ppServer)
+{
+    if (ppServer == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppServer = NULL;
+    if (!ValidGeometry(channelCount, slotCount, slotSize))
+    {
+        return E_INVALIDARG;
+    }
+    if (name == NULL)
+    {
+        name = kDefaultName;
+    }
+
+    SharedMemoryServer* server = new (std::nothrow) SharedMemoryServer;
+    if (server == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    server->m_channelCount = channelCount;
+    server->m_slotCount = slotCount;
+    server->m_slotSize = slotSize;
+
+    HRESULT hr = server->Map(name, true, SectionSize(channelCount, slotCount, slotSize));
+    if (SUCCEEDED(hr))
+    {
+        // A new section is zero-filled, which already is a free channel with empty rings
+        SharedMemoryHeader* header = new (server->m_view) SharedMemoryHeader;
+        header->serverProcessId = GetCurrentProcessId();
+        header->channelCount = channelCount;
+        header->slotCount = slotCount;
+        header->slotSize = slotSize;
+        for (UINT32 i = 0; i < channelCount; ++i)
+        {
+            new (server->Channel(i)) SharedChannel;
+        }
+        hr = server->MapEvents(name, true);
+    }
+    if (SUCCEEDED(hr))
+    {
+        server->m_stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+        if (server->m_stop == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+    if (FAILED(hr))
+    {
+        delete server;
+        return hr;
+    }
+
+    // Clients may use the section from now on
+    server->m_header->magic.store(kSharedMemoryMagic, std::memory_order_release);
+    *ppServer = server;
+    return S_OK;
+}
+
+HRESULT SharedMemoryServer::Serve(UINT32 channel, SharedMemoryHandler handler, void* context)
+{
+    SharedChannel* shared = Channel(channel);
+    HANDLE requestEvent = Event(channel, false);
+    HANDLE replyEvent = Event(channel, true);
+    size_t maxMessage = m_slotSize - sizeof(SharedSlot);
+    SharedSpin spin;
+
+    // The requests are decoded here, where the client can't change them. 8-byte aligned,
+    // like a slot.
+    UINT64* copy = new (std::nothrow) UINT64[maxMessage / sizeof(UINT64)];
+    if (copy == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (;;)
+    {
+        UINT32 tail = shared->requests.tail.load(std::memory_order_relaxed);
+        if (!WaitForMessage(shared->requests, tail, requestEvent, m_stop, &spin))
+        {
+            break;
+        }
+
+        // Begin keeps an honest client from having more requests in flight than the reply
+        // ring has room for. A client that has anyway gets no reply to the extra request,
+        // rather than one that overwrites a reply it hasn't read yet.
+        UINT32 head = shared->replies.head.load(std::memory_order_relaxed);
+        if (head - shared->replies.tail.load(std::memory_order_acquire) >= m_slotCount)
+        {
+            shared->requests.tail.store(tail + 1, std::memory_order_release);
+            continue;
+        }
+
+        // Copy the request out and encode the reply where it goes. The size is read once, a
+        // broken client could change it while we look.
+        const SharedSlot* request = Slot(channel, false, tail);
+        SharedSlot* reply = Slot(channel, true, head);
+        UINT32 size = request->size;
+        if (size <= maxMessage)
+        {
+            memcpy(copy, request + 1, size);
+        }
+
+        WireReader reader(reinterpret_cast<const BYTE*>(copy), (size <= maxMessage) ? size : 0);
+        WireWriter writer(reinterpret_cast<BYTE*>(reply + 1), maxMessage);
+        HRESULT hr = (size <= maxMessage) ? handler(context, reader, writer) : RPC_E_INVALID_DATA;
+        if (SUCCEEDED(hr) && writer.Failed())
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+        }
+        if (FAILED(hr))
+        {
+            // A reply that is just a failed HRESULT is what the proxy returns to its caller.
+            // Unlike a socket the ring stays in step with the client, so we carry on.
+            writer.Reset();
+            writer.PutHResult(hr);
+        }
+
+        reply->size = static_cast<UINT32>(writer.Size());
+        Publish(shared->replies, head + 1, replyEvent);
+
+        // Only now is the request answered. A client that claims the channel waits for
+        // this before it skips the replies a dead client left behind, see Claim.
+        shared->requests.tail.store(tail + 1, std::memory_order_release);
+    }
+
+    delete[] copy;
+    return S_OK;
+}
+
+void SharedMemoryServer::Stop()
+{
+    SetEvent(m_stop);
+}
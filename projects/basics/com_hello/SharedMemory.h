@@ -0,0 +1,194 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include "WireFormat.h"
+
+// Calls between processes on the same machine through a shared memory section, started
+// with HelloWorldLocalServer.exe /shm. No data crosses the kernel on the way.
+//
+// The section holds a few channels. A channel connects one client thread to one server
+// thread that has its own HelloWorld object, through two rings of fixed-size slots: one
+// for the requests and one for the replies. Each ring has exactly one producer and one
+// consumer, so neither needs a lock. The producer writes the slot at 'head' and then moves
+// head on. The consumer reads the slot at 'tail' and then moves tail on.
+//
+// The server copies every request out of the ring before it decodes it. The client can
+// still write to the slot, and the stub checks a BSTR's length and terminator once and then
+// uses it where it is, so decoding in place would let a client change a string after it was
+// checked. The copy is a memcpy into a buffer each serving thread allocates once, and the
+// name BSTR HelloWorld gets points into that. The reply is written right into the reply
+// slot, and the proxy reads it from there. The greeting is still copied twice on its way:
+// HelloWorld returns it in a BSTR of its own, which the stub copies into the slot and frees,
+// and the proxy copies it out of the slot into the caller's BSTR.
+//
+// For the same reason neither side reads the ring's geometry from the header more than
+// once: the section keeps its own copy, see SharedMemorySection.
+//
+// A side waiting for a message spins for a while, because the other side usually answers
+// within microseconds. If nothing comes it sleeps on a named event, which the producer
+// signals only when it sees a sleeper. Like a futex, the kernel is only involved when
+// somebody actually has to sleep.
+const UINT32 kSharedMemoryMagic = 0x4D534857;   // "WHSM"
+
+struct SharedMemoryHeader
+{
+    std::atomic<UINT32> magic;      // set once the section is ready
+    DWORD serverProcessId;
+    UINT32 channelCount;
+    UINT32 slotCount;               // per ring, a power of two
+    UINT32 slotSize;                // bytes per slot, including the SharedSlot header
+};
+
+// One direction of a channel. The indexes only ever grow, the slot of an index is
+// index & (slotCount - 1), which stays in step when an index wraps around. Every field gets its own cache line, so the two sides don't make each
+// other's caches miss.
+struct SharedRing
+{
+    alignas(64) std::atomic<UINT32> head;       // written by the producer only
+    alignas(64) std::atomic<UINT32> tail;       // written by the consumer only
+    alignas(64) std::atomic<LONG> sleeping;     // the consumer waits on the ring's event
+};
+
+struct SharedChannel
+{
+    alignas(64) std::atomic<DWORD> clientProcessId;     // 0 while the channel is free
+    SharedRing requests;
+    SharedRing replies;
+};
+
+// The start of every slot. The message follows, 8-byte aligned.
+struct SharedSlot
+{
+    UINT32 size;
+    UINT32 reserved;
+};
+
+// How long a waiting side spins before it sleeps. The limit doubles every time a spin
+// finds a message and halves every time it doesn't, so a busy channel stays out of the
+// kernel and an idle one soon stops burning a CPU.
+class SharedSpin
+{
+    static const UINT32 kMin = 64;
+    static const UINT32 kMax = 64 * 1024;
+
+    UINT32 m_limit;
+
+public:
+    SharedSpin() : m_limit(1024) {}
+
+    UINT32 Limit() const { return m_limit; }
+    void Succeeded() { m_limit = (m_limit < kMax) ? m_limit * 2 : kMax; }
+    void Failed() { m_limit = (m_limit > kMin) ? m_limit / 2 : kMin; }
+};
+
+// A view of the section and the events of its rings, common to both sides
+class SharedMemorySection
+{
+protected:
+    HANDLE m_mapping;
+    BYTE* m_view;
+    SharedMemoryHeader* m_header;
+    HANDLE* m_events;       // requests and replies event of every channel
+    UINT32 m_eventCount;
+
+    // What the header said when the section was mapped. Every process that maps the
+    // section can write to the header, so only these are used.
+    UINT32 m_channelCount;
+    UINT32 m_slotCount;
+    UINT32 m_slotSize;
+
+    SharedMemorySection();
+    ~SharedMemorySection();
+
+    SharedMemorySection(const SharedMemorySection&) = delete;
+    SharedMemorySection& operator=(const SharedMemorySection&) = delete;
+
+    static bool ValidGeometry(UINT32 channelCount, UINT32 slotCount, UINT32 slotSize);
+    static size_t SectionSize(UINT32 channelCount, UINT32 slotCount, UINT32 slotSize);
+
+    // Creates the section, or opens the one a server created
+    HRESULT Map(const char* name, bool create, size_t size);
+    HRESULT MapEvents(const char* name, bool create);
+
+    SharedChannel* Channel(UINT32 channel) const;
+    SharedSlot* Slot(UINT32 channel, bool replies, UINT32 index) const;
+    HANDLE Event(UINT32 channel, bool replies) const { return m_events[channel * 2 + (replies ? 1 : 0)]; }
+
+    // Makes the slot at ring.head visible to the consumer and wakes it if it sleeps
+    static void Publish(SharedRing& ring, UINT32 head, HANDLE event);
+
+    // Waits until the ring has a message at 'tail'. Returns false if 'peer' is signaled first.
+    static bool WaitForMessage(SharedRing& ring, UINT32 tail, HANDLE event, HANDLE peer, SharedSpin* spin);
+};
+
+// The client end of one channel. A channel belongs to the thread using it: every thread
+// that calls the server needs a SharedMemoryChannel of its own.
+//
+//     SharedMemoryChannel* channel;
+//     SharedMemoryChannel::Open(NULL, &channel);
+//     IHelloWorldWireProxy helloWorld(channel);
+//     helloWorld.SayHelloTo(name, &greeting);
+class SharedMemoryChannel : public WireChannel, private SharedMemorySection
+{
+    UINT32 m_channel;
+    HANDLE m_server;            // the server process, to notice when it is gone
+    UINT32 m_outstanding;       // requests begun and not ended yet
+    bool m_holdingReply;        // the last reply End returned still occupies its slot
+    SharedSpin m_spin;
+
+    SharedMemoryChannel();
+
+    HRESULT Claim();
+
+public:
+    // Opens a free channel of the section the server created under 'name', or under
+    // "HelloWorld" if it is NULL
+    static HRESULT Open(const char* name, SharedMemoryChannel** ppChannel);
+
+    // Gives the channel back to the server
+    ~SharedMemoryChannel();
+
+    // Writes the request into the ring and returns without waiting. Up to slotCount - 1
+    // requests may be in flight, after that Begin fails with E_PENDING until End is called.
+    HRESULT Begin(const WireWriter& request);
+
+    // Waits for the reply to the oldest request in flight. The reply is read in place and
+    // stays valid until the next End.
+    HRESULT End(WireReader* reply);
+
+    // WireChannel
+    HRESULT Call(const WireWriter& request, WireReader* reply);
+};
+
+// Answers one request by writing its reply, e.g. with IHelloWorldWireStub
+typedef HRESULT (*SharedMemoryHandler)(void* context, WireReader& request, WireWriter& reply);
+
+// The server end: creates the section and serves its channels
+class SharedMemoryServer : private SharedMemorySection
+{
+    HANDLE m_stop;          // manual-reset, signaled by Stop
+
+    SharedMemoryServer();
+
+public:
+    ~SharedMemoryServer();
+
+    static const UINT32 kDefaultChannels = 8;
+    static const UINT32 kDefaultSlotCount = 16;
+    static const UINT32 kDefaultSlotSize = 16 * 1024;
+
+    // Creates the section under 'name', or under "HelloWorld" if it is NULL. Fails if a
+    // server with that name is running already. 'slotCount' must be a power of two.
+    static HRESULT Create(const char* name, UINT32 channelCount, UINT32 slotCount, UINT32 slotSize, SharedMemoryServer** ppServer);
+
+    UINT32 ChannelCount() const { return m_channelCount; }
+
+    // Answers the requests on one channel with 'handler', on the calling thread, until Stop
+    // is called. Serve each channel on a thread of its own. Returns E_OUTOFMEMORY at once
+    // if there is no memory for the copy of the requests, S_OK once stopped.
+    HRESULT Serve(UINT32 channel, SharedMemoryHandler handler, void* context);
+
+    // Makes every Serve return once it has answered the requests it has. Call it before
+    // deleting the server, and delete the server only after every Serve has returned.
+    void Stop();
+};
@@ -0,0 +1,366 @@
+#include "SurrogatePool.h"
+
+// How long a new worker may take until it accepts connections
+static const DWORD kStartTimeout = 10000;
+
+// How long to wait before a worker that failed to start is tried again
+static const DWORD kRetryInterval = 1000;
+
+SurrogatePool::SurrogatePool() : m_job(NULL), m_monitor(NULL), m_changed(NULL), m_stopping(false), m_active(0), m_count(0)
+{
+    m_workerExe[0] = '\0';
+    InitializeSRWLock(&m_lock);
+    for (UINT32 i = 0; i < kMaxWorkers; ++i)
+    {
+        Worker& worker = m_workers[i];
+        worker.pool = this;
+        worker.launch = NULL;
+        worker.state = SurrogateWorkerStarting;
+        worker.process = NULL;
+        worker.processId = 0;
+        worker.generation = 0;
+        worker.path[0] = '\0';
+        worker.restarts = 0;
+        worker.outstanding.store(0, std::memory_order_relaxed);
+        worker.activations.store(0, std::memory_order_relaxed);
+        worker.calls.store(0, std::memory_order_relaxed);
+    }
+}
+
+SurrogatePool::~SurrogatePool()
+{
+    // The monitor starts no more workers once it sees m_stopping
+    if (m_monitor != NULL)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        m_stopping = true;
+        ReleaseSRWLockExclusive(&m_lock);
+        SetEvent(m_changed);
+        WaitForSingleObject(m_monitor, INFINITE);
+        CloseHandle(m_monitor);
+    }
+    for (UINT32 i = 0; i < kMaxWorkers; ++i)
+    {
+        Worker& worker = m_workers[i];
+        if (worker.launch != NULL)
+        {
+            WaitForThreadpoolWorkCallbacks(worker.launch, FALSE);
+            CloseThreadpoolWork(worker.launch);
+        }
+        if (worker.process != NULL)
+        {
+            CloseHandle(worker.process);
+            DeleteFileA(worker.path);
+        }
+    }
+    if (m_changed != NULL)
+    {
+        CloseHandle(m_changed);
+    }
+
+    // Closing the job ends the workers
+    if (m_job != NULL)
+    {
+        CloseHandle(m_job);
+    }
+}
+
+HRESULT SurrogatePool::Start(UINT32 active, UINT32 standby)
+{
+    if (active == 0 || active + standby > kMaxWorkers)
+    {
+        return E_INVALIDARG;
+    }
+
+    // The workers live next to us
+    DWORD cch = GetModuleFileNameA(NULL, m_workerExe, MAX_PATH);
+    if (cch == 0 || cch >= MAX_PATH)
+    {
+        return E_FAIL;
+    }
+    char* name = strrchr(m_workerExe, '\\');
+    name = (name != NULL) ? name + 1 : m_workerExe;
+    if (strcpy_s(name, MAX_PATH - (name - m_workerExe), "HelloWorldLocalServer.exe") != 0)
+    {
+        return E_FAIL;
+    }
+
+    m_job = CreateJobObjectA(NULL, NULL);
+    if (m_job == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+    limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    if (!SetInformationJobObject(m_job, JobObjectExtendedLimitInformation, &limits, sizeof(limits)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_changed = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (m_changed == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // The workers warm up side by side
+    m_active = active;
+    m_count = active + standby;
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        m_workers[i].launch = CreateThreadpoolWork(LaunchCallback, &m_workers[i], NULL);
+        if (m_workers[i].launch == NULL)
+        {
+            m_count = i;
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        SubmitThreadpoolWork(m_workers[i].launch);
+    }
+    UINT32 started = 0;
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        WaitForThreadpoolWorkCallbacks(m_workers[i].launch, FALSE);
+        started += (m_workers[i].state != SurrogateWorkerFailed) ? 1 : 0;
+    }
+    if (started == 0)
+    {
+        return CO_E_SERVER_EXEC_FAILURE;
+    }
+
+    m_monitor = CreateThread(NULL, 0, MonitorThread, this, 0, NULL);
+    if (m_monitor == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    return S_OK;
+}
+
+// Starts the worker in slot 'index' and waits until it accepts connections. It becomes
+// active if the pool is short of active workers, a standby otherwise. Runs on the thread
+// pool, see LaunchCallback. The slot must be in the Starting state, nobody else touches it
+// then.
+bool SurrogatePool::Launch(UINT32 index)
+{
+    Worker& worker = m_workers[index];
+    HANDLE process = NULL;
+
+    // A new socket for every start, so a client can't reach the worker that died
+    char temp[MAX_PATH];
+    DWORD cchTemp = GetTempPathA(MAX_PATH, temp);
+    char commandLine[2 * MAX_PATH + 8];
+    STARTUPINFOA startup = { sizeof(startup) };
+    PROCESS_INFORMATION info;
+    if (cchTemp > 0 && cchTemp < MAX_PATH &&
+        _snprintf_s(worker.path, MAX_PATH, _TRUNCATE, "%sHelloWorld.%lu.%u.%u.sock", temp, GetCurrentProcessId(), index, ++worker.generation) >= 0 &&
+        _snprintf_s(commandLine, sizeof(commandLine), _TRUNCATE, "\"%s\" \"%s\"", m_workerExe, worker.path) >= 0 &&
+        CreateProcessA(m_workerExe, commandLine, NULL, NULL, FALSE, CREATE_SUSPENDED | CREATE_NO_WINDOW, NULL, NULL, &startup, &info))
+    {
+        // Suspended until it is in the job, so it can't outlive us even if we die right away
+        process = info.hProcess;
+        if (AssignProcessToJobObject(m_job, process))
+        {
+            ResumeThread(info.hThread);
+        }
+        else
+        {
+            TerminateProcess(process, 1);
+        }
+        CloseHandle(info.hThread);
+    }
+
+    // Warm up: the worker is ready once it accepts a connection
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy_s(address.sun_path, sizeof(address.sun_path), worker.path);
+    bool ready = false;
+    for (DWORD waited = 0; process != NULL && !ready && waited < kStartTimeout; waited += 10)
+    {
+        SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s != INVALID_SOCKET)
+        {
+            ready = connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR;
+            closesocket(s);
+        }
+        if (!ready && WaitForSingleObject(process, 10) != WAIT_TIMEOUT)
+        {
+            break;
+        }
+    }
+    if (!ready && process != NULL)
+    {
+        TerminateProcess(process, 1);
+        CloseHandle(process);
+    }
+
+    AcquireSRWLockExclusive(&m_lock);
+    if (ready)
+    {
+        UINT32 active = 0;
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            active += (m_workers[i].state == SurrogateWorkerActive) ? 1 : 0;
+        }
+        worker.process = process;
+        worker.processId = info.dwProcessId;
+        worker.state = (active < m_active) ? SurrogateWorkerActive : SurrogateWorkerStandby;
+    }
+    else
+    {
+        worker.state = SurrogateWorkerFailed;
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+
+    // The monitor waits for the new process from now on
+    SetEvent(m_changed);
+    return ready;
+}
+
+void CALLBACK SurrogatePool::LaunchCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK)
+{
+    Worker* worker = static_cast<Worker*>(context);
+    worker->pool->Launch(static_cast<UINT32>(worker - worker->pool->m_workers));
+}
+
+// A worker process ended. A standby takes its place if it was active, and it is started
+// again.
+void SurrogatePool::WorkerExited(UINT32 index)
+{
+    Worker& worker = m_workers[index];
+
+    AcquireSRWLockExclusive(&m_lock);
+    if (worker.state == SurrogateWorkerActive)
+    {
+        for (UINT32 i = 0; i < m_count; ++i)
+        {
+            if (m_workers[i].state == SurrogateWorkerStandby)
+            {
+                m_workers[i].state = SurrogateWorkerActive;
+                break;
+            }
+        }
+    }
+    CloseHandle(worker.process);
+    DeleteFileA(worker.path);
+    worker.process = NULL;
+    worker.processId = 0;
+    worker.state = SurrogateWorkerStarting;
+    ++worker.restarts;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    // If this fails the monitor tries again later
+    SubmitThreadpoolWork(worker.launch);
+}
+
+// Waits for workers to exit and has them started again. Only the monitor starts workers
+// once the pool is running, and every start wakes it when it is done, so it can't miss a
+// process it should watch.
+DWORD WINAPI SurrogatePool::MonitorThread(LPVOID param)
+{
+    SurrogatePool* pool = static_cast<SurrogatePool*>(param);
+    for (;;)
+    {
+        HANDLE handles[kMaxWorkers + 1] = { pool->m_changed };
+        UINT32 indexes[kMaxWorkers];
+        DWORD count = 0;
+        bool failed = false;
+
+        AcquireSRWLockShared(&pool->m_lock);
+        bool stopping = pool->m_stopping;
+        for (UINT32 i = 0; i < pool->m_count; ++i)
+        {
+            if (pool->m_workers[i].process != NULL)
+            {
+                indexes[count] = i;
+                handles[1 + count++] = pool->m_workers[i].process;
+            }
+            failed = failed || pool->m_workers[i].state == SurrogateWorkerFailed;
+        }
+        ReleaseSRWLockShared(&pool->m_lock);
+        if (stopping)
+        {
+            return 0;
+        }
+
+        DWORD result = WaitForMultipleObjects(1 + count, handles, FALSE, failed ? kRetryInterval : INFINITE);
+        if (result > WAIT_OBJECT_0 && result <= WAIT_OBJECT_0 + count)
+        {
+            pool->WorkerExited(indexes[result - WAIT_OBJECT_0 - 1]);
+        }
+        else if (result == WAIT_TIMEOUT)
+        {
+            // Starting, so the next round doesn't try the same worker again
+            UINT32 retry[kMaxWorkers];
+            UINT32 retries = 0;
+            AcquireSRWLockExclusive(&pool->m_lock);
+            for (UINT32 i = 0; i < pool->m_count; ++i)
+            {
+                if (pool->m_workers[i].state == SurrogateWorkerFailed)
+                {
+                    pool->m_workers[i].state = SurrogateWorkerStarting;
+                    retry[retries++] = i;
+                }
+            }
+            ReleaseSRWLockExclusive(&pool->m_lock);
+            for (UINT32 i = 0; i < retries; ++i)
+            {
+                SubmitThreadpoolWork(pool->m_workers[retry[i]].launch);
+            }
+        }
+    }
+}
+
+HRESULT SurrogatePool::Activate(UINT32* worker, char* path, size_t cch)
+{
+    AcquireSRWLockShared(&m_lock);
+    UINT32 best = kMaxWorkers;
+    LONG bestOutstanding = 0;
+    for (UINT32 i = 0; i < m_count; ++i)
+    {
+        if (m_workers[i].state != SurrogateWorkerActive)
+        {
+            continue;
+        }
+        // Ties go to the worker with fewer objects
+        LONG outstanding = m_workers[i].outstanding.load(std::memory_order_relaxed);
+        if (best == kMaxWorkers || outstanding < bestOutstanding ||
+            (outstanding == bestOutstanding && m_workers[i].activations.load(std::memory_order_relaxed) < m_workers[best].activations.load(std::memory_order_relaxed)))
+        {
+            best = i;
+            bestOutstanding = outstanding;
+        }
+    }
+
+    HRESULT hr = CO_E_SERVER_EXEC_FAILURE;
+    if (best != kMaxWorkers)
+    {
+        hr = (strcpy_s(path, cch, m_workers[best].path) == 0) ? S_OK : E_INVALIDARG;
+    }
+    ReleaseSRWLockShared(&m_lock);
+
+    if (SUCCEEDED(hr))
+    {
+        m_workers[best].activations.fetch_add(1, std::memory_order_relaxed);
+        *worker = best;
+    }
+    return hr;
+}
+
+UINT32 SurrogatePool::GetStats(SurrogateWorkerStats* stats, UINT32 count)
+{
+    AcquireSRWLockShared(&m_lock);
+    for (UINT32 i = 0; i < count && i < m_count; ++i)
+    {
+        const Worker& worker = m_workers[i];
+        stats[i].state = worker.state;
+        stats[i].processId = worker.processId;
+        stats[i].outstanding = worker.outstanding.load(std::memory_order_relaxed);
+        stats[i].activations = worker.activations.load(std::memory_order_relaxed);
+        stats[i].calls = worker.calls.load(std::memory_order_relaxed);
+        stats[i].restarts = worker.restarts;
+    }
+    ReleaseSRWLockShared(&m_lock);
+    return m_count;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "LocalServer.h"
+#include <atomic>
+
+// HelloWorldSurrogate.exe hosts HelloWorld the way dllhost.exe hosts a DLL server, except
+// that one host runs a pool of worker processes instead of loading the DLL into itself.
+// Every worker is a HelloWorldLocalServer.exe listening on a socket of its own. Clients
+// connect to the surrogate like to a single local server, and the surrogate relays each
+// connection to a worker.
+//
+// A new object goes to the active worker with the fewest calls in flight, so a worker that
+// is stuck with slow calls gets no new work. Standby workers are started and warmed up like
+// the active ones, but get no objects until an active worker dies and a standby takes its
+// place. The dead worker is started again, as the new standby, on the thread pool: a start
+// takes as long as the worker needs to warm up, and meanwhile the monitor keeps watching the
+// others. Objects that lived on it are gone, their clients see the connection close like a
+// server that died.
+//
+// All workers belong to a job object, so they go away together with the surrogate.
+enum SurrogateWorkerState
+{
+    SurrogateWorkerStarting,
+    SurrogateWorkerStandby,
+    SurrogateWorkerActive,
+    SurrogateWorkerFailed,      // could not be started, tried again later
+};
+
+struct SurrogateWorkerStats
+{
+    SurrogateWorkerState state;
+    DWORD processId;
+    LONG outstanding;           // calls in flight right now: the worker's queue depth
+    LONG activations;           // objects created on the worker
+    LONGLONG calls;             // calls completed
+    LONG restarts;
+};
+
+class SurrogatePool
+{
+public:
+    static const UINT32 kMaxWorkers = 32;
+
+private:
+    // Each worker on cache lines of its own, its counters change with every call
+    struct alignas(64) Worker
+    {
+        SurrogatePool* pool;
+        PTP_WORK launch;        // runs Launch for this worker
+        SurrogateWorkerState state;
+        HANDLE process;
+        DWORD processId;
+        UINT32 generation;
+        char path[MAX_PATH];    // the socket the worker listens on
+        LONG restarts;
+        std::atomic<LONG> outstanding;
+        std::atomic<LONG> activations;
+        std::atomic<LONGLONG> calls;
+    };
+
+    char m_workerExe[MAX_PATH];
+    HANDLE m_job;
+    HANDLE m_monitor;
+    HANDLE m_changed;           // a worker was started, or the pool is stopping
+    SRWLOCK m_lock;             // guards the states, processes and paths of the workers
+    bool m_stopping;
+    UINT32 m_active;            // how many workers should be active
+    UINT32 m_count;
+    Worker m_workers[kMaxWorkers];
+
+    SurrogatePool(const SurrogatePool&) = delete;
+    SurrogatePool& operator=(const SurrogatePool&) = delete;
+
+    bool Launch(UINT32 index);
+    static void CALLBACK LaunchCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WORK work);
+    void WorkerExited(UINT32 index);
+    static DWORD WINAPI MonitorThread(LPVOID param);
+
+public:
+    SurrogatePool();
+
+    // Waits for starts in progress, then ends all workers
+    ~SurrogatePool();
+
+    // Starts 'active' workers that take objects and 'standby' workers that wait to replace
+    // one that dies. The workers are HelloWorldLocalServer.exe from the surrogate's folder.
+    // The caller must have called WSAStartup.
+    HRESULT Start(UINT32 active, UINT32 standby);
+
+    // Chooses the worker for a new object and copies the path of its socket
+    HRESULT Activate(UINT32* worker, char* path, size_t cch);
+
+    // Called around every call relayed to a worker
+    void CallStarted(UINT32 worker) { m_workers[worker].outstanding.fetch_add(1, std::memory_order_relaxed); }
+    void CallFinished(UINT32 worker)
+    {
+        m_workers[worker].outstanding.fetch_sub(1, std::memory_order_relaxed);
+        m_workers[worker].calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Fills in the counters of up to 'count' workers and returns the number of workers
+    UINT32 GetStats(SurrogateWorkerStats* stats, UINT32 count);
+};
@@ -0,0 +1,64 @@
+#include "TypeInfo.h"
+#include "./midl/IHelloWorld.h"
+
+EXTERN_C IMAGE_DOS_HEADER __ImageBase;
+
+static ITypeInfo* s_pTypeInfo = NULL;
+
+static HRESULT LoadHelloWorldTypeInfo(ITypeInfo** ppTInfo)
+{
+    // The type library is linked into the DLL as a resource, see HelloWorld.rc. OLE
+    // maps it straight from the module. If that fails, try a registered copy.
+    ITypeLib* pTypeLib = NULL;
+    WCHAR path[MAX_PATH];
+    HRESULT hr = E_FAIL;
+    if (GetModuleFileNameW((HMODULE)&__ImageBase, path, MAX_PATH) != 0)
+    {
+        hr = LoadTypeLibEx(path, REGKIND_NONE, &pTypeLib);
+    }
+    if (FAILED(hr))
+    {
+        hr = LoadRegTypeLib(LIBID_HelloWorldLib, 1, 0, LOCALE_NEUTRAL, &pTypeLib);
+    }
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // The ITypeInfo keeps its type library alive
+    hr = pTypeLib->GetTypeInfoOfGuid(IID_IHelloWorld, ppTInfo);
+    pTypeLib->Release();
+    return hr;
+}
+
+HRESULT GetHelloWorldTypeInfo(ITypeInfo** ppTInfo)
+{
+    if (ppTInfo == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppTInfo = NULL;
+
+    // Acquire, so a type info another thread just cached is seen fully built
+    ITypeInfo* pTypeInfo = static_cast<ITypeInfo*>(ReadPointerAcquire(reinterpret_cast<void* const*>(&s_pTypeInfo)));
+    if (pTypeInfo == NULL)
+    {
+        HRESULT hr = LoadHelloWorldTypeInfo(&pTypeInfo);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // Threads racing here may each load it, only the first one is kept
+        ITypeInfo* pCached = static_cast<ITypeInfo*>(InterlockedCompareExchangePointer(reinterpret_cast<void**>(&s_pTypeInfo), pTypeInfo, NULL));
+        if (pCached != NULL)
+        {
+            pTypeInfo->Release();
+            pTypeInfo = pCached;
+        }
+    }
+
+    pTypeInfo->AddRef();
+    *ppTInfo = pTypeInfo;
+    return S_OK;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <Windows.h>
+
+// Returns the type information of IHelloWorld, AddRef'ed. The type library is loaded the
+// first time this is called and the ITypeInfo is kept for the rest of the process, so
+// IDispatch::GetTypeInfo is cheap enough for script hosts to call on every object.
+HRESULT GetHelloWorldTypeInfo(ITypeInfo** ppTInfo);
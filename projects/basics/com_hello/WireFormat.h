@@ -0,0 +1,311 @@
+#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <new>
+
+// A compact wire format for calls on our interfaces, used by the proxies and stubs that
+// idlgen generates (see idlgen/idlgen.cpp and gen/*_wire.h).
+//
+// A request is the method's DISPID followed by its [in] arguments, a reply is the HRESULT
+// followed by the [out] arguments if the call succeeded. Everything is little-endian and
+// 4-byte aligned:
+//
+//   LONG, HRESULT, DISPID   4 bytes
+//   BSTR                    byte length (0xFFFFFFFF for a NULL BSTR), the characters and a
+//                           terminating 0, padded to 4 bytes. That is exactly how a BSTR
+//                           looks in memory, so the stub passes a pointer into the request
+//                           to the server instead of copying the string.
+//   SAFEARRAY(BSTR)         element count (0xFFFFFFFF for NULL), then the BSTRs
+class WireWriter
+{
+    static constexpr size_t kInline = 256;
+
+    BYTE* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    bool m_failed;
+    bool m_fixed;                        // writing into a buffer given to us, which can't grow
+    alignas(8) BYTE m_inline[kInline];   // small calls never touch the heap
+
+    WireWriter(const WireWriter&) = delete;
+    WireWriter& operator=(const WireWriter&) = delete;
+
+    BYTE* Reserve(size_t cb)
+    {
+        if (m_failed)
+        {
+            return NULL;
+        }
+        if (m_capacity - m_size < cb)
+        {
+            if (m_fixed)
+            {
+                m_failed = true;
+                return NULL;
+            }
+            size_t capacity = m_capacity * 2;
+            while (capacity - m_size < cb)
+            {
+                capacity *= 2;
+            }
+            BYTE* data = static_cast<BYTE*>(::operator new(capacity, std::nothrow));
+            if (data == NULL)
+            {
+                m_failed = true;
+                return NULL;
+            }
+            memcpy(data, m_data, m_size);
+            if (m_data != m_inline)
+            {
+                ::operator delete(m_data);
+            }
+            m_data = data;
+            m_capacity = capacity;
+        }
+        BYTE* p = m_data + m_size;
+        m_size += cb;
+        return p;
+    }
+
+public:
+    WireWriter() : m_data(m_inline), m_size(0), m_capacity(kInline), m_failed(false), m_fixed(false) {}
+
+    // Writes in place into the given buffer, e.g. a slot in shared memory. A message that
+    // doesn't fit makes the writer fail. The buffer must be 4-byte aligned.
+    WireWriter(BYTE* buffer, size_t capacity) : m_data(buffer), m_size(0), m_capacity(capacity), m_failed(false), m_fixed(true) {}
+
+    ~WireWriter()
+    {
+        if (m_data != m_inline && !m_fixed)
+        {
+            ::operator delete(m_data);
+        }
+    }
+
+    const BYTE* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // True if the writer ran out of memory, or was given something it can't encode
+    bool Failed() const { return m_failed; }
+
+    void Reset()
+    {
+        m_size = 0;
+        m_failed = false;
+    }
+
+    void PutUInt32(UINT32 value)
+    {
+        BYTE* p = Reserve(sizeof(value));
+        if (p != NULL)
+        {
+            memcpy(p, &value, sizeof(value));
+        }
+    }
+
+    // Appends raw bytes, e.g. a message that was encoded by another writer
+    void PutBytes(const void* data, size_t cb)
+    {
+        BYTE* p = Reserve(cb);
+        if (p != NULL)
+        {
+            memcpy(p, data, cb);
+        }
+    }
+
+    void PutLong(LONG value) { PutUInt32(static_cast<UINT32>(value)); }
+    void PutHResult(HRESULT hr) { PutUInt32(static_cast<UINT32>(hr)); }
+
+    void PutBstr(BSTR value)
+    {
+        if (value == NULL)
+        {
+            PutUInt32(0xFFFFFFFF);
+            return;
+        }
+
+        UINT32 cb = SysStringByteLen(value);
+        BYTE* p = Reserve(sizeof(cb) + ((cb + sizeof(OLECHAR) + 3) & ~3u));
+        if (p != NULL)
+        {
+            memcpy(p, &cb, sizeof(cb));
+            memcpy(p + sizeof(cb), value, cb);
+            // The terminator and the padding
+            memset(p + sizeof(cb) + cb, 0, ((cb + sizeof(OLECHAR) + 3) & ~3u) - cb);
+        }
+    }
+
+    void PutBstrArray(SAFEARRAY* value)
+    {
+        if (value == NULL)
+        {
+            PutUInt32(0xFFFFFFFF);
+            return;
+        }
+
+        VARTYPE vt;
+        if (SafeArrayGetDim(value) != 1 || FAILED(SafeArrayGetVartype(value, &vt)) || vt != VT_BSTR)
+        {
+            m_failed = true;
+            return;
+        }
+
+        LONG lBound, uBound;
+        SafeArrayGetLBound(value, 1, &lBound);
+        SafeArrayGetUBound(value, 1, &uBound);
+        UINT32 count = (uBound >= lBound) ? static_cast<UINT32>(uBound - lBound + 1) : 0;
+        PutUInt32(count);
+
+        BSTR* elements;
+        if (FAILED(SafeArrayAccessData(value, reinterpret_cast<void**>(&elements))))
+        {
+            m_failed = true;
+            return;
+        }
+        for (UINT32 i = 0; i < count; ++i)
+        {
+            PutBstr(elements[i]);
+        }
+        SafeArrayUnaccessData(value);
+    }
+};
+
+// Reads what a WireWriter wrote. Every Get checks the bounds of the buffer, so a broken or
+// hostile message fails with RPC_E_INVALID_DATA instead of reading past its end.
+class WireReader
+{
+    const BYTE* m_data;
+    size_t m_size;
+    size_t m_pos;
+
+public:
+    WireReader() : m_data(NULL), m_size(0), m_pos(0) {}
+    WireReader(const BYTE* data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    bool AtEnd() const { return m_pos == m_size; }
+
+    // The whole message, e.g. to pass it on unchanged
+    const BYTE* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    HRESULT GetUInt32(UINT32* value)
+    {
+        if (m_size - m_pos < sizeof(*value))
+        {
+            return RPC_E_INVALID_DATA;
+        }
+        memcpy(value, m_data + m_pos, sizeof(*value));
+        m_pos += sizeof(*value);
+        return S_OK;
+    }
+
+    HRESULT GetLong(LONG* value)
+    {
+        UINT32 u;
+        HRESULT hr = GetUInt32(&u);
+        *value = static_cast<LONG>(u);
+        return hr;
+    }
+
+    HRESULT GetHResult(HRESULT* value)
+    {
+        UINT32 u;
+        HRESULT hr = GetUInt32(&u);
+        *value = static_cast<HRESULT>(u);
+        return hr;
+    }
+
+    // Points *value into the buffer, without copying. The BSTR is only valid as long as the
+    // buffer, and must not be freed. That is what an [in] BSTR is to the server anyway.
+    // The buffer must be 4-byte aligned, and nobody else may write to it while the BSTR is
+    // used: its length and terminator are checked here, once.
+    HRESULT GetBstr(BSTR* value)
+    {
+        UINT32 cb;
+        HRESULT hr = GetUInt32(&cb);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        if (cb == 0xFFFFFFFF)
+        {
+            *value = NULL;
+            return S_OK;
+        }
+
+        size_t padded = (static_cast<size_t>(cb) + sizeof(OLECHAR) + 3) & ~static_cast<size_t>(3);
+        if (cb % sizeof(OLECHAR) != 0 || m_size - m_pos < padded)
+        {
+            return RPC_E_INVALID_DATA;
+        }
+        OLECHAR* chars = reinterpret_cast<OLECHAR*>(const_cast<BYTE*>(m_data + m_pos));
+        if (chars[cb / sizeof(OLECHAR)] != 0)
+        {
+            return RPC_E_INVALID_DATA;
+        }
+        m_pos += padded;
+        *value = chars;
+        return S_OK;
+    }
+
+    // Like GetBstr, but returns a real BSTR the caller owns
+    HRESULT GetBstrCopy(BSTR* value)
+    {
+        BSTR wire;
+        HRESULT hr = GetBstr(&wire);
+        if (FAILED(hr) || wire == NULL)
+        {
+            *value = NULL;
+            return hr;
+        }
+        *value = SysAllocStringLen(wire, SysStringLen(wire));
+        return (*value != NULL) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    // Builds a new SAFEARRAY(BSTR) the caller owns
+    HRESULT GetBstrArray(SAFEARRAY** value)
+    {
+        *value = NULL;
+
+        UINT32 count;
+        HRESULT hr = GetUInt32(&count);
+        if (FAILED(hr) || count == 0xFFFFFFFF)
+        {
+            return hr;
+        }
+        // Every element takes at least 4 bytes, don't let a bogus count allocate a huge array
+        if (count > (m_size - m_pos) / sizeof(UINT32))
+        {
+            return RPC_E_INVALID_DATA;
+        }
+
+        SAFEARRAY* array = SafeArrayCreateVector(VT_BSTR, 0, count);
+        if (array == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        BSTR* elements;
+        SafeArrayAccessData(array, reinterpret_cast<void**>(&elements));
+        for (UINT32 i = 0; i < count && SUCCEEDED(hr); ++i)
+        {
+            hr = GetBstrCopy(&elements[i]);
+        }
+        SafeArrayUnaccessData(array);
+
+        if (FAILED(hr))
+        {
+            SafeArrayDestroy(array);
+            return hr;
+        }
+        *value = array;
+        return S_OK;
+    }
+};
+
+// Carries a request to the server and brings back its reply. The reply stays valid until
+// the next call on the same channel.
+struct WireChannel
+{
+    virtual HRESULT Call(const WireWriter& request, WireReader* reply) = 0;
+};
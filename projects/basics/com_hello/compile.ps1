@@ -1,6 +1,48 @@
-cl /c /EHsc HelloWorldDll.cpp
-cl /c /EHsc HelloWorldFactory.cpp
-cl /c /EHsc HelloWorld.cpp
+# Everything in ./midl is generated from IHelloWorld.idl here, and none of it is checked in
+New-Item -ItemType Directory -Force ./midl | Out-Null
+midl /nologo /char signed /env win32 /Oicf /out ./midl IHelloWorld.idl
+rc /nologo /fo HelloWorld.res HelloWorld.rc
+
+# The dispatch table and the wire proxy/stub in ./gen come from idlgen
+cl /nologo /EHsc /std:c++17 /Fe:idlgen.exe ./idlgen/idlgen.cpp
+./idlgen.exe IHelloWorld.idl ./gen
+
+# Add /DHELLOWORLD_ACTIVATION_PROBES to these two to time the stages of activation, see ActivationProbe.h
+cl /c /EHsc /std:c++17 HelloWorldDll.cpp
+cl /c /EHsc /std:c++17 HelloWorldFactory.cpp
+# Add /DHELLOWORLD_BIASED_REFCOUNT to count references per owning thread, see BiasedRefCount.h
+cl /c /EHsc /std:c++17 HelloWorld.cpp
+cl /c /EHsc /std:c++17 HelloWorldGreeter.cpp
+cl /c /EHsc /std:c++17 HelloWorldEvents.cpp
+cl /c /EHsc /std:c++17 HelloWorldEventQueue.cpp
+cl /c /EHsc /std:c++17 HelloWorldStats.cpp
+cl /c /EHsc /std:c++17 BstrAlloc.cpp
+cl /c /EHsc /std:c++17 ModuleAccounting.cpp
+cl /c /EHsc /std:c++17 GreetingFormatter.cpp
+cl /c /EHsc /std:c++17 BiasedRefCount.cpp
+cl /c /EHsc /std:c++17 TypeInfo.cpp
 cl /c /EHsc ./midl/IHelloWorld_i.c
 
-link /dll /def:HelloWorld.def /out:HelloWorld.dll HelloWorldDll.obj HelloWorldFactory.obj HelloWorld.obj IHelloWorld_i.obj Advapi32.lib Shlwapi.lib OleAut32.lib
+link /dll /def:HelloWorld.def /out:HelloWorld.dll HelloWorldDll.obj HelloWorldFactory.obj HelloWorld.obj HelloWorldGreeter.obj HelloWorldEvents.obj HelloWorldEventQueue.obj HelloWorldStats.obj ModuleAccounting.obj BstrAlloc.obj GreetingFormatter.obj BiasedRefCount.obj TypeInfo.obj IHelloWorld_i.obj HelloWorld.res Advapi32.lib Shlwapi.lib Ole32.lib OleAut32.lib Synchronization.lib
+
+# What DllRegisterServer writes to the registry, as a file clients can map, see ActivationDb.h.
+# The classes come from the manifest HelloWorld.dll exports, see ClassManifest.h.
+cl /c /EHsc /std:c++17 ActivationDb.cpp
+cl /nologo /EHsc /std:c++17 /Fe:HelloWorldActivationDb.exe HelloWorldActivationDb.cpp ActivationDb.obj Ole32.lib
+./HelloWorldActivationDb.exe HelloWorld.actdb HelloWorld.dll
+
+# The same object in a process of its own, served over a Unix domain socket (see LocalServer.h)
+# or, when started with /shm, over shared memory (see SharedMemory.h)
+cl /c /EHsc /std:c++17 HelloWorldLocalServer.cpp
+cl /c /EHsc /std:c++17 SharedMemory.cpp
+link /out:HelloWorldLocalServer.exe HelloWorldLocalServer.obj SharedMemory.obj HelloWorld.obj HelloWorldGreeter.obj HelloWorldEvents.obj HelloWorldEventQueue.obj HelloWorldStats.obj ModuleAccounting.obj BstrAlloc.obj GreetingFormatter.obj BiasedRefCount.obj TypeInfo.obj IHelloWorld_i.obj HelloWorld.res Ws2_32.lib Ole32.lib OleAut32.lib Synchronization.lib
+
+# A slow and a fast sink under each overflow policy, see HelloWorldEventQueue.h
+cl /c /EHsc /std:c++17 HelloWorldEventQueueDemo.cpp
+link /out:HelloWorldEventQueueDemo.exe HelloWorldEventQueueDemo.obj HelloWorld.obj HelloWorldGreeter.obj HelloWorldEvents.obj HelloWorldEventQueue.obj HelloWorldStats.obj ModuleAccounting.obj BstrAlloc.obj GreetingFormatter.obj BiasedRefCount.obj TypeInfo.obj IHelloWorld_i.obj HelloWorld.res Ole32.lib OleAut32.lib Synchronization.lib
+
+# A pool of HelloWorldLocalServer.exe workers behind one socket, see SurrogatePool.h
+cl /c /EHsc /std:c++17 HelloWorldSurrogate.cpp
+cl /c /EHsc /std:c++17 SurrogatePool.cpp
+cl /c /EHsc /std:c++17 LocalServerChannel.cpp
+link /out:HelloWorldSurrogate.exe HelloWorldSurrogate.obj SurrogatePool.obj LocalServerChannel.obj Ws2_32.lib OleAut32.lib
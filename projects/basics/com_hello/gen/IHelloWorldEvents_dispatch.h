@@ -0,0 +1,12 @@
+// Generated by idlgen from IHelloWorld.idl. Do not edit, run idlgen again instead.
+#pragma once
+#include "../DispatchNames.h"
+
+static constexpr const wchar_t* IHelloWorldEvents_OnGreetedParams[] = { L"greeting" };
+
+// The late-bound view of IHelloWorldEvents: every method with its DISPID and the
+// names of its [in] parameters, for DispatchNameMap and DispatchImpl::Describes
+static constexpr DispatchMember IHelloWorldEvents_DispatchMembers[] =
+{
+    { L"OnGreeted", 1, IHelloWorldEvents_OnGreetedParams, 1 },
+};
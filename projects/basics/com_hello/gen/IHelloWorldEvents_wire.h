@@ -0,0 +1,75 @@
+// Generated by idlgen from IHelloWorld.idl. Do not edit, run idlgen again instead.
+#pragma once
+#include "../WireFormat.h"
+
+// Calls IHelloWorldEvents on the other side of a WireChannel
+class IHelloWorldEventsWireProxy
+{
+    WireChannel* m_channel;
+
+public:
+    explicit IHelloWorldEventsWireProxy(WireChannel* channel) : m_channel(channel) {}
+
+    HRESULT OnGreeted(BSTR greeting)
+    {
+        WireWriter request;
+        request.PutUInt32(1);
+        request.PutBstr(greeting);
+        if (request.Failed())
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        WireReader reply;
+        HRESULT hr = m_channel->Call(request, &reply);
+        HRESULT result = E_FAIL;
+        if (SUCCEEDED(hr))
+        {
+            hr = reply.GetHResult(&result);
+        }
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        return result;
+    }
+};
+
+// Unpacks a request, calls the method on 'server' and packs the reply. [in] strings are
+// handed to the server straight from the request buffer, which must stay valid and
+// 4-byte aligned for the duration of the call.
+template <class Server>
+HRESULT IHelloWorldEventsWireStub(Server* server, WireReader& request, WireWriter& reply)
+{
+    UINT32 method;
+    HRESULT hr = request.GetUInt32(&method);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    switch (method)
+    {
+    case 1:
+    {
+        BSTR greeting = NULL;
+        if (SUCCEEDED(hr))
+        {
+            hr = request.GetBstr(&greeting);
+        }
+        if (SUCCEEDED(hr) && !request.AtEnd())
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+        if (SUCCEEDED(hr))
+        {
+            HRESULT result = server->OnGreeted(greeting);
+            reply.PutHResult(result);
+            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;
+        }
+        return hr;
+    }
+    default:
+        return RPC_E_INVALID_DATA;
+    }
+}
@@ -0,0 +1,16 @@
+// Generated by idlgen from IHelloWorld.idl. Do not edit, run idlgen again instead.
+#pragma once
+#include "../DispatchNames.h"
+
+static constexpr const wchar_t* IHelloWorld_SayHelloToParams[] = { L"name" };
+static constexpr const wchar_t* IHelloWorld_SayHelloToManyParams[] = { L"names" };
+
+// The late-bound view of IHelloWorld: every method with its DISPID and the
+// names of its [in] parameters, for DispatchNameMap and DispatchImpl::Describes
+static constexpr DispatchMember IHelloWorld_DispatchMembers[] =
+{
+    { L"SayHello", 1, NULL, 0 },
+    { L"SayHelloStr", 2, NULL, 0 },
+    { L"SayHelloTo", 3, IHelloWorld_SayHelloToParams, 1 },
+    { L"SayHelloToMany", 4, IHelloWorld_SayHelloToManyParams, 1 },
+};
@@ -0,0 +1,253 @@
+// Generated by idlgen from IHelloWorld.idl. Do not edit, run idlgen again instead.
+#pragma once
+#include "../WireFormat.h"
+
+// Calls IHelloWorld on the other side of a WireChannel
+class IHelloWorldWireProxy
+{
+    WireChannel* m_channel;
+
+public:
+    explicit IHelloWorldWireProxy(WireChannel* channel) : m_channel(channel) {}
+
+    HRESULT SayHello()
+    {
+        WireWriter request;
+        request.PutUInt32(1);
+        if (request.Failed())
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        WireReader reply;
+        HRESULT hr = m_channel->Call(request, &reply);
+        HRESULT result = E_FAIL;
+        if (SUCCEEDED(hr))
+        {
+            hr = reply.GetHResult(&result);
+        }
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        return result;
+    }
+
+    HRESULT SayHelloStr(BSTR* greeting)
+    {
+        if (greeting == NULL)
+        {
+            return E_POINTER;
+        }
+        *greeting = NULL;
+
+        WireWriter request;
+        request.PutUInt32(2);
+        if (request.Failed())
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        WireReader reply;
+        HRESULT hr = m_channel->Call(request, &reply);
+        HRESULT result = E_FAIL;
+        if (SUCCEEDED(hr))
+        {
+            hr = reply.GetHResult(&result);
+        }
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        if (SUCCEEDED(result))
+        {
+            hr = reply.GetBstrCopy(greeting);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+        return result;
+    }
+
+    HRESULT SayHelloTo(BSTR name, BSTR* greeting)
+    {
+        if (greeting == NULL)
+        {
+            return E_POINTER;
+        }
+        *greeting = NULL;
+
+        WireWriter request;
+        request.PutUInt32(3);
+        request.PutBstr(name);
+        if (request.Failed())
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        WireReader reply;
+        HRESULT hr = m_channel->Call(request, &reply);
+        HRESULT result = E_FAIL;
+        if (SUCCEEDED(hr))
+        {
+            hr = reply.GetHResult(&result);
+        }
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        if (SUCCEEDED(result))
+        {
+            hr = reply.GetBstrCopy(greeting);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+        return result;
+    }
+
+    HRESULT SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings)
+    {
+        if (greetings == NULL)
+        {
+            return E_POINTER;
+        }
+        *greetings = NULL;
+
+        WireWriter request;
+        request.PutUInt32(4);
+        request.PutBstrArray(names);
+        if (request.Failed())
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        WireReader reply;
+        HRESULT hr = m_channel->Call(request, &reply);
+        HRESULT result = E_FAIL;
+        if (SUCCEEDED(hr))
+        {
+            hr = reply.GetHResult(&result);
+        }
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        if (SUCCEEDED(result))
+        {
+            hr = reply.GetBstrArray(greetings);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+        return result;
+    }
+};
+
+// Unpacks a request, calls the method on 'server' and packs the reply. [in] strings are
+// handed to the server straight from the request buffer, which must stay valid and
+// 4-byte aligned for the duration of the call.
+template <class Server>
+HRESULT IHelloWorldWireStub(Server* server, WireReader& request, WireWriter& reply)
+{
+    UINT32 method;
+    HRESULT hr = request.GetUInt32(&method);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    switch (method)
+    {
+    case 1:
+    {
+        if (SUCCEEDED(hr) && !request.AtEnd())
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+        if (SUCCEEDED(hr))
+        {
+            HRESULT result = server->SayHello();
+            reply.PutHResult(result);
+            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;
+        }
+        return hr;
+    }
+    case 2:
+    {
+        BSTR greeting = NULL;
+        if (SUCCEEDED(hr) && !request.AtEnd())
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+        if (SUCCEEDED(hr))
+        {
+            HRESULT result = server->SayHelloStr(&greeting);
+            reply.PutHResult(result);
+            if (SUCCEEDED(result))
+            {
+                reply.PutBstr(greeting);
+                SysFreeString(greeting);
+            }
+            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;
+        }
+        return hr;
+    }
+    case 3:
+    {
+        BSTR name = NULL;
+        BSTR greeting = NULL;
+        if (SUCCEEDED(hr))
+        {
+            hr = request.GetBstr(&name);
+        }
+        if (SUCCEEDED(hr) && !request.AtEnd())
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+        if (SUCCEEDED(hr))
+        {
+            HRESULT result = server->SayHelloTo(name, &greeting);
+            reply.PutHResult(result);
+            if (SUCCEEDED(result))
+            {
+                reply.PutBstr(greeting);
+                SysFreeString(greeting);
+            }
+            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;
+        }
+        return hr;
+    }
+    case 4:
+    {
+        SAFEARRAY* names = NULL;
+        SAFEARRAY* greetings = NULL;
+        if (SUCCEEDED(hr))
+        {
+            hr = request.GetBstrArray(&names);
+        }
+        if (SUCCEEDED(hr) && !request.AtEnd())
+        {
+            hr = RPC_E_INVALID_DATA;
+        }
+        if (SUCCEEDED(hr))
+        {
+            HRESULT result = server->SayHelloToMany(names, &greetings);
+            reply.PutHResult(result);
+            if (SUCCEEDED(result))
+            {
+                reply.PutBstrArray(greetings);
+                SafeArrayDestroy(greetings);
+            }
+            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;
+        }
+        SafeArrayDestroy(names);
+        return hr;
+    }
+    default:
+        return RPC_E_INVALID_DATA;
+    }
+}
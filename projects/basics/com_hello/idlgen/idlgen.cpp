@@ -0,0 +1,616 @@
+// idlgen - generates the dispatch table and the wire proxy/stub of our interfaces from
+// their IDL.
+//
+//     idlgen IHelloWorld.idl ./gen
+//
+// writes gen/IHelloWorld_dispatch.h and gen/IHelloWorld_wire.h for every interface in the
+// file. The interface header itself still comes from MIDL, the clients include it.
+//
+// Only the subset of IDL our interfaces use is understood: IDispatch-based interfaces with
+// id(...) on every method, HRESULT return values, and [in] or [out, retval] parameters of type BSTR, LONG
+// and SAFEARRAY(BSTR). Anything else stops the generator with an error, rather than
+// producing code that marshals it wrong. Interfaces based on IUnknown have no DISPIDs and
+// are skipped, they are left to MIDL entirely, and so are the typedefs they use.
+//
+// The tool is plain C++17 without any Windows headers, so it builds anywhere:
+//
+//     cl /EHsc /std:c++17 idlgen.cpp
+//     g++ -std=c++17 -o idlgen idlgen.cpp
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class WireType { Bstr, Long, BstrArray };
+
+struct Param
+{
+    std::string name;
+    WireType type;
+    bool out;       // [out, retval], a pointer to the type
+};
+
+struct Method
+{
+    std::string name;
+    long dispid;
+    std::vector<Param> params;
+};
+
+struct Interface
+{
+    std::string name;
+    std::string base;
+    std::vector<Method> methods;
+};
+
+struct Token
+{
+    std::string text;
+    int line;
+};
+
+// Splits IDL into identifiers, numbers, string literals and single punctuation characters.
+// Comments and preprocessor lines are dropped.
+static std::vector<Token> Tokenize(const std::string& src)
+{
+    std::vector<Token> tokens;
+    int line = 1;
+    for (size_t i = 0; i < src.size();)
+    {
+        char c = src[i];
+        if (c == '\n')
+        {
+            ++line;
+            ++i;
+        }
+        else if (isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+        }
+        else if (src.compare(i, 2, "//") == 0 || (c == '#' && (i == 0 || src[i - 1] == '\n')))
+        {
+            while (i < src.size() && src[i] != '\n')
+                ++i;
+        }
+        else if (src.compare(i, 2, "/*") == 0)
+        {
+            size_t end = src.find("*/", i + 2);
+            end = (end == std::string::npos) ? src.size() : end + 2;
+            for (; i < end; ++i)
+                line += (src[i] == '\n');
+        }
+        else if (c == '"')
+        {
+            size_t end = src.find('"', i + 1);
+            if (end == std::string::npos)
+                throw std::runtime_error("line " + std::to_string(line) + ": unterminated string");
+            tokens.push_back({ src.substr(i, end + 1 - i), line });
+            i = end + 1;
+        }
+        else if (isalnum(static_cast<unsigned char>(c)) || c == '_')
+        {
+            size_t start = i;
+            // GUIDs in uuid(...) are not quoted, so take the dashes along
+            while (i < src.size() && (isalnum(static_cast<unsigned char>(src[i])) || src[i] == '_' || src[i] == '-'))
+                ++i;
+            tokens.push_back({ src.substr(start, i - start), line });
+        }
+        else
+        {
+            tokens.push_back({ std::string(1, c), line });
+            ++i;
+        }
+    }
+    return tokens;
+}
+
+class Parser
+{
+    std::vector<Token> m_tokens;
+    size_t m_pos = 0;
+
+    [[noreturn]] void Fail(const std::string& message) const
+    {
+        int line = m_tokens.empty() ? 0 : m_tokens[m_pos < m_tokens.size() ? m_pos : m_tokens.size() - 1].line;
+        throw std::runtime_error("line " + std::to_string(line) + ": " + message);
+    }
+
+    bool AtEnd() const { return m_pos >= m_tokens.size(); }
+    const std::string& Peek(size_t ahead = 0) const
+    {
+        static const std::string end;
+        return (m_pos + ahead >= m_tokens.size()) ? end : m_tokens[m_pos + ahead].text;
+    }
+
+    std::string Next()
+    {
+        if (AtEnd())
+            Fail("unexpected end of file");
+        return m_tokens[m_pos++].text;
+    }
+
+    void Expect(const std::string& text)
+    {
+        if (Next() != text)
+        {
+            --m_pos;
+            Fail("expected '" + text + "' but found '" + Peek() + "'");
+        }
+    }
+
+    // Skips a balanced (), [] or {} group, the opening bracket being the next token
+    void SkipGroup()
+    {
+        std::string open = Next();
+        std::string close = (open == "(") ? ")" : (open == "[") ? "]" : "}";
+        int depth = 1;
+        while (depth > 0)
+        {
+            std::string t = Next();
+            if (t == open)
+                ++depth;
+            else if (t == close)
+                --depth;
+        }
+    }
+
+    // Reads "[a, b(x), c]" into a list of attributes, each with its argument text
+    std::vector<std::pair<std::string, std::string>> Attributes()
+    {
+        std::vector<std::pair<std::string, std::string>> attributes;
+        if (Peek() != "[")
+            return attributes;
+        Next();
+        while (Peek() != "]")
+        {
+            std::string name = Next();
+            std::string args;
+            if (Peek() == "(")
+            {
+                Next();
+                int depth = 1;
+                for (;;)
+                {
+                    std::string t = Next();
+                    depth += (t == "(") - (t == ")");
+                    if (depth == 0)
+                        break;
+                    args += t;
+                }
+            }
+            attributes.push_back({ name, args });
+            if (Peek() == ",")
+                Next();
+        }
+        Expect("]");
+        return attributes;
+    }
+
+    static const std::string* Find(const std::vector<std::pair<std::string, std::string>>& attributes, const char* name)
+    {
+        for (const auto& attribute : attributes)
+        {
+            if (attribute.first == name)
+                return &attribute.second;
+        }
+        return nullptr;
+    }
+
+    Param ParseParam()
+    {
+        auto attributes = Attributes();
+        Param param;
+        param.out = Find(attributes, "out") != nullptr;
+        if (param.out && Find(attributes, "retval") == nullptr)
+            Fail("only [out, retval] parameters are supported");
+        if (!param.out && Find(attributes, "in") == nullptr)
+            Fail("parameters must be [in] or [out, retval]");
+        if (Find(attributes, "lcid") != nullptr)
+            Fail("[lcid] parameters are not supported");
+
+        std::string type = Next();
+        if (type == "SAFEARRAY")
+        {
+            Expect("(");
+            std::string element = Next();
+            Expect(")");
+            if (element != "BSTR")
+                Fail("only SAFEARRAY(BSTR) is supported");
+            param.type = WireType::BstrArray;
+        }
+        else if (type == "BSTR")
+            param.type = WireType::Bstr;
+        else if (type == "LONG" || type == "long")
+            param.type = WireType::Long;
+        else
+            Fail("unsupported parameter type '" + type + "'");
+
+        int pointers = 0;
+        while (Peek() == "*")
+        {
+            Next();
+            ++pointers;
+        }
+        if (pointers != (param.out ? 1 : 0))
+            Fail("[in] parameters are passed by value, [out] parameters by pointer");
+
+        param.name = Next();
+        return param;
+    }
+
+    Method ParseMethod()
+    {
+        auto attributes = Attributes();
+        const std::string* id = Find(attributes, "id");
+        if (id == nullptr)
+            Fail("every method needs an id(...)");
+
+        Method method;
+        method.dispid = strtol(id->c_str(), nullptr, 0);
+        if (Next() != "HRESULT")
+            Fail("methods must return HRESULT");
+        method.name = Next();
+
+        Expect("(");
+        if (Peek() == "void")
+            Next();
+        while (Peek() != ")")
+        {
+            method.params.push_back(ParseParam());
+            if (Peek() == ",")
+                Next();
+        }
+        Expect(")");
+        Expect(";");
+
+        for (size_t i = 0; i + 1 < method.params.size(); ++i)
+        {
+            if (method.params[i].out)
+                Fail("the [out, retval] parameter must come last");
+        }
+        return method;
+    }
+
+    Interface ParseInterface()
+    {
+        Interface itf;
+        itf.name = Next();
+        Expect(":");
+        itf.base = Next();
+        Expect("{");
+        while (Peek() != "}")
+            itf.methods.push_back(ParseMethod());
+        Expect("}");
+        if (Peek() == ";")
+            Next();
+        return itf;
+    }
+
+public:
+    explicit Parser(const std::string& src) : m_tokens(Tokenize(src)) {}
+
+    std::vector<Interface> Parse()
+    {
+        std::vector<Interface> interfaces;
+        while (!AtEnd())
+        {
+            if (Peek() == "[")
+            {
+                SkipGroup();
+            }
+            else if (Peek() == "interface" && Peek(3) != "IDispatch")
+            {
+                // interface <name> : <base> { ... }
+                for (int i = 0; i < 4; ++i)
+                    Next();
+                SkipGroup();
+                if (Peek() == ";")
+                    Next();
+            }
+            else if (Peek() == "interface")
+            {
+                Next();
+                interfaces.push_back(ParseInterface());
+            }
+            else if (Peek() == "import" || Peek() == "importlib" || Peek() == "cpp_quote")
+            {
+                while (Next() != ";")
+                {
+                }
+            }
+            else if (Peek() == "typedef")
+            {
+                // typedef enum|struct <tag> { ... } <name>;
+                while (Peek() != ";")
+                {
+                    if (Peek() == "{")
+                        SkipGroup();
+                    else
+                        Next();
+                }
+                Next();
+            }
+            else if (Peek() == "library" || Peek() == "coclass" || Peek() == "dispinterface")
+            {
+                // Nothing to generate for these, MIDL builds the type library
+                Next();
+                Next();
+                SkipGroup();
+                if (Peek() == ";")
+                    Next();
+            }
+            else
+            {
+                Fail("unexpected '" + Peek() + "'");
+            }
+        }
+        return interfaces;
+    }
+};
+
+static const char* CppType(WireType type)
+{
+    switch (type)
+    {
+    case WireType::Bstr: return "BSTR";
+    case WireType::Long: return "LONG";
+    default: return "SAFEARRAY*";
+    }
+}
+
+static const char* WireSuffix(WireType type)
+{
+    switch (type)
+    {
+    case WireType::Bstr: return "Bstr";
+    case WireType::Long: return "Long";
+    default: return "BstrArray";
+    }
+}
+
+static std::string Signature(const Method& method)
+{
+    std::string s;
+    for (const Param& param : method.params)
+    {
+        if (!s.empty())
+            s += ", ";
+        s += std::string(CppType(param.type)) + (param.out ? "* " : " ") + param.name;
+    }
+    return s;
+}
+
+static void Banner(std::ostream& out, const std::string& idl)
+{
+    out << "// Generated by idlgen from " << idl << ". Do not edit, run idlgen again instead.\n";
+    out << "#pragma once\n";
+}
+
+static void WriteDispatch(std::ostream& out, const std::string& idl, const Interface& itf)
+{
+    Banner(out, idl);
+    out << "#include \"../DispatchNames.h\"\n\n";
+
+    for (const Method& method : itf.methods)
+    {
+        std::string names;
+        for (const Param& param : method.params)
+        {
+            if (!param.out)
+                names += std::string(names.empty() ? "" : ", ") + "L\"" + param.name + "\"";
+        }
+        if (!names.empty())
+            out << "static constexpr const wchar_t* " << itf.name << "_" << method.name << "Params[] = { " << names << " };\n";
+    }
+
+    out << "\n// The late-bound view of " << itf.name << ": every method with its DISPID and the\n";
+    out << "// names of its [in] parameters, for DispatchNameMap and DispatchImpl::Describes\n";
+    out << "static constexpr DispatchMember " << itf.name << "_DispatchMembers[] =\n{\n";
+    for (const Method& method : itf.methods)
+    {
+        size_t inParams = 0;
+        for (const Param& param : method.params)
+            inParams += !param.out;
+        out << "    { L\"" << method.name << "\", " << method.dispid << ", ";
+        if (inParams == 0)
+            out << "NULL, 0 },\n";
+        else
+            out << itf.name << "_" << method.name << "Params, " << inParams << " },\n";
+    }
+    out << "};\n";
+}
+
+static void WriteWire(std::ostream& out, const std::string& idl, const Interface& itf)
+{
+    Banner(out, idl);
+    out << "#include \"../WireFormat.h\"\n\n";
+
+    // The proxy
+    out << "// Calls " << itf.name << " on the other side of a WireChannel\n";
+    out << "class " << itf.name << "WireProxy\n{\n";
+    out << "    WireChannel* m_channel;\n\n";
+    out << "public:\n";
+    out << "    explicit " << itf.name << "WireProxy(WireChannel* channel) : m_channel(channel) {}\n";
+    for (const Method& method : itf.methods)
+    {
+        out << "\n    HRESULT " << method.name << "(" << Signature(method) << ")\n    {\n";
+        for (const Param& param : method.params)
+        {
+            if (param.out)
+            {
+                out << "        if (" << param.name << " == NULL)\n";
+                out << "        {\n";
+                out << "            return E_POINTER;\n";
+                out << "        }\n";
+                out << "        *" << param.name << " = " << (param.type == WireType::Long ? "0" : "NULL") << ";\n\n";
+            }
+        }
+        out << "        WireWriter request;\n";
+        out << "        request.PutUInt32(" << method.dispid << ");\n";
+        for (const Param& param : method.params)
+        {
+            if (!param.out)
+                out << "        request.Put" << WireSuffix(param.type) << "(" << param.name << ");\n";
+        }
+        out << "        if (request.Failed())\n";
+        out << "        {\n";
+        out << "            return E_OUTOFMEMORY;\n";
+        out << "        }\n\n";
+        out << "        WireReader reply;\n";
+        out << "        HRESULT hr = m_channel->Call(request, &reply);\n";
+        out << "        HRESULT result = E_FAIL;\n";
+        out << "        if (SUCCEEDED(hr))\n";
+        out << "        {\n";
+        out << "            hr = reply.GetHResult(&result);\n";
+        out << "        }\n";
+        out << "        if (FAILED(hr))\n";
+        out << "        {\n";
+        out << "            return hr;\n";
+        out << "        }\n";
+        const Param* retval = (!method.params.empty() && method.params.back().out) ? &method.params.back() : nullptr;
+        if (retval != nullptr)
+        {
+            out << "        if (SUCCEEDED(result))\n";
+            out << "        {\n";
+            if (retval->type == WireType::Bstr)
+                out << "            hr = reply.GetBstrCopy(" << retval->name << ");\n";
+            else
+                out << "            hr = reply.Get" << WireSuffix(retval->type) << "(" << retval->name << ");\n";
+            out << "            if (FAILED(hr))\n";
+            out << "            {\n";
+            out << "                return hr;\n";
+            out << "            }\n";
+            out << "        }\n";
+        }
+        out << "        return result;\n";
+        out << "    }\n";
+    }
+    out << "};\n\n";
+
+    // The stub
+    out << "// Unpacks a request, calls the method on 'server' and packs the reply. [in] strings are\n";
+    out << "// handed to the server straight from the request buffer, which must stay valid and\n";
+    out << "// 4-byte aligned for the duration of the call.\n";
+    out << "template <class Server>\n";
+    out << "HRESULT " << itf.name << "WireStub(Server* server, WireReader& request, WireWriter& reply)\n{\n";
+    out << "    UINT32 method;\n";
+    out << "    HRESULT hr = request.GetUInt32(&method);\n";
+    out << "    if (FAILED(hr))\n";
+    out << "    {\n";
+    out << "        return hr;\n";
+    out << "    }\n\n";
+    out << "    switch (method)\n    {\n";
+    for (const Method& method : itf.methods)
+    {
+        out << "    case " << method.dispid << ":\n    {\n";
+        std::string args;
+        for (const Param& param : method.params)
+        {
+            if (param.out)
+            {
+                out << "        " << CppType(param.type) << " " << param.name << " = " << (param.type == WireType::Long ? "0" : "NULL") << ";\n";
+                args += std::string(args.empty() ? "" : ", ") + "&" + param.name;
+                continue;
+            }
+            out << "        " << CppType(param.type) << " " << param.name << (param.type == WireType::Long ? " = 0" : " = NULL") << ";\n";
+            args += std::string(args.empty() ? "" : ", ") + param.name;
+        }
+        for (const Param& param : method.params)
+        {
+            if (param.out)
+                continue;
+            out << "        if (SUCCEEDED(hr))\n";
+            out << "        {\n";
+            out << "            hr = request.Get" << WireSuffix(param.type) << "(&" << param.name << ");\n";
+            out << "        }\n";
+        }
+        out << "        if (SUCCEEDED(hr) && !request.AtEnd())\n";
+        out << "        {\n";
+        out << "            hr = RPC_E_INVALID_DATA;\n";
+        out << "        }\n";
+        out << "        if (SUCCEEDED(hr))\n";
+        out << "        {\n";
+        out << "            HRESULT result = server->" << method.name << "(" << args << ");\n";
+        out << "            reply.PutHResult(result);\n";
+        for (const Param& param : method.params)
+        {
+            if (!param.out)
+                continue;
+            out << "            if (SUCCEEDED(result))\n";
+            out << "            {\n";
+            out << "                reply.Put" << WireSuffix(param.type) << "(" << param.name << ");\n";
+            if (param.type == WireType::Bstr)
+                out << "                SysFreeString(" << param.name << ");\n";
+            else if (param.type == WireType::BstrArray)
+                out << "                SafeArrayDestroy(" << param.name << ");\n";
+            out << "            }\n";
+        }
+        out << "            hr = reply.Failed() ? E_OUTOFMEMORY : S_OK;\n";
+        out << "        }\n";
+        for (const Param& param : method.params)
+        {
+            // Arrays are decoded into real SAFEARRAYs, strings point into the request
+            if (!param.out && param.type == WireType::BstrArray)
+                out << "        SafeArrayDestroy(" << param.name << ");\n";
+        }
+        out << "        return hr;\n";
+        out << "    }\n";
+    }
+    out << "    default:\n";
+    out << "        return RPC_E_INVALID_DATA;\n";
+    out << "    }\n";
+    out << "}\n";
+}
+
+static void WriteFile(const std::string& path, void (*write)(std::ostream&, const std::string&, const Interface&), const std::string& idl, const Interface& itf)
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("can't write " + path);
+    write(out, idl, itf);
+    std::cout << path << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: idlgen <file.idl> <output directory>\n";
+        return 2;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in)
+    {
+        std::cerr << "idlgen: can't read " << argv[1] << "\n";
+        return 1;
+    }
+    std::stringstream src;
+    src << in.rdbuf();
+
+    std::string idl = argv[1];
+    size_t slash = idl.find_last_of("/\\");
+    if (slash != std::string::npos)
+        idl = idl.substr(slash + 1);
+
+    try
+    {
+        std::string dir = argv[2];
+        for (const Interface& itf : Parser(src.str()).Parse())
+        {
+            WriteFile(dir + "/" + itf.name + "_dispatch.h", WriteDispatch, idl, itf);
+            WriteFile(dir + "/" + itf.name + "_wire.h", WriteWire, idl, itf);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << argv[1] << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
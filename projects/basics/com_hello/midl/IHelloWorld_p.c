@@ -1,412 +0,0 @@
-/* this ALWAYS GENERATED file contains the proxy stub code */
-
-
-/* File created by MIDL compiler version 5.01.0164 */
-/* at Thu Jun 22 15:08:23 2023
- */
-/* Compiler settings for IHelloWorld.idl:
-    Oicf (OptLev=i2), W1, Zp8, env=Win32, ms_ext, c_ext
-    error checks: allocation ref bounds_check enum stub_data 
-*/
-//@@MIDL_FILE_HEADING(  )
-
-#define USE_STUBLESS_PROXY
-
-
-/* verify that the <rpcproxy.h> version is high enough to compile this file*/
-#ifndef __REDQ_RPCPROXY_H_VERSION__
-#define __REQUIRED_RPCPROXY_H_VERSION__ 440
-#endif
-
-
-#include "rpcproxy.h"
-#ifndef __RPCPROXY_H_VERSION__
-#error this stub requires an updated version of <rpcproxy.h>
-#endif // __RPCPROXY_H_VERSION__
-
-
-#include "IHelloWorld.h"
-
-#define TYPE_FORMAT_STRING_SIZE   55                                
-#define PROC_FORMAT_STRING_SIZE   85                                
-
-typedef struct _MIDL_TYPE_FORMAT_STRING
-    {
-    short          Pad;
-    unsigned char  Format[ TYPE_FORMAT_STRING_SIZE ];
-    } MIDL_TYPE_FORMAT_STRING;
-
-typedef struct _MIDL_PROC_FORMAT_STRING
-    {
-    short          Pad;
-    unsigned char  Format[ PROC_FORMAT_STRING_SIZE ];
-    } MIDL_PROC_FORMAT_STRING;
-
-
-extern const MIDL_TYPE_FORMAT_STRING __MIDL_TypeFormatString;
-extern const MIDL_PROC_FORMAT_STRING __MIDL_ProcFormatString;
-
-
-/* Object interface: IUnknown, ver. 0.0,
-   GUID={0x00000000,0x0000,0x0000,{0xC0,0x00,0x00,0x00,0x00,0x00,0x00,0x46}} */
-
-
-/* Object interface: IDispatch, ver. 0.0,
-   GUID={0x00020400,0x0000,0x0000,{0xC0,0x00,0x00,0x00,0x00,0x00,0x00,0x46}} */
-
-
-/* Object interface: IHelloWorld, ver. 0.0,
-   GUID={0xA851A7FE,0x4903,0x48AF,{0xA6,0x94,0x51,0xFE,0xB7,0x55,0xEE,0x5B}} */
-
-
-extern const MIDL_STUB_DESC Object_StubDesc;
-
-
-extern const MIDL_SERVER_INFO IHelloWorld_ServerInfo;
-
-#pragma code_seg(".orpc")
-extern const USER_MARSHAL_ROUTINE_QUADRUPLE UserMarshalRoutines[1];
-
-static const MIDL_STUB_DESC Object_StubDesc = 
-    {
-    0,
-    NdrOleAllocate,
-    NdrOleFree,
-    0,
-    0,
-    0,
-    0,
-    0,
-    __MIDL_TypeFormatString.Format,
-    1, /* -error bounds_check flag */
-    0x20000, /* Ndr library version */
-    0,
-    0x50100a4, /* MIDL Version 5.1.164 */
-    0,
-    UserMarshalRoutines,
-    0,  /* notify & notify_flag routine table */
-    1,  /* Flags */
-    0,  /* Reserved3 */
-    0,  /* Reserved4 */
-    0   /* Reserved5 */
-    };
-
-static const unsigned short IHelloWorld_FormatStringOffsetTable[] = 
-    {
-    (unsigned short) -1,
-    (unsigned short) -1,
-    (unsigned short) -1,
-    (unsigned short) -1,
-    0,
-    22,
-    50
-    };
-
-static const MIDL_SERVER_INFO IHelloWorld_ServerInfo = 
-    {
-    &Object_StubDesc,
-    0,
-    __MIDL_ProcFormatString.Format,
-    &IHelloWorld_FormatStringOffsetTable[-3],
-    0,
-    0,
-    0,
-    0
-    };
-
-static const MIDL_STUBLESS_PROXY_INFO IHelloWorld_ProxyInfo =
-    {
-    &Object_StubDesc,
-    __MIDL_ProcFormatString.Format,
-    &IHelloWorld_FormatStringOffsetTable[-3],
-    0,
-    0,
-    0
-    };
-
-CINTERFACE_PROXY_VTABLE(10) _IHelloWorldProxyVtbl = 
-{
-    &IHelloWorld_ProxyInfo,
-    &IID_IHelloWorld,
-    IUnknown_QueryInterface_Proxy,
-    IUnknown_AddRef_Proxy,
-    IUnknown_Release_Proxy ,
-    0 /* (void *)-1 /* IDispatch::GetTypeInfoCount */ ,
-    0 /* (void *)-1 /* IDispatch::GetTypeInfo */ ,
-    0 /* (void *)-1 /* IDispatch::GetIDsOfNames */ ,
-    0 /* IDispatch_Invoke_Proxy */ ,
-    (void *)-1 /* IHelloWorld::SayHello */ ,
-    (void *)-1 /* IHelloWorld::SayHelloStr */ ,
-    (void *)-1 /* IHelloWorld::SayHelloTo */
-};
-
-
-static const PRPC_STUB_FUNCTION IHelloWorld_table[] =
-{
-    STUB_FORWARDING_FUNCTION,
-    STUB_FORWARDING_FUNCTION,
-    STUB_FORWARDING_FUNCTION,
-    STUB_FORWARDING_FUNCTION,
-    NdrStubCall2,
-    NdrStubCall2,
-    NdrStubCall2
-};
-
-CInterfaceStubVtbl _IHelloWorldStubVtbl =
-{
-    &IID_IHelloWorld,
-    &IHelloWorld_ServerInfo,
-    10,
-    &IHelloWorld_table[-3],
-    CStdStubBuffer_DELEGATING_METHODS
-};
-
-#pragma data_seg(".rdata")
-
-static const USER_MARSHAL_ROUTINE_QUADRUPLE UserMarshalRoutines[1] = 
-        {
-            
-            {
-            BSTR_UserSize
-            ,BSTR_UserMarshal
-            ,BSTR_UserUnmarshal
-            ,BSTR_UserFree
-            }
-
-        };
-
-
-#if !defined(__RPC_WIN32__)
-#error  Invalid build platform for this stub.
-#endif
-
-#if !(TARGET_IS_NT40_OR_LATER)
-#error You need a Windows NT 4.0 or later to run this stub because it uses these features:
-#error   -Oif or -Oicf, [wire_marshal] or [user_marshal] attribute, more than 32 methods in the interface.
-#error However, your C/C++ compilation flags indicate you intend to run this app on earlier systems.
-#error This app will die there with the RPC_X_WRONG_STUB_VERSION error.
-#endif
-
-
-static const MIDL_PROC_FORMAT_STRING __MIDL_ProcFormatString =
-    {
-        0,
-        {
-
-	/* Procedure SayHello */
-
-			0x33,		/* FC_AUTO_HANDLE */
-			0x6c,		/* Old Flags:  object, Oi2 */
-/*  2 */	NdrFcLong( 0x0 ),	/* 0 */
-/*  6 */	NdrFcShort( 0x7 ),	/* 7 */
-#ifndef _ALPHA_
-/*  8 */	NdrFcShort( 0x8 ),	/* x86, MIPS, PPC Stack size/offset = 8 */
-#else
-			NdrFcShort( 0x10 ),	/* Alpha Stack size/offset = 16 */
-#endif
-/* 10 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 12 */	NdrFcShort( 0x8 ),	/* 8 */
-/* 14 */	0x4,		/* Oi2 Flags:  has return, */
-			0x1,		/* 1 */
-
-	/* Return value */
-
-/* 16 */	NdrFcShort( 0x70 ),	/* Flags:  out, return, base type, */
-#ifndef _ALPHA_
-/* 18 */	NdrFcShort( 0x4 ),	/* x86, MIPS, PPC Stack size/offset = 4 */
-#else
-			NdrFcShort( 0x8 ),	/* Alpha Stack size/offset = 8 */
-#endif
-/* 20 */	0x8,		/* FC_LONG */
-			0x0,		/* 0 */
-
-	/* Procedure SayHelloStr */
-
-/* 22 */	0x33,		/* FC_AUTO_HANDLE */
-			0x6c,		/* Old Flags:  object, Oi2 */
-/* 24 */	NdrFcLong( 0x0 ),	/* 0 */
-/* 28 */	NdrFcShort( 0x8 ),	/* 8 */
-#ifndef _ALPHA_
-/* 30 */	NdrFcShort( 0xc ),	/* x86, MIPS, PPC Stack size/offset = 12 */
-#else
-			NdrFcShort( 0x18 ),	/* Alpha Stack size/offset = 24 */
-#endif
-/* 32 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 34 */	NdrFcShort( 0x8 ),	/* 8 */
-/* 36 */	0x5,		/* Oi2 Flags:  srv must size, has return, */
-			0x2,		/* 2 */
-
-	/* Parameter greeting */
-
-/* 38 */	NdrFcShort( 0x2113 ),	/* Flags:  must size, must free, out, simple ref, srv alloc size=8 */
-#ifndef _ALPHA_
-/* 40 */	NdrFcShort( 0x4 ),	/* x86, MIPS, PPC Stack size/offset = 4 */
-#else
-			NdrFcShort( 0x8 ),	/* Alpha Stack size/offset = 8 */
-#endif
-/* 42 */	NdrFcShort( 0x1e ),	/* Type Offset=30 */
-
-	/* Return value */
-
-/* 44 */	NdrFcShort( 0x70 ),	/* Flags:  out, return, base type, */
-#ifndef _ALPHA_
-/* 46 */	NdrFcShort( 0x8 ),	/* x86, MIPS, PPC Stack size/offset = 8 */
-#else
-			NdrFcShort( 0x10 ),	/* Alpha Stack size/offset = 16 */
-#endif
-/* 48 */	0x8,		/* FC_LONG */
-			0x0,		/* 0 */
-
-	/* Procedure SayHelloTo */
-
-/* 50 */	0x33,		/* FC_AUTO_HANDLE */
-			0x6c,		/* Old Flags:  object, Oi2 */
-/* 52 */	NdrFcLong( 0x0 ),	/* 0 */
-/* 56 */	NdrFcShort( 0x9 ),	/* 9 */
-#ifndef _ALPHA_
-/* 58 */	NdrFcShort( 0x10 ),	/* x86, MIPS, PPC Stack size/offset = 16 */
-#else
-			NdrFcShort( 0x20 ),	/* Alpha Stack size/offset = 32 */
-#endif
-/* 60 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 62 */	NdrFcShort( 0x8 ),	/* 8 */
-/* 64 */	0x7,		/* Oi2 Flags:  srv must size, clt must size, has return, */
-			0x3,		/* 3 */
-
-	/* Parameter name */
-
-/* 66 */	NdrFcShort( 0x8b ),	/* Flags:  must size, must free, in, by val, */
-#ifndef _ALPHA_
-/* 68 */	NdrFcShort( 0x4 ),	/* x86, MIPS, PPC Stack size/offset = 4 */
-#else
-			NdrFcShort( 0x8 ),	/* Alpha Stack size/offset = 8 */
-#endif
-/* 70 */	NdrFcShort( 0x2c ),	/* Type Offset=44 */
-
-	/* Parameter greeting */
-
-/* 72 */	NdrFcShort( 0x2113 ),	/* Flags:  must size, must free, out, simple ref, srv alloc size=8 */
-#ifndef _ALPHA_
-/* 74 */	NdrFcShort( 0x8 ),	/* x86, MIPS, PPC Stack size/offset = 8 */
-#else
-			NdrFcShort( 0x10 ),	/* Alpha Stack size/offset = 16 */
-#endif
-/* 76 */	NdrFcShort( 0x1e ),	/* Type Offset=30 */
-
-	/* Return value */
-
-/* 78 */	NdrFcShort( 0x70 ),	/* Flags:  out, return, base type, */
-#ifndef _ALPHA_
-/* 80 */	NdrFcShort( 0xc ),	/* x86, MIPS, PPC Stack size/offset = 12 */
-#else
-			NdrFcShort( 0x18 ),	/* Alpha Stack size/offset = 24 */
-#endif
-/* 82 */	0x8,		/* FC_LONG */
-			0x0,		/* 0 */
-
-			0x0
-        }
-    };
-
-static const MIDL_TYPE_FORMAT_STRING __MIDL_TypeFormatString =
-    {
-        0,
-        {
-			NdrFcShort( 0x0 ),	/* 0 */
-/*  2 */	
-			0x11, 0x4,	/* FC_RP [alloced_on_stack] */
-/*  4 */	NdrFcShort( 0x1a ),	/* Offset= 26 (30) */
-/*  6 */	
-			0x13, 0x0,	/* FC_OP */
-/*  8 */	NdrFcShort( 0xc ),	/* Offset= 12 (20) */
-/* 10 */	
-			0x1b,		/* FC_CARRAY */
-			0x1,		/* 1 */
-/* 12 */	NdrFcShort( 0x2 ),	/* 2 */
-/* 14 */	0x9,		/* Corr desc: FC_ULONG */
-			0x0,		/*  */
-/* 16 */	NdrFcShort( 0xfffc ),	/* -4 */
-/* 18 */	0x6,		/* FC_SHORT */
-			0x5b,		/* FC_END */
-/* 20 */	
-			0x17,		/* FC_CSTRUCT */
-			0x3,		/* 3 */
-/* 22 */	NdrFcShort( 0x8 ),	/* 8 */
-/* 24 */	NdrFcShort( 0xfffffff2 ),	/* Offset= -14 (10) */
-/* 26 */	0x8,		/* FC_LONG */
-			0x8,		/* FC_LONG */
-/* 28 */	0x5c,		/* FC_PAD */
-			0x5b,		/* FC_END */
-/* 30 */	0xb4,		/* FC_USER_MARSHAL */
-			0x83,		/* 131 */
-/* 32 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 34 */	NdrFcShort( 0x4 ),	/* 4 */
-/* 36 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 38 */	NdrFcShort( 0xffffffe0 ),	/* Offset= -32 (6) */
-/* 40 */	
-			0x12, 0x0,	/* FC_UP */
-/* 42 */	NdrFcShort( 0xffffffea ),	/* Offset= -22 (20) */
-/* 44 */	0xb4,		/* FC_USER_MARSHAL */
-			0x83,		/* 131 */
-/* 46 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 48 */	NdrFcShort( 0x4 ),	/* 4 */
-/* 50 */	NdrFcShort( 0x0 ),	/* 0 */
-/* 52 */	NdrFcShort( 0xfffffff4 ),	/* Offset= -12 (40) */
-
-			0x0
-        }
-    };
-
-const CInterfaceProxyVtbl * _IHelloWorld_ProxyVtblList[] = 
-{
-    ( CInterfaceProxyVtbl *) &_IHelloWorldProxyVtbl,
-    0
-};
-
-const CInterfaceStubVtbl * _IHelloWorld_StubVtblList[] = 
-{
-    ( CInterfaceStubVtbl *) &_IHelloWorldStubVtbl,
-    0
-};
-
-PCInterfaceName const _IHelloWorld_InterfaceNamesList[] = 
-{
-    "IHelloWorld",
-    0
-};
-
-const IID *  _IHelloWorld_BaseIIDList[] = 
-{
-    &IID_IDispatch,
-    0
-};
-
-
-#define _IHelloWorld_CHECK_IID(n)	IID_GENERIC_CHECK_IID( _IHelloWorld, pIID, n)
-
-int __stdcall _IHelloWorld_IID_Lookup( const IID * pIID, int * pIndex )
-{
-    
-    if(!_IHelloWorld_CHECK_IID(0))
-        {
-        *pIndex = 0;
-        return 1;
-        }
-
-    return 0;
-}
-
-const ExtendedProxyFileInfo IHelloWorld_ProxyFileInfo = 
-{
-    (PCInterfaceProxyVtblList *) & _IHelloWorld_ProxyVtblList,
-    (PCInterfaceStubVtblList *) & _IHelloWorld_StubVtblList,
-    (const PCInterfaceName * ) & _IHelloWorld_InterfaceNamesList,
-    (const IID ** ) & _IHelloWorld_BaseIIDList,
-    & _IHelloWorld_IID_Lookup, 
-    1,
-    2,
-    0, /* table of [async_uuid] interfaces */
-    0, /* Filler1 */
-    0, /* Filler2 */
-    0  /* Filler3 */
-};
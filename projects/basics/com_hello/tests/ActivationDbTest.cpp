@@ -0,0 +1,261 @@
+#include "../ActivationDb.h"
+#include "./midl/IHelloWorld.h"
+#include "Check.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Writes a database of many classes and looks every one of them up, refuses damaged
+// files, and activates HelloWorld through a database that points at the shared library
+// the build made of it, HELLOWORLD_MODULE_PATH.
+static const int kClasses = 300;
+
+static GUID MakeClsid(int i)
+{
+    // Close to each other, so only a few bytes tell them apart
+    GUID clsid = { 0xDC0F3891, 0x93F3, 0x42E9, { 0xA1, 0x17, 0x72, 0x9B, 0x4F, 0x3C, 0x77, 0x5A } };
+    clsid.Data1 += i;
+    clsid.Data4[7] ^= static_cast<BYTE>(i * 7);
+    return clsid;
+}
+
+static std::wstring MakeProgId(int i)
+{
+    return L"HelloWorldLib.HelloWorld" + std::to_wstring(i);
+}
+
+static std::wstring TempPath(const char* name)
+{
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string(dir != NULL ? dir : "/tmp") + "/" + name;
+    return std::wstring(path.begin(), path.end());
+}
+
+static std::vector<BYTE> ReadBytes(const std::wstring& path)
+{
+    std::string narrow(path.begin(), path.end());
+    std::vector<BYTE> bytes;
+    FILE* file = fopen(narrow.c_str(), "rb");
+    if (file != NULL)
+    {
+        BYTE buffer[4096];
+        size_t cb;
+        while ((cb = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + cb);
+        }
+        fclose(file);
+    }
+    return bytes;
+}
+
+static void WriteBytes(const std::wstring& path, const std::vector<BYTE>& bytes)
+{
+    std::string narrow(path.begin(), path.end());
+    FILE* file = fopen(narrow.c_str(), "wb");
+    if (file != NULL)
+    {
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        fclose(file);
+    }
+}
+
+static void TestLookups(const std::wstring& path, const std::vector<std::wstring>& progIds)
+{
+    ActivationDb* db = NULL;
+    CHECK(ActivationDb::Open(path.c_str(), &db) == S_OK);
+    if (db == NULL)
+    {
+        return;
+    }
+    CHECK(db->ClassCount() == kClasses);
+
+    // Every key finds its own class, through both indexes
+    for (int i = 0; i < kClasses; ++i)
+    {
+        GUID clsid = MakeClsid(i);
+        CLSID found = CLSID_NULL;
+        CHECK(db->FindProgId(progIds[i].c_str(), &found) == S_OK && found == clsid);
+
+        const ActivationDbClass* entry = db->FindClsid(clsid);
+        CHECK(entry != NULL && entry->clsid == clsid);
+        if (entry != NULL)
+        {
+            // The file holds UTF-16 whatever wchar_t is
+            CHECK(std::u16string(progIds[i].begin(), progIds[i].end()) == db->ProgId(entry));
+            CHECK(std::u16string(u"HelloWorld.dll") == db->Module(entry));
+            CHECK(entry->threading == static_cast<UINT32>(i % 4));
+        }
+    }
+
+    // ProgIDs compare without regard to ASCII case
+    CLSID found;
+    CHECK(db->FindProgId(L"helloworldlib.helloworld7", &found) == S_OK && found == MakeClsid(7));
+    CHECK(db->FindProgId(L"HELLOWORLDLIB.HELLOWORLD42", &found) == S_OK && found == MakeClsid(42));
+
+    // Keys that aren't in the file land on some class, which must not match
+    CHECK(db->FindProgId(L"HelloWorldLib.HelloWorld", &found) == CO_E_CLASSSTRING && found == CLSID_NULL);
+    CHECK(db->FindProgId(L"HelloWorldLib.HelloWorld300", &found) == CO_E_CLASSSTRING);
+    CHECK(db->FindProgId(L"", &found) == CO_E_CLASSSTRING);
+    CHECK(db->FindProgId(NULL, &found) == E_POINTER);
+    for (int i = kClasses; i < 4 * kClasses; ++i)
+    {
+        CHECK(db->FindClsid(MakeClsid(i)) == NULL);
+    }
+
+    // Without a COM runtime there is no apartment to create anything in, and nothing to load
+    void* pv = reinterpret_cast<void*>(1);
+    CHECK(db->CreateInstance(MakeClsid(0), NULL, IID_IUnknown, &pv) == CO_E_NOTINITIALIZED && pv == NULL);
+    CHECK(db->CreateInstance(MakeClsid(kClasses), NULL, IID_IUnknown, &pv) == REGDB_E_CLASSNOTREG);
+    CHECK(db->GetClassObject(MakeClsid(1), IID_IClassFactory, &pv) == HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND) && pv == NULL);
+
+    delete db;
+}
+
+static void TestDamagedFiles(const std::wstring& path)
+{
+    std::vector<BYTE> good = ReadBytes(path);
+    CHECK(good.size() > sizeof(ActivationDbHeader));
+    std::wstring damagedPath = TempPath("ActivationDbTest.damaged.actdb");
+    const HRESULT badFormat = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+    ActivationDbHeader header;
+    memcpy(&header, good.data(), sizeof(header));
+
+    struct Damage
+    {
+        const char* what;
+        size_t offset;
+        UINT32 value;
+    };
+    const Damage damages[] = {
+        { "magic", offsetof(ActivationDbHeader, magic), 0x12345678 },
+        { "version", offsetof(ActivationDbHeader, version), kActivationDbVersion + 1 },
+        { "file size", offsetof(ActivationDbHeader, fileSize), header.fileSize - 4 },
+        { "no classes", offsetof(ActivationDbHeader, classCount), 0 },
+        { "table past the end", offsetof(ActivationDbHeader, classes), header.fileSize },
+        { "unaligned table", offsetof(ActivationDbHeader, progIdSlots), header.progIdSlots + 2 },
+        { "table in the header", offsetof(ActivationDbHeader, clsidSeeds), 4 },
+        { "slot out of range", header.progIdSlots, kClasses },
+        { "threading model", header.classes + offsetof(ActivationDbClass, threading), ActivationDbNeutral + 1 },
+        { "string past the end", header.classes + offsetof(ActivationDbClass, progId), header.fileSize },
+        { "unaligned string", header.classes + offsetof(ActivationDbClass, module), header.classes + 1 },
+    };
+    for (const Damage& damage : damages)
+    {
+        std::vector<BYTE> bytes = good;
+        memcpy(&bytes[damage.offset], &damage.value, sizeof(damage.value));
+        WriteBytes(damagedPath, bytes);
+
+        ActivationDb* db = reinterpret_cast<ActivationDb*>(1);
+        HRESULT hr = ActivationDb::Open(damagedPath.c_str(), &db);
+        if (hr != badFormat || db != NULL)
+        {
+            fprintf(stderr, "damaged %s: 0x%08X\n", damage.what, static_cast<unsigned int>(hr));
+        }
+        CHECK(hr == badFormat && db == NULL);
+    }
+
+    // A last string that runs into the end of the file without its terminator
+    std::vector<BYTE> unterminated = good;
+    unterminated.back() = 'x';
+    WriteBytes(damagedPath, unterminated);
+    ActivationDb* db = NULL;
+    CHECK(ActivationDb::Open(damagedPath.c_str(), &db) == badFormat);
+
+    // Shorter than a header
+    WriteBytes(damagedPath, std::vector<BYTE>(good.begin(), good.begin() + sizeof(ActivationDbHeader) - 1));
+    CHECK(ActivationDb::Open(damagedPath.c_str(), &db) == badFormat);
+
+    remove(std::string(damagedPath.begin(), damagedPath.end()).c_str());
+}
+
+// Through a real module: the ProgID finds the CLSID, the first activation loads the module
+// and resolves its entry point, and the object greets
+static void TestActivation()
+{
+    static const CLSID kMissingExport = { 0x1B2E6C53, 0x5E07, 0x4B0A, { 0x9D, 0x3E, 0x41, 0x6F, 0x0C, 0x88, 0x12, 0x7D } };
+    ActivationDbWriter writer;
+    CHECK(writer.Add(CLSID_HelloWorld, L"HelloWorldLib.HelloWorld", L"" HELLOWORLD_MODULE_PATH, "DllGetClassObject", ActivationDbBoth) == S_OK);
+    CHECK(writer.Add(kMissingExport, L"HelloWorldLib.Missing", L"" HELLOWORLD_MODULE_PATH, "DllGetMissingObject", ActivationDbBoth) == S_OK);
+    std::wstring path = TempPath("ActivationDbTest.module.actdb");
+    CHECK(writer.Write(path.c_str()) == S_OK);
+
+    ActivationDb* db = NULL;
+    CHECK(ActivationDb::Open(path.c_str(), &db) == S_OK);
+    if (db == NULL)
+    {
+        return;
+    }
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    CLSID clsid = CLSID_NULL;
+    CHECK(db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid) == S_OK && clsid == CLSID_HelloWorld);
+    for (int i = 0; i < 2; ++i)
+    {
+        IHelloWorld* pHelloWorld = NULL;
+        CHECK(db->CreateInstance(clsid, NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        if (pHelloWorld != NULL)
+        {
+            BSTR name = SysAllocString(L"John Doe");
+            BSTR greeting = NULL;
+            CHECK(pHelloWorld->SayHelloTo(name, &greeting) == S_OK);
+            CHECK(greeting != NULL && wcsstr(greeting, L"John Doe") != NULL);
+            SysFreeString(greeting);
+            SysFreeString(name);
+            CHECK(pHelloWorld->Release() == 0);
+        }
+    }
+
+    IClassFactory* pFactory = NULL;
+    CHECK(db->GetClassObject(clsid, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK && pFactory != NULL);
+    if (pFactory != NULL)
+    {
+        pFactory->Release();
+    }
+
+    // The module loads, but has no such export
+    void* pv = reinterpret_cast<void*>(1);
+    CHECK(db->GetClassObject(kMissingExport, IID_IClassFactory, &pv) == HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND) && pv == NULL);
+
+    CoUninitialize();
+    delete db;
+    remove(std::string(path.begin(), path.end()).c_str());
+}
+
+int main()
+{
+    std::vector<std::wstring> progIds;
+    ActivationDbWriter writer;
+    for (int i = 0; i < kClasses; ++i)
+    {
+        progIds.push_back(MakeProgId(i));
+    }
+    for (int i = 0; i < kClasses; ++i)
+    {
+        CHECK(writer.Add(MakeClsid(i), progIds[i].c_str(), L"HelloWorld.dll", "DllGetClassObject", static_cast<ActivationDbThreading>(i % 4)) == S_OK);
+    }
+
+    // Neither a CLSID nor a ProgID may come twice
+    CHECK(writer.Add(MakeClsid(3), L"Other.Class", L"Other.dll", "DllGetClassObject", ActivationDbBoth) == E_INVALIDARG);
+    CHECK(writer.Add(MakeClsid(kClasses), L"helloworldlib.HELLOWORLD3", L"Other.dll", "DllGetClassObject", ActivationDbBoth) == E_INVALIDARG);
+    CHECK(writer.Add(MakeClsid(kClasses), NULL, L"Other.dll", "DllGetClassObject", ActivationDbBoth) == E_POINTER);
+    if (sizeof(wchar_t) > sizeof(char16_t))
+    {
+        const wchar_t beyond[] = { L'A', static_cast<wchar_t>(0x1F600), 0 };
+        CHECK(writer.Add(MakeClsid(kClasses), beyond, L"Other.dll", "DllGetClassObject", ActivationDbBoth) == E_INVALIDARG);
+    }
+
+    std::wstring path = TempPath("ActivationDbTest.actdb");
+    CHECK(writer.Write(path.c_str()) == S_OK);
+    CHECK(ActivationDbWriter().Write(path.c_str()) == E_INVALIDARG);
+
+    TestLookups(path, progIds);
+    TestDamagedFiles(path);
+    TestActivation();
+
+    ActivationDb* db = reinterpret_cast<ActivationDb*>(1);
+    CHECK(ActivationDb::Open(TempPath("ActivationDbTest.missing.actdb").c_str(), &db) == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) && db == NULL);
+
+    remove(std::string(path.begin(), path.end()).c_str());
+    return CHECK_RESULT();
+}
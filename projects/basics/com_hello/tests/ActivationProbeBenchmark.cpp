@@ -0,0 +1,168 @@
+#include "../ActivationDb.h"
+#include "../ClassManifest.h"
+#include "../ActivationProbe.h"
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// HelloWorldClient_activationprobe off Windows: activates HelloWorld round after round
+// through the activation database, the class manifest and the DLL's own DllGetClassObject,
+// then prints the p50 and p99 of every stage, see ActivationProbe.h. The DLL is
+// HELLOWORLD_MODULE_PATH, HelloWorld.dll built with the probes, so the dump finds it by name
+// and adds its stages. Checks that every stage was timed, and that the JSON has them all.
+#ifndef HELLOWORLD_ACTIVATION_PROBES
+#error Build ActivationProbeBenchmark with HELLOWORLD_ACTIVATION_PROBES
+#endif
+
+static const wchar_t* const kModule = L"" HELLOWORLD_MODULE_PATH;
+
+static const char* const kStages[kActivationStageCount] = {
+    "ProgId", "ModuleLoad", "GetClassObject", "CreateInstance", "QueryInterface", "Activation"
+};
+
+static std::wstring TempPath(const char* name)
+{
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string(dir != NULL ? dir : "/tmp") + "/" + name;
+    return std::wstring(path.begin(), path.end());
+}
+
+static void Release(IHelloWorld* pHelloWorld)
+{
+    if (pHelloWorld != NULL)
+    {
+        pHelloWorld->Release();
+    }
+}
+
+// One activation each way. The database and the loader are new every round, so the module
+// is loaded, or found loaded, every round too.
+static HRESULT Round(const std::wstring& dbPath, ActivationDbGetClassObject getClassObject)
+{
+    ActivationDb* db = NULL;
+    ClassManifestLoader* loader = NULL;
+    HRESULT hr = ActivationDb::Open(dbPath.c_str(), &db);
+    if (SUCCEEDED(hr))
+    {
+        hr = ClassManifestLoader::Create(&kModule, 1, &loader);
+    }
+
+    CLSID clsid = CLSID_NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    if (SUCCEEDED(hr))
+    {
+        HELLOWORLD_PROBE_BEGIN(progId);
+        hr = db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+        HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
+    }
+    if (SUCCEEDED(hr))
+    {
+        HELLOWORLD_PROBE_BEGIN(activation);
+        hr = db->CreateInstance(clsid, NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld));
+        HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
+        Release(pHelloWorld);
+        pHelloWorld = NULL;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        HELLOWORLD_PROBE_BEGIN(progId);
+        hr = loader->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+        HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
+    }
+    if (SUCCEEDED(hr))
+    {
+        HELLOWORLD_PROBE_BEGIN(activation);
+        hr = loader->CreateInstance(clsid, NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld));
+        HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
+        Release(pHelloWorld);
+        pHelloWorld = NULL;
+    }
+
+    // What CoGetClassObject and IClassFactory::CreateInstance do once the DLL is known
+    if (SUCCEEDED(hr))
+    {
+        HELLOWORLD_PROBE_BEGIN(activation);
+        IClassFactory* pFactory = NULL;
+        hr = getClassObject(clsid, IID_IClassFactory, reinterpret_cast<void**>(&pFactory));
+        if (SUCCEEDED(hr))
+        {
+            hr = pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld));
+            pFactory->Release();
+        }
+        HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
+        Release(pHelloWorld);
+    }
+
+    delete loader;
+    delete db;
+    return hr;
+}
+
+// Reads the table back: every stage has a line with its count, p50, p99 and maximum
+static void CheckTable(const std::string& table, long rounds)
+{
+    std::istringstream lines(table);
+    std::string line;
+    std::getline(lines, line);
+    CHECK(line.compare(0, 5, "stage") == 0);
+    for (int i = 0; i < kActivationStageCount; ++i)
+    {
+        char name[32] = {};
+        unsigned long long count = 0, p50 = 0, p99 = 0, max = 0;
+        CHECK(std::getline(lines, line) && sscanf(line.c_str(), "%31s %llu %llu %llu %llu", name, &count, &p50, &p99, &max) == 5);
+        CHECK(strcmp(name, kStages[i]) == 0);
+        CHECK(count >= static_cast<unsigned long long>(rounds));
+        CHECK(p50 <= p99 && p99 <= max);
+        if (strcmp(name, kStages[i]) != 0 || count < static_cast<unsigned long long>(rounds))
+        {
+            fprintf(stderr, "stage %s: %llu timings\n", kStages[i], count);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long rounds = BenchmarkIterations(argc, argv, 2000);
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    ActivationDbWriter writer;
+    CHECK(writer.Add(CLSID_HelloWorld, L"HelloWorldLib.HelloWorld", kModule, "DllGetClassObject", ActivationDbBoth) == S_OK);
+    std::wstring dbPath = TempPath("ActivationProbeBenchmark.actdb");
+    CHECK(writer.Write(dbPath.c_str()) == S_OK);
+
+    HMODULE module = LoadLibraryExW(kModule, NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+    ActivationDbGetClassObject getClassObject = (module != NULL) ? reinterpret_cast<ActivationDbGetClassObject>(GetProcAddress(module, "DllGetClassObject")) : NULL;
+    CHECK(getClassObject != NULL && GetModuleHandleW(L"HelloWorld.dll") == module);
+    if (getClassObject != NULL)
+    {
+        HRESULT hr = S_OK;
+        for (long i = 0; i < rounds && SUCCEEDED(hr); ++i)
+        {
+            hr = Round(dbPath, getClassObject);
+        }
+        CHECK(hr == S_OK);
+
+        std::ostringstream table;
+        ActivationProbeDump(table);
+        std::cout << table.str();
+        CheckTable(table.str(), rounds);
+
+        SetEnvironmentVariableW(L"HELLOWORLD_PROBE_FORMAT", L"json");
+        std::ostringstream json;
+        ActivationProbeDump(json);
+        std::cout << json.str();
+        CHECK(json.str().compare(0, 26, "{\"unit\":\"ns\",\"stages\":[{\"s") == 0);
+        for (const char* stage : kStages)
+        {
+            CHECK(json.str().find(std::string("{\"stage\":\"") + stage + "\",\"count\":") != std::string::npos);
+        }
+    }
+
+    remove(std::string(dbPath.begin(), dbPath.end()).c_str());
+    CoUninitialize();
+    return CHECK_RESULT();
+}
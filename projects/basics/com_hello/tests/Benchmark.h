@@ -0,0 +1,36 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Benchmarks are plain executables too. They run for a fraction of a second under ctest and
+// print what they measured; they check that the code under test works, never how fast it
+// is, because a shared build machine can't tell. Pass a number of iterations on the
+// command line for a longer, steadier run.
+inline long BenchmarkIterations(int argc, char** argv, long defaultIterations)
+{
+    return (argc > 1) ? atol(argv[1]) : defaultIterations;
+}
+
+// Calls op() 'iterations' times and returns the nanoseconds one call took on average
+template <class Op>
+double NanosecondsPerCall(long iterations, Op op)
+{
+    // One round to warm up caches and allocators
+    for (long i = 0; i < iterations / 10 + 1; ++i)
+    {
+        op();
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+    {
+        op();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(iterations);
+}
+
+inline void PrintNanoseconds(const char* name, double ns)
+{
+    printf("%-48s %10.1f ns\n", name, ns);
+}
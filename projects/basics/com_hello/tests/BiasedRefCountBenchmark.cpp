@@ -0,0 +1,91 @@
+#include "../BiasedRefCount.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+// An AddRef and Release pair with BiasedRefCount against InterlockedIncrement/Decrement:
+// on the owner's thread, on a merged object, and on 1 to 8 threads that all count one
+// object, the owner among them. Plus what the one merge per object costs.
+static void Ignore(void*)
+{
+}
+
+// Every thread counts the same object; returns the slowest thread's time per pair
+template <class Pair>
+static double OnThreads(int threadCount, long iterations, Pair pair)
+{
+    std::vector<double> results(threadCount);
+    std::vector<std::thread> threads;
+    results[0] = 0;
+    for (int t = 1; t < threadCount; ++t)
+    {
+        threads.emplace_back([t, iterations, &results, &pair] { results[t] = NanosecondsPerCall(iterations, pair); });
+    }
+    // The calling thread is the owner
+    results[0] = NanosecondsPerCall(iterations, pair);
+    double worst = results[0];
+    for (int t = 1; t < threadCount; ++t)
+    {
+        threads[t - 1].join();
+        worst = (results[t] > worst) ? results[t] : worst;
+    }
+    return worst;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 2000000);
+
+    volatile LONG interlocked = 1;
+    BiasedRefCount biased(&Ignore, NULL);
+
+    PrintNanoseconds("Interlocked pair", NanosecondsPerCall(iterations, [&]
+    {
+        InterlockedIncrement(&interlocked);
+        InterlockedDecrement(&interlocked);
+    }));
+    PrintNanoseconds("Biased pair, owner", NanosecondsPerCall(iterations, [&]
+    {
+        biased.AddRef();
+        biased.Release();
+    }));
+
+    // Another thread takes and drops a reference of its own, which merges nothing
+    std::thread([&] { biased.AddRef(); biased.Release(); }).join();
+    const int threadCounts[] = { 1, 2, 4, 8 };
+    for (int threadCount : threadCounts)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "%d thread(s), one object, interlocked", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations / threadCount, [&]
+        {
+            InterlockedIncrement(&interlocked);
+            InterlockedDecrement(&interlocked);
+        }));
+        snprintf(line, sizeof(line), "%d thread(s), one object, biased", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations / threadCount, [&]
+        {
+            biased.AddRef();
+            biased.Release();
+        }));
+    }
+
+    // Merged objects count in the shared word, like Interlocked with a flag check
+    BiasedRefCount merged(&Ignore, NULL);
+    merged.AddRef();
+    std::thread([&] { merged.Release(); }).join();
+    PrintNanoseconds("Biased pair, merged", NanosecondsPerCall(iterations, [&]
+    {
+        merged.AddRef();
+        merged.Release();
+    }));
+
+    // The price of a merge by another thread, paid once per object that has one
+    PrintNanoseconds("FlushProcessWriteBuffers", NanosecondsPerCall(iterations / 100, [] { FlushProcessWriteBuffers(); }));
+
+    CHECK(interlocked == 1);
+    CHECK(biased.Release() == 0);
+    CHECK(merged.Release() == 0);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,171 @@
+#include "../BiasedRefCount.h"
+#include "Check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// The owner counting alone, other threads releasing what the owner handed them, with the
+// owner still busy, done or gone, and all of that at once on many objects. Every object
+// must be destroyed exactly once, never early, and only a merge by a thread other than the
+// owner may cost a FlushProcessWriteBuffers, once per object.
+struct Tracked
+{
+    BiasedRefCount refs;
+    std::atomic<int> destroyed{0};
+
+    Tracked() : refs(&Destroy, this) {}
+
+    static void Destroy(void* context)
+    {
+        ++static_cast<Tracked*>(context)->destroyed;
+    }
+};
+
+static LONG64 Flushes()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    return CompatFlushProcessWriteBuffersCount();
+#endif
+}
+
+static void OwnerOnly()
+{
+    LONG64 flushes = Flushes();
+    Tracked object;
+    for (int i = 0; i < 3; ++i)
+    {
+        object.refs.AddRef();
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        object.refs.Release();
+    }
+    CHECK(object.destroyed == 0);
+    CHECK(object.refs.Release() == 0);
+    CHECK(object.destroyed == 1);
+    CHECK(Flushes() == flushes);
+}
+
+// Another thread takes a reference of its own, and the owner lets go first: the owner
+// merges, without a flush, and the other thread destroys
+static void OwnerMergesFirst()
+{
+    LONG64 flushes = Flushes();
+    Tracked object;
+    std::thread([&object] { object.refs.AddRef(); }).join();
+    object.refs.Release();
+    CHECK(object.destroyed == 0);
+    std::thread([&object] { object.refs.Release(); }).join();
+    CHECK(object.destroyed == 1);
+    CHECK(Flushes() == flushes);
+}
+
+// The owner hands a reference to another thread, which releases it while the owner still
+// holds its own: that thread merges, with one flush
+static void OtherMergesFirst()
+{
+    LONG64 flushes = Flushes();
+    Tracked object;
+    object.refs.AddRef();
+    std::thread([&object] { object.refs.Release(); }).join();
+    CHECK(object.destroyed == 0);
+#ifndef _WIN32
+    CHECK(Flushes() == flushes + 1);
+#endif
+    object.refs.Release();
+    CHECK(object.destroyed == 1);
+#ifndef _WIN32
+    CHECK(Flushes() == flushes + 1);
+#endif
+}
+
+// The owner thread exits with references out: the last release merges and destroys
+static void OwnerGone()
+{
+    Tracked* object = NULL;
+    std::thread([&object]
+    {
+        object = new Tracked;
+        object->refs.AddRef();
+        object->refs.Release();
+    }).join();
+    CHECK(object->destroyed == 0);
+    std::thread([object] { object->refs.Release(); }).join();
+    CHECK(object->destroyed == 1);
+    delete object;
+}
+
+// The owner keeps adding and releasing references on every object while four threads do
+// the same with the references it handed them, and release those at the end
+static void Contention()
+{
+    const int kObjects = 1000;
+    const int kThreads = 4;
+    const int kChurn = 50;
+
+    LONG64 flushes = Flushes();
+    std::vector<Tracked*> objects(kObjects);
+    for (Tracked*& object : objects)
+    {
+        object = new Tracked;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            object->refs.AddRef();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&objects]
+        {
+            for (Tracked* object : objects)
+            {
+                for (int i = 0; i < kChurn; ++i)
+                {
+                    object->refs.AddRef();
+                    object->refs.Release();
+                }
+                object->refs.Release();
+            }
+        });
+    }
+    for (Tracked* object : objects)
+    {
+        for (int i = 0; i < kChurn; ++i)
+        {
+            object->refs.AddRef();
+            object->refs.Release();
+        }
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (Tracked* object : objects)
+    {
+        CHECK(object->destroyed == 0);
+        object->refs.Release();
+        CHECK(object->destroyed == 1);
+        delete object;
+    }
+    // The owner never let go first, so a worker merged each object, exactly once
+#ifndef _WIN32
+    CHECK(Flushes() == flushes + kObjects);
+#else
+    (void)flushes;
+#endif
+}
+
+int main()
+{
+    OwnerOnly();
+    OwnerMergesFirst();
+    OtherMergesFirst();
+    OwnerGone();
+    Contention();
+    return CHECK_RESULT();
+}
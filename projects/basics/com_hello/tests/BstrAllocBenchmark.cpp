@@ -0,0 +1,88 @@
+#include "../BstrAlloc.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Allocating and freeing a greeting-sized BSTR through BstrAllocLen, against plain
+// SysAllocString and against SysAllocStringLen with the counts kept in one shared atomic,
+// which is what the per-thread counters replace. With more threads the shared counter's
+// cache line bounces between cores on every allocation; the per-thread counters don't.
+//
+// Off Windows SysAllocString is the compat one on top of operator new, so only the
+// differences between the rows mean something, not the absolute numbers.
+static const OLECHAR kGreeting[] = L"Hello, John Doe!";
+static const UINT kGreetingLength = ARRAYSIZE(kGreeting) - 1;
+
+static std::atomic<LONG64> s_sharedAllocations{0};
+static std::atomic<LONG64> s_sharedBytes{0};
+
+template <class Op>
+static double OnThreads(int threadCount, long iterations, Op op)
+{
+    std::vector<double> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([t, iterations, &results, &op]
+        {
+            results[t] = NanosecondsPerCall(iterations, op);
+        });
+    }
+    double worst = 0;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads[t].join();
+        worst = (results[t] > worst) ? results[t] : worst;
+    }
+    return worst;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 500000);
+
+    BstrAllocStats before;
+    GetBstrAllocStats(&before);
+
+    const int threadCounts[] = { 1, 4, 8 };
+    for (int threadCount : threadCounts)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "%d thread(s), SysAllocString", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, []
+        {
+            SysFreeString(SysAllocString(kGreeting));
+        }));
+
+        snprintf(line, sizeof(line), "%d thread(s), shared atomic counters", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, []
+        {
+            BSTR bstr = SysAllocStringLen(kGreeting, kGreetingLength);
+            s_sharedAllocations.fetch_add(1);
+            s_sharedBytes.fetch_add(kGreetingLength * sizeof(OLECHAR));
+            SysFreeString(bstr);
+        }));
+
+        snprintf(line, sizeof(line), "%d thread(s), BstrAllocLiteral", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, []
+        {
+            SysFreeString(BstrAllocLiteral(kGreeting));
+        }));
+    }
+
+    // Every allocation was counted, and in the right size class
+    BstrAllocStats after;
+    GetBstrAllocStats(&after);
+    LONG64 expected = 0;
+    for (int threadCount : threadCounts)
+    {
+        expected += threadCount * (iterations + iterations / 10 + 1);
+    }
+    CHECK(after.allocations - before.allocations == expected);
+    CHECK(after.bySizeClass[BstrSize16] - before.bySizeClass[BstrSize16] == expected);
+    CHECK(after.bytes - before.bytes == expected * kGreetingLength * static_cast<LONG64>(sizeof(OLECHAR)));
+    CHECK(after.failures == before.failures);
+    return CHECK_RESULT();
+}
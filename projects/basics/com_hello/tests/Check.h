@@ -0,0 +1,22 @@
+#pragma once
+#include <stdio.h>
+
+// Every test is a plain executable: CHECK reports each failed condition with its line, and
+// main returns CHECK_RESULT(), which is nonzero if any of them failed, for ctest.
+inline int& CheckFailures()
+{
+    static int s_failures = 0;
+    return s_failures;
+}
+
+#define CHECK(condition)                                                            \
+    do                                                                              \
+    {                                                                               \
+        if (!(condition))                                                           \
+        {                                                                           \
+            fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++CheckFailures();                                                      \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_RESULT() (CheckFailures() == 0 ? 0 : 1)
@@ -0,0 +1,149 @@
+#include "../ClassManifest.h"
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <dlfcn.h>
+#include <chrono>
+
+// Cold-start activation from the manifest of HelloWorld built as a shared library,
+// HELLOWORLD_MODULE_PATH, in a process that hasn't loaded it yet. The registry functions
+// below take the place of compat's for the whole process, the test is linked with its
+// symbols exported, so any registry access HelloWorld makes is counted. Activation must
+// make none. DllRegisterServer makes some, which shows the counting works. The module
+// functions count what the loader holds, HelloWorld can't be unloaded to check.
+static const wchar_t* const kModule = L"" HELLOWORLD_MODULE_PATH;
+
+static LONG s_registryCalls = 0;
+static LONG s_modulesHeld = 0;
+
+HMODULE LoadLibraryExW(LPCWSTR path, HANDLE, DWORD)
+{
+    char narrow[MAX_PATH];
+    size_t i = 0;
+    for (; path[i] != 0 && i < MAX_PATH - 1; ++i)
+    {
+        narrow[i] = static_cast<char>(path[i]);
+    }
+    narrow[i] = 0;
+    HMODULE module = dlopen(narrow, RTLD_NOW);
+    if (module == NULL)
+    {
+        SetLastError(ERROR_MOD_NOT_FOUND);
+        return NULL;
+    }
+    ++s_modulesHeld;
+    return module;
+}
+
+BOOL FreeLibrary(HMODULE module)
+{
+    --s_modulesHeld;
+    return dlclose(module) == 0;
+}
+
+LONG RegCreateKeyExW(HKEY, LPCWSTR, DWORD, LPWSTR, DWORD, DWORD, void*, HKEY* result, DWORD*)
+{
+    ++s_registryCalls;
+    *result = NULL;
+    return ERROR_ACCESS_DENIED;
+}
+
+LONG RegSetValueExW(HKEY, LPCWSTR, DWORD, DWORD, const BYTE*, DWORD)
+{
+    ++s_registryCalls;
+    return ERROR_ACCESS_DENIED;
+}
+
+LONG RegCloseKey(HKEY)
+{
+    ++s_registryCalls;
+    return ERROR_SUCCESS;
+}
+
+LONG SHDeleteKeyW(HKEY, LPCWSTR)
+{
+    ++s_registryCalls;
+    return ERROR_ACCESS_DENIED;
+}
+
+static bool ModuleLoaded()
+{
+    void* module = dlopen(HELLOWORLD_MODULE_PATH, RTLD_NOW | RTLD_NOLOAD);
+    if (module != NULL)
+    {
+        dlclose(module);
+    }
+    return module != NULL;
+}
+
+// A Create that fails lets go of every module it loaded before the failure
+static void TestFailedCreate()
+{
+    const LPCWSTR missing[] = { kModule, L"/nonexistent/HelloWorld.so" };
+    ClassManifestLoader* loader = reinterpret_cast<ClassManifestLoader*>(1);
+    CHECK(ClassManifestLoader::Create(missing, ARRAYSIZE(missing), &loader) == HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND) && loader == NULL);
+    CHECK(s_modulesHeld == 0);
+
+    // The same module twice serves every class twice
+    const LPCWSTR twice[] = { kModule, kModule };
+    CHECK(ClassManifestLoader::Create(twice, ARRAYSIZE(twice), &loader) == E_INVALIDARG && loader == NULL);
+    CHECK(s_modulesHeld == 0);
+}
+
+static void TestColdStart()
+{
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    auto start = std::chrono::steady_clock::now();
+    ClassManifestLoader* loader = NULL;
+    CHECK(ClassManifestLoader::Create(&kModule, 1, &loader) == S_OK);
+    if (loader == NULL)
+    {
+        return;
+    }
+    CLSID clsid = CLSID_NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(loader->FindProgId(L"helloworldlib.helloworld", &clsid) == S_OK && clsid == CLSID_HelloWorld);
+    CHECK(loader->CreateInstance(clsid, NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    PrintNanoseconds("cold start, module load to first object", ns);
+
+    CHECK(loader->ClassCount() == 1);
+    const ClassManifestClass* info = loader->FindClsid(CLSID_HelloWorld);
+    CHECK(info != NULL && wcscmp(info->progId, L"HelloWorldLib.HelloWorld") == 0 && wcscmp(info->ThreadingModel(), L"Both") == 0);
+    CHECK(loader->FindProgId(L"HelloWorldLib.Missing", &clsid) == CO_E_CLASSSTRING && clsid == CLSID_NULL);
+    CHECK(loader->CreateInstance(IID_IHelloWorld, NULL, IID_IUnknown, reinterpret_cast<void**>(&pHelloWorld)) == REGDB_E_CLASSNOTREG);
+
+    if (pHelloWorld != NULL)
+    {
+        BSTR name = SysAllocString(L"John Doe");
+        BSTR greeting = NULL;
+        CHECK(pHelloWorld->SayHelloTo(name, &greeting) == S_OK);
+        CHECK(greeting != NULL && wcsstr(greeting, L"John Doe") != NULL);
+        SysFreeString(greeting);
+        SysFreeString(name);
+        CHECK(pHelloWorld->Release() == 0);
+    }
+    CHECK(s_registryCalls == 0);
+
+    // The module stays loaded, and registering it does go to the registry
+    CHECK(s_modulesHeld == 1 && ModuleLoaded());
+    void* module = dlopen(HELLOWORLD_MODULE_PATH, RTLD_NOW | RTLD_NOLOAD);
+    HRESULT (__stdcall *registerServer)() = (module != NULL) ? reinterpret_cast<HRESULT (__stdcall *)()>(dlsym(module, "DllRegisterServer")) : NULL;
+    CHECK(registerServer != NULL && FAILED(registerServer()) && s_registryCalls > 0);
+    if (module != NULL)
+    {
+        dlclose(module);
+    }
+
+    delete loader;
+    CoUninitialize();
+}
+
+int main()
+{
+    CHECK(!ModuleLoaded());
+    TestFailedCreate();
+    TestColdStart();
+    return CHECK_RESULT();
+}
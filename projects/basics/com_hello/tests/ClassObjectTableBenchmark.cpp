@@ -0,0 +1,189 @@
+#include "../ClassObjectTable.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// DllGetClassObject's lookup, on 1 to 8 threads at once: the ClassObjectTable with its
+// static class object, against what DllGetClassObject did before, which was to compare the
+// CLSID, allocate a new factory, QueryInterface it, bump the module count and Release it.
+// Both hand out a referenced class object, as DllGetClassObject must.
+static std::atomic<LONG> s_moduleCount{0};
+
+// What HelloWorldFactory was: a heap object with a reference count of its own
+class HeapFactory : public IClassFactory
+{
+    std::atomic<ULONG> m_refCount{1};
+
+public:
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (riid != IID_IUnknown && riid != IID_IClassFactory)
+        {
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+        *ppv = static_cast<IClassFactory*>(this);
+        AddRef();
+        return S_OK;
+    }
+    ULONG __stdcall AddRef() { return ++m_refCount; }
+    ULONG __stdcall Release()
+    {
+        ULONG count = --m_refCount;
+        if (count == 0)
+        {
+            delete this;
+        }
+        return count;
+    }
+    HRESULT __stdcall CreateInstance(IUnknown*, REFIID, void** ppv) { *ppv = NULL; return E_NOTIMPL; }
+    HRESULT __stdcall LockServer(BOOL) { return S_OK; }
+};
+
+// What HelloWorldFactory is now: static, its references only lock the module
+class StaticFactory : public IClassFactory
+{
+public:
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (riid != IID_IUnknown && riid != IID_IClassFactory)
+        {
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+        *ppv = static_cast<IClassFactory*>(this);
+        AddRef();
+        return S_OK;
+    }
+    ULONG __stdcall AddRef() { ++s_moduleCount; return 2; }
+    ULONG __stdcall Release() { --s_moduleCount; return 1; }
+    HRESULT __stdcall CreateInstance(IUnknown*, REFIID, void** ppv) { *ppv = NULL; return E_NOTIMPL; }
+    HRESULT __stdcall LockServer(BOOL) { return S_OK; }
+};
+
+static StaticFactory s_factories[16];
+
+static constexpr ClassObjectTable s_one({
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", &s_factories[0] },
+});
+
+static constexpr ClassObjectTable s_sixteen({
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C7750}", &s_factories[0] },  { L"{DC0F3891-93F3-42E9-A117-729B4F3C7751}", &s_factories[1] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C7752}", &s_factories[2] },  { L"{DC0F3891-93F3-42E9-A117-729B4F3C7753}", &s_factories[3] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C7754}", &s_factories[4] },  { L"{DC0F3891-93F3-42E9-A117-729B4F3C7755}", &s_factories[5] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C7756}", &s_factories[6] },  { L"{DC0F3891-93F3-42E9-A117-729B4F3C7757}", &s_factories[7] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C7758}", &s_factories[8] },  { L"{DC0F3891-93F3-42E9-A117-729B4F3C7759}", &s_factories[9] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", &s_factories[10] }, { L"{DC0F3891-93F3-42E9-A117-729B4F3C775B}", &s_factories[11] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C775C}", &s_factories[12] }, { L"{DC0F3891-93F3-42E9-A117-729B4F3C775D}", &s_factories[13] },
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C775E}", &s_factories[14] }, { L"{DC0F3891-93F3-42E9-A117-729B4F3C775F}", &s_factories[15] },
+});
+
+static constexpr GUID kClsid = { 0xDC0F3891, 0x93F3, 0x42E9, { 0xA1, 0x17, 0x72, 0x9B, 0x4F, 0x3C, 0x77, 0x5A } };
+
+static HRESULT GetClassObjectBefore(REFCLSID clsid, REFIID iid, void** ppv)
+{
+    if (clsid != kClsid)
+    {
+        return E_FAIL;
+    }
+    HeapFactory* factory = new HeapFactory();
+    HRESULT hr = factory->QueryInterface(iid, ppv);
+    if (SUCCEEDED(hr))
+    {
+        ++s_moduleCount;
+    }
+    factory->Release();
+    return hr;
+}
+
+template <size_t N>
+static HRESULT GetClassObject(const ClassObjectTable<N>& table, REFCLSID clsid, REFIID iid, void** ppv)
+{
+    IClassFactory* factory = table.Find(clsid);
+    if (factory == NULL)
+    {
+        *ppv = NULL;
+        return E_FAIL;
+    }
+    return factory->QueryInterface(iid, ppv);
+}
+
+// Gets and releases the class object, on every thread at once
+template <class GetClassObjectOp>
+static double OnThreads(int threadCount, long iterations, GetClassObjectOp getClassObject)
+{
+    std::vector<double> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([t, iterations, &results, &getClassObject]
+        {
+            results[t] = NanosecondsPerCall(iterations, [&getClassObject]
+            {
+                IClassFactory* factory = NULL;
+                if (SUCCEEDED(getClassObject(reinterpret_cast<void**>(&factory))))
+                {
+                    factory->Release();
+                }
+            });
+        });
+    }
+    double worst = 0;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads[t].join();
+        worst = (results[t] > worst) ? results[t] : worst;
+    }
+    return worst;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 500000);
+
+    IClassFactory* factory = NULL;
+    CHECK(GetClassObject(s_one, kClsid, IID_IClassFactory, reinterpret_cast<void**>(&factory)) == S_OK && factory == &s_factories[0]);
+    factory->Release();
+    CHECK(GetClassObject(s_sixteen, kClsid, IID_IClassFactory, reinterpret_cast<void**>(&factory)) == S_OK && factory == &s_factories[10]);
+    factory->Release();
+
+    const int threadCounts[] = { 1, 2, 4, 8 };
+    for (int threadCount : threadCounts)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "%d thread(s), new factory per call", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, [](void** ppv)
+        {
+            return GetClassObjectBefore(kClsid, IID_IClassFactory, ppv);
+        }));
+        snprintf(line, sizeof(line), "%d thread(s), table of 1", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, [](void** ppv)
+        {
+            return GetClassObject(s_one, kClsid, IID_IClassFactory, ppv);
+        }));
+        snprintf(line, sizeof(line), "%d thread(s), table of 16", threadCount);
+        PrintNanoseconds(line, OnThreads(threadCount, iterations, [](void** ppv)
+        {
+            return GetClassObject(s_sixteen, kClsid, IID_IClassFactory, ppv);
+        }));
+    }
+
+    // The lookup alone, without the reference that makes the module count a shared line,
+    // going through all 16 CLSIDs so the compiler can't keep one result
+    GUID clsids[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        clsids[i] = kClsid;
+        clsids[i].Data4[7] = static_cast<BYTE>(0x50 + i);
+    }
+    IClassFactory* volatile sink = NULL;
+    unsigned int next = 0;
+    PrintNanoseconds("Find in a table of 16, no reference", NanosecondsPerCall(iterations, [&]
+    {
+        sink = s_sixteen.Find(clsids[next++ & 15]);
+    }));
+    CHECK(sink != NULL);
+    return CHECK_RESULT();
+}
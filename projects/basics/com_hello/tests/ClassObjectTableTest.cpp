@@ -0,0 +1,116 @@
+#include "../ClassObjectTable.h"
+#include "Check.h"
+
+// Stands in for a class object, only its address matters
+class FakeFactory : public IClassFactory
+{
+public:
+    HRESULT __stdcall QueryInterface(REFIID, void** ppv) { *ppv = NULL; return E_NOINTERFACE; }
+    ULONG __stdcall AddRef() { return 2; }
+    ULONG __stdcall Release() { return 1; }
+    HRESULT __stdcall CreateInstance(IUnknown*, REFIID, void** ppv) { *ppv = NULL; return E_NOTIMPL; }
+    HRESULT __stdcall LockServer(BOOL) { return S_OK; }
+};
+
+static FakeFactory s_first, s_second, s_third, s_fourth;
+
+// Out of order, and with CLSIDs that only differ in Data4 or in the case of their digits
+static constexpr ClassObjectTable s_table({
+    { L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", &s_first },
+    { L"{00000000-0000-0000-0000-000000000001}", &s_second },
+    { L"{dc0f3891-93f3-42e9-a117-729b4f3c775b}", &s_third },
+    { L"{FFFFFFFF-FFFF-FFFF-FFFF-FFFFFFFFFFFF}", &s_fourth },
+});
+
+static constexpr GUID kFirst = { 0xDC0F3891, 0x93F3, 0x42E9, { 0xA1, 0x17, 0x72, 0x9B, 0x4F, 0x3C, 0x77, 0x5A } };
+
+// The table is built at compile time, so it can be asked at compile time too
+static_assert(s_table.Contains(ClassObjectKey::Parse(L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}")), "HelloWorld is served");
+static_assert(!s_table.Contains(ClassObjectKey::Parse(L"{DC0F3891-93F3-42E9-A117-729B4F3C775C}")), "nothing else is");
+
+static void TestParse()
+{
+    // A key parsed from a string matches the one made from the same GUID at run time
+    CHECK(ClassObjectKey::Parse(L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}") == ClassObjectKey::FromGuid(kFirst));
+    CHECK(ClassObjectKey::Parse(L"{dc0f3891-93f3-42e9-a117-729b4f3c775a}") == ClassObjectKey::FromGuid(kFirst));
+    CHECK(!(ClassObjectKey::Parse(L"{DC0F3891-93F3-42E9-A117-729B4F3C775B}") == ClassObjectKey::FromGuid(kFirst)));
+
+    GUID data1 = {};
+    data1.Data1 = 0x12345678;
+    CHECK(ClassObjectKey::Parse(L"{12345678-0000-0000-0000-000000000000}") == ClassObjectKey::FromGuid(data1));
+    GUID data4 = {};
+    data4.Data4[7] = 0xAB;
+    CHECK(ClassObjectKey::Parse(L"{00000000-0000-0000-0000-0000000000AB}") == ClassObjectKey::FromGuid(data4));
+
+    // Malformed strings throw, which makes them compile errors in a constant expression
+    const wchar_t* const malformed[] = {
+        L"DC0F3891-93F3-42E9-A117-729B4F3C775A",    // no braces
+        L"{DC0F3891-93F3-42E9-A117-729B4F3C775A",   // no closing brace
+        L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}x", // trailing characters
+        L"{DC0F3891+93F3-42E9-A117-729B4F3C775A}",  // wrong separator
+        L"{DC0F3891-93F3-42E9-A117-729B4F3C775G}",  // not a hex digit
+    };
+    for (const wchar_t* s : malformed)
+    {
+        bool threw = false;
+        try
+        {
+            ClassObjectKey::Parse(s);
+        }
+        catch (const char*)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+static void TestFind()
+{
+    CHECK(s_table.Find(kFirst) == &s_first);
+
+    GUID second = {};
+    second.Data4[7] = 0x01;
+    CHECK(s_table.Find(second) == &s_second);
+
+    GUID third = kFirst;
+    third.Data4[7] = 0x5B;
+    CHECK(s_table.Find(third) == &s_third);
+
+    GUID fourth;
+    memset(&fourth, 0xFF, sizeof(fourth));
+    CHECK(s_table.Find(fourth) == &s_fourth);
+
+    // Below the smallest key, between keys and above the largest one
+    CHECK(s_table.Find(CLSID_NULL) == NULL);
+    GUID between = kFirst;
+    between.Data4[7] = 0x59;
+    CHECK(s_table.Find(between) == NULL);
+    GUID almostFourth = fourth;
+    almostFourth.Data4[7] = 0xFE;
+    CHECK(s_table.Find(almostFourth) == NULL);
+
+    // A duplicate CLSID, in any case, is refused
+    bool threw = false;
+    try
+    {
+        ClassObjectEntry entries[] = {
+            { L"{DC0F3891-93F3-42E9-A117-729B4F3C775A}", &s_first },
+            { L"{dc0f3891-93f3-42e9-a117-729b4f3c775a}", &s_second },
+        };
+        ClassObjectTable<2> duplicate(entries);
+        (void)duplicate;
+    }
+    catch (const char*)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+int main()
+{
+    TestParse();
+    TestFind();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,119 @@
+#include "../DispatchImpl.h"
+#include "Benchmark.h"
+#include "Check.h"
+
+// Late-bound calls through the dispatch engine, against the hand-written switch it replaced.
+// The method itself does next to nothing, so what is measured is the unpacking of
+// DISPPARAMS and the storing of the result.
+class Target
+{
+public:
+    HRESULT __stdcall Length(BSTR name, LONG* pResult)
+    {
+        *pResult = static_cast<LONG>(SysStringLen(name));
+        return S_OK;
+    }
+    HRESULT __stdcall Subtract(LONG a, LONG b, LONG* pResult)
+    {
+        *pResult = a - b;
+        return S_OK;
+    }
+
+    // What Invoke looked like before DispatchImpl: one case per DISPID, taking only
+    // positional arguments of exactly the declared type
+    HRESULT Invoke(DISPID dispIdMember, DISPPARAMS* pDispParams, VARIANT* pVarResult)
+    {
+        switch (dispIdMember)
+        {
+        case 1:
+        {
+            if (pDispParams->cArgs != 1 || pDispParams->rgvarg[0].vt != VT_BSTR)
+                return DISP_E_TYPEMISMATCH;
+
+            LONG length;
+            HRESULT hr = Length(pDispParams->rgvarg[0].bstrVal, &length);
+            if (SUCCEEDED(hr))
+            {
+                pVarResult->vt = VT_I4;
+                pVarResult->lVal = length;
+            }
+            return hr;
+        }
+        default:
+            return DISP_E_MEMBERNOTFOUND;
+        }
+    }
+};
+
+typedef DispatchImpl<Target,
+    DispMethod<&Target::Length,   1>,
+    DispMethod<&Target::Subtract, 2>> TargetDispatch;
+
+static Target s_target;
+static long s_iterations;
+
+static double Time(DISPID id, DISPPARAMS* params)
+{
+    VARIANT result;
+    VariantInit(&result);
+    HRESULT hr = TargetDispatch::Invoke(&s_target, id, IID_NULL, LOCALE_USER_DEFAULT, DISPATCH_METHOD, params, &result, NULL, NULL);
+    CHECK(hr == S_OK && V_VT(&result) == VT_I4);
+
+    return NanosecondsPerCall(s_iterations, [id, params, &result]
+    {
+        TargetDispatch::Invoke(&s_target, id, IID_NULL, LOCALE_USER_DEFAULT, DISPATCH_METHOD, params, &result, NULL, NULL);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    s_iterations = BenchmarkIterations(argc, argv, 1000000);
+
+    BSTR name = SysAllocString(L"John Doe");
+    VARIANT arg;
+    VariantInit(&arg);
+    V_VT(&arg) = VT_BSTR;
+    V_BSTR(&arg) = name;
+    DISPPARAMS params = { &arg, NULL, 1, 0 };
+
+    VARIANT result;
+    VariantInit(&result);
+    CHECK(s_target.Invoke(1, &params, &result) == S_OK && V_I4(&result) == 8);
+    PrintNanoseconds("hand-written switch, BSTR", NanosecondsPerCall(s_iterations, [&params, &result]
+    {
+        s_target.Invoke(1, &params, &result);
+    }));
+    PrintNanoseconds("DispatchImpl, BSTR in place", Time(1, &params));
+
+    VARIANT byRef;
+    VariantInit(&byRef);
+    V_VT(&byRef) = VT_VARIANT | VT_BYREF;
+    V_VARIANTREF(&byRef) = &arg;
+    DISPPARAMS byRefParams = { &byRef, NULL, 1, 0 };
+    PrintNanoseconds("DispatchImpl, BSTR in a VARIANT*", Time(1, &byRefParams));
+
+    // The slow path allocates the converted string and frees it again
+    VARIANT number;
+    VariantInit(&number);
+    V_VT(&number) = VT_I4;
+    V_I4(&number) = 12345678;
+    DISPPARAMS coercedParams = { &number, NULL, 1, 0 };
+    PrintNanoseconds("DispatchImpl, LONG converted to BSTR", Time(1, &coercedParams));
+
+    VARIANT args[2];
+    VariantInit(&args[0]);
+    VariantInit(&args[1]);
+    V_VT(&args[0]) = VT_I4;
+    V_I4(&args[0]) = 3;
+    V_VT(&args[1]) = VT_I4;
+    V_I4(&args[1]) = 10;
+    DISPPARAMS positional = { args, NULL, 2, 0 };
+    PrintNanoseconds("DispatchImpl, two positional LONGs", Time(2, &positional));
+
+    DISPID named[2] = { 1, 0 };
+    DISPPARAMS namedParams = { args, named, 2, 2 };
+    PrintNanoseconds("DispatchImpl, two named LONGs", Time(2, &namedParams));
+
+    SysFreeString(name);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,370 @@
+#include "../DispatchImpl.h"
+#include "../gen/IHelloWorld_dispatch.h"
+#include "Check.h"
+
+// A return value the test can watch being freed. DispRetval frees a result nobody asked
+// for through VariantType<T>::Free, so giving Token a VariantType shows when that happens.
+struct Token
+{
+    int freed;
+};
+
+template <> struct VariantType<Token*>
+{
+    static constexpr VARTYPE vt = VT_BYREF;
+    static bool Accepts(VARTYPE argVt) { return argVt == vt; }
+    static Token*& Field(VARIANT* v) { return reinterpret_cast<Token*&>(V_BYREF(v)); }
+    static void Free(Token* value) { ++value->freed; }
+};
+
+// Stands in for HelloWorld, with the signatures of IHelloWorld's dispatch methods and a few
+// more that exercise the parts of the engine HelloWorld doesn't
+class Target
+{
+public:
+    LONG calls = 0;
+    LCID lastLcid = 0;
+    Token token = {};
+
+    HRESULT __stdcall SayHello() { ++calls; return S_OK; }
+    HRESULT __stdcall SayHelloStr(BSTR* pResult)
+    {
+        ++calls;
+        *pResult = SysAllocString(L"Hello, World!");
+        return (*pResult != NULL) ? S_OK : E_OUTOFMEMORY;
+    }
+    HRESULT __stdcall SayHelloTo(BSTR name, DispLcid lcid, BSTR* pResult)
+    {
+        ++calls;
+        lastLcid = static_cast<LCID>(lcid);
+        *pResult = SysAllocString(name);
+        return (*pResult != NULL) ? S_OK : E_OUTOFMEMORY;
+    }
+    HRESULT __stdcall SayHelloToMany(SAFEARRAY* names, DispLcid, LONG* pCount)
+    {
+        ++calls;
+        LONG lBound = 0, uBound = -1;
+        SafeArrayGetLBound(names, 1, &lBound);
+        SafeArrayGetUBound(names, 1, &uBound);
+        *pCount = uBound - lBound + 1;
+        return S_OK;
+    }
+
+    // Tells the order of its arguments apart
+    HRESULT __stdcall Subtract(LONG a, LONG b, LONG* pResult)
+    {
+        ++calls;
+        *pResult = a - b;
+        return S_OK;
+    }
+    HRESULT __stdcall GetToken(Token** ppToken)
+    {
+        ++calls;
+        *ppToken = &token;
+        return S_OK;
+    }
+    HRESULT __stdcall Fail(BSTR* pResult)
+    {
+        ++calls;
+        *pResult = NULL;
+        return E_FAIL;
+    }
+};
+
+typedef DispatchImpl<Target,
+    DispMethod<&Target::SayHello,       1>,
+    DispMethod<&Target::SayHelloStr,    2>,
+    DispMethod<&Target::SayHelloTo,     3>,
+    DispMethod<&Target::SayHelloToMany, 4>> TargetDispatch;
+
+typedef DispatchImpl<Target,
+    DispMethod<&Target::Subtract, 10>,
+    DispMethod<&Target::GetToken, 11>,
+    DispMethod<&Target::Fail,     12>> ExtraDispatch;
+
+static_assert(TargetDispatch::Describes(IHelloWorld_DispatchMembers), "Target is out of sync with IHelloWorld.idl");
+static_assert(DispMethodTraits<decltype(&Target::SayHelloTo)>::kInParams == 1, "DispLcid is not an [in] parameter");
+static_assert(DispMethodTraits<decltype(&Target::SayHelloTo)>::kHasLcid, "SayHelloTo takes the LCID");
+static_assert(DispMethodTraits<decltype(&Target::SayHelloTo)>::kHasRetval, "SayHelloTo has a retval");
+static_assert(!DispMethodTraits<decltype(&Target::SayHello)>::kHasRetval, "SayHello has no retval");
+static_assert(DispMethodTraits<decltype(&Target::Subtract)>::kInParams == 2, "Subtract takes two arguments");
+
+static const LCID kLcid = 0x0407;
+
+static VARIANT Long(LONG value)
+{
+    VARIANT v;
+    VariantInit(&v);
+    V_VT(&v) = VT_I4;
+    V_I4(&v) = value;
+    return v;
+}
+
+static VARIANT String(BSTR value)
+{
+    VARIANT v;
+    VariantInit(&v);
+    V_VT(&v) = VT_BSTR;
+    V_BSTR(&v) = value;
+    return v;
+}
+
+static VARIANT ByRef(VARTYPE vt, void* value)
+{
+    VARIANT v;
+    VariantInit(&v);
+    V_VT(&v) = vt | VT_BYREF;
+    V_BYREF(&v) = value;
+    return v;
+}
+
+template <class Dispatch>
+static HRESULT Call(Target* target, DISPID id, DISPPARAMS* params, VARIANT* result, UINT* argErr = NULL, WORD flags = DISPATCH_METHOD)
+{
+    return Dispatch::Invoke(target, id, IID_NULL, kLcid, flags, params, result, NULL, argErr);
+}
+
+static bool SameText(const VARIANT& v, const wchar_t* text)
+{
+    return V_VT(&v) == VT_BSTR && V_BSTR(&v) != NULL && wcscmp(V_BSTR(&v), text) == 0;
+}
+
+static void TestPositional()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+
+    DISPPARAMS none = { NULL, NULL, 0, 0 };
+    CHECK(Call<TargetDispatch>(&target, 1, &none, &result) == S_OK && target.calls == 1);
+    CHECK(V_VT(&result) == VT_EMPTY);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result) == S_OK);
+    CHECK(SameText(result, L"Hello, World!"));
+    VariantClear(&result);
+
+    // An argument of the right type is used in place, and the LCID reaches the method
+    BSTR name = SysAllocString(L"John Doe");
+    VARIANT args[2] = { String(name) };
+    DISPPARAMS one = { args, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 3, &one, &result) == S_OK);
+    CHECK(SameText(result, L"John Doe") && V_BSTR(&result) != name);
+    CHECK(target.lastLcid == kLcid);
+    VariantClear(&result);
+
+    // Positional arguments come in reverse order: rgvarg[0] is the last one
+    args[0] = Long(3);
+    args[1] = Long(10);
+    DISPPARAMS two = { args, NULL, 2, 0 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &two, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 7);
+
+    SAFEARRAY* names = SafeArrayCreateVector(VT_BSTR, 0, 3);
+    VARIANT array;
+    VariantInit(&array);
+    V_VT(&array) = VT_ARRAY | VT_BSTR;
+    V_ARRAY(&array) = names;
+    DISPPARAMS arrayParams = { &array, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 4, &arrayParams, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 3);
+
+    SafeArrayDestroy(names);
+    SysFreeString(name);
+}
+
+static void TestNamed()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+
+    // Named arguments come first, in any order, and name the parameter by its position
+    VARIANT args[2] = { Long(3), Long(10) };
+    DISPID named[2] = { 1, 0 };
+    DISPPARAMS allNamed = { args, named, 2, 2 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &allNamed, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 7);
+
+    // Positional arguments fill the first parameters, named ones the rest
+    DISPID second[1] = { 1 };
+    DISPPARAMS mixed = { args, second, 2, 1 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &mixed, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 7);
+
+    // A parameter that is neither passed by position nor named
+    DISPID wrong[2] = { 1, 5 };
+    DISPPARAMS missing = { args, wrong, 2, 2 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &missing, &result) == DISP_E_PARAMNOTFOUND);
+    CHECK(target.calls == 2);
+}
+
+static void TestByRef()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+
+    // VB passes variables ByRef: the value is read through the pointer
+    LONG a = 10;
+    LONG b = 3;
+    VARIANT args[2] = { ByRef(VT_I4, &b), ByRef(VT_I4, &a) };
+    DISPPARAMS params = { args, NULL, 2, 0 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &params, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 7);
+
+    BSTR name = SysAllocString(L"Jane");
+    VARIANT byRefName = ByRef(VT_BSTR, &name);
+    DISPPARAMS one = { &byRefName, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 3, &one, &result) == S_OK);
+    CHECK(SameText(result, L"Jane"));
+    VariantClear(&result);
+
+    // ... often wrapped in a VARIANT*, around a value or around another reference
+    VARIANT inner = String(name);
+    VARIANT wrapped = ByRef(VT_VARIANT, &inner);
+    DISPPARAMS wrappedParams = { &wrapped, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 3, &wrappedParams, &result) == S_OK);
+    CHECK(SameText(result, L"Jane"));
+    VariantClear(&result);
+
+    inner = ByRef(VT_BSTR, &name);
+    CHECK(Call<TargetDispatch>(&target, 3, &wrappedParams, &result) == S_OK);
+    CHECK(SameText(result, L"Jane"));
+    VariantClear(&result);
+
+    // An array passed by reference
+    SAFEARRAY* names = SafeArrayCreateVector(VT_BSTR, 1, 2);
+    VARIANT byRefArray = ByRef(VT_ARRAY | VT_BSTR, &names);
+    DISPPARAMS arrayParams = { &byRefArray, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 4, &arrayParams, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 2);
+
+    // The referenced values are the caller's and are left alone
+    CHECK(a == 10 && b == 3);
+    CHECK(wcscmp(name, L"Jane") == 0);
+    SafeArrayDestroy(names);
+    SysFreeString(name);
+}
+
+static void TestCoercion()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+
+    // A number where a string is expected is converted, and the copy freed after the call
+    VARIANT number = Long(42);
+    DISPPARAMS one = { &number, NULL, 1, 0 };
+    CHECK(Call<TargetDispatch>(&target, 3, &one, &result) == S_OK);
+    CHECK(SameText(result, L"42"));
+    VariantClear(&result);
+
+    BSTR text = SysAllocString(L"17");
+    BSTR notNumber = SysAllocString(L"seventeen");
+    VARIANT args[2] = { String(text), Long(20) };
+    DISPPARAMS params = { args, NULL, 2, 0 };
+    CHECK(Call<ExtraDispatch>(&target, 10, &params, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_I4 && V_I4(&result) == 3);
+
+    // A conversion that fails names the argument, by its index in rgvarg
+    LONG calls = target.calls;
+    UINT argErr = 99;
+    args[0] = String(notNumber);
+    CHECK(Call<ExtraDispatch>(&target, 10, &params, &result, &argErr) == DISP_E_TYPEMISMATCH);
+    CHECK(argErr == 0);
+
+    argErr = 99;
+    args[0] = Long(1);
+    args[1] = String(notNumber);
+    CHECK(Call<ExtraDispatch>(&target, 10, &params, &result, &argErr) == DISP_E_TYPEMISMATCH);
+    CHECK(argErr == 1);
+
+    DISPID named[2] = { 1, 0 };
+    DISPPARAMS namedParams = { args, named, 2, 2 };
+    argErr = 99;
+    CHECK(Call<ExtraDispatch>(&target, 10, &namedParams, &result, &argErr) == DISP_E_TYPEMISMATCH);
+    CHECK(argErr == 1);
+
+    // puArgErr is optional
+    CHECK(Call<ExtraDispatch>(&target, 10, &params, &result) == DISP_E_TYPEMISMATCH);
+    CHECK(target.calls == calls);
+
+    // Arrays aren't converted
+    args[0] = Long(1);
+    DISPPARAMS arrayParams = { args, NULL, 1, 0 };
+    argErr = 99;
+    CHECK(Call<TargetDispatch>(&target, 4, &arrayParams, &result, &argErr) == DISP_E_TYPEMISMATCH);
+    CHECK(argErr == 0);
+
+    SysFreeString(notNumber);
+    SysFreeString(text);
+}
+
+static void TestRejected()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+    VARIANT args[2] = { Long(1), Long(2) };
+    DISPPARAMS none = { NULL, NULL, 0, 0 };
+    DISPPARAMS two = { args, NULL, 2, 0 };
+
+    // No optional parameters: too few and too many arguments are both wrong
+    CHECK(Call<TargetDispatch>(&target, 3, &none, &result) == DISP_E_BADPARAMCOUNT);
+    CHECK(Call<TargetDispatch>(&target, 3, &two, &result) == DISP_E_BADPARAMCOUNT);
+    CHECK(Call<TargetDispatch>(&target, 1, &two, &result) == DISP_E_BADPARAMCOUNT);
+
+    // Methods only, or a property get of one without arguments
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, DISPATCH_PROPERTYGET) == S_OK);
+    VariantClear(&result);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, DISPATCH_METHOD | DISPATCH_PROPERTYGET) == S_OK);
+    VariantClear(&result);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, DISPATCH_PROPERTYPUT) == DISP_E_MEMBERNOTFOUND);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, DISPATCH_PROPERTYPUTREF) == DISP_E_MEMBERNOTFOUND);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, DISPATCH_METHOD | DISPATCH_PROPERTYPUT) == DISP_E_MEMBERNOTFOUND);
+    CHECK(Call<TargetDispatch>(&target, 2, &none, &result, NULL, 0) == DISP_E_MEMBERNOTFOUND);
+
+    CHECK(Call<TargetDispatch>(&target, 0, &none, &result) == DISP_E_MEMBERNOTFOUND);
+    CHECK(Call<TargetDispatch>(&target, 10, &two, &result) == DISP_E_MEMBERNOTFOUND);
+    CHECK(Call<TargetDispatch>(&target, 2, NULL, &result) == E_INVALIDARG);
+    CHECK(TargetDispatch::Invoke(&target, 2, IID_IUnknown, kLcid, DISPATCH_METHOD, &none, &result, NULL, NULL) == DISP_E_UNKNOWNINTERFACE);
+    CHECK(V_VT(&result) == VT_EMPTY);
+    CHECK(target.calls == 2);
+}
+
+static void TestRetval()
+{
+    Target target;
+    VARIANT result;
+    VariantInit(&result);
+    DISPPARAMS none = { NULL, NULL, 0, 0 };
+
+    // The result goes to pVarResult, whose owner frees it
+    CHECK(Call<ExtraDispatch>(&target, 11, &none, &result) == S_OK);
+    CHECK(V_VT(&result) == VT_BYREF && V_BYREF(&result) == &target.token);
+    CHECK(target.token.freed == 0);
+
+    // Without pVarResult the engine frees it, once
+    CHECK(Call<ExtraDispatch>(&target, 11, &none, NULL) == S_OK);
+    CHECK(target.token.freed == 1);
+
+    // A BSTR nobody asked for doesn't leak either, which the sanitizers check
+    CHECK(Call<TargetDispatch>(&target, 2, &none, NULL) == S_OK);
+
+    // A failed call leaves pVarResult alone
+    VariantInit(&result);
+    CHECK(Call<ExtraDispatch>(&target, 12, &none, &result) == E_FAIL);
+    CHECK(V_VT(&result) == VT_EMPTY);
+    CHECK(Call<ExtraDispatch>(&target, 12, &none, NULL) == E_FAIL);
+    CHECK(target.token.freed == 1);
+}
+
+int main()
+{
+    TestPositional();
+    TestNamed();
+    TestByRef();
+    TestCoercion();
+    TestRejected();
+    TestRetval();
+    return CHECK_RESULT();
+}
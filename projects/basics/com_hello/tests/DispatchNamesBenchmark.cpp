@@ -0,0 +1,70 @@
+#include "../gen/IHelloWorld_dispatch.h"
+#include "Benchmark.h"
+#include "Check.h"
+
+// Name lookups in the perfect-hash table, against the chain of _wcsicmp calls that
+// GetIDsOfNames used to be, for the first and the last name of the chain and for a miss.
+// The miss is what a script host pays for every property it probes that we don't have.
+static constexpr DispatchNameMap s_names(IHelloWorld_DispatchMembers);
+
+// A bigger interface, to show the chain growing with the member count and the table not
+static constexpr DispatchMember s_manyMembers[] = {
+    { L"Alpha", 10, NULL, 0 },   { L"Beta", 11, NULL, 0 },   { L"Gamma", 12, NULL, 0 },  { L"Delta", 13, NULL, 0 },
+    { L"Epsilon", 14, NULL, 0 }, { L"Zeta", 15, NULL, 0 },   { L"Eta", 16, NULL, 0 },    { L"Theta", 17, NULL, 0 },
+    { L"Iota", 18, NULL, 0 },    { L"Kappa", 19, NULL, 0 },  { L"Lambda", 20, NULL, 0 }, { L"Mu", 21, NULL, 0 },
+    { L"Nu", 22, NULL, 0 },      { L"Xi", 23, NULL, 0 },     { L"Omicron", 24, NULL, 0 }, { L"Pi", 25, NULL, 0 },
+};
+static constexpr DispatchNameMap s_many(s_manyMembers);
+
+template <size_t N>
+static DISPID Chain(const DispatchMember (&members)[N], const wchar_t* name)
+{
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (_wcsicmp(name, members[i].name) == 0)
+            return members[i].dispid;
+    }
+    return DISPID_UNKNOWN;
+}
+
+template <size_t N>
+static void Compare(const char* label, long iterations, const DispatchNameMap<N>& map, const DispatchMember (&members)[N], const wchar_t* name)
+{
+    // Names come from the caller, in a buffer of its own, and rarely in our spelling
+    wchar_t buffer[32];
+    wcsncpy(buffer, name, ARRAYSIZE(buffer) - 1);
+    buffer[ARRAYSIZE(buffer) - 1] = 0;
+    for (wchar_t* c = buffer; *c; ++c)
+    {
+        *c = DispatchNames::FoldCase(*c);
+    }
+
+    const DispatchMember* member = map.Find(buffer);
+    CHECK((member != NULL ? member->dispid : DISPID_UNKNOWN) == Chain(members, buffer));
+
+    volatile DISPID sink = 0;
+    char line[96];
+    snprintf(line, sizeof(line), "%s, _wcsicmp chain", label);
+    PrintNanoseconds(line, NanosecondsPerCall(iterations, [&]
+    {
+        sink = Chain(members, buffer);
+    }));
+    snprintf(line, sizeof(line), "%s, perfect hash", label);
+    PrintNanoseconds(line, NanosecondsPerCall(iterations, [&]
+    {
+        const DispatchMember* found = map.Find(buffer);
+        sink = (found != NULL) ? found->dispid : DISPID_UNKNOWN;
+    }));
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 1000000);
+
+    Compare("IHelloWorld, first name", iterations, s_names, IHelloWorld_DispatchMembers, L"SayHello");
+    Compare("IHelloWorld, last name", iterations, s_names, IHelloWorld_DispatchMembers, L"SayHelloToMany");
+    Compare("IHelloWorld, unknown name", iterations, s_names, IHelloWorld_DispatchMembers, L"Greeting");
+    Compare("16 members, last name", iterations, s_many, s_manyMembers, L"Pi");
+    Compare("16 members, unknown name", iterations, s_many, s_manyMembers, L"Rho");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,83 @@
+#include "../gen/IHelloWorld_dispatch.h"
+#include "Check.h"
+
+// The map HelloWorld::GetIDsOfNames uses, over the members idlgen took from the IDL
+static constexpr DispatchNameMap s_names(IHelloWorld_DispatchMembers);
+
+// Enough members that several seeds have to be tried
+static constexpr const wchar_t* s_manyParams[] = { L"first", L"Second", L"third" };
+static constexpr DispatchMember s_manyMembers[] = {
+    { L"Alpha", 10, NULL, 0 },     { L"Beta", 11, NULL, 0 },     { L"Gamma", 12, NULL, 0 },  { L"Delta", 13, NULL, 0 },
+    { L"Epsilon", 14, NULL, 0 },   { L"Zeta", 15, NULL, 0 },     { L"Eta", 16, NULL, 0 },    { L"Theta", 17, NULL, 0 },
+    { L"Iota", 18, NULL, 0 },      { L"Kappa", 19, NULL, 0 },    { L"Lambda", 20, NULL, 0 }, { L"Mu", 21, s_manyParams, 3 },
+};
+static constexpr DispatchNameMap s_many(s_manyMembers);
+
+static void TestFind()
+{
+    for (const DispatchMember& member : IHelloWorld_DispatchMembers)
+    {
+        CHECK(s_names.Find(member.name) == &member);
+        CHECK(s_names.FindById(member.dispid) == &member);
+    }
+    for (const DispatchMember& member : s_manyMembers)
+    {
+        CHECK(s_many.Find(member.name) == &member);
+        CHECK(s_many.FindById(member.dispid) == &member);
+    }
+
+    // Names are case-insensitive, but only in ASCII
+    CHECK(s_names.Find(L"sayhelloto") != NULL && s_names.Find(L"sayhelloto")->dispid == 3);
+    CHECK(s_names.Find(L"SAYHELLOTOMANY") != NULL && s_names.Find(L"SAYHELLOTOMANY")->dispid == 4);
+    CHECK(s_names.Find(L"SayHell\u00D6") == NULL);
+
+    // Names that aren't ours, including prefixes and extensions of ours
+    CHECK(s_names.Find(L"") == NULL);
+    CHECK(s_names.Find(L"SayHel") == NULL);
+    CHECK(s_names.Find(L"SayHelloToo") == NULL);
+    CHECK(s_names.Find(L"Goodbye") == NULL);
+    CHECK(s_names.FindById(0) == NULL);
+    CHECK(s_names.FindById(DISPID_UNKNOWN) == NULL);
+}
+
+static void TestGetIDsOfNames()
+{
+    DISPID ids[4];
+
+    LPOLESTR method[] = { const_cast<LPOLESTR>(L"SayHelloStr") };
+    CHECK(s_names.GetIDsOfNames(method, 1, ids) == S_OK);
+    CHECK(ids[0] == 2);
+
+    // A parameter name maps to its position in the IDL
+    LPOLESTR named[] = { const_cast<LPOLESTR>(L"SayHelloTo"), const_cast<LPOLESTR>(L"NAME") };
+    CHECK(s_names.GetIDsOfNames(named, 2, ids) == S_OK);
+    CHECK(ids[0] == 3 && ids[1] == 0);
+
+    LPOLESTR params[] = { const_cast<LPOLESTR>(L"mu"), const_cast<LPOLESTR>(L"third"), const_cast<LPOLESTR>(L"second"),
+                          const_cast<LPOLESTR>(L"First") };
+    CHECK(s_many.GetIDsOfNames(params, 4, ids) == S_OK);
+    CHECK(ids[0] == 21 && ids[1] == 2 && ids[2] == 1 && ids[3] == 0);
+
+    // An unknown parameter fails, but the others are still resolved
+    LPOLESTR badParam[] = { const_cast<LPOLESTR>(L"SayHelloTo"), const_cast<LPOLESTR>(L"nom"), const_cast<LPOLESTR>(L"name") };
+    CHECK(s_names.GetIDsOfNames(badParam, 3, ids) == DISP_E_UNKNOWNNAME);
+    CHECK(ids[0] == 3 && ids[1] == DISPID_UNKNOWN && ids[2] == 0);
+
+    // An unknown member leaves every name unresolved
+    LPOLESTR badMember[] = { const_cast<LPOLESTR>(L"SayGoodbye"), const_cast<LPOLESTR>(L"name") };
+    CHECK(s_names.GetIDsOfNames(badMember, 2, ids) == DISP_E_UNKNOWNNAME);
+    CHECK(ids[0] == DISPID_UNKNOWN && ids[1] == DISPID_UNKNOWN);
+
+    LPOLESTR nullName[] = { NULL };
+    CHECK(s_names.GetIDsOfNames(nullName, 1, ids) == DISP_E_UNKNOWNNAME);
+    CHECK(s_names.GetIDsOfNames(method, 0, ids) == E_INVALIDARG);
+    CHECK(s_names.GetIDsOfNames(NULL, 1, ids) == E_POINTER);
+    CHECK(s_names.GetIDsOfNames(method, 1, NULL) == E_POINTER);
+}
+
+int main()
+{
+    TestFind();
+    TestGetIDsOfNames();
+    return CHECK_RESULT();
+}
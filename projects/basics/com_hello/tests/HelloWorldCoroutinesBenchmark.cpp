@@ -0,0 +1,152 @@
+#include "../../com_hello_client/HelloWorldCoroutines.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <olectl.h>
+#include <new>
+
+// HelloWorldClient_coroutine off Windows: the main thread starts coroutines that greet a
+// few times each and end on the executor, round after round. Prints the time per greeting,
+// and how often the heap was asked for memory per coroutine once things are warm. Frames
+// are allocated on the main thread and freed on the executor threads, so this only stays
+// near zero if HelloWorldFramePool hands them back to the main thread.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+
+typedef HelloWorldAsyncClient<HelloWorldExecutor> AsyncHelloWorld;
+
+static const int kCoroutines = 64;
+static const int kGreetings = 4;
+static const UINT32 kExecutorThreads = 2;
+
+static std::atomic<long> s_heapAllocations(0);
+
+void* operator new(size_t size)
+{
+    ++s_heapAllocations;
+    void* p = malloc(size ? size : 1);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    ++s_heapAllocations;
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static std::atomic<long> s_running(0);
+static std::atomic<long> s_failed(0);
+static HANDLE s_done = NULL;
+
+static HelloWorldTask GreetFew(AsyncHelloWorld& helloWorld, BSTR name)
+{
+    for (int i = 0; i < kGreetings; ++i)
+    {
+        BSTR greeting = NULL;
+        HRESULT hr = co_await helloWorld.SayHelloTo(name, &greeting);
+        SysFreeString(greeting);
+        if (FAILED(hr))
+        {
+            co_return hr;
+        }
+    }
+    co_return S_OK;
+}
+
+static HelloWorldTask Run(AsyncHelloWorld& helloWorld, BSTR name)
+{
+    HRESULT hr = co_await GreetFew(helloWorld, name);
+    if (FAILED(hr))
+    {
+        s_failed.fetch_add(1);
+    }
+    if (s_running.fetch_sub(1) == 1)
+    {
+        SetEvent(s_done);
+    }
+    co_return hr;
+}
+
+// Starts kCoroutines coroutines on this thread and waits until they all ended
+static void Round(AsyncHelloWorld& helloWorld, BSTR name)
+{
+    ResetEvent(s_done);
+    s_running = kCoroutines;
+    for (int i = 0; i < kCoroutines; ++i)
+    {
+        if (FAILED(Run(helloWorld, name).Start()))
+        {
+            s_failed.fetch_add(1);
+            if (s_running.fetch_sub(1) == 1)
+            {
+                SetEvent(s_done);
+            }
+        }
+    }
+    WaitForSingleObject(s_done, INFINITE);
+}
+
+int main(int argc, char** argv)
+{
+    long rounds = BenchmarkIterations(argc, argv, 200);
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pFactory != NULL)
+    {
+        CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        pFactory->Release();
+    }
+    if (pHelloWorld == NULL)
+    {
+        return CHECK_RESULT();
+    }
+
+    HelloWorldExecutor executor;
+    CHECK(executor.Start(kExecutorThreads) == S_OK);
+    s_done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    BSTR name = SysAllocString(L"John Doe");
+    {
+        AsyncHelloWorld helloWorld(pHelloWorld, executor);
+        CHECK(helloWorld.Initialize() == S_OK);
+
+        double ns = NanosecondsPerCall(rounds, [&] { Round(helloWorld, name); });
+        PrintNanoseconds("greeting from a coroutine", ns / (kCoroutines * kGreetings));
+
+        // Warm by now: every frame and call object has been made once
+        long before = s_heapAllocations.load();
+        for (long i = 0; i < rounds; ++i)
+        {
+            Round(helloWorld, name);
+        }
+        double perCoroutine = static_cast<double>(s_heapAllocations.load() - before) / (rounds * kCoroutines);
+        printf("%-48s %10.3f\n", "heap allocations per coroutine", perCoroutine);
+
+        // Every greeting takes two BSTRs from the heap off Windows, the copy of the name that
+        // Begin_ keeps and the greeting. The two frames of every coroutine must not come on
+        // top of that, as they would if they weren't recycled.
+        CHECK(perCoroutine < 2 * kGreetings + 1);
+        CHECK(s_failed.load() == 0);
+        executor.Stop();
+    }
+
+    CloseHandle(s_done);
+    SysFreeString(name);
+    pHelloWorld->Release();
+    CoUninitialize();
+    return CHECK_RESULT();
+}
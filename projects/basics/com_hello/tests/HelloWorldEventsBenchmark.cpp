@@ -0,0 +1,168 @@
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <olectl.h>
+#include <thread>
+#include <vector>
+
+// What a greeting costs with 1, 10 and 1000 sinks advised, each called on the greeting
+// thread. Agile sinks are called as they are, the others through the pointer GlobalSink
+// keeps for the MTA. Greets from an MTA thread, and from a thread in no apartment like the
+// greeter pool's. Checks that every sink heard every greeting, and was let go after
+// Unadvise.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+
+class CountingSink : public IHelloWorldEvents
+{
+    LONG m_cRef;
+    bool m_agile;
+
+public:
+    LONG m_greetings;
+
+    explicit CountingSink(bool agile) : m_cRef(1), m_agile(agile), m_greetings(0) {}
+
+    LONG References() const { return m_cRef; }
+
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv)
+    {
+        if (riid == IID_IUnknown || riid == IID_IDispatch || riid == IID_IHelloWorldEvents || (m_agile && riid == IID_IAgileObject))
+        {
+            *ppv = static_cast<IHelloWorldEvents*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+    ULONG __stdcall Release()
+    {
+        LONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    HRESULT __stdcall GetTypeInfoCount(UINT* pctinfo)
+    {
+        *pctinfo = 0;
+        return S_OK;
+    }
+    HRESULT __stdcall GetTypeInfo(UINT, LCID, ITypeInfo** ppTInfo)
+    {
+        *ppTInfo = NULL;
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall GetIDsOfNames(const IID&, LPOLESTR*, UINT, LCID, DISPID*) { return E_NOTIMPL; }
+    HRESULT __stdcall Invoke(DISPID, const IID&, LCID, WORD, DISPPARAMS*, VARIANT*, EXCEPINFO*, UINT*) { return E_NOTIMPL; }
+
+    HRESULT __stdcall OnGreeted(BSTR)
+    {
+        InterlockedIncrement(&m_greetings);
+        return S_OK;
+    }
+};
+
+static IHelloWorld* CreateHelloWorld()
+{
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pFactory != NULL)
+    {
+        CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        pFactory->Release();
+    }
+    return pHelloWorld;
+}
+
+// Greets 'iterations' times on this thread, returns the nanoseconds per greeting
+static double Greet(IHelloWorld* pHelloWorld, BSTR name, long iterations)
+{
+    return NanosecondsPerCall(iterations, [pHelloWorld, name]
+    {
+        BSTR greeting = NULL;
+        pHelloWorld->SayHelloTo(name, &greeting);
+        SysFreeString(greeting);
+    });
+}
+
+static void Benchmark(IHelloWorld* pHelloWorld, IConnectionPoint* pPoint, BSTR name, int sinkCount, bool agile, long iterations)
+{
+    std::vector<CountingSink*> sinks;
+    std::vector<DWORD> cookies;
+    for (int i = 0; i < sinkCount; ++i)
+    {
+        CountingSink* pSink = new CountingSink(agile);
+        DWORD cookie = 0;
+        CHECK(pPoint->Advise(pSink, &cookie) == S_OK);
+        sinks.push_back(pSink);
+        cookies.push_back(cookie);
+    }
+
+    // Fewer greetings the more sinks there are, every round makes about as many calls
+    iterations = iterations / sinkCount + 1;
+    double mta = Greet(pHelloWorld, name, iterations);
+    double noApartment = 0;
+    std::thread([&] { noApartment = Greet(pHelloWorld, name, iterations); }).join();
+
+    char label[64];
+    snprintf(label, sizeof(label), "%d %s sinks, MTA thread", sinkCount, agile ? "agile" : "apartment");
+    PrintNanoseconds(label, mta);
+    snprintf(label, sizeof(label), "%d %s sinks, no apartment", sinkCount, agile ? "agile" : "apartment");
+    PrintNanoseconds(label, noApartment);
+
+    // Twice the warm-up and the measured greetings, once per thread
+    LONG expected = static_cast<LONG>(2 * (iterations + iterations / 10 + 1));
+    for (int i = 0; i < sinkCount; ++i)
+    {
+        CHECK(sinks[i]->m_greetings == expected);
+        CHECK(pPoint->Unadvise(cookies[i]) == S_OK);
+    }
+    for (CountingSink* pSink : sinks)
+    {
+        CHECK(pSink->References() == 1);
+        pSink->Release();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 20000);
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    IHelloWorld* pHelloWorld = CreateHelloWorld();
+    if (pHelloWorld == NULL)
+    {
+        return CHECK_RESULT();
+    }
+    IConnectionPointContainer* pContainer = NULL;
+    IConnectionPoint* pPoint = NULL;
+    CHECK(pHelloWorld->QueryInterface(IID_IConnectionPointContainer, reinterpret_cast<void**>(&pContainer)) == S_OK);
+    if (pContainer != NULL)
+    {
+        CHECK(pContainer->FindConnectionPoint(IID_IHelloWorldEvents, &pPoint) == S_OK);
+        pContainer->Release();
+    }
+
+    if (pPoint != NULL)
+    {
+        BSTR name = SysAllocString(L"John Doe");
+        PrintNanoseconds("no sinks, MTA thread", Greet(pHelloWorld, name, iterations));
+        const int sinkCounts[] = { 1, 10, 1000 };
+        for (int sinkCount : sinkCounts)
+        {
+            Benchmark(pHelloWorld, pPoint, name, sinkCount, true, iterations);
+            Benchmark(pHelloWorld, pPoint, name, sinkCount, false, iterations);
+        }
+        SysFreeString(name);
+        pPoint->Release();
+    }
+
+    CHECK(pHelloWorld->Release() == 0);
+    CoUninitialize();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,335 @@
+#include "./midl/IHelloWorld.h"
+#include "Check.h"
+#include <olectl.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The asynchronous SayHelloTo of HelloWorldGreeter on a pool of two threads that lets eight
+// calls wait. Several threads keep several calls each in flight at once, and every call
+// must finish with its own greeting. Then a sink that blocks holds both pool threads, to
+// check what Begin_, Cancel and TestCancel say about calls that are queued, cancelled or
+// done, and that the pool goes away with DLL_PROCESS_DETACH.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+extern "C" BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved);
+
+static const int kPoolThreads = 2;
+static const int kQueuedCalls = 8;
+
+static IHelloWorld* CreateHelloWorld()
+{
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pFactory != NULL)
+    {
+        CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        pFactory->Release();
+    }
+    return pHelloWorld;
+}
+
+static AsyncIHelloWorldGreeter* CreateCall(ICallFactory* pFactory)
+{
+    AsyncIHelloWorldGreeter* pCall = NULL;
+    CHECK(pFactory->CreateCall(IID_AsyncIHelloWorldGreeter, NULL, IID_AsyncIHelloWorldGreeter, reinterpret_cast<IUnknown**>(&pCall)) == S_OK);
+    return pCall;
+}
+
+static int ThreadCount()
+{
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    char line[256];
+    int threads = -1;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "Threads:", 8) == 0)
+        {
+            threads = atoi(line + 8);
+        }
+    }
+    fclose(file);
+    return threads;
+}
+
+// Holds every greeting until Open, and counts the pool threads it holds
+class BlockingSink : public IHelloWorldEvents
+{
+    LONG m_cRef;
+    HANDLE m_open;
+
+public:
+    std::atomic<int> m_waiting{0};
+
+    BlockingSink() : m_cRef(1), m_open(CreateEventW(NULL, TRUE, FALSE, NULL)) {}
+    ~BlockingSink() { CloseHandle(m_open); }
+
+    void Open() { SetEvent(m_open); }
+
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv)
+    {
+        if (riid == IID_IUnknown || riid == IID_IDispatch || riid == IID_IHelloWorldEvents)
+        {
+            *ppv = static_cast<IHelloWorldEvents*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+    ULONG __stdcall Release()
+    {
+        LONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    HRESULT __stdcall GetTypeInfoCount(UINT* pctinfo)
+    {
+        *pctinfo = 0;
+        return S_OK;
+    }
+    HRESULT __stdcall GetTypeInfo(UINT, LCID, ITypeInfo** ppTInfo)
+    {
+        *ppTInfo = NULL;
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall GetIDsOfNames(const IID&, LPOLESTR*, UINT, LCID, DISPID*) { return E_NOTIMPL; }
+    HRESULT __stdcall Invoke(DISPID, const IID&, LCID, WORD, DISPPARAMS*, VARIANT*, EXCEPINFO*, UINT*) { return E_NOTIMPL; }
+
+    HRESULT __stdcall OnGreeted(BSTR)
+    {
+        ++m_waiting;
+        WaitForSingleObject(m_open, INFINITE);
+        --m_waiting;
+        return S_OK;
+    }
+};
+
+// 'threadCount' threads, each with 'callCount' calls in flight, for 'rounds' rounds
+static void TestOverlappingCalls(ICallFactory* pFactory, IHelloWorldGreeter* pGreeter, int threadCount, int callCount, int rounds)
+{
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([t, callCount, rounds, pFactory, pGreeter, &failures]
+        {
+            CoInitializeEx(NULL, COINIT_MULTITHREADED);
+            std::vector<AsyncIHelloWorldGreeter*> calls(callCount);
+            std::vector<BSTR> names(callCount);
+            std::vector<BSTR> expected(callCount);
+            for (int c = 0; c < callCount; ++c)
+            {
+                calls[c] = CreateCall(pFactory);
+                std::wstring name = L"Caller " + std::to_wstring(t) + L"." + std::to_wstring(c);
+                names[c] = SysAllocString(name.c_str());
+                expected[c] = NULL;
+                pGreeter->SayHelloTo(names[c], &expected[c]);
+            }
+            for (int round = 0; round < rounds; ++round)
+            {
+                // Queue more calls than there are pool threads before collecting any of them
+                for (int c = 0; c < callCount; ++c)
+                {
+                    if (calls[c] == NULL || calls[c]->Begin_SayHelloTo(names[c]) != S_OK)
+                    {
+                        ++failures;
+                    }
+                }
+                for (int c = callCount - 1; c >= 0; --c)
+                {
+                    BSTR greeting = NULL;
+                    if (calls[c] == NULL || calls[c]->Finish_SayHelloTo(&greeting) != S_OK || greeting == NULL || expected[c] == NULL
+                        || wcscmp(greeting, expected[c]) != 0)
+                    {
+                        ++failures;
+                    }
+                    SysFreeString(greeting);
+                }
+            }
+            for (int c = 0; c < callCount; ++c)
+            {
+                if (calls[c] != NULL)
+                {
+                    calls[c]->Release();
+                }
+                SysFreeString(names[c]);
+                SysFreeString(expected[c]);
+            }
+            CoUninitialize();
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(failures.load() == 0);
+}
+
+static void TestQueueAndCancel(IHelloWorld* pHelloWorld, ICallFactory* pFactory)
+{
+    IConnectionPointContainer* pContainer = NULL;
+    IConnectionPoint* pPoint = NULL;
+    CHECK(pHelloWorld->QueryInterface(IID_IConnectionPointContainer, reinterpret_cast<void**>(&pContainer)) == S_OK);
+    if (pContainer == NULL)
+    {
+        return;
+    }
+    CHECK(pContainer->FindConnectionPoint(IID_IHelloWorldEvents, &pPoint) == S_OK);
+    pContainer->Release();
+    if (pPoint == NULL)
+    {
+        return;
+    }
+    BlockingSink* pSink = new BlockingSink;
+    DWORD cookie = 0;
+    CHECK(pPoint->Advise(pSink, &cookie) == S_OK);
+
+    BSTR name = SysAllocString(L"John Doe");
+    std::vector<AsyncIHelloWorldGreeter*> calls;
+    for (int i = 0; i < kPoolThreads + kQueuedCalls + 1; ++i)
+    {
+        calls.push_back(CreateCall(pFactory));
+    }
+
+    // Both pool threads greet, and hang in the sink
+    for (int i = 0; i < kPoolThreads; ++i)
+    {
+        CHECK(calls[i]->Begin_SayHelloTo(name) == S_OK);
+    }
+    for (int spin = 0; spin < 5000 && pSink->m_waiting.load() < kPoolThreads; ++spin)
+    {
+        Sleep(1);
+    }
+    CHECK(pSink->m_waiting.load() == kPoolThreads);
+
+    // The queue takes kQueuedCalls calls, then the next one is refused
+    for (int i = kPoolThreads; i < kPoolThreads + kQueuedCalls; ++i)
+    {
+        CHECK(calls[i]->Begin_SayHelloTo(name) == S_OK);
+    }
+    AsyncIHelloWorldGreeter* pRefused = calls.back();
+    CHECK(pRefused->Begin_SayHelloTo(name) == RPC_E_SERVER_TOO_BUSY);
+
+    // A call runs once at a time
+    AsyncIHelloWorldGreeter* pQueued = calls[kPoolThreads];
+    CHECK(pQueued->Begin_SayHelloTo(name) == RPC_S_CALLPENDING);
+
+    // A queued call can be cancelled, and says so until it is finished
+    ICancelMethodCalls* pCancel = NULL;
+    CHECK(pQueued->QueryInterface(IID_ICancelMethodCalls, reinterpret_cast<void**>(&pCancel)) == S_OK);
+    if (pCancel != NULL)
+    {
+        CHECK(pCancel->TestCancel() == RPC_S_CALLPENDING);
+        CHECK(pCancel->Cancel(0) == S_OK);
+        CHECK(pCancel->TestCancel() == RPC_E_CALL_CANCELED);
+    }
+
+    pSink->Open();
+    for (int i = 0; i < kPoolThreads + kQueuedCalls; ++i)
+    {
+        BSTR greeting = NULL;
+        HRESULT hr = calls[i]->Finish_SayHelloTo(&greeting);
+        if (calls[i] == pQueued)
+        {
+            CHECK(hr == RPC_E_CALL_CANCELED && greeting == NULL);
+        }
+        else
+        {
+            CHECK(hr == S_OK && greeting != NULL);
+        }
+        SysFreeString(greeting);
+    }
+
+    // Finished calls are over: nothing to cancel and nothing to finish
+    if (pCancel != NULL)
+    {
+        CHECK(pCancel->Cancel(0) == RPC_E_CALL_COMPLETE);
+        CHECK(pCancel->TestCancel() == RPC_E_CALL_COMPLETE);
+        pCancel->Release();
+    }
+    BSTR greeting = NULL;
+    CHECK(pQueued->Finish_SayHelloTo(&greeting) == E_UNEXPECTED && greeting == NULL);
+    CHECK(pRefused->Finish_SayHelloTo(&greeting) == E_UNEXPECTED && greeting == NULL);
+
+    // The refused call is as good as new
+    CHECK(pRefused->Begin_SayHelloTo(name) == S_OK);
+    CHECK(pRefused->Finish_SayHelloTo(&greeting) == S_OK && greeting != NULL);
+    SysFreeString(greeting);
+
+    for (AsyncIHelloWorldGreeter* pCall : calls)
+    {
+        pCall->Release();
+    }
+    SysFreeString(name);
+    CHECK(pPoint->Unadvise(cookie) == S_OK);
+    pPoint->Release();
+    pSink->Release();
+}
+
+// FreeLibrary closes the pool, and its threads go
+static void TestClosePool()
+{
+    int before = ThreadCount();
+    CHECK(before > kPoolThreads);
+    DllMain(NULL, DLL_PROCESS_DETACH, NULL);
+    int after = before;
+    for (int spin = 0; spin < 5000 && after > before - kPoolThreads; ++spin)
+    {
+        Sleep(1);
+        after = ThreadCount();
+    }
+    CHECK(after == before - kPoolThreads);
+}
+
+int main()
+{
+    // Before the first call creates the pool
+    wchar_t value[16];
+    swprintf(value, ARRAYSIZE(value), L"%d", kPoolThreads);
+    SetEnvironmentVariableW(L"HELLOWORLD_ASYNC_THREADS", value);
+    swprintf(value, ARRAYSIZE(value), L"%d", kQueuedCalls);
+    SetEnvironmentVariableW(L"HELLOWORLD_ASYNC_QUEUE", value);
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    IHelloWorld* pHelloWorld = CreateHelloWorld();
+    if (pHelloWorld == NULL)
+    {
+        return CHECK_RESULT();
+    }
+    IHelloWorldGreeter* pGreeter = NULL;
+    ICallFactory* pFactory = NULL;
+    CHECK(pHelloWorld->QueryInterface(IID_IHelloWorldGreeter, reinterpret_cast<void**>(&pGreeter)) == S_OK);
+    CHECK(pHelloWorld->QueryInterface(IID_ICallFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pGreeter != NULL && pFactory != NULL)
+    {
+        // Never more calls than the queue takes, even with none of them started yet
+        TestOverlappingCalls(pFactory, pGreeter, 4, kQueuedCalls / 4, 200);
+        TestQueueAndCancel(pHelloWorld, pFactory);
+    }
+    if (pGreeter != NULL)
+    {
+        pGreeter->Release();
+    }
+    if (pFactory != NULL)
+    {
+        pFactory->Release();
+    }
+    pHelloWorld->Release();
+
+    TestClosePool();
+    CoUninitialize();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,143 @@
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <olectl.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// HelloWorldClient_hammer off Windows: one shared HelloWorld greets from 1 to 8 MTA threads
+// at once, each thread taking its own reference for every greeting. Prints how the
+// greetings per second scale, and checks that every greeting came back right and that only
+// main's reference is left. Before that, threads race for the marshaler and the connection
+// point of fresh objects, which the object creates the first time someone asks; they must
+// all get the one that was kept.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+extern "C" HRESULT __stdcall DllCanUnloadNow();
+
+static IHelloWorld* CreateHelloWorld()
+{
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pFactory != NULL)
+    {
+        CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        pFactory->Release();
+    }
+    return pHelloWorld;
+}
+
+// Every thread asks a fresh object for 'riid' at the same moment
+static void RaceForInterface(REFIID riid, int threadCount)
+{
+    for (int round = 0; round < 100; ++round)
+    {
+        IHelloWorld* pHelloWorld = CreateHelloWorld();
+        if (pHelloWorld == NULL)
+        {
+            return;
+        }
+        std::vector<IUnknown*> results(threadCount);
+        std::atomic<int> ready{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([t, threadCount, &ready, &results, pHelloWorld, &riid]
+            {
+                ++ready;
+                while (ready.load() < threadCount)
+                {
+                    std::this_thread::yield();
+                }
+                results[t] = NULL;
+                pHelloWorld->QueryInterface(riid, reinterpret_cast<void**>(&results[t]));
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        for (IUnknown* pResult : results)
+        {
+            CHECK(pResult != NULL && pResult == results[0]);
+            if (pResult != NULL)
+            {
+                pResult->Release();
+            }
+        }
+        CHECK(pHelloWorld->Release() == 0);
+    }
+}
+
+// Greets 'greetings' times on 'threadCount' threads and returns the greetings per second
+static double Hammer(IHelloWorld* pHelloWorld, BSTR name, BSTR expected, int threadCount, long greetings)
+{
+    std::atomic<long> failures{0};
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([pHelloWorld, name, expected, greetings, &failures]
+        {
+            CoInitializeEx(NULL, COINIT_MULTITHREADED);
+            for (long i = 0; i < greetings; ++i)
+            {
+                pHelloWorld->AddRef();
+                BSTR greeting = NULL;
+                HRESULT hr = pHelloWorld->SayHelloTo(name, &greeting);
+                if (FAILED(hr) || greeting == NULL || wcscmp(greeting, expected) != 0)
+                {
+                    ++failures;
+                }
+                SysFreeString(greeting);
+                pHelloWorld->Release();
+            }
+            CoUninitialize();
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(failures.load() == 0);
+    return greetings * threadCount / elapsed.count();
+}
+
+int main(int argc, char** argv)
+{
+    long greetings = BenchmarkIterations(argc, argv, 50000);
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    RaceForInterface(IID_IMarshal, 8);
+    RaceForInterface(IID_IConnectionPointContainer, 8);
+
+    IHelloWorld* pHelloWorld = CreateHelloWorld();
+    if (pHelloWorld == NULL)
+    {
+        return CHECK_RESULT();
+    }
+    BSTR name = SysAllocString(L"John Doe");
+    BSTR expected = NULL;
+    CHECK(pHelloWorld->SayHelloTo(name, &expected) == S_OK && expected != NULL);
+
+    printf("threads  greetings/s  speedup\n");
+    double single = 0;
+    const int threadCounts[] = { 1, 2, 4, 8 };
+    for (int threadCount : threadCounts)
+    {
+        double rate = Hammer(pHelloWorld, name, expected, threadCount, greetings);
+        single = (threadCount == 1) ? rate : single;
+        printf("%7d %12.0f %8.2f\n", threadCount, rate, rate / single);
+    }
+
+    pHelloWorld->AddRef();
+    CHECK(pHelloWorld->Release() == 1);
+    SysFreeString(expected);
+    SysFreeString(name);
+    CHECK(pHelloWorld->Release() == 0);
+    CHECK(DllCanUnloadNow() == S_OK);
+    CoUninitialize();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,132 @@
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <olectl.h>
+#include <string>
+
+// What the call statistics cost SayHelloTo through the vtable: with the statistics off
+// (HELLOWORLD_STATS_SAMPLE=0), with the default sampling of one call in 64, and with every
+// call timed. The setting is read once per process, so every measurement runs in a child
+// process of its own, this program again with "child" after the iterations. The children
+// take turns, and the fastest of their runs counts. Prints the time per call and the cost
+// over no statistics, and checks that the calls were counted when, and only when, the
+// statistics were on.
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+
+static const int kTrials = 5;
+
+// Greets in batches and prints the fastest batch, as the parent reads it
+static int Child(long iterations)
+{
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    if (pFactory != NULL)
+    {
+        CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+        pFactory->Release();
+    }
+    if (pHelloWorld == NULL)
+    {
+        return CHECK_RESULT();
+    }
+
+    BSTR name = SysAllocString(L"John Doe");
+    double fastest = 0;
+    for (int batch = 0; batch < kTrials; ++batch)
+    {
+        double ns = NanosecondsPerCall(iterations, [pHelloWorld, name]
+        {
+            BSTR greeting = NULL;
+            pHelloWorld->SayHelloTo(name, &greeting);
+            SysFreeString(greeting);
+        });
+        fastest = (batch == 0 || ns < fastest) ? ns : fastest;
+    }
+    SysFreeString(name);
+
+    IHelloWorldStats* pStats = NULL;
+    CHECK(pHelloWorld->QueryInterface(IID_IHelloWorldStats, reinterpret_cast<void**>(&pStats)) == S_OK);
+    if (pStats != NULL)
+    {
+        HelloWorldMethodStats stats = {};
+        CHECK(pStats->GetMethodStats(HelloWorldMethodSayHelloTo, HelloWorldCallVtable, &stats) == S_OK);
+        WCHAR sample[8];
+        bool off = GetEnvironmentVariableW(L"HELLOWORLD_STATS_SAMPLE", sample, ARRAYSIZE(sample)) == 1 && sample[0] == L'0';
+        long long calls = kTrials * (iterations + iterations / 10 + 1);
+        CHECK(stats.calls == (off ? 0 : calls));
+        CHECK(off ? stats.timed == 0 : stats.timed > 0);
+        pStats->Release();
+    }
+    pHelloWorld->Release();
+    CoUninitialize();
+
+    printf("%f\n", fastest);
+    return CHECK_RESULT();
+}
+
+// Runs a child with HELLOWORLD_STATS_SAMPLE set to 'sample', or unset if it is NULL, and
+// returns its time per call, or 0 if it failed
+static double RunChild(const char* self, long iterations, const wchar_t* sample)
+{
+    SetEnvironmentVariableW(L"HELLOWORLD_STATS_SAMPLE", sample);
+    std::string command = std::string("\"") + self + "\" " + std::to_string(iterations) + " child";
+    FILE* child = popen(command.c_str(), "r");
+    double ns = 0;
+    if (child == NULL || fscanf(child, "%lf", &ns) != 1)
+    {
+        ns = 0;
+    }
+    if (child != NULL && pclose(child) != 0)
+    {
+        ns = 0;
+    }
+    return ns;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 20000);
+    if (argc > 2 && strcmp(argv[2], "child") == 0)
+    {
+        return Child(iterations);
+    }
+
+    struct Setting
+    {
+        const char* label;
+        const wchar_t* sample;
+        double fastest;
+    };
+    Setting settings[] = {
+        { "statistics off", L"0", 0 },
+        { "one call in 64 timed", NULL, 0 },
+        { "every call timed", L"1", 0 },
+    };
+    for (int trial = 0; trial < kTrials; ++trial)
+    {
+        for (Setting& setting : settings)
+        {
+            double ns = RunChild(argv[0], iterations, setting.sample);
+            CHECK(ns > 0);
+            setting.fastest = (trial == 0 || ns < setting.fastest) ? ns : setting.fastest;
+        }
+    }
+
+    for (const Setting& setting : settings)
+    {
+        PrintNanoseconds(setting.label, setting.fastest);
+    }
+    for (size_t i = 1; i < ARRAYSIZE(settings); ++i)
+    {
+        double cost = (settings[0].fastest > 0) ? 100.0 * (settings[i].fastest / settings[0].fastest - 1) : 0;
+        printf("%-48s %10.1f %%\n", (std::string("cost, ") + settings[i].label).c_str(), cost);
+    }
+    return CHECK_RESULT();
+}
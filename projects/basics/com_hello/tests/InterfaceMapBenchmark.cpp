@@ -0,0 +1,105 @@
+#include "./midl/IHelloWorld.h"
+#include "../InterfaceMap.h"
+#include "Benchmark.h"
+#include "Check.h"
+
+// QueryInterface hits and misses: the InterfaceMap against the chain of IsEqualGUID compares
+// it replaced, on HelloWorld's three entries, and HelloWorld's own QueryInterface, whose
+// misses also go through the class manifest check.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+
+class Mapped : public IHelloWorld
+{
+    typedef InterfaceMap<Mapped,
+        InterfaceEntry<IHelloWorld, &IID_IUnknown>,
+        InterfaceEntry<IHelloWorld, &IID_IHelloWorld>,
+        InterfaceEntry<IHelloWorld, &IID_IDispatch>> Interfaces;
+
+public:
+    LONG refs = 1;
+
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) { return Interfaces::QueryInterface(this, riid, ppv); }
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&refs); }
+    ULONG __stdcall Release() { return InterlockedDecrement(&refs); }
+    HRESULT __stdcall GetTypeInfoCount(UINT*) { return E_NOTIMPL; }
+    HRESULT __stdcall GetTypeInfo(UINT, LCID, ITypeInfo**) { return E_NOTIMPL; }
+    HRESULT __stdcall GetIDsOfNames(REFIID, LPOLESTR*, UINT, LCID, DISPID*) { return E_NOTIMPL; }
+    HRESULT __stdcall Invoke(DISPID, REFIID, LCID, WORD, DISPPARAMS*, VARIANT*, EXCEPINFO*, UINT*) { return E_NOTIMPL; }
+    HRESULT __stdcall SayHello() { return S_OK; }
+    HRESULT __stdcall SayHelloStr(BSTR*) { return E_NOTIMPL; }
+    HRESULT __stdcall SayHelloTo(BSTR, BSTR*) { return E_NOTIMPL; }
+    HRESULT __stdcall SayHelloToMany(SAFEARRAY*, SAFEARRAY**) { return E_NOTIMPL; }
+};
+
+// What HelloWorld::QueryInterface was before the map
+class Chained : public Mapped
+{
+public:
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (ppv == NULL)
+        {
+            return E_POINTER;
+        }
+        if (riid == IID_IUnknown || riid == IID_IHelloWorld || riid == IID_IDispatch)
+        {
+            *ppv = static_cast<IHelloWorld*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+};
+
+template <class Object>
+static double QueryAndRelease(Object* object, long iterations, REFIID riid)
+{
+    IHelloWorld* pObject = object;
+    return NanosecondsPerCall(iterations, [pObject, &riid]
+    {
+        IUnknown* pUnk = NULL;
+        if (SUCCEEDED(pObject->QueryInterface(riid, reinterpret_cast<void**>(&pUnk))))
+        {
+            pUnk->Release();
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 2000000);
+
+    Mapped mapped;
+    Chained chained;
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+    pFactory->Release();
+
+    struct
+    {
+        const char* name;
+        const IID* iid;
+    } cases[] = {
+        { "first entry", &IID_IUnknown },
+        { "last entry", &IID_IDispatch },
+        { "miss", &IID_IClassFactory },
+    };
+    for (const auto& c : cases)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "IsEqualGUID chain, %s", c.name);
+        PrintNanoseconds(line, QueryAndRelease(&chained, iterations, *c.iid));
+        snprintf(line, sizeof(line), "InterfaceMap, %s", c.name);
+        PrintNanoseconds(line, QueryAndRelease(&mapped, iterations, *c.iid));
+        snprintf(line, sizeof(line), "HelloWorld, %s", c.name);
+        PrintNanoseconds(line, QueryAndRelease(pHelloWorld, iterations, *c.iid));
+    }
+    PrintNanoseconds("HelloWorld, IMarshal", QueryAndRelease(pHelloWorld, iterations, IID_IMarshal));
+
+    CHECK(mapped.refs == 1 && chained.refs == 1);
+    CHECK(pHelloWorld->Release() == 0);
+    return CHECK_RESULT();
+}
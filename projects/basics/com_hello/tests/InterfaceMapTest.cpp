@@ -0,0 +1,70 @@
+#include "../InterfaceMap.h"
+#include "Check.h"
+
+// A class with two interfaces and an identity: every IID of the map hands out the right base
+// with one AddRef, IUnknown always the same pointer; anything else, including IIDs one byte
+// off from an entry, is E_NOINTERFACE with *ppv cleared and no reference taken.
+static const IID IID_IFirst = { 0x11111111, 0x2222, 0x3333, { 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB } };
+static const IID IID_ISecond = { 0xCCCCCCCC, 0xDDDD, 0xEEEE, { 0xFF, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+
+struct IFirst : public IUnknown
+{
+    virtual int __stdcall First() = 0;
+};
+
+struct ISecond : public IUnknown
+{
+    virtual int __stdcall Second() = 0;
+};
+
+class Both : public IFirst, public ISecond
+{
+    typedef InterfaceMap<Both,
+        InterfaceEntry<IFirst, &IID_IUnknown>,
+        InterfaceEntry<IFirst, &IID_IFirst>,
+        InterfaceEntry<ISecond, &IID_ISecond>> Interfaces;
+
+public:
+    ULONG refs = 1;
+
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) { return Interfaces::QueryInterface(this, riid, ppv); }
+    ULONG __stdcall AddRef() { return ++refs; }
+    ULONG __stdcall Release() { return --refs; }
+    int __stdcall First() { return 1; }
+    int __stdcall Second() { return 2; }
+};
+
+int main()
+{
+    Both both;
+    void* pv = NULL;
+
+    CHECK(both.QueryInterface(IID_IUnknown, &pv) == S_OK && pv == static_cast<IFirst*>(&both));
+    CHECK(both.refs == 2);
+    CHECK(both.QueryInterface(IID_IFirst, &pv) == S_OK && pv == static_cast<IFirst*>(&both));
+    CHECK(static_cast<IFirst*>(pv)->First() == 1);
+    CHECK(both.QueryInterface(IID_ISecond, &pv) == S_OK && pv == static_cast<ISecond*>(&both));
+    CHECK(pv != static_cast<void*>(static_cast<IFirst*>(&both)));
+    CHECK(static_cast<ISecond*>(pv)->Second() == 2);
+    CHECK(both.refs == 4);
+
+    // The identity is the same whichever interface is asked
+    IUnknown* pUnk = NULL;
+    CHECK(static_cast<ISecond*>(&both)->QueryInterface(IID_IUnknown, reinterpret_cast<void**>(&pUnk)) == S_OK);
+    CHECK(pUnk == static_cast<IFirst*>(&both));
+    CHECK(both.refs == 5);
+
+    // Every byte of the IID counts
+    for (size_t i = 0; i < sizeof(IID); ++i)
+    {
+        IID iid = IID_ISecond;
+        reinterpret_cast<BYTE*>(&iid)[i] ^= 0x01;
+        pv = &both;
+        CHECK(both.QueryInterface(iid, &pv) == E_NOINTERFACE && pv == NULL);
+    }
+    pv = &both;
+    CHECK(both.QueryInterface(IID_IClassFactory, &pv) == E_NOINTERFACE && pv == NULL);
+    CHECK(both.QueryInterface(IID_IFirst, NULL) == E_POINTER);
+    CHECK(both.refs == 5);
+    return CHECK_RESULT();
+}
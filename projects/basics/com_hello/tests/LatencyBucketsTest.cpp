@@ -0,0 +1,79 @@
+#include "../LatencyBuckets.h"
+#include "Check.h"
+
+// The shape ActivationProbe.h and HelloWorldStats.h use
+typedef LatencyBuckets<4> Buckets;
+
+static void TestSmallValues()
+{
+    // Below 2^SubBucketBits every value has a bucket of its own
+    for (UINT64 value = 0; value < Buckets::kSubBuckets; ++value)
+    {
+        CHECK(Buckets::Index(value) == value);
+        CHECK(Buckets::UpperBound(static_cast<UINT32>(value)) == value);
+    }
+    CHECK(Buckets::Index(Buckets::kSubBuckets) == Buckets::kSubBuckets);
+}
+
+static void TestBounds()
+{
+    // Every bucket holds the values from one past the bound of the one before up to its own
+    // bound, and is at most 1/2^SubBucketBits as wide as the values in it
+    const UINT32 count = Buckets::Count(64);
+    UINT64 previous = 0;
+    for (UINT32 index = 1; index < count; ++index)
+    {
+        UINT64 bound = Buckets::UpperBound(index);
+        UINT64 first = previous + 1;
+        CHECK(bound >= first);
+        CHECK(Buckets::Index(first) == index);
+        CHECK(Buckets::Index(bound) == index);
+        CHECK((bound - first) * Buckets::kSubBuckets <= first);
+        previous = bound;
+    }
+    CHECK(previous == ~0ull);
+}
+
+static void TestCount()
+{
+    // Count(bits) buckets hold every value below 2^bits, and no more than that
+    for (UINT32 bits = 4; bits < 64; ++bits)
+    {
+        UINT64 largest = (1ull << bits) - 1;
+        CHECK(Buckets::Index(largest) == Buckets::Count(bits) - 1);
+        CHECK(Buckets::Index(largest + 1) == Buckets::Count(bits));
+    }
+    CHECK(Buckets::Index(~0ull) == Buckets::Count(64) - 1);
+
+    // Values whose highest bit is in the upper half of 64 bits
+    CHECK(Buckets::Index(1ull << 32) == Buckets::Count(32));
+    CHECK(Buckets::Index((1ull << 32) - 1) == Buckets::Count(32) - 1);
+    CHECK(Buckets::Index(0x8000000000000000ull) == Buckets::Count(63));
+}
+
+static void TestOtherShapes()
+{
+    typedef LatencyBuckets<0> Powers;
+    CHECK(Powers::Index(0) == 0);
+    CHECK(Powers::Index(1) == 1);
+    CHECK(Powers::Index(2) == 2 && Powers::Index(3) == 2);
+    CHECK(Powers::Index(4) == 3 && Powers::Index(7) == 3);
+    CHECK(Powers::UpperBound(3) == 7);
+
+    typedef LatencyBuckets<7> Fine;
+    for (UINT64 value = 1; value < 1000000; value = value * 3 + 1)
+    {
+        UINT32 index = Fine::Index(value);
+        CHECK(Fine::UpperBound(index) >= value);
+        CHECK(index == 0 || Fine::UpperBound(index - 1) < value);
+    }
+}
+
+int main()
+{
+    TestSmallValues();
+    TestBounds();
+    TestCount();
+    TestOtherShapes();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,177 @@
+#include "../ModuleAccounting.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+// Live counts, high-water marks and bytes per kind, from one thread and across threads,
+// and the allocation sites with HELLOWORLD_ALLOC_SITES=1, so every creation is recorded.
+// The objects are only ever keys here, so made-up addresses do.
+static const void* Address(UINT_PTR n)
+{
+    return reinterpret_cast<const void*>(0x100000 + n * 16);
+}
+
+static ModuleMemoryStats Stats()
+{
+    ModuleMemoryStats stats = {};
+    GetModuleMemoryStats(&stats);
+    return stats;
+}
+
+// The slot ModuleAccounting.cpp hashes an object to, to make objects collide
+static UINT32 SlotOf(const void* object)
+{
+    UINT64 address = reinterpret_cast<UINT_PTR>(object) >> 4;
+    return static_cast<UINT32>((address * 0x9E3779B97F4A7C15ull) >> 54) % 1024;
+}
+
+static bool HasSite(const void* object, ModuleObjectKind kind)
+{
+    ModuleAllocationSite sites[64];
+    UINT32 count = 0;
+    GetModuleAllocationSites(sites, ARRAYSIZE(sites), &count);
+    for (UINT32 i = 0; i < count && i < ARRAYSIZE(sites); ++i)
+    {
+        if (sites[i].object == object)
+        {
+            return sites[i].kind == kind && sites[i].frameCount > 0;
+        }
+    }
+    return false;
+}
+
+static void TestCounts()
+{
+    for (UINT_PTR i = 0; i < 3; ++i)
+    {
+        ModuleObjectCreated(ModuleObjectGreeter, Address(i), 100);
+    }
+    ModuleObjectDestroyed(ModuleObjectGreeter, Address(1), 100);
+
+    ModuleMemoryStats stats = Stats();
+    const ModuleObjectCounts& greeters = stats.objects[ModuleObjectGreeter];
+    CHECK(greeters.live == 2 && greeters.highWater == 3 && greeters.created == 3 && greeters.bytes == 200);
+    const ModuleObjectCounts& others = stats.objects[ModuleObjectHelloWorld];
+    CHECK(others.live == 0 && others.highWater == 0 && others.created == 0 && others.bytes == 0);
+
+    // Every creation was recorded, and the destroyed object was forgotten
+    CHECK(stats.sites == 2 && stats.sitesDropped == 0);
+    CHECK(HasSite(Address(0), ModuleObjectGreeter) && !HasSite(Address(1), ModuleObjectGreeter));
+
+    // The high-water mark stays where it was
+    ModuleObjectDestroyed(ModuleObjectGreeter, Address(0), 100);
+    ModuleObjectDestroyed(ModuleObjectGreeter, Address(2), 100);
+    stats = Stats();
+    CHECK(stats.objects[ModuleObjectGreeter].live == 0 && stats.objects[ModuleObjectGreeter].highWater == 3);
+    CHECK(stats.objects[ModuleObjectGreeter].bytes == 0 && stats.sites == 0);
+}
+
+// Objects are created on some threads and destroyed on others. The counters of all the
+// threads add up, whichever thread has exited.
+static void TestThreads()
+{
+    const int kThreads = 4;
+    const UINT_PTR kPerThread = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([t, kPerThread]
+        {
+            for (UINT_PTR i = 0; i < kPerThread; ++i)
+            {
+                ModuleObjectCreated(ModuleObjectGreeterCall, Address(1000 + t * kPerThread + i), 64);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ModuleMemoryStats stats = Stats();
+    const ModuleObjectCounts& calls = stats.objects[ModuleObjectGreeterCall];
+    CHECK(calls.live == kThreads * kPerThread && calls.highWater == kThreads * kPerThread);
+    CHECK(calls.created == kThreads * kPerThread && calls.bytes == kThreads * kPerThread * 64);
+    CHECK(stats.sites + stats.sitesDropped == kThreads * kPerThread);
+
+    // More sites than fit are reported as S_FALSE, with how many there are
+    ModuleAllocationSite sites[8];
+    UINT32 count = 0;
+    CHECK(GetModuleAllocationSites(sites, ARRAYSIZE(sites), &count) == S_FALSE && count == stats.sites);
+
+    threads.clear();
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([t, kPerThread]
+        {
+            for (UINT_PTR i = 0; i < kPerThread; ++i)
+            {
+                ModuleObjectDestroyed(ModuleObjectGreeterCall, Address(1000 + t * kPerThread + i), 64);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    stats = Stats();
+    CHECK(stats.objects[ModuleObjectGreeterCall].live == 0 && stats.objects[ModuleObjectGreeterCall].bytes == 0);
+    CHECK(stats.sites == 0);
+    CHECK(GetModuleAllocationSites(sites, ARRAYSIZE(sites), &count) == S_OK && count == 0);
+}
+
+// Nine objects that hash to the same slot: eight take the slots from there on, the ninth
+// finds them all taken and is dropped. Destroying it changes nothing in the table.
+static void TestDroppedSite()
+{
+    LONG64 droppedBefore = Stats().sitesDropped;
+    const UINT32 kColliding = 9;
+    const void* objects[kColliding];
+    UINT32 found = 0;
+    UINT32 target = SlotOf(Address(50000));
+    for (UINT_PTR n = 50000; found < kColliding; ++n)
+    {
+        if (SlotOf(Address(n)) == target)
+        {
+            objects[found++] = Address(n);
+        }
+    }
+
+    for (UINT32 i = 0; i < kColliding; ++i)
+    {
+        ModuleObjectCreated(ModuleObjectStats, objects[i], 16);
+    }
+    ModuleMemoryStats stats = Stats();
+    CHECK(stats.sites == kColliding - 1 && stats.sitesDropped == droppedBefore + 1);
+    CHECK(HasSite(objects[0], ModuleObjectStats) && !HasSite(objects[kColliding - 1], ModuleObjectStats));
+
+    ModuleObjectDestroyed(ModuleObjectStats, objects[kColliding - 1], 16);
+    stats = Stats();
+    CHECK(stats.sites == kColliding - 1 && stats.objects[ModuleObjectStats].live == kColliding - 1);
+
+    // A slot that frees up takes the next object again
+    ModuleObjectDestroyed(ModuleObjectStats, objects[3], 16);
+    ModuleObjectCreated(ModuleObjectStats, objects[kColliding - 1], 16);
+    CHECK(HasSite(objects[kColliding - 1], ModuleObjectStats) && Stats().sitesDropped == droppedBefore + 1);
+
+    for (UINT32 i = 0; i < kColliding; ++i)
+    {
+        if (i != 3)
+        {
+            ModuleObjectDestroyed(ModuleObjectStats, objects[i], 16);
+        }
+    }
+    stats = Stats();
+    CHECK(stats.sites == 0 && stats.objects[ModuleObjectStats].live == 0 && stats.objects[ModuleObjectStats].bytes == 0);
+}
+
+int main()
+{
+    // Read on the first creation, so before any
+    SetEnvironmentVariableW(L"HELLOWORLD_ALLOC_SITES", L"1");
+
+    TestCounts();
+    TestThreads();
+    TestDroppedSite();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,163 @@
+#include "../ObjectPool.h"
+#include "Check.h"
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Threads come and go in waves, and every block is freed on another thread than the one
+// that allocated it, which is what a server does with objects its clients release from
+// their own threads. The pool must keep its memory bounded through all of that: the depot
+// never holds more than its capacity, exiting threads hand their magazines back, and the
+// resident set stops growing once the first wave has warmed things up.
+static const size_t kBlockSize = 256;
+static const size_t kDepot = 256;
+static const int kWaves = 20;
+static const int kPairs = 4;
+static const int kBurst = 500;
+static const int kRounds = 100;
+
+struct PoolTag
+{
+    static constexpr const wchar_t* setting = L"OBJECTPOOLCHURNTEST_POOL";
+};
+typedef ObjectPool<PoolTag, kBlockSize> Pool;
+
+static ObjectPoolStats Stats()
+{
+    ObjectPoolStats stats;
+    Pool::GetStats(&stats);
+    return stats;
+}
+
+// Resident set size in bytes, or 0 where we can't tell
+static size_t ResidentBytes()
+{
+#ifdef __linux__
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL)
+    {
+        return 0;
+    }
+    unsigned long size = 0, resident = 0;
+    int fields = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    return (fields == 2) ? resident * 4096 : 0;
+#else
+    return 0;
+#endif
+}
+
+// Hands bursts of blocks from an allocating thread to a freeing one
+struct Handoff
+{
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::vector<void*> blocks;
+    bool done = false;
+};
+
+static void Allocating(Handoff* handoff)
+{
+    std::vector<void*> burst(kBurst);
+    for (int round = 0; round < kRounds; ++round)
+    {
+        for (void*& block : burst)
+        {
+            block = Pool::Allocate(kBlockSize);
+            memset(block, round & 0xFF, kBlockSize);
+        }
+
+        // Wait for the freeing thread to catch up, so the blocks in flight stay few
+        for (;;)
+        {
+            AcquireSRWLockExclusive(&handoff->lock);
+            bool room = handoff->blocks.size() < 2 * kBurst;
+            if (room)
+            {
+                handoff->blocks.insert(handoff->blocks.end(), burst.begin(), burst.end());
+            }
+            ReleaseSRWLockExclusive(&handoff->lock);
+            if (room)
+            {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    AcquireSRWLockExclusive(&handoff->lock);
+    handoff->done = true;
+    ReleaseSRWLockExclusive(&handoff->lock);
+}
+
+static void Freeing(Handoff* handoff)
+{
+    std::vector<void*> blocks;
+    for (bool done = false; !done;)
+    {
+        AcquireSRWLockExclusive(&handoff->lock);
+        blocks.swap(handoff->blocks);
+        done = handoff->done && blocks.empty();
+        ReleaseSRWLockExclusive(&handoff->lock);
+
+        for (void* block : blocks)
+        {
+            Pool::Free(block);
+        }
+        if (blocks.empty())
+        {
+            std::this_thread::yield();
+        }
+        blocks.clear();
+    }
+}
+
+static void RunWave()
+{
+    std::vector<Handoff> handoffs(kPairs);
+    std::vector<std::thread> threads;
+    for (Handoff& handoff : handoffs)
+    {
+        threads.emplace_back(Allocating, &handoff);
+        threads.emplace_back(Freeing, &handoff);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+int main()
+{
+    SetEnvironmentVariableW(L"OBJECTPOOLCHURNTEST_POOL", L"256");
+
+    RunWave();
+    size_t warm = ResidentBytes();
+    for (int wave = 1; wave < kWaves; ++wave)
+    {
+        RunWave();
+
+        // Every thread of the wave has exited and spilled its magazine into the depot
+        ObjectPoolStats stats = Stats();
+        CHECK(stats.live == 0);
+        CHECK(stats.cached >= 0 && stats.cached <= static_cast<LONG64>(kDepot));
+    }
+    size_t after = ResidentBytes();
+
+    ObjectPoolStats stats = Stats();
+    LONG64 allocations = static_cast<LONG64>(kWaves) * kPairs * kBurst * kRounds;
+    CHECK(stats.hits + stats.misses == allocations);
+    printf("%lld allocations of %zu bytes, %lld from the pool, %lld cached at the end\n",
+           static_cast<long long>(allocations), kBlockSize, static_cast<long long>(stats.hits), static_cast<long long>(stats.cached));
+
+    // Hundreds of megabytes went through the pool; the process must not have kept them.
+    // The margin covers the heap's own caches, which differ between allocators.
+    if (warm != 0 && after != 0)
+    {
+        printf("resident after the first wave %zu KB, after the last %zu KB\n", warm / 1024, after / 1024);
+        CHECK(after < warm + 16 * 1024 * 1024);
+    }
+
+    Pool::Drain();
+    stats = Stats();
+    CHECK(stats.cached == 0 && stats.live == 0);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,177 @@
+#include "../ObjectPool.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+static const size_t kBlockSize = 48;
+static const size_t kDepot = 64;
+
+struct PoolTag
+{
+    static constexpr const wchar_t* setting = L"OBJECTPOOLTEST_POOL";
+};
+typedef ObjectPool<PoolTag, kBlockSize> Pool;
+
+struct OffTag
+{
+    static constexpr const wchar_t* setting = L"OBJECTPOOLTEST_OFF";
+};
+typedef ObjectPool<OffTag, kBlockSize> OffPool;
+
+static ObjectPoolStats Stats()
+{
+    ObjectPoolStats stats;
+    Pool::GetStats(&stats);
+    return stats;
+}
+
+// Without the setting every block comes from the heap and goes back to it
+static void TestDisabled()
+{
+    void* blocks[10];
+    for (void*& block : blocks)
+    {
+        block = OffPool::Allocate(kBlockSize);
+        CHECK(block != NULL);
+    }
+    for (void* block : blocks)
+    {
+        OffPool::Free(block);
+    }
+    OffPool::Free(NULL);
+
+    ObjectPoolStats stats;
+    OffPool::GetStats(&stats);
+    CHECK(stats.hits == 0 && stats.misses == 10 && stats.live == 0 && stats.cached == 0);
+}
+
+static void TestReuse()
+{
+    // A freed block is the next one handed out
+    void* first = Pool::Allocate(kBlockSize);
+    CHECK(first != NULL);
+    Pool::Free(first);
+    void* second = Pool::Allocate(kBlockSize - 8);
+    CHECK(second == first);
+
+    ObjectPoolStats stats = Stats();
+    CHECK(stats.misses == 1 && stats.hits == 1 && stats.live == 1 && stats.cached == 0);
+
+    // Bigger requests bypass the pool, but their blocks may still be reused
+    void* big = Pool::Allocate(kBlockSize * 4);
+    CHECK(big != NULL);
+    memset(big, 0xAB, kBlockSize * 4);
+    Pool::Free(big);
+    Pool::Free(second);
+    stats = Stats();
+    CHECK(stats.misses == 2 && stats.live == 0 && stats.cached == 2);
+}
+
+// Blocks freed on one thread are served on another through the depot, and the depot never
+// keeps more than it was given room for
+static void TestDepot()
+{
+    std::vector<void*> blocks;
+    for (int i = 0; i < 200; ++i)
+    {
+        blocks.push_back(Pool::Allocate(kBlockSize));
+    }
+    std::thread freeing([&blocks]
+    {
+        for (void* block : blocks)
+        {
+            Pool::Free(block);
+        }
+    });
+    freeing.join();
+
+    // The freeing thread has exited and handed its magazine back
+    ObjectPoolStats stats = Stats();
+    CHECK(stats.live == 0);
+    CHECK(stats.cached >= 0 && stats.cached <= static_cast<LONG64>(kDepot + 32));
+
+    LONG64 hitsBefore = stats.hits;
+    std::thread allocating([]
+    {
+        void* block = Pool::Allocate(kBlockSize);
+        Pool::Free(block);
+    });
+    allocating.join();
+    CHECK(Stats().hits == hitsBefore + 1);
+}
+
+static void TestThreads()
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([]
+        {
+            void* blocks[40];
+            for (int round = 0; round < 2000; ++round)
+            {
+                for (void*& block : blocks)
+                {
+                    block = Pool::Allocate(kBlockSize);
+                    memset(block, round & 0xFF, kBlockSize);
+                }
+                for (void* block : blocks)
+                {
+                    Pool::Free(block);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ObjectPoolStats stats = Stats();
+    CHECK(stats.live == 0);
+    CHECK(stats.hits > stats.misses);
+}
+
+// What a DLL does when it is unloaded: nothing is cached afterwards, also not in the
+// magazines of threads that are still running, and the pool keeps working
+static void TestDrain()
+{
+    void* block = Pool::Allocate(kBlockSize);
+    Pool::Free(block);
+    CHECK(Stats().cached > 0);
+
+    Pool::Drain();
+    ObjectPoolStats stats = Stats();
+    CHECK(stats.cached == 0 && stats.live == 0);
+
+    LONG64 missesBefore = stats.misses;
+    block = Pool::Allocate(kBlockSize);
+    CHECK(block != NULL);
+    CHECK(Stats().misses == missesBefore + 1);
+
+    // Frees after Drain go to the heap, on this thread and on others, so nothing is
+    // cached again that Drain would have had to free
+    Pool::Free(block);
+    std::thread other([]
+    {
+        Pool::Free(Pool::Allocate(kBlockSize));
+    });
+    other.join();
+    stats = Stats();
+    CHECK(stats.cached == 0 && stats.live == 0);
+    CHECK(stats.misses == missesBefore + 2);
+}
+
+int main()
+{
+    // The pool reads its setting once, on first use
+    SetEnvironmentVariableW(L"OBJECTPOOLTEST_POOL", L"64");
+    SetEnvironmentVariableW(L"OBJECTPOOLTEST_OFF", NULL);
+
+    TestDisabled();
+    TestReuse();
+    TestDepot();
+    TestThreads();
+    TestDrain();
+    return CHECK_RESULT();
+}
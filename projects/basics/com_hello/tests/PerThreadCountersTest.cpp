@@ -0,0 +1,108 @@
+#include "../PerThreadCounters.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+struct CountersTag;
+typedef PerThreadCounters<CountersTag, 3> Counters;
+
+struct OtherCountersTag;
+typedef PerThreadCounters<OtherCountersTag, 1> OtherCounters;
+
+static const int kThreads = 8;
+static const int kAdds = 100000;
+
+static void TestOneThread()
+{
+    // Add returns the thread's own count
+    CHECK(Counters::Add(0, 5) == 5);
+    CHECK(Counters::Add(0, -2) == 3);
+    CHECK(Counters::Add(2, 7) == 7);
+
+    LONG64 totals[Counters::kCount];
+    Counters::Read(totals);
+    CHECK(totals[0] == 3 && totals[1] == 0 && totals[2] == 7);
+
+    // Every tag has counters of its own
+    LONG64 other[OtherCounters::kCount];
+    OtherCounters::Read(other);
+    CHECK(other[0] == 0);
+}
+
+static void TestManyThreads()
+{
+    LONG64 before[Counters::kCount];
+    Counters::Read(before);
+
+    // Readers may run while the threads count, and never see a total go down
+    bool monotonic = true;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([t]
+        {
+            for (int i = 0; i < kAdds; ++i)
+            {
+                Counters::Add(0, 1);
+                Counters::Add(1, t);
+            }
+        });
+    }
+    LONG64 previous = before[0];
+    for (int i = 0; i < 1000; ++i)
+    {
+        LONG64 totals[Counters::kCount];
+        Counters::Read(totals);
+        monotonic = monotonic && totals[0] >= previous;
+        previous = totals[0];
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(monotonic);
+
+    // Once the threads are gone their counts are still there
+    LONG64 after[Counters::kCount];
+    Counters::Read(after);
+    CHECK(after[0] - before[0] == static_cast<LONG64>(kThreads) * kAdds);
+    CHECK(after[1] - before[1] == static_cast<LONG64>(kThreads) * (kThreads - 1) / 2 * kAdds);
+    CHECK(after[2] == before[2]);
+}
+
+// A thread that starts after another one exited takes over its shard, and counts on top of
+// what is in it, so nothing is lost and the shards don't pile up
+static void TestShardReuse()
+{
+    LONG64 before[OtherCounters::kCount];
+    OtherCounters::Read(before);
+    for (int round = 0; round < 100; ++round)
+    {
+        std::thread thread([]
+        {
+            OtherCounters::Add(0, 1);
+        });
+        thread.join();
+    }
+
+    LONG64 after[OtherCounters::kCount];
+    OtherCounters::Read(after);
+    CHECK(after[0] - before[0] == 100);
+
+    // The last thread got a shard that already held the counts of the ones before it
+    LONG64 own = 0;
+    std::thread last([&own]
+    {
+        own = OtherCounters::Add(0, 1);
+    });
+    last.join();
+    CHECK(own == 101);
+}
+
+int main()
+{
+    TestOneThread();
+    TestManyThreads();
+    TestShardReuse();
+    return CHECK_RESULT();
+}
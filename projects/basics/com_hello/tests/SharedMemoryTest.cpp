@@ -0,0 +1,315 @@
+#include "../SharedMemory.h"
+#include "../HelloWorld.h"
+#include "../gen/IHelloWorld_wire.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+// Client and server are threads of this process here. Off Windows the section and its
+// events are only known within the process, see compat/Windows.h.
+static const UINT32 kSlotCount = 4;
+static const UINT32 kSlotSize = 1024;
+
+static HRESULT AnswerWithHelloWorld(void* context, WireReader& request, WireWriter& reply)
+{
+    return IHelloWorldWireStub(static_cast<HelloWorld*>(context), request, reply);
+}
+
+// Replies with the number in the request
+static HRESULT Echo(void*, WireReader& request, WireWriter& reply)
+{
+    UINT32 value;
+    HRESULT hr = request.GetUInt32(&value);
+    if (SUCCEEDED(hr))
+    {
+        reply.PutUInt32(value);
+    }
+    return hr;
+}
+
+// Serves every channel of the server on a thread of its own until Stop
+class Serving
+{
+    SharedMemoryServer* m_server;
+    std::vector<std::thread> m_threads;
+    std::vector<HRESULT> m_results;
+
+public:
+    Serving(SharedMemoryServer* server, SharedMemoryHandler handler, void* context)
+        : m_server(server), m_results(server->ChannelCount(), E_FAIL)
+    {
+        for (UINT32 i = 0; i < server->ChannelCount(); ++i)
+        {
+            m_threads.emplace_back([this, i, handler, context]() { m_results[i] = m_server->Serve(i, handler, context); });
+        }
+    }
+
+    // Stops the server and checks that every Serve returned
+    ~Serving()
+    {
+        m_server->Stop();
+        for (size_t i = 0; i < m_threads.size(); ++i)
+        {
+            m_threads[i].join();
+            CHECK(m_results[i] == S_OK);
+        }
+        delete m_server;
+    }
+};
+
+// Calls HelloWorld through the generated proxy, on every channel there is
+static void TestCalls()
+{
+    SharedMemoryServer* server = NULL;
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Calls", 2, kSlotCount, kSlotSize, &server) == S_OK);
+    if (server == NULL)
+    {
+        return;
+    }
+    SharedMemoryServer* second = NULL;
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Calls", 2, kSlotCount, kSlotSize, &second) == HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS));
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Odd", 2, 3, kSlotSize, &second) == E_INVALIDARG);
+
+    // The channels share the object, which is free-threaded
+    HelloWorld* pHelloWorld = new HelloWorld;
+    {
+        Serving serving(server, AnswerWithHelloWorld, pHelloWorld);
+
+        SharedMemoryChannel* channels[2] = {};
+        CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Calls", &channels[0]) == S_OK);
+        CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Calls", &channels[1]) == S_OK);
+        SharedMemoryChannel* third = NULL;
+        CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Calls", &third) == RPC_E_SERVER_TOO_BUSY && third == NULL);
+        CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Missing", &third) == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+        BSTR name = SysAllocString(L"John Doe");
+        for (SharedMemoryChannel* channel : channels)
+        {
+            if (channel == NULL)
+            {
+                continue;
+            }
+            IHelloWorldWireProxy proxy(channel);
+            for (int i = 0; i < 100; ++i)
+            {
+                BSTR greeting = NULL;
+                CHECK(proxy.SayHelloTo(name, &greeting) == S_OK && greeting != NULL && wcscmp(greeting, L"Hello, John Doe!\n") == 0);
+                SysFreeString(greeting);
+            }
+
+            // A failed call comes back as the HRESULT, and the channel stays in step
+            CHECK(proxy.SayHelloTo(name, NULL) == E_POINTER);
+            BSTR greeting = NULL;
+            CHECK(proxy.SayHelloStr(&greeting) == S_OK && greeting != NULL && wcscmp(greeting, L"Hello, World!\n") == 0);
+            SysFreeString(greeting);
+            delete channel;
+        }
+        SysFreeString(name);
+
+        // A channel that was given back can be opened again
+        CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Calls", &third) == S_OK);
+        delete third;
+    }
+    pHelloWorld->Release();
+}
+
+// Requests in flight come back in order, and no more than the reply ring has room for
+static void TestPipelining()
+{
+    SharedMemoryServer* server = NULL;
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Pipelining", 1, kSlotCount, kSlotSize, &server) == S_OK);
+    if (server == NULL)
+    {
+        return;
+    }
+    Serving serving(server, Echo, NULL);
+
+    SharedMemoryChannel* channel = NULL;
+    CHECK(SharedMemoryChannel::Open("SharedMemoryTest.Pipelining", &channel) == S_OK);
+    if (channel == NULL)
+    {
+        return;
+    }
+
+    WireReader reply;
+    CHECK(channel->End(&reply) == E_UNEXPECTED);
+    for (UINT32 round = 0; round < 3; ++round)
+    {
+        UINT32 next = 0;
+        for (; next < kSlotCount; ++next)
+        {
+            WireWriter request;
+            request.PutUInt32(round * 100 + next);
+            HRESULT hr = channel->Begin(request);
+            if (hr == E_PENDING)
+            {
+                break;
+            }
+            CHECK(hr == S_OK);
+        }
+        CHECK(next == kSlotCount - 1);
+
+        // Call waits for the oldest reply, so it can't be mixed in
+        WireWriter request;
+        request.PutUInt32(0);
+        CHECK(channel->Call(request, &reply) == E_PENDING);
+
+        for (UINT32 i = 0; i < next; ++i)
+        {
+            UINT32 value = 0;
+            CHECK(channel->End(&reply) == S_OK && reply.GetUInt32(&value) == S_OK && value == round * 100 + i);
+        }
+        CHECK(channel->End(&reply) == E_UNEXPECTED);
+    }
+
+    // A request that doesn't fit into a slot
+    std::vector<BYTE> big(kSlotSize);
+    WireWriter request;
+    request.PutBytes(big.data(), big.size());
+    CHECK(channel->Begin(request) == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    delete channel;
+}
+
+// The section as a client sees it, to play a client that doesn't keep to the protocol
+struct RawSection
+{
+    HANDLE mapping;
+    BYTE* view;
+    HANDLE requestEvent;
+
+    explicit RawSection(const char* name)
+    {
+        char path[MAX_PATH];
+        _snprintf_s(path, MAX_PATH, _TRUNCATE, "Local\\%s", name);
+        mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, path);
+        view = (mapping != NULL) ? static_cast<BYTE*>(MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0)) : NULL;
+        _snprintf_s(path, MAX_PATH, _TRUNCATE, "Local\\%s.0.requests", name);
+        requestEvent = OpenEventA(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, path);
+    }
+
+    ~RawSection()
+    {
+        if (view != NULL)
+        {
+            UnmapViewOfFile(view);
+        }
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+        }
+        if (requestEvent != NULL)
+        {
+            CloseHandle(requestEvent);
+        }
+    }
+
+    // The layout of SharedMemory.cpp, for a section of one channel
+    SharedChannel* Channel() const { return reinterpret_cast<SharedChannel*>(view + 64); }
+    UINT32* Message(bool replies, UINT32 index) const
+    {
+        BYTE* slots = view + 64 + sizeof(SharedChannel);
+        SharedSlot* slot = reinterpret_cast<SharedSlot*>(slots + ((replies ? kSlotCount : 0) + (index % kSlotCount)) * kSlotSize);
+        return reinterpret_cast<UINT32*>(slot + 1);
+    }
+
+    void Send(UINT32 index, UINT32 value)
+    {
+        Message(false, index)[-2] = sizeof(UINT32);
+        Message(false, index)[0] = value;
+    }
+
+    void Publish(UINT32 head)
+    {
+        Channel()->requests.head.store(head, std::memory_order_seq_cst);
+        SetEvent(requestEvent);
+    }
+
+    bool WaitForTail(UINT32 tail)
+    {
+        for (int i = 0; i < 5000; ++i)
+        {
+            if (Channel()->requests.tail.load(std::memory_order_acquire) == tail)
+            {
+                return true;
+            }
+            Sleep(1);
+        }
+        return false;
+    }
+};
+
+// A client with more requests in flight than Begin allows gets no replies to the extra ones,
+// and the replies it hasn't read yet stay as they were
+static void TestBrokenClient()
+{
+    SharedMemoryServer* server = NULL;
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Broken", 1, kSlotCount, kSlotSize, &server) == S_OK);
+    if (server == NULL)
+    {
+        return;
+    }
+    Serving serving(server, Echo, NULL);
+
+    RawSection section("SharedMemoryTest.Broken");
+    CHECK(section.view != NULL && section.requestEvent != NULL);
+    if (section.view == NULL || section.requestEvent == NULL)
+    {
+        return;
+    }
+    section.Channel()->clientProcessId.store(GetCurrentProcessId());
+
+    // One request at a time, so the requests have room, but no reply is ever read
+    const UINT32 kSent = kSlotCount + 2;
+    for (UINT32 i = 0; i < kSent; ++i)
+    {
+        section.Send(i, 1000 + i);
+        section.Publish(i + 1);
+        CHECK(section.WaitForTail(i + 1));
+    }
+    CHECK(section.Channel()->replies.head.load() == kSlotCount);
+    for (UINT32 i = 0; i < kSlotCount; ++i)
+    {
+        CHECK(section.Message(true, i)[0] == 1000 + i);
+    }
+
+    // Once the client reads a reply, there is room for the next
+    section.Channel()->replies.tail.store(1, std::memory_order_release);
+    section.Send(kSent, 2000);
+    section.Publish(kSent + 1);
+    CHECK(section.WaitForTail(kSent + 1));
+    CHECK(section.Channel()->replies.head.load() == kSlotCount + 1);
+    CHECK(section.Message(true, kSlotCount)[0] == 2000);
+    CHECK(section.Message(true, 1)[0] == 1001);
+}
+
+// Stop ends a Serve that is waiting for requests, and one that has never had any
+static void TestStop()
+{
+    SharedMemoryServer* server = NULL;
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Stop", 3, kSlotCount, kSlotSize, &server) == S_OK);
+    if (server != NULL)
+    {
+        Serving serving(server, Echo, NULL);
+        Sleep(10);
+    }
+
+    // The name is free again once the server is gone
+    CHECK(SharedMemoryServer::Create("SharedMemoryTest.Stop", 3, kSlotCount, kSlotSize, &server) == S_OK);
+    if (server != NULL)
+    {
+        server->Stop();
+        CHECK(server->Serve(0, Echo, NULL) == S_OK);
+        delete server;
+    }
+}
+
+int main()
+{
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    TestCalls();
+    TestPipelining();
+    TestBrokenClient();
+    TestStop();
+    CoUninitialize();
+    return CHECK_RESULT();
+}
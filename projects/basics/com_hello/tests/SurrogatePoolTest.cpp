@@ -0,0 +1,172 @@
+#include "../SurrogatePool.h"
+#include "../gen/IHelloWorld_wire.h"
+#include "Check.h"
+#include <string>
+
+// The workers are the HelloWorldLocalServer.exe this folder builds, which SurrogatePool
+// finds next to the test. Off Windows that only works from the build folder, where ctest
+// runs the test.
+
+// Waits up to 10 s for the pool to get to where 'done' says
+template <class Done>
+static bool WaitForWorkers(SurrogatePool& pool, Done done)
+{
+    SurrogateWorkerStats stats[SurrogatePool::kMaxWorkers];
+    for (int i = 0; i < 1000; ++i)
+    {
+        UINT32 count = pool.GetStats(stats, SurrogatePool::kMaxWorkers);
+        if (done(stats, count))
+        {
+            return true;
+        }
+        Sleep(10);
+    }
+    return false;
+}
+
+static UINT32 CountState(const SurrogateWorkerStats* stats, UINT32 count, SurrogateWorkerState state)
+{
+    UINT32 n = 0;
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        n += (stats[i].state == state) ? 1 : 0;
+    }
+    return n;
+}
+
+static void Kill(DWORD processId)
+{
+    HANDLE process = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE, FALSE, processId);
+    CHECK(process != NULL);
+    if (process != NULL)
+    {
+        CHECK(TerminateProcess(process, 1));
+        CHECK(WaitForSingleObject(process, 10000) == WAIT_OBJECT_0);
+        CloseHandle(process);
+    }
+}
+
+// Calls HelloWorld on the worker Activate chooses
+static HRESULT Greet(SurrogatePool& pool)
+{
+    UINT32 worker;
+    char path[MAX_PATH];
+    HRESULT hr = pool.Activate(&worker, path, MAX_PATH);
+    LocalServerConnection* connection = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hr = LocalServerConnection::Connect(path, &connection);
+    }
+    if (SUCCEEDED(hr))
+    {
+        LocalServerCall call(connection);
+        IHelloWorldWireProxy proxy(&call);
+        BSTR name = SysAllocString(L"John Doe");
+        BSTR greeting = NULL;
+        pool.CallStarted(worker);
+        hr = proxy.SayHelloTo(name, &greeting);
+        pool.CallFinished(worker);
+        if (SUCCEEDED(hr) && wcscmp(greeting, L"Hello, John Doe!\n") != 0)
+        {
+            hr = E_UNEXPECTED;
+        }
+        SysFreeString(greeting);
+        SysFreeString(name);
+    }
+    delete connection;
+    return hr;
+}
+
+// A socket path is in use while a server listens on it, not while a file is left behind
+static void TestPathInUse()
+{
+    char temp[MAX_PATH];
+    GetTempPathA(MAX_PATH, temp);
+    std::string path = std::string(temp) + "SurrogatePoolTest." + std::to_string(GetCurrentProcessId()) + ".sock";
+    DeleteFileA(path.c_str());
+    CHECK(!LocalServerPathInUse(path.c_str()));
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy_s(address.sun_path, sizeof(address.sun_path), path.c_str());
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(listener != INVALID_SOCKET);
+    CHECK(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR);
+    CHECK(listen(listener, SOMAXCONN) != SOCKET_ERROR);
+    CHECK(LocalServerPathInUse(path.c_str()));
+
+    closesocket(listener);
+    CHECK(!LocalServerPathInUse(path.c_str()));
+    CHECK(DeleteFileA(path.c_str()));
+}
+
+static void TestPool()
+{
+    CHECK(SurrogatePool().Start(0, 1) == E_INVALIDARG);
+    CHECK(SurrogatePool().Start(SurrogatePool::kMaxWorkers, 1) == E_INVALIDARG);
+
+    SurrogatePool pool;
+    HRESULT hr = pool.Start(2, 1);
+    CHECK(hr == S_OK);
+    if (FAILED(hr))
+    {
+        return;
+    }
+
+    // Every worker starts before Start returns
+    SurrogateWorkerStats stats[SurrogatePool::kMaxWorkers];
+    UINT32 count = pool.GetStats(stats, SurrogatePool::kMaxWorkers);
+    CHECK(count == 3);
+    CHECK(CountState(stats, count, SurrogateWorkerActive) == 2);
+    CHECK(CountState(stats, count, SurrogateWorkerStandby) == 1);
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(Greet(pool) == S_OK);
+    }
+
+    // Objects go to the active workers only, and fill them evenly
+    count = pool.GetStats(stats, SurrogatePool::kMaxWorkers);
+    UINT32 standby = 0;
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        CHECK(stats[i].outstanding == 0);
+        CHECK(stats[i].activations == ((stats[i].state == SurrogateWorkerActive) ? 2 : 0));
+        CHECK(stats[i].calls == stats[i].activations);
+        standby = (stats[i].state == SurrogateWorkerStandby) ? i : standby;
+    }
+
+    // The standby takes the place of an active worker that dies, which comes back as the
+    // new standby
+    UINT32 victim = (standby == 0) ? 1 : 0;
+    DWORD victimId = stats[victim].processId;
+    Kill(victimId);
+    CHECK(WaitForWorkers(pool, [&](const SurrogateWorkerStats* s, UINT32 n) {
+        return s[victim].restarts == 1 && s[victim].state == SurrogateWorkerStandby && s[standby].state == SurrogateWorkerActive &&
+               CountState(s, n, SurrogateWorkerActive) == 2;
+    }));
+    count = pool.GetStats(stats, SurrogatePool::kMaxWorkers);
+    CHECK(stats[victim].processId != victimId && stats[victim].processId != 0);
+    CHECK(Greet(pool) == S_OK);
+
+    // Two that die together both come back: the monitor doesn't wait for one to start
+    // before it notices the other
+    DWORD first = stats[0].processId;
+    DWORD second = stats[2].processId;
+    Kill(first);
+    Kill(second);
+    CHECK(WaitForWorkers(pool, [&](const SurrogateWorkerStats* s, UINT32 n) {
+        return s[0].processId != first && s[2].processId != second && CountState(s, n, SurrogateWorkerActive) == 2 &&
+               CountState(s, n, SurrogateWorkerStandby) == 1;
+    }));
+    CHECK(Greet(pool) == S_OK);
+}
+
+int main()
+{
+    WSADATA wsaData;
+    CHECK(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+    TestPathInUse();
+    TestPool();
+    WSACleanup();
+    return CHECK_RESULT();
+}
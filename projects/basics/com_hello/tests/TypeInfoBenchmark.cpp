@@ -0,0 +1,75 @@
+#include "./midl/IHelloWorld.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <chrono>
+
+// IDispatch::GetTypeInfo of HelloWorld: the first call, which loads the type library from
+// the module, and every later one, which hands out the cached ITypeInfo. Against that, a
+// load for every call, and the GetIDsOfNames a host without type information makes on every
+// late-bound call. Off Windows the type library is compat's empty stand-in, so the load
+// numbers show the shape of the cost, not OLE's.
+extern "C" HRESULT __stdcall DllGetClassObject(const CLSID& clsid, const IID& iid, void** ppv);
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 1000000);
+
+    IClassFactory* pFactory = NULL;
+    IHelloWorld* pHelloWorld = NULL;
+    CHECK(DllGetClassObject(CLSID_HelloWorld, IID_IClassFactory, reinterpret_cast<void**>(&pFactory)) == S_OK);
+    CHECK(pFactory->CreateInstance(NULL, IID_IHelloWorld, reinterpret_cast<void**>(&pHelloWorld)) == S_OK);
+    pFactory->Release();
+
+    UINT count = 0;
+    CHECK(pHelloWorld->GetTypeInfoCount(&count) == S_OK && count == 1);
+    ITypeInfo* pTypeInfo = reinterpret_cast<ITypeInfo*>(1);
+    CHECK(pHelloWorld->GetTypeInfo(1, LOCALE_USER_DEFAULT, &pTypeInfo) == DISP_E_BADINDEX && pTypeInfo == NULL);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CHECK(pHelloWorld->GetTypeInfo(0, LOCALE_USER_DEFAULT, &pTypeInfo) == S_OK && pTypeInfo != NULL);
+    std::chrono::duration<double, std::nano> first = std::chrono::steady_clock::now() - start;
+    PrintNanoseconds("GetTypeInfo, first call", first.count());
+
+    // Every locale, German (0x0407) here, gets the one that was cached
+    ITypeInfo* pAgain = NULL;
+    CHECK(pHelloWorld->GetTypeInfo(0, 0x0407, &pAgain) == S_OK && pAgain == pTypeInfo);
+    pAgain->Release();
+
+    PrintNanoseconds("GetTypeInfo, cached", NanosecondsPerCall(iterations, [pHelloWorld]
+    {
+        ITypeInfo* pTInfo = NULL;
+        if (SUCCEEDED(pHelloWorld->GetTypeInfo(0, LOCALE_USER_DEFAULT, &pTInfo)))
+        {
+            pTInfo->Release();
+        }
+    }));
+
+    WCHAR path[MAX_PATH];
+    CHECK(GetModuleFileNameW(NULL, path, MAX_PATH) != 0);
+    PrintNanoseconds("LoadTypeLibEx and GetTypeInfoOfGuid, every call", NanosecondsPerCall(iterations / 100, [&path]
+    {
+        ITypeLib* pTypeLib = NULL;
+        if (SUCCEEDED(LoadTypeLibEx(path, REGKIND_NONE, &pTypeLib)))
+        {
+            ITypeInfo* pTInfo = NULL;
+            if (SUCCEEDED(pTypeLib->GetTypeInfoOfGuid(IID_IHelloWorld, &pTInfo)))
+            {
+                pTInfo->Release();
+            }
+            pTypeLib->Release();
+        }
+    }));
+
+    OLECHAR name[] = L"SayHelloTo";
+    LPOLESTR names[] = { name };
+    DISPID dispId = 0;
+    PrintNanoseconds("GetIDsOfNames(SayHelloTo), every call", NanosecondsPerCall(iterations, [pHelloWorld, &names, &dispId]
+    {
+        pHelloWorld->GetIDsOfNames(IID_NULL, names, 1, LOCALE_USER_DEFAULT, &dispId);
+    }));
+    CHECK(dispId == 3);
+
+    pTypeInfo->Release();
+    CHECK(pHelloWorld->Release() == 0);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,157 @@
+#include "../WireFormat.h"
+#include "../gen/IHelloWorld_wire.h"
+#include "Benchmark.h"
+#include "Check.h"
+#include <vector>
+
+// A SayHelloTo round trip through the generated wire proxy and stub, against the same call
+// marshaled the way NDR marshals it for the MIDL /Oicf proxy, for a short and a long name.
+// Both run in-process over a loopback that copies the request and the reply, as a channel
+// would, and call the same server, so the difference is the marshaling.
+//
+// NDR isn't available off Windows; NdrStyleCall does what it does for a BSTR argument and
+// result: a sizing pass and then a marshaling pass over a heap buffer, the BSTR in its
+// user-marshal form (flags, byte count, conformance, characters), and a fresh BSTR for every
+// string that is unmarshaled, [in] arguments on the server side included.
+struct Echo
+{
+    HRESULT SayHello() { return S_OK; }
+    HRESULT SayHelloStr(BSTR* greeting) { *greeting = NULL; return S_OK; }
+    HRESULT SayHelloTo(BSTR name, BSTR* greeting)
+    {
+        *greeting = SysAllocStringLen(name, SysStringLen(name));
+        return (*greeting != NULL) ? S_OK : E_OUTOFMEMORY;
+    }
+    HRESULT SayHelloToMany(SAFEARRAY*, SAFEARRAY** greetings) { *greetings = NULL; return S_OK; }
+};
+
+static Echo s_echo;
+
+class LoopbackChannel : public WireChannel
+{
+    alignas(8) BYTE m_request[8192];
+    WireWriter m_reply;
+    alignas(8) BYTE m_replyCopy[8192];
+
+public:
+    HRESULT Call(const WireWriter& request, WireReader* reply)
+    {
+        memcpy(m_request, request.Data(), request.Size());
+        WireReader reader(m_request, request.Size());
+        m_reply.Reset();
+        HRESULT hr = IHelloWorldWireStub(&s_echo, reader, m_reply);
+        memcpy(m_replyCopy, m_reply.Data(), m_reply.Size());
+        *reply = WireReader(m_replyCopy, m_reply.Size());
+        return hr;
+    }
+};
+
+// BSTR_UserSize/UserMarshal/UserUnmarshal: a unique pointer's referent id, then the wireBSTR
+static size_t NdrBstrSize(size_t size, BSTR value)
+{
+    size = (size + 3) & ~static_cast<size_t>(3);
+    return size + 4 * sizeof(UINT32) + SysStringByteLen(value);
+}
+
+static BYTE* NdrBstrMarshal(BYTE* p, BSTR value)
+{
+    while (reinterpret_cast<uintptr_t>(p) & 3)
+    {
+        *p++ = 0;
+    }
+    UINT32 cb = SysStringByteLen(value);
+    UINT32 cch = SysStringLen(value);
+    UINT32 header[4] = { 0x00020000, 0x55555555, cch, cch };   // referent, fFlags, clSize, conformance
+    memcpy(p, header, sizeof(header));
+    memcpy(p + sizeof(header), value, cb);
+    return p + sizeof(header) + cb;
+}
+
+static const BYTE* NdrBstrUnmarshal(const BYTE* p, BSTR* value)
+{
+    while (reinterpret_cast<uintptr_t>(p) & 3)
+    {
+        ++p;
+    }
+    UINT32 header[4];
+    memcpy(header, p, sizeof(header));
+    *value = SysAllocStringLen(reinterpret_cast<const OLECHAR*>(p + sizeof(header)), header[3]);
+    return p + sizeof(header) + header[3] * sizeof(OLECHAR);
+}
+
+static HRESULT NdrStyleCall(BSTR name, BSTR* greeting)
+{
+    // Client: size, allocate, marshal
+    size_t size = NdrBstrSize(0, name);
+    BYTE* request = static_cast<BYTE*>(malloc(size));
+    NdrBstrMarshal(request, name);
+
+    // The channel's copy to the server
+    BYTE* received = static_cast<BYTE*>(malloc(size));
+    memcpy(received, request, size);
+    free(request);
+
+    // Server: unmarshal into a BSTR of its own, call, size and marshal the reply, free
+    BSTR serverName = NULL;
+    NdrBstrUnmarshal(received, &serverName);
+    free(received);
+    BSTR serverGreeting = NULL;
+    HRESULT result = s_echo.SayHelloTo(serverName, &serverGreeting);
+    SysFreeString(serverName);
+    size = NdrBstrSize(0, serverGreeting) + sizeof(HRESULT);
+    BYTE* reply = static_cast<BYTE*>(malloc(size));
+    BYTE* end = NdrBstrMarshal(reply, serverGreeting);
+    memcpy(end, &result, sizeof(result));
+    SysFreeString(serverGreeting);
+
+    // The channel's copy back, and the client unmarshals
+    BYTE* back = static_cast<BYTE*>(malloc(size));
+    memcpy(back, reply, size);
+    free(reply);
+    end = const_cast<BYTE*>(NdrBstrUnmarshal(back, greeting));
+    memcpy(&result, end, sizeof(result));
+    free(back);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = BenchmarkIterations(argc, argv, 1000000);
+
+    LoopbackChannel channel;
+    IHelloWorldWireProxy proxy(&channel);
+    std::vector<OLECHAR> longName(1000, L'x');
+    longName.push_back(0);
+    BSTR names[] = { SysAllocString(L"John Doe"), SysAllocString(longName.data()) };
+    const char* labels[] = { "8 chars", "1000 chars" };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        BSTR name = names[i];
+        BSTR greeting = NULL;
+        CHECK(proxy.SayHelloTo(name, &greeting) == S_OK && wcscmp(greeting, name) == 0);
+        SysFreeString(greeting);
+        CHECK(NdrStyleCall(name, &greeting) == S_OK && wcscmp(greeting, name) == 0);
+        SysFreeString(greeting);
+
+        char line[96];
+        snprintf(line, sizeof(line), "Wire proxy/stub, SayHelloTo, %s", labels[i]);
+        PrintNanoseconds(line, NanosecondsPerCall(iterations, [&proxy, name]
+        {
+            BSTR greeting = NULL;
+            proxy.SayHelloTo(name, &greeting);
+            SysFreeString(greeting);
+        }));
+        snprintf(line, sizeof(line), "NDR-style, SayHelloTo, %s", labels[i]);
+        PrintNanoseconds(line, NanosecondsPerCall(iterations, [name]
+        {
+            BSTR greeting = NULL;
+            NdrStyleCall(name, &greeting);
+            SysFreeString(greeting);
+        }));
+    }
+
+    SysFreeString(names[0]);
+    SysFreeString(names[1]);
+    return CHECK_RESULT();
+}
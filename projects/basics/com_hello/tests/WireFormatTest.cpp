@@ -0,0 +1,371 @@
+#include "../WireFormat.h"
+#include "../gen/IHelloWorld_wire.h"
+#include "Check.h"
+
+static bool SameBstr(BSTR a, BSTR b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+    return SysStringByteLen(a) == SysStringByteLen(b) && memcmp(a, b, SysStringByteLen(a)) == 0;
+}
+
+// What a reader gets from a message, copied into a buffer of its own as the channels do
+struct Message
+{
+    alignas(8) BYTE data[1024];
+    size_t size;
+
+    explicit Message(const WireWriter& writer) : size(writer.Size()) { memcpy(data, writer.Data(), size); }
+    Message(const UINT32* words, size_t count) : size(count * sizeof(UINT32)) { memcpy(data, words, size); }
+
+    WireReader Reader() const { return WireReader(data, size); }
+};
+
+static void TestScalars()
+{
+    WireWriter writer;
+    writer.PutUInt32(0xDEADBEEF);
+    writer.PutLong(-42);
+    writer.PutHResult(E_POINTER);
+    CHECK(!writer.Failed());
+    CHECK(writer.Size() == 12);
+
+    Message message(writer);
+    WireReader reader = message.Reader();
+    UINT32 u = 0;
+    LONG l = 0;
+    HRESULT hr = S_OK;
+    CHECK(reader.GetUInt32(&u) == S_OK && u == 0xDEADBEEF);
+    CHECK(reader.GetLong(&l) == S_OK && l == -42);
+    CHECK(reader.GetHResult(&hr) == S_OK && hr == E_POINTER);
+    CHECK(reader.AtEnd());
+
+    // Reading past the end fails instead of reading garbage
+    CHECK(reader.GetUInt32(&u) == RPC_E_INVALID_DATA);
+}
+
+static void TestBstrs()
+{
+    const wchar_t* const texts[] = { L"", L"a", L"ab", L"abc", L"Hello, John Doe!" };
+    WireWriter writer;
+    writer.PutBstr(NULL);
+    BSTR bstrs[ARRAYSIZE(texts)];
+    for (size_t i = 0; i < ARRAYSIZE(texts); ++i)
+    {
+        bstrs[i] = SysAllocString(texts[i]);
+        writer.PutBstr(bstrs[i]);
+    }
+    CHECK(!writer.Failed());
+    CHECK(writer.Size() % 4 == 0);
+
+    Message message(writer);
+    WireReader reader = message.Reader();
+    BSTR value = reinterpret_cast<BSTR>(1);
+    CHECK(reader.GetBstr(&value) == S_OK && value == NULL);
+    for (size_t i = 0; i < ARRAYSIZE(texts); ++i)
+    {
+        // GetBstr points into the message, and what it points to is a BSTR
+        CHECK(reader.GetBstr(&value) == S_OK);
+        CHECK(SameBstr(value, bstrs[i]));
+        CHECK(reinterpret_cast<const BYTE*>(value) > message.data && reinterpret_cast<const BYTE*>(value) < message.data + message.size);
+        CHECK(value[SysStringLen(value)] == 0);
+    }
+    CHECK(reader.AtEnd());
+
+    reader = message.Reader();
+    CHECK(reader.GetBstrCopy(&value) == S_OK && value == NULL);
+    CHECK(reader.GetBstrCopy(&value) == S_OK);
+    CHECK(SameBstr(value, bstrs[0]));
+    CHECK(reinterpret_cast<const BYTE*>(value) < message.data || reinterpret_cast<const BYTE*>(value) >= message.data + message.size);
+    SysFreeString(value);
+
+    for (size_t i = 0; i < ARRAYSIZE(texts); ++i)
+    {
+        SysFreeString(bstrs[i]);
+    }
+}
+
+static SAFEARRAY* MakeArray(const wchar_t* const* texts, ULONG count)
+{
+    SAFEARRAY* array = SafeArrayCreateVector(VT_BSTR, 0, count);
+    BSTR* elements;
+    SafeArrayAccessData(array, reinterpret_cast<void**>(&elements));
+    for (ULONG i = 0; i < count; ++i)
+    {
+        elements[i] = (texts[i] != NULL) ? SysAllocString(texts[i]) : NULL;
+    }
+    SafeArrayUnaccessData(array);
+    return array;
+}
+
+static void TestBstrArrays()
+{
+    const wchar_t* const names[] = { L"John", NULL, L"", L"Jane Doe" };
+    SAFEARRAY* array = MakeArray(names, ARRAYSIZE(names));
+    SAFEARRAY* empty = MakeArray(names, 0);
+
+    WireWriter writer;
+    writer.PutBstrArray(NULL);
+    writer.PutBstrArray(empty);
+    writer.PutBstrArray(array);
+    CHECK(!writer.Failed());
+
+    Message message(writer);
+    WireReader reader = message.Reader();
+    SAFEARRAY* value = reinterpret_cast<SAFEARRAY*>(1);
+    CHECK(reader.GetBstrArray(&value) == S_OK && value == NULL);
+    CHECK(reader.GetBstrArray(&value) == S_OK && value != NULL);
+    LONG lBound = 0, uBound = 0;
+    SafeArrayGetLBound(value, 1, &lBound);
+    SafeArrayGetUBound(value, 1, &uBound);
+    CHECK(uBound < lBound);
+    SafeArrayDestroy(value);
+
+    CHECK(reader.GetBstrArray(&value) == S_OK && value != NULL);
+    SafeArrayGetLBound(value, 1, &lBound);
+    SafeArrayGetUBound(value, 1, &uBound);
+    CHECK(uBound - lBound + 1 == static_cast<LONG>(ARRAYSIZE(names)));
+    BSTR* expected;
+    BSTR* actual;
+    SafeArrayAccessData(array, reinterpret_cast<void**>(&expected));
+    SafeArrayAccessData(value, reinterpret_cast<void**>(&actual));
+    for (size_t i = 0; i < ARRAYSIZE(names); ++i)
+    {
+        CHECK(SameBstr(actual[i], expected[i]));
+    }
+    SafeArrayUnaccessData(value);
+    SafeArrayUnaccessData(array);
+    SafeArrayDestroy(value);
+    CHECK(reader.AtEnd());
+
+    SafeArrayDestroy(empty);
+    SafeArrayDestroy(array);
+}
+
+static void TestWriterBuffers()
+{
+    // Growing past the inline buffer keeps what was written
+    WireWriter writer;
+    for (UINT32 i = 0; i < 1000; ++i)
+    {
+        writer.PutUInt32(i);
+    }
+    CHECK(!writer.Failed() && writer.Size() == 4000);
+    WireReader reader(writer.Data(), writer.Size());
+    bool same = true;
+    for (UINT32 i = 0; i < 1000; ++i)
+    {
+        UINT32 value;
+        same = same && reader.GetUInt32(&value) == S_OK && value == i;
+    }
+    CHECK(same);
+
+    // A fixed buffer fails the message that doesn't fit, and Reset starts over
+    alignas(4) BYTE buffer[16];
+    WireWriter fixed(buffer, sizeof(buffer));
+    BSTR name = SysAllocString(L"longer than the buffer");
+    fixed.PutUInt32(1);
+    fixed.PutBstr(name);
+    CHECK(fixed.Failed());
+    fixed.PutUInt32(2);
+    CHECK(fixed.Failed());
+    fixed.Reset();
+    fixed.PutUInt32(3);
+    CHECK(!fixed.Failed() && fixed.Size() == 4 && fixed.Data() == buffer);
+    SysFreeString(name);
+}
+
+// Messages a broken or hostile peer could send
+static void TestMalformed()
+{
+    BSTR value = NULL;
+    SAFEARRAY* array = NULL;
+
+    // Shorter than a length
+    const UINT32 truncatedLength[] = { 0 };
+    Message shortLength(truncatedLength, 0);
+    WireReader reader = shortLength.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+    CHECK(reader.GetBstrArray(&array) == RPC_E_INVALID_DATA && array == NULL);
+
+    // A length that runs past the end
+    const UINT32 pastEnd[] = { 400, 0x00410041 };
+    Message pastEndMessage(pastEnd, ARRAYSIZE(pastEnd));
+    reader = pastEndMessage.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+
+    // A length that isn't a whole number of characters
+    const UINT32 oddLength[] = { sizeof(OLECHAR) + 1, 0, 0, 0 };
+    Message oddLengthMessage(oddLength, ARRAYSIZE(oddLength));
+    reader = oddLengthMessage.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+
+    // Lengths that overflow when the terminator and padding are added
+    const UINT32 hugeLength[] = { 0xFFFFFFFC, 0 };
+    Message hugeLengthMessage(hugeLength, ARRAYSIZE(hugeLength));
+    reader = hugeLengthMessage.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+    const UINT32 hugeOddLength[] = { 0xFFFFFFFE, 0 };
+    Message hugeOddLengthMessage(hugeOddLength, ARRAYSIZE(hugeOddLength));
+    reader = hugeOddLengthMessage.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+
+    // Characters without a terminator
+    UINT32 unterminated[4] = { sizeof(OLECHAR) };
+    memset(&unterminated[1], 0x41, sizeof(unterminated) - sizeof(UINT32));
+    Message unterminatedMessage(unterminated, ARRAYSIZE(unterminated));
+    reader = unterminatedMessage.Reader();
+    CHECK(reader.GetBstr(&value) == RPC_E_INVALID_DATA);
+    reader = unterminatedMessage.Reader();
+    CHECK(reader.GetBstrCopy(&value) == RPC_E_INVALID_DATA && value == NULL);
+
+    // An element count bigger than the message could hold, which must not be allocated
+    const UINT32 hugeCount[] = { 0x7FFFFFFF, 0xFFFFFFFF };
+    Message hugeCountMessage(hugeCount, ARRAYSIZE(hugeCount));
+    reader = hugeCountMessage.Reader();
+    CHECK(reader.GetBstrArray(&array) == RPC_E_INVALID_DATA && array == NULL);
+
+    // A count that fits, but an element that is broken: nothing is returned or leaked
+    const UINT32 brokenElement[] = { 2, 0xFFFFFFFF, 64 };
+    Message brokenElementMessage(brokenElement, ARRAYSIZE(brokenElement));
+    reader = brokenElementMessage.Reader();
+    CHECK(reader.GetBstrArray(&array) == RPC_E_INVALID_DATA && array == NULL);
+
+    // A well-formed message, cut short anywhere, never reads past its end
+    WireWriter writer;
+    BSTR name = SysAllocString(L"John Doe");
+    writer.PutUInt32(3);
+    writer.PutBstr(name);
+    SysFreeString(name);
+    Message whole(writer);
+    for (size_t size = 0; size < whole.size; ++size)
+    {
+        WireReader cut(whole.data, size);
+        UINT32 dispid;
+        HRESULT hr = cut.GetUInt32(&dispid);
+        if (SUCCEEDED(hr))
+        {
+            hr = cut.GetBstr(&value);
+        }
+        CHECK(hr == RPC_E_INVALID_DATA);
+    }
+}
+
+// Loops a request back to a stub in the same process, copying it into a buffer of its own
+// first, as the channels do
+template <class Server>
+class LoopbackChannel : public WireChannel
+{
+    Server* m_server;
+    alignas(8) BYTE m_request[4096];
+    WireWriter m_reply;
+
+public:
+    explicit LoopbackChannel(Server* server) : m_server(server) {}
+
+    HRESULT Call(const WireWriter& request, WireReader* reply)
+    {
+        if (request.Size() > sizeof(m_request))
+        {
+            return RPC_E_INVALID_DATA;
+        }
+        memcpy(m_request, request.Data(), request.Size());
+        WireReader reader(m_request, request.Size());
+        m_reply.Reset();
+        HRESULT hr = IHelloWorldWireStub(m_server, reader, m_reply);
+        *reply = WireReader(m_reply.Data(), m_reply.Size());
+        return hr;
+    }
+};
+
+// Greets like HelloWorld, and fails for names it doesn't like
+struct Greeter
+{
+    HRESULT SayHello() { return S_OK; }
+    HRESULT SayHelloStr(BSTR* greeting) { return SayHelloTo(NULL, greeting); }
+    HRESULT SayHelloTo(BSTR name, BSTR* greeting)
+    {
+        if (name != NULL && wcscmp(name, L"nobody") == 0)
+        {
+            *greeting = NULL;
+            return E_INVALIDARG;
+        }
+        wchar_t text[64];
+        swprintf(text, ARRAYSIZE(text), L"Hello, %ls!", (name != NULL) ? name : L"World");
+        *greeting = SysAllocString(text);
+        return S_OK;
+    }
+    HRESULT SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings)
+    {
+        LONG lBound, uBound;
+        SafeArrayGetLBound(names, 1, &lBound);
+        SafeArrayGetUBound(names, 1, &uBound);
+        *greetings = SafeArrayCreateVector(VT_BSTR, 0, static_cast<ULONG>(uBound - lBound + 1));
+        BSTR* in;
+        BSTR* out;
+        SafeArrayAccessData(names, reinterpret_cast<void**>(&in));
+        SafeArrayAccessData(*greetings, reinterpret_cast<void**>(&out));
+        for (LONG i = 0; i <= uBound - lBound; ++i)
+        {
+            SayHelloTo(in[i], &out[i]);
+        }
+        SafeArrayUnaccessData(*greetings);
+        SafeArrayUnaccessData(names);
+        return S_OK;
+    }
+};
+
+// The generated proxy and stub, end to end
+static void TestProxyStub()
+{
+    Greeter greeter;
+    LoopbackChannel<Greeter> channel(&greeter);
+    IHelloWorldWireProxy proxy(&channel);
+
+    CHECK(proxy.SayHello() == S_OK);
+    BSTR greeting = NULL;
+    CHECK(proxy.SayHelloStr(&greeting) == S_OK && wcscmp(greeting, L"Hello, World!") == 0);
+    SysFreeString(greeting);
+
+    BSTR name = SysAllocString(L"John Doe");
+    CHECK(proxy.SayHelloTo(name, &greeting) == S_OK && wcscmp(greeting, L"Hello, John Doe!") == 0);
+    SysFreeString(greeting);
+    SysFreeString(name);
+
+    // The server's failure comes back as it was, without [out] arguments
+    name = SysAllocString(L"nobody");
+    greeting = reinterpret_cast<BSTR>(1);
+    CHECK(proxy.SayHelloTo(name, &greeting) == E_INVALIDARG && greeting == NULL);
+    SysFreeString(name);
+    CHECK(proxy.SayHelloTo(NULL, NULL) == E_POINTER);
+
+    const wchar_t* const names[] = { L"John", L"Jane" };
+    SAFEARRAY* array = MakeArray(names, ARRAYSIZE(names));
+    SAFEARRAY* greetings = NULL;
+    CHECK(proxy.SayHelloToMany(array, &greetings) == S_OK && greetings != NULL);
+    BSTR* elements;
+    SafeArrayAccessData(greetings, reinterpret_cast<void**>(&elements));
+    CHECK(wcscmp(elements[0], L"Hello, John!") == 0 && wcscmp(elements[1], L"Hello, Jane!") == 0);
+    SafeArrayUnaccessData(greetings);
+    SafeArrayDestroy(greetings);
+    SafeArrayDestroy(array);
+
+    // A method the stub doesn't know
+    WireWriter unknown;
+    unknown.PutUInt32(99);
+    WireReader reply;
+    CHECK(channel.Call(unknown, &reply) == RPC_E_INVALID_DATA);
+}
+
+int main()
+{
+    TestScalars();
+    TestBstrs();
+    TestBstrArrays();
+    TestWriterBuffers();
+    TestMalformed();
+    TestProxyStub();
+    return CHECK_RESULT();
+}
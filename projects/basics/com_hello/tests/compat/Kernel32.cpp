@@ -0,0 +1,818 @@
+#include "Windows.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Kernel objects. A HANDLE is the object itself, with a reference for every handle open
+// to it. One lock and one condition variable serve every object: waits are rare in what
+// runs here, and a wait on several objects needs nothing more.
+namespace
+{
+enum KernelKind
+{
+    KernelEvent,
+    KernelThread,
+    KernelProcess,
+    KernelJob,
+    KernelFile,
+    KernelSection,
+};
+
+struct KernelObject
+{
+    KernelKind kind;
+    LONG refs;                  // under s_lock
+    std::string name;           // empty if it has none
+
+    // Events, and threads, which are signaled once they have exited
+    bool manualReset;
+    bool signaled;
+
+    // Processes, and the thread of a suspended process, whose 'fd' resumes it
+    pid_t pid;
+    bool child;                 // we started it, and reap it
+    bool started;
+
+    // Jobs
+    bool killOnClose;
+    std::vector<pid_t> pids;
+
+    // Files, and sections, of the file or of a memory file
+    int fd;
+    size_t size;
+
+    explicit KernelObject(KernelKind k)
+        : kind(k), refs(1), manualReset(false), signaled(false), pid(0), child(false), started(false), killOnClose(false), fd(-1), size(0)
+    {
+    }
+    ~KernelObject()
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        if (killOnClose)
+        {
+            for (pid_t p : pids)
+            {
+                kill(p, SIGKILL);
+            }
+        }
+        if (child)
+        {
+            waitpid(pid, NULL, WNOHANG);
+        }
+    }
+};
+
+struct View
+{
+    KernelObject* section;
+    size_t size;
+};
+
+std::mutex s_lock;
+std::condition_variable s_signaled;
+std::map<std::string, KernelObject*> s_names;
+std::map<const BYTE*, View> s_views;
+
+void ReleaseLocked(KernelObject* object)
+{
+    if (--object->refs == 0)
+    {
+        if (!object->name.empty())
+        {
+            s_names.erase(object->name);
+        }
+        delete object;
+    }
+}
+
+// Opens the object with the name, or returns NULL with ERROR_FILE_NOT_FOUND
+KernelObject* OpenNamed(KernelKind kind, const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    auto it = (name != NULL) ? s_names.find(name) : s_names.end();
+    if (it == s_names.end())
+    {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return NULL;
+    }
+    if (it->second->kind != kind)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    ++it->second->refs;
+    return it->second;
+}
+
+// Gives the new object its name, or returns the object that has it already, with
+// ERROR_ALREADY_EXISTS, as the Create functions do. Takes the new object either way.
+KernelObject* Name(KernelObject* object, const char* name)
+{
+    SetLastError(ERROR_SUCCESS);
+    if (name == NULL)
+    {
+        return object;
+    }
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    auto it = s_names.find(name);
+    if (it == s_names.end())
+    {
+        object->name = name;
+        s_names[object->name] = object;
+        return object;
+    }
+    bool sameKind = it->second->kind == object->kind;
+    delete object;
+    if (!sameKind)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    ++it->second->refs;
+    SetLastError(ERROR_ALREADY_EXISTS);
+    return it->second;
+}
+
+// A process that has exited but hasn't been reaped yet is a zombie
+bool ProcessExited(const KernelObject* process)
+{
+    if (process->pid == getpid())
+    {
+        return false;
+    }
+    if (kill(process->pid, 0) == -1)
+    {
+        return errno == ESRCH;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(process->pid));
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return true;
+    }
+    char state = 0;
+    int scanned = fscanf(file, "%*d (%*[^)]) %c", &state);
+    fclose(file);
+    return scanned == 1 && state == 'Z';
+}
+
+// Splits a command line the way the CRT does for argv: arguments are separated by blanks,
+// quotes group blanks into an argument, \" is a quote.
+std::vector<std::string> SplitCommandLine(const char* commandLine)
+{
+    std::vector<std::string> arguments;
+    const char* p = commandLine;
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t')
+        {
+            ++p;
+        }
+        if (*p == 0)
+        {
+            return arguments;
+        }
+        std::string argument;
+        bool quoted = false;
+        for (; *p != 0 && (quoted || (*p != ' ' && *p != '\t')); ++p)
+        {
+            if (p[0] == '\\' && p[1] == '"')
+            {
+                argument += '"';
+                ++p;
+            }
+            else if (*p == '"')
+            {
+                quoted = !quoted;
+            }
+            else
+            {
+                argument += *p;
+            }
+        }
+        arguments.push_back(argument);
+    }
+}
+}
+
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer, size, format, args);
+    va_end(args);
+
+    // With _TRUNCATE a string that doesn't fit is cut off, without it nothing is written
+    if (written < 0 || static_cast<size_t>(written) >= size)
+    {
+        if (count != _TRUNCATE && size != 0)
+        {
+            buffer[0] = 0;
+        }
+        return -1;
+    }
+    return written;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+    if (handle == NULL || handle == INVALID_HANDLE_VALUE)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    std::lock_guard<std::mutex> lock(s_lock);
+    ReleaseLocked(static_cast<KernelObject*>(handle));
+    return TRUE;
+}
+
+HANDLE CreateEventA(void*, BOOL manualReset, BOOL initialState, const char* name)
+{
+    KernelObject* event = new (std::nothrow) KernelObject(KernelEvent);
+    if (event == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    event->manualReset = manualReset != FALSE;
+    event->signaled = initialState != FALSE;
+    return Name(event, name);
+}
+
+HANDLE CreateEventW(void* security, BOOL manualReset, BOOL initialState, LPCWSTR name)
+{
+    std::string narrow;
+    for (; name != NULL && *name != 0; ++name)
+    {
+        narrow += static_cast<char>(*name);
+    }
+    return CreateEventA(security, manualReset, initialState, (name != NULL) ? narrow.c_str() : NULL);
+}
+
+HANDLE OpenEventA(DWORD, BOOL, const char* name)
+{
+    return OpenNamed(KernelEvent, name);
+}
+
+static BOOL SetEventState(HANDLE handle, bool signaled)
+{
+    KernelObject* event = static_cast<KernelObject*>(handle);
+    if (event == NULL || event->kind != KernelEvent)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    std::lock_guard<std::mutex> lock(s_lock);
+    event->signaled = signaled;
+    if (signaled)
+    {
+        s_signaled.notify_all();
+    }
+    return TRUE;
+}
+
+BOOL SetEvent(HANDLE event)
+{
+    return SetEventState(event, true);
+}
+
+BOOL ResetEvent(HANDLE event)
+{
+    return SetEventState(event, false);
+}
+
+struct ThreadStart
+{
+    KernelObject* thread;
+    LPTHREAD_START_ROUTINE start;
+    LPVOID parameter;
+};
+
+// The thread holds a reference to its handle's object until it has signaled it
+HANDLE CreateThread(void*, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID parameter, DWORD, DWORD* threadId)
+{
+    KernelObject* thread = new (std::nothrow) KernelObject(KernelThread);
+    if (thread == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    thread->manualReset = true;
+    thread->refs = 2;
+    ThreadStart run = { thread, start, parameter };
+    try
+    {
+        std::thread([run]()
+        {
+            run.start(run.parameter);
+            std::lock_guard<std::mutex> lock(s_lock);
+            run.thread->signaled = true;
+            s_signaled.notify_all();
+            ReleaseLocked(run.thread);
+        }).detach();
+    }
+    catch (...)
+    {
+        delete thread;
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    if (threadId != NULL)
+    {
+        *threadId = 0;
+    }
+    return thread;
+}
+
+// A suspended process waits for a byte on a pipe before it runs the executable. Handles are
+// never inherited: the child closes every file but the standard ones. Only what is safe
+// after fork runs in the child.
+BOOL CreateProcessA(const char* application, char* commandLine, void*, void*, BOOL, DWORD flags, void*, const char* directory,
+                    STARTUPINFOA*, PROCESS_INFORMATION* info)
+{
+    std::vector<std::string> arguments = SplitCommandLine((commandLine != NULL) ? commandLine : application);
+    if (application == NULL && !arguments.empty())
+    {
+        application = arguments[0].c_str();
+    }
+    std::vector<char*> argv;
+    for (std::string& argument : arguments)
+    {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(NULL);
+
+    KernelObject* process = new (std::nothrow) KernelObject(KernelProcess);
+    KernelObject* thread = new (std::nothrow) KernelObject(KernelThread);
+    int resume[2] = { -1, -1 };
+    if (process == NULL || thread == NULL || application == NULL || pipe2(resume, O_CLOEXEC) != 0)
+    {
+        delete process;
+        delete thread;
+        SetLastError(application == NULL ? ERROR_INVALID_PARAMETER : ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
+    int files = static_cast<int>(sysconf(_SC_OPEN_MAX));
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        for (int fd = 3; fd < files; ++fd)
+        {
+            if (fd != resume[0])
+            {
+                close(fd);
+            }
+        }
+        char go = 0;
+        if ((flags & CREATE_SUSPENDED) && read(resume[0], &go, 1) != 1)
+        {
+            _exit(1);
+        }
+        if (directory != NULL && chdir(directory) != 0)
+        {
+            _exit(127);
+        }
+        execv(application, argv.data());
+        _exit(127);
+    }
+    close(resume[0]);
+    if (pid == -1)
+    {
+        close(resume[1]);
+        delete process;
+        delete thread;
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
+    process->pid = pid;
+    process->child = true;
+    thread->pid = pid;
+    thread->fd = resume[1];
+    if (!(flags & CREATE_SUSPENDED))
+    {
+        ResumeThread(thread);
+    }
+    info->hProcess = process;
+    info->hThread = thread;
+    info->dwProcessId = static_cast<DWORD>(pid);
+    info->dwThreadId = static_cast<DWORD>(pid);
+    return TRUE;
+}
+
+// Only the thread of a suspended process can be resumed
+DWORD ResumeThread(HANDLE handle)
+{
+    KernelObject* thread = static_cast<KernelObject*>(handle);
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (thread == NULL || thread->kind != KernelThread || thread->fd == -1)
+    {
+        return (thread != NULL && thread->kind == KernelThread) ? 0 : static_cast<DWORD>(-1);
+    }
+    char go = 1;
+    ssize_t written = write(thread->fd, &go, 1);
+    close(thread->fd);
+    thread->fd = -1;
+    return (written == 1) ? 1 : static_cast<DWORD>(-1);
+}
+
+BOOL TerminateProcess(HANDLE handle, UINT)
+{
+    KernelObject* process = static_cast<KernelObject*>(handle);
+    if (process == NULL || process->kind != KernelProcess || kill(process->pid, SIGKILL) != 0)
+    {
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+HANDLE CreateJobObjectA(void*, const char* name)
+{
+    KernelObject* job = new (std::nothrow) KernelObject(KernelJob);
+    if (job == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    return Name(job, name);
+}
+
+BOOL SetInformationJobObject(HANDLE handle, JOBOBJECTINFOCLASS infoClass, void* info, DWORD cbInfo)
+{
+    KernelObject* job = static_cast<KernelObject*>(handle);
+    if (job == NULL || job->kind != KernelJob || infoClass != JobObjectExtendedLimitInformation ||
+        cbInfo < sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    std::lock_guard<std::mutex> lock(s_lock);
+    job->killOnClose = (static_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION*>(info)->BasicLimitInformation.LimitFlags &
+                        JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE) != 0;
+    return TRUE;
+}
+
+BOOL AssignProcessToJobObject(HANDLE jobHandle, HANDLE processHandle)
+{
+    KernelObject* job = static_cast<KernelObject*>(jobHandle);
+    KernelObject* process = static_cast<KernelObject*>(processHandle);
+    if (job == NULL || job->kind != KernelJob || process == NULL || process->kind != KernelProcess)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    std::lock_guard<std::mutex> lock(s_lock);
+    job->pids.push_back(process->pid);
+    return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    return WaitForMultipleObjects(1, &handle, FALSE, milliseconds);
+}
+
+// Only for one of the objects. A process of our own never exits while we wait; another
+// one can't signal us, so we look at it every few milliseconds.
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds)
+{
+    if (count == 0 || waitAll)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return WAIT_FAILED;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    std::unique_lock<std::mutex> lock(s_lock);
+    for (;;)
+    {
+        bool polling = false;
+        for (DWORD i = 0; i < count; ++i)
+        {
+            KernelObject* object = static_cast<KernelObject*>(handles[i]);
+            if (object == NULL || object == INVALID_HANDLE_VALUE || object->kind == KernelSection || object->kind == KernelJob)
+            {
+                SetLastError(ERROR_INVALID_HANDLE);
+                return WAIT_FAILED;
+            }
+            if ((object->kind == KernelEvent || object->kind == KernelThread) && object->signaled)
+            {
+                object->signaled = object->manualReset;
+                return WAIT_OBJECT_0 + i;
+            }
+            if (object->kind == KernelProcess)
+            {
+                if (ProcessExited(object))
+                {
+                    return WAIT_OBJECT_0 + i;
+                }
+                polling = polling || object->pid != getpid();
+            }
+        }
+
+        if (milliseconds == 0)
+        {
+            return WAIT_TIMEOUT;
+        }
+        auto until = polling ? std::chrono::steady_clock::now() + std::chrono::milliseconds(10) : deadline;
+        if (milliseconds != INFINITE && until > deadline)
+        {
+            until = deadline;
+        }
+        if (milliseconds == INFINITE && !polling)
+        {
+            s_signaled.wait(lock);
+        }
+        else if (s_signaled.wait_until(lock, until) == std::cv_status::timeout && milliseconds != INFINITE &&
+                 std::chrono::steady_clock::now() >= deadline)
+        {
+            return WAIT_TIMEOUT;
+        }
+    }
+}
+
+DWORD GetCurrentProcessId()
+{
+    return static_cast<DWORD>(getpid());
+}
+
+HANDLE OpenProcess(DWORD, BOOL, DWORD processId)
+{
+    KernelObject* process = new (std::nothrow) KernelObject(KernelProcess);
+    if (process == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    process->pid = static_cast<pid_t>(processId);
+    if (processId == 0 || ProcessExited(process))
+    {
+        delete process;
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    return process;
+}
+
+DWORD GetTempPathA(DWORD size, char* path)
+{
+    const char* temp = getenv("TMPDIR");
+    std::string folder = (temp != NULL && temp[0] != 0) ? temp : "/tmp";
+    if (folder.back() != '/')
+    {
+        folder += '/';
+    }
+    if (folder.size() >= size)
+    {
+        return static_cast<DWORD>(folder.size() + 1);
+    }
+    memcpy(path, folder.c_str(), folder.size() + 1);
+    return static_cast<DWORD>(folder.size());
+}
+
+// Files are opened for reading or for writing, never both, which is all that is needed
+HANDLE CreateFileW(LPCWSTR path, DWORD access, DWORD, void*, DWORD disposition, DWORD, HANDLE)
+{
+    std::string narrow;
+    for (; *path != 0; ++path)
+    {
+        narrow += (*path < 0x80) ? static_cast<char>(*path) : '?';
+    }
+    int flags = (access & GENERIC_WRITE) ? O_WRONLY : O_RDONLY;
+    if (disposition == CREATE_ALWAYS)
+    {
+        flags |= O_CREAT | O_TRUNC;
+    }
+
+    KernelObject* file = new (std::nothrow) KernelObject(KernelFile);
+    if (file == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return INVALID_HANDLE_VALUE;
+    }
+    file->fd = open(narrow.c_str(), flags | O_CLOEXEC, 0644);
+    if (file->fd == -1)
+    {
+        SetLastError((errno == ENOENT) ? ERROR_FILE_NOT_FOUND : ERROR_ACCESS_DENIED);
+        delete file;
+        return INVALID_HANDLE_VALUE;
+    }
+    return file;
+}
+
+BOOL GetFileSizeEx(HANDLE handle, LARGE_INTEGER* size)
+{
+    KernelObject* file = static_cast<KernelObject*>(handle);
+    struct stat status;
+    if (file == NULL || file == INVALID_HANDLE_VALUE || file->kind != KernelFile || fstat(file->fd, &status) != 0)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    size->QuadPart = status.st_size;
+    return TRUE;
+}
+
+BOOL WriteFile(HANDLE handle, const void* buffer, DWORD cb, DWORD* written, void*)
+{
+    KernelObject* file = static_cast<KernelObject*>(handle);
+    if (file == NULL || file == INVALID_HANDLE_VALUE || file->kind != KernelFile)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    ssize_t cbWritten = write(file->fd, buffer, cb);
+    if (cbWritten == -1)
+    {
+        SetLastError((errno == EBADF) ? ERROR_ACCESS_DENIED : ERROR_WRITE_FAULT);
+        return FALSE;
+    }
+    *written = static_cast<DWORD>(cbWritten);
+    return TRUE;
+}
+
+BOOL DeleteFileA(const char* path)
+{
+    if (unlink(path) != 0)
+    {
+        SetLastError((errno == ENOENT) ? ERROR_FILE_NOT_FOUND : ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Sections of a file share its descriptor, and are as large as the file unless a size is
+// given. Sections backed by the paging file are memory files here.
+HANDLE CreateFileMappingA(HANDLE handle, void*, DWORD, DWORD sizeHigh, DWORD sizeLow, const char* name)
+{
+    KernelObject* file = (handle != INVALID_HANDLE_VALUE) ? static_cast<KernelObject*>(handle) : NULL;
+    if (handle == NULL || (file != NULL && file->kind != KernelFile))
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    if (name != NULL)
+    {
+        // An existing section is opened, whatever size it was asked for
+        KernelObject* existing = OpenNamed(KernelSection, name);
+        if (existing != NULL)
+        {
+            SetLastError(ERROR_ALREADY_EXISTS);
+            return existing;
+        }
+    }
+
+    KernelObject* section = new (std::nothrow) KernelObject(KernelSection);
+    if (section == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    section->size = (static_cast<size_t>(sizeHigh) << 32) | sizeLow;
+    if (file != NULL)
+    {
+        LARGE_INTEGER fileSize;
+        section->fd = fcntl(file->fd, F_DUPFD_CLOEXEC, 0);
+        if (section->fd == -1 || !GetFileSizeEx(file, &fileSize))
+        {
+            delete section;
+            SetLastError(ERROR_INVALID_HANDLE);
+            return NULL;
+        }
+        if (section->size == 0)
+        {
+            section->size = static_cast<size_t>(fileSize.QuadPart);
+        }
+    }
+    else
+    {
+        section->fd = memfd_create("section", MFD_CLOEXEC);
+        if (section->fd == -1 || ftruncate(section->fd, static_cast<off_t>(section->size)) != 0)
+        {
+            delete section;
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return NULL;
+        }
+    }
+    return Name(section, name);
+}
+
+HANDLE CreateFileMappingW(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, LPCWSTR name)
+{
+    std::string narrow;
+    for (; name != NULL && *name != 0; ++name)
+    {
+        narrow += static_cast<char>(*name);
+    }
+    return CreateFileMappingA(file, security, protect, sizeHigh, sizeLow, (name != NULL) ? narrow.c_str() : NULL);
+}
+
+HANDLE OpenFileMappingA(DWORD, BOOL, const char* name)
+{
+    return OpenNamed(KernelSection, name);
+}
+
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size)
+{
+    KernelObject* section = static_cast<KernelObject*>(mapping);
+    size_t offset = (static_cast<size_t>(offsetHigh) << 32) | offsetLow;
+    if (section == NULL || section->kind != KernelSection || offset > section->size)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    if (size == 0)
+    {
+        size = section->size - offset;
+    }
+
+    int protection = (access & FILE_MAP_WRITE) ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* view = mmap(NULL, size, protection, MAP_SHARED, section->fd, static_cast<off_t>(offset));
+    if (view == MAP_FAILED)
+    {
+        SetLastError(ERROR_ACCESS_DENIED);
+        return NULL;
+    }
+
+    // The view keeps the section, as on Windows
+    std::lock_guard<std::mutex> lock(s_lock);
+    ++section->refs;
+    View& entry = s_views[static_cast<const BYTE*>(view)];
+    entry.section = section;
+    entry.size = size;
+    return view;
+}
+
+BOOL UnmapViewOfFile(const void* base)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    auto it = s_views.find(static_cast<const BYTE*>(base));
+    if (it == s_views.end())
+    {
+        SetLastError(ERROR_INVALID_ADDRESS);
+        return FALSE;
+    }
+    munmap(const_cast<void*>(base), it->second.size);
+    ReleaseLocked(it->second.section);
+    s_views.erase(it);
+    return TRUE;
+}
+
+// Describes the pages of a view from the one with the address to the view's end. Anything
+// else isn't known here and returns 0.
+SIZE_T VirtualQuery(const void* address, MEMORY_BASIC_INFORMATION* info, SIZE_T length)
+{
+    if (length < sizeof(MEMORY_BASIC_INFORMATION))
+    {
+        SetLastError(ERROR_BAD_LENGTH);
+        return 0;
+    }
+
+    const BYTE* p = static_cast<const BYTE*>(address);
+    std::lock_guard<std::mutex> lock(s_lock);
+    auto it = s_views.upper_bound(p);
+    if (it == s_views.begin())
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+    --it;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t pages = (it->second.size + page - 1) & ~(page - 1);
+    if (p >= it->first + pages)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+
+    const BYTE* start = it->first + ((p - it->first) & ~(page - 1));
+    info->BaseAddress = const_cast<BYTE*>(start);
+    info->AllocationBase = const_cast<BYTE*>(it->first);
+    info->AllocationProtect = PAGE_READWRITE;
+    info->RegionSize = static_cast<SIZE_T>(it->first + pages - start);
+    info->State = MEM_COMMIT;
+    info->Protect = PAGE_READWRITE;
+    info->Type = MEM_MAPPED;
+    return sizeof(MEMORY_BASIC_INFORMATION);
+}
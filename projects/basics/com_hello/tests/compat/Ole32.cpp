@@ -0,0 +1,459 @@
+#include "Windows.h"
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <new>
+
+// The apartment of the thread, as CoInitializeEx left it
+struct Apartment
+{
+    APTTYPE type;
+    ULONG inits;
+};
+
+static thread_local Apartment t_apartment = { APTTYPE_CURRENT, 0 };
+static LONG s_mtaUsage = 0;
+
+HRESULT CoInitializeEx(LPVOID, DWORD coInit)
+{
+    APTTYPE type = (coInit & COINIT_APARTMENTTHREADED) ? APTTYPE_STA : APTTYPE_MTA;
+    if (t_apartment.inits == 0)
+    {
+        t_apartment.type = type;
+        t_apartment.inits = 1;
+        return S_OK;
+    }
+    if (t_apartment.type != type)
+    {
+        return RPC_E_CHANGED_MODE;
+    }
+    ++t_apartment.inits;
+    return S_FALSE;
+}
+
+void CoUninitialize()
+{
+    if (t_apartment.inits > 0 && --t_apartment.inits == 0)
+    {
+        t_apartment.type = APTTYPE_CURRENT;
+    }
+}
+
+HRESULT CoGetApartmentType(APTTYPE* type, APTTYPEQUALIFIER* qualifier)
+{
+    if (type == NULL || qualifier == NULL)
+    {
+        return E_INVALIDARG;
+    }
+    *qualifier = APTTYPEQUALIFIER_NONE;
+    if (t_apartment.inits > 0)
+    {
+        *type = t_apartment.type;
+        return S_OK;
+    }
+    if (__atomic_load_n(&s_mtaUsage, __ATOMIC_ACQUIRE) > 0)
+    {
+        *type = APTTYPE_MTA;
+        *qualifier = APTTYPEQUALIFIER_IMPLICIT_MTA;
+        return S_OK;
+    }
+    *type = APTTYPE_CURRENT;
+    return CO_E_NOTINITIALIZED;
+}
+
+HRESULT CoIncrementMTAUsage(CO_MTA_USAGE_COOKIE* cookie)
+{
+    if (cookie == NULL)
+    {
+        return E_INVALIDARG;
+    }
+    InterlockedIncrement(&s_mtaUsage);
+    *cookie = reinterpret_cast<CO_MTA_USAGE_COOKIE>(&s_mtaUsage);
+    return S_OK;
+}
+
+HRESULT CoDecrementMTAUsage(CO_MTA_USAGE_COOKIE cookie)
+{
+    if (cookie != reinterpret_cast<CO_MTA_USAGE_COOKIE>(&s_mtaUsage))
+    {
+        return E_INVALIDARG;
+    }
+    InterlockedDecrement(&s_mtaUsage);
+    return S_OK;
+}
+
+static bool InApartment()
+{
+    APTTYPE type;
+    APTTYPEQUALIFIER qualifier;
+    return SUCCEEDED(CoGetApartmentType(&type, &qualifier));
+}
+
+// The global interface table. With nothing to marshal, every thread gets the pointer that
+// was registered.
+class GlobalInterfaceTable : public IGlobalInterfaceTable
+{
+    std::mutex m_lock;
+    std::map<DWORD, IUnknown*> m_entries;
+    DWORD m_nextCookie = 0x100;
+
+public:
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (ppv == NULL)
+        {
+            return E_POINTER;
+        }
+        if (riid == IID_IUnknown || riid == IID_IGlobalInterfaceTable)
+        {
+            *ppv = static_cast<IGlobalInterfaceTable*>(this);
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    // One object per process, never freed
+    ULONG __stdcall AddRef() { return 2; }
+    ULONG __stdcall Release() { return 1; }
+
+    HRESULT __stdcall RegisterInterfaceInGlobal(IUnknown* pUnk, REFIID, DWORD* pdwCookie)
+    {
+        if (pUnk == NULL || pdwCookie == NULL)
+        {
+            return E_INVALIDARG;
+        }
+        pUnk->AddRef();
+        std::lock_guard<std::mutex> lock(m_lock);
+        *pdwCookie = m_nextCookie++;
+        m_entries[*pdwCookie] = pUnk;
+        return S_OK;
+    }
+
+    HRESULT __stdcall RevokeInterfaceFromGlobal(DWORD dwCookie)
+    {
+        IUnknown* pUnk = NULL;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            std::map<DWORD, IUnknown*>::iterator entry = m_entries.find(dwCookie);
+            if (entry == m_entries.end())
+            {
+                return E_INVALIDARG;
+            }
+            pUnk = entry->second;
+            m_entries.erase(entry);
+        }
+        pUnk->Release();
+        return S_OK;
+    }
+
+    HRESULT __stdcall GetInterfaceFromGlobal(DWORD dwCookie, REFIID riid, void** ppv)
+    {
+        if (ppv == NULL)
+        {
+            return E_INVALIDARG;
+        }
+        *ppv = NULL;
+        if (!InApartment())
+        {
+            return CO_E_NOTINITIALIZED;
+        }
+        IUnknown* pUnk = NULL;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            std::map<DWORD, IUnknown*>::iterator entry = m_entries.find(dwCookie);
+            if (entry == m_entries.end())
+            {
+                return E_INVALIDARG;
+            }
+            pUnk = entry->second;
+            pUnk->AddRef();
+        }
+        HRESULT hr = pUnk->QueryInterface(riid, ppv);
+        pUnk->Release();
+        return hr;
+    }
+};
+
+// The manual reset event, aggregatable as the call objects of COM aggregate it
+class ManualResetEvent : public ISynchronize
+{
+    // The non-delegating IUnknown
+    class Inner : public IUnknown
+    {
+        ManualResetEvent* m_pEvent;
+
+    public:
+        explicit Inner(ManualResetEvent* pEvent) : m_pEvent(pEvent) {}
+        HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+        {
+            if (ppv == NULL)
+            {
+                return E_POINTER;
+            }
+            if (riid == IID_IUnknown)
+            {
+                *ppv = static_cast<IUnknown*>(this);
+            }
+            else if (riid == IID_ISynchronize)
+            {
+                *ppv = static_cast<ISynchronize*>(m_pEvent);
+            }
+            else
+            {
+                *ppv = NULL;
+                return E_NOINTERFACE;
+            }
+            reinterpret_cast<IUnknown*>(*ppv)->AddRef();
+            return S_OK;
+        }
+        ULONG __stdcall AddRef() { return InterlockedIncrement(&m_pEvent->m_cRef); }
+        ULONG __stdcall Release()
+        {
+            LONG cRef = InterlockedDecrement(&m_pEvent->m_cRef);
+            if (cRef == 0)
+            {
+                delete m_pEvent;
+            }
+            return cRef;
+        }
+    } m_inner;
+
+    LONG m_cRef;
+    IUnknown* m_pUnkOuter;
+    std::mutex m_lock;
+    std::condition_variable m_signaled;
+    bool m_set;
+
+public:
+    explicit ManualResetEvent(IUnknown* pUnkOuter)
+        : m_inner(this), m_cRef(1), m_pUnkOuter(pUnkOuter ? pUnkOuter : &m_inner), m_set(false)
+    {
+    }
+
+    IUnknown* Inner() { return &m_inner; }
+
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) { return m_pUnkOuter->QueryInterface(riid, ppv); }
+    ULONG __stdcall AddRef() { return m_pUnkOuter->AddRef(); }
+    ULONG __stdcall Release() { return m_pUnkOuter->Release(); }
+
+    HRESULT __stdcall Wait(DWORD, DWORD dwMilliseconds)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (dwMilliseconds == INFINITE)
+        {
+            m_signaled.wait(lock, [this] { return m_set; });
+            return S_OK;
+        }
+        return m_signaled.wait_for(lock, std::chrono::milliseconds(dwMilliseconds), [this] { return m_set; }) ? S_OK : RPC_S_CALLPENDING;
+    }
+
+    HRESULT __stdcall Signal()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_set = true;
+        m_signaled.notify_all();
+        return S_OK;
+    }
+
+    HRESULT __stdcall Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_set = false;
+        return S_OK;
+    }
+};
+
+HRESULT CoCreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, DWORD, REFIID riid, void** ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppv = NULL;
+    if (clsid == CLSID_StdGlobalInterfaceTable)
+    {
+        if (pUnkOuter != NULL)
+        {
+            return CLASS_E_NOAGGREGATION;
+        }
+        static GlobalInterfaceTable* s_pTable = new GlobalInterfaceTable;
+        return s_pTable->QueryInterface(riid, ppv);
+    }
+    if (clsid == CLSID_ManualResetEvent)
+    {
+        if (pUnkOuter != NULL && riid != IID_IUnknown)
+        {
+            return CLASS_E_NOAGGREGATION;
+        }
+        ManualResetEvent* pEvent = new (std::nothrow) ManualResetEvent(pUnkOuter);
+        if (pEvent == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        HRESULT hr = pEvent->Inner()->QueryInterface(riid, ppv);
+        pEvent->Inner()->Release();
+        return hr;
+    }
+    return REGDB_E_CLASSNOTREG;
+}
+
+// The free-threaded marshaler, made to be aggregated: the outer object hands out its
+// IMarshal, which is the outer object's identity
+class FreeThreadedMarshaler : public IUnknown
+{
+    class Marshal : public IMarshal
+    {
+        IUnknown* m_pUnkOuter;
+
+    public:
+        explicit Marshal(IUnknown* pUnkOuter) : m_pUnkOuter(pUnkOuter) {}
+        HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) { return m_pUnkOuter->QueryInterface(riid, ppv); }
+        ULONG __stdcall AddRef() { return m_pUnkOuter->AddRef(); }
+        ULONG __stdcall Release() { return m_pUnkOuter->Release(); }
+
+        HRESULT __stdcall GetUnmarshalClass(REFIID, void*, DWORD, void*, DWORD, CLSID* pCid)
+        {
+            *pCid = CLSID_InProcFreeMarshaler;
+            return S_OK;
+        }
+    } m_marshal;
+
+    LONG m_cRef;
+
+public:
+    explicit FreeThreadedMarshaler(IUnknown* pUnkOuter) : m_marshal(pUnkOuter), m_cRef(1) {}
+
+    // The non-delegating IUnknown
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (ppv == NULL)
+        {
+            return E_POINTER;
+        }
+        if (riid == IID_IUnknown)
+        {
+            *ppv = static_cast<IUnknown*>(this);
+        }
+        else if (riid == IID_IMarshal)
+        {
+            *ppv = static_cast<IMarshal*>(&m_marshal);
+        }
+        else
+        {
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+        reinterpret_cast<IUnknown*>(*ppv)->AddRef();
+        return S_OK;
+    }
+
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+    ULONG __stdcall Release()
+    {
+        LONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+};
+
+HRESULT CoCreateFreeThreadedMarshaler(IUnknown* pUnkOuter, IUnknown** ppUnkMarshal)
+{
+    if (ppUnkMarshal == NULL)
+    {
+        return E_POINTER;
+    }
+    *ppUnkMarshal = new (std::nothrow) FreeThreadedMarshaler(pUnkOuter);
+    return (*ppUnkMarshal != NULL) ? S_OK : E_OUTOFMEMORY;
+}
+
+// A type library with an empty type info for every GUID. The type info keeps the library
+// alive, as OLE's do.
+class TypeLib : public ITypeLib
+{
+    class TypeInfo : public ITypeInfo
+    {
+        LONG m_cRef;
+        TypeLib* m_pTypeLib;
+
+    public:
+        explicit TypeInfo(TypeLib* pTypeLib) : m_cRef(1), m_pTypeLib(pTypeLib) { m_pTypeLib->AddRef(); }
+        ~TypeInfo() { m_pTypeLib->Release(); }
+
+        HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+        {
+            if (riid != IID_IUnknown)
+            {
+                *ppv = NULL;
+                return E_NOINTERFACE;
+            }
+            *ppv = this;
+            AddRef();
+            return S_OK;
+        }
+        ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+        ULONG __stdcall Release()
+        {
+            LONG cRef = InterlockedDecrement(&m_cRef);
+            if (cRef == 0)
+            {
+                delete this;
+            }
+            return cRef;
+        }
+    };
+
+    LONG m_cRef = 1;
+
+public:
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv)
+    {
+        if (riid != IID_IUnknown)
+        {
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+        *ppv = this;
+        AddRef();
+        return S_OK;
+    }
+    ULONG __stdcall AddRef() { return InterlockedIncrement(&m_cRef); }
+    ULONG __stdcall Release()
+    {
+        LONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    HRESULT __stdcall GetTypeInfoOfGuid(REFGUID, ITypeInfo** ppTInfo)
+    {
+        *ppTInfo = new (std::nothrow) TypeInfo(this);
+        return (*ppTInfo != NULL) ? S_OK : E_OUTOFMEMORY;
+    }
+};
+
+HRESULT LoadTypeLibEx(LPCWSTR path, REGKIND, ITypeLib** ppTLib)
+{
+    *ppTLib = NULL;
+    char narrow[MAX_PATH * 4];
+    if (path == NULL || wcstombs(narrow, path, sizeof(narrow)) >= sizeof(narrow) || access(narrow, R_OK) != 0)
+    {
+        return TYPE_E_CANTLOADLIBRARY;
+    }
+    *ppTLib = new (std::nothrow) TypeLib;
+    return (*ppTLib != NULL) ? S_OK : E_OUTOFMEMORY;
+}
+
+HRESULT LoadRegTypeLib(REFGUID, WORD, WORD, LCID, ITypeLib** ppTLib)
+{
+    *ppTLib = NULL;
+    return TYPE_E_CANTLOADLIBRARY;
+}
@@ -0,0 +1,391 @@
+#include "Windows.h"
+#include <execinfo.h>
+#include <linux/membarrier.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+void GetSystemInfo(SYSTEM_INFO* info)
+{
+    unsigned processors = std::thread::hardware_concurrency();
+    info->dwNumberOfProcessors = (processors > 0) ? processors : 1;
+}
+
+void Sleep(DWORD milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+BOOL SwitchToThread()
+{
+    return sched_yield() == 0;
+}
+
+void YieldProcessor()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static LONG64 s_flushes = 0;
+
+LONG64 CompatFlushProcessWriteBuffersCount()
+{
+    return __atomic_load_n(&s_flushes, __ATOMIC_RELAXED);
+}
+
+// Interrupts every processor that runs a thread of the process, which drains its store
+// buffer, with the private expedited membarrier. Kernels without it get the same from the
+// TLB shootdown of taking a page away.
+void FlushProcessWriteBuffers()
+{
+    InterlockedExchangeAdd64(&s_flushes, 1);
+    static const bool s_membarrier = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+    if (s_membarrier && syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0)
+    {
+        return;
+    }
+
+    static std::mutex s_lock;
+    static void* s_page = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    std::lock_guard<std::mutex> lock(s_lock);
+    mprotect(s_page, 4096, PROT_READ | PROT_WRITE);
+    *static_cast<volatile char*>(s_page) = 0;
+    mprotect(s_page, 4096, PROT_NONE);
+}
+
+// Waiting on an address: the waiters of every address sleep on one of a few condition
+// variables, found by hashing the address. The value is compared under the lock the waker
+// takes, so a wake can't slip in between the compare and the wait.
+struct AddressWaiters
+{
+    std::mutex lock;
+    std::condition_variable changed;
+};
+
+static AddressWaiters s_addressWaiters[64];
+
+static AddressWaiters& WaitersOf(const volatile void* address)
+{
+    uintptr_t value = reinterpret_cast<uintptr_t>(address);
+    return s_addressWaiters[(value >> 3) % ARRAYSIZE(s_addressWaiters)];
+}
+
+BOOL WaitOnAddress(volatile void* address, PVOID compareAddress, SIZE_T addressSize, DWORD milliseconds)
+{
+    AddressWaiters& waiters = WaitersOf(address);
+    std::unique_lock<std::mutex> lock(waiters.lock);
+    if (memcmp(const_cast<const void*>(address), compareAddress, addressSize) != 0)
+    {
+        return TRUE;
+    }
+    if (milliseconds == INFINITE)
+    {
+        waiters.changed.wait(lock);
+        return TRUE;
+    }
+    return waiters.changed.wait_for(lock, std::chrono::milliseconds(milliseconds)) == std::cv_status::no_timeout;
+}
+
+// Wakes every thread that waits on an address with the same hash; they compare again
+void WakeByAddressSingle(PVOID address)
+{
+    WakeByAddressAll(address);
+}
+
+void WakeByAddressAll(PVOID address)
+{
+    AddressWaiters& waiters = WaitersOf(address);
+    std::lock_guard<std::mutex> lock(waiters.lock);
+    waiters.changed.notify_all();
+}
+
+// A CONDITION_VARIABLE counts the wakes. A sleeper reads the count before it lets go of the
+// lock and waits for it to change, so no wake after that gets lost. Every wake wakes all.
+static uintptr_t* WakeCount(CONDITION_VARIABLE* condition)
+{
+    return reinterpret_cast<uintptr_t*>(&condition->Ptr);
+}
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition)
+{
+    condition->Ptr = NULL;
+}
+
+BOOL SleepConditionVariableSRW(CONDITION_VARIABLE* condition, SRWLOCK* lock, DWORD milliseconds, ULONG flags)
+{
+    uintptr_t seen = __atomic_load_n(WakeCount(condition), __ATOMIC_ACQUIRE);
+    bool shared = (flags & CONDITION_VARIABLE_LOCKMODE_SHARED) != 0;
+    shared ? ReleaseSRWLockShared(lock) : ReleaseSRWLockExclusive(lock);
+    BOOL woken = WaitOnAddress(WakeCount(condition), &seen, sizeof(seen), milliseconds);
+    shared ? AcquireSRWLockShared(lock) : AcquireSRWLockExclusive(lock);
+    if (!woken)
+    {
+        SetLastError(ERROR_TIMEOUT);
+    }
+    return woken;
+}
+
+void WakeConditionVariable(CONDITION_VARIABLE* condition)
+{
+    WakeAllConditionVariable(condition);
+}
+
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition)
+{
+    __atomic_add_fetch(WakeCount(condition), 1, __ATOMIC_RELEASE);
+    WakeByAddressAll(WakeCount(condition));
+}
+
+// The performance counter counts nanoseconds
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+    frequency->QuadPart = 1000000000;
+    return TRUE;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count)
+{
+    count->QuadPart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return TRUE;
+}
+
+ULONGLONG GetTickCount64()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+WORD CaptureStackBackTrace(DWORD framesToSkip, DWORD framesToCapture, PVOID* backTrace, DWORD* backTraceHash)
+{
+    // Our own frame on top of what the caller wants to skip
+    void* frames[128];
+    int count = backtrace(frames, ARRAYSIZE(frames));
+    DWORD skip = framesToSkip + 1;
+    WORD captured = 0;
+    for (DWORD i = skip; i < static_cast<DWORD>(count) && captured < framesToCapture; ++i)
+    {
+        backTrace[captured++] = frames[i];
+    }
+    if (backTraceHash != NULL)
+    {
+        DWORD hash = 0;
+        for (WORD i = 0; i < captured; ++i)
+        {
+            hash += static_cast<DWORD>(reinterpret_cast<uintptr_t>(backTrace[i]));
+        }
+        *backTraceHash = hash;
+    }
+    return captured;
+}
+
+// A callback waiting for a thread
+struct PoolItem
+{
+    void (*run)(void* callback, void* context);
+    void* callback;
+    void* context;
+};
+
+struct TP_POOL
+{
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<PoolItem> items;
+    DWORD maximum = 500;
+    DWORD threads = 0;
+    DWORD idle = 0;
+    bool closed = false;
+};
+
+struct TP_WORK
+{
+    PTP_WORK_CALLBACK callback;
+    PVOID context;
+    PTP_POOL pool;
+    std::mutex lock;
+    std::condition_variable done;
+    LONG refs;          // the handle, and one for every submission that hasn't returned
+    LONG pending;       // submissions that haven't returned
+};
+
+static PTP_POOL DefaultPool()
+{
+    // Never freed, callbacks may still run while the process exits
+    static PTP_POOL s_pool = new TP_POOL;
+    return s_pool;
+}
+
+static void Worker(PTP_POOL pool)
+{
+    std::unique_lock<std::mutex> lock(pool->lock);
+    for (;;)
+    {
+        while (pool->items.empty() && !pool->closed)
+        {
+            ++pool->idle;
+            pool->wake.wait(lock);
+            --pool->idle;
+        }
+        if (pool->items.empty())
+        {
+            break;
+        }
+        PoolItem item = pool->items.front();
+        pool->items.pop_front();
+        lock.unlock();
+        item.run(item.callback, item.context);
+        lock.lock();
+    }
+
+    // The last thread of a closed pool frees it
+    bool last = (--pool->threads == 0);
+    lock.unlock();
+    if (last)
+    {
+        delete pool;
+    }
+}
+
+// Queues a callback, and starts a thread for it if none is idle
+static BOOL Submit(PTP_POOL pool, const PoolItem& item)
+{
+    std::lock_guard<std::mutex> lock(pool->lock);
+    if (pool->closed)
+    {
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+    pool->items.push_back(item);
+    if (pool->items.size() > pool->idle && pool->threads < pool->maximum)
+    {
+        ++pool->threads;
+        std::thread(Worker, pool).detach();
+    }
+    else
+    {
+        pool->wake.notify_one();
+    }
+    return TRUE;
+}
+
+PTP_POOL CreateThreadpool(PVOID)
+{
+    PTP_POOL pool = new (std::nothrow) TP_POOL;
+    if (pool == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+    }
+    return pool;
+}
+
+void SetThreadpoolThreadMaximum(PTP_POOL pool, DWORD maximum)
+{
+    std::lock_guard<std::mutex> lock(pool->lock);
+    pool->maximum = (maximum > 0) ? maximum : 1;
+}
+
+// The threads run what was queued already, then exit; the last one frees the pool
+void CloseThreadpool(PTP_POOL pool)
+{
+    bool unused;
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        pool->closed = true;
+        pool->wake.notify_all();
+        unused = (pool->threads == 0);
+    }
+    if (unused)
+    {
+        delete pool;
+    }
+}
+
+static void RunSimple(void* callback, void* context)
+{
+    reinterpret_cast<PTP_SIMPLE_CALLBACK>(callback)(NULL, context);
+}
+
+BOOL TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK callback, PVOID context, PTP_CALLBACK_ENVIRON environment)
+{
+    PTP_POOL pool = (environment != NULL && environment->Pool != NULL) ? environment->Pool : DefaultPool();
+    PoolItem item = { RunSimple, reinterpret_cast<void*>(callback), context };
+    return Submit(pool, item);
+}
+
+static void ReleaseWork(PTP_WORK work)
+{
+    std::unique_lock<std::mutex> lock(work->lock);
+    if (--work->refs == 0)
+    {
+        lock.unlock();
+        delete work;
+    }
+}
+
+static void RunWork(void* callback, void* context)
+{
+    PTP_WORK work = static_cast<PTP_WORK>(context);
+    reinterpret_cast<PTP_WORK_CALLBACK>(callback)(NULL, work->context, work);
+    {
+        std::lock_guard<std::mutex> lock(work->lock);
+        if (--work->pending == 0)
+        {
+            work->done.notify_all();
+        }
+    }
+    ReleaseWork(work);
+}
+
+PTP_WORK CreateThreadpoolWork(PTP_WORK_CALLBACK callback, PVOID context, PTP_CALLBACK_ENVIRON environment)
+{
+    PTP_WORK work = new (std::nothrow) TP_WORK;
+    if (work == NULL)
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    work->callback = callback;
+    work->context = context;
+    work->pool = (environment != NULL && environment->Pool != NULL) ? environment->Pool : DefaultPool();
+    work->refs = 1;
+    work->pending = 0;
+    return work;
+}
+
+void SubmitThreadpoolWork(PTP_WORK work)
+{
+    {
+        std::lock_guard<std::mutex> lock(work->lock);
+        ++work->refs;
+        ++work->pending;
+    }
+    PoolItem item = { RunWork, reinterpret_cast<void*>(work->callback), work };
+    if (!Submit(work->pool, item))
+    {
+        {
+            std::lock_guard<std::mutex> lock(work->lock);
+            --work->pending;
+        }
+        ReleaseWork(work);
+    }
+}
+
+// Waits for the callbacks submitted so far; cancelling them isn't supported
+void WaitForThreadpoolWorkCallbacks(PTP_WORK work, BOOL)
+{
+    std::unique_lock<std::mutex> lock(work->lock);
+    work->done.wait(lock, [work] { return work->pending == 0; });
+}
+
+// Freed once the callbacks that were submitted have returned, which may be from one of them
+void CloseThreadpoolWork(PTP_WORK work)
+{
+    ReleaseWork(work);
+}
@@ -0,0 +1,556 @@
+#include "Windows.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <link.h>
+#include <unistd.h>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+const GUID IID_NULL = {};
+const GUID CLSID_NULL = {};
+const IID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IClassFactory = { 0x00000001, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IDispatch = { 0x00020400, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IMarshal = { 0x00000003, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IConnectionPoint = { 0xB196B286, 0xBAB4, 0x101A, { 0xB6, 0x9C, 0x00, 0xAA, 0x00, 0x34, 0x1D, 0x07 } };
+const IID IID_IConnectionPointContainer = { 0xB196B284, 0xBAB4, 0x101A, { 0xB6, 0x9C, 0x00, 0xAA, 0x00, 0x34, 0x1D, 0x07 } };
+const IID IID_IGlobalInterfaceTable = { 0x00000146, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IAgileObject = { 0x94EA2B94, 0xE9CC, 0x49E0, { 0xC0, 0xFF, 0xEE, 0x64, 0xCA, 0x8F, 0x5B, 0x90 } };
+const IID IID_ISynchronize = { 0x00000030, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_ISynchronizeHandle = { 0x00000031, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_ICallFactory = { 0x1C733A30, 0x2A1C, 0x11CE, { 0xAD, 0xE5, 0x00, 0xAA, 0x00, 0x44, 0x77, 0x3D } };
+const IID IID_ICancelMethodCalls = { 0x00000029, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const CLSID CLSID_StdGlobalInterfaceTable = { 0x00000323, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const CLSID CLSID_ManualResetEvent = { 0x0000032C, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const CLSID CLSID_InProcFreeMarshaler = { 0x0000033A, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+static thread_local DWORD t_lastError = 0;
+
+DWORD GetLastError()
+{
+    return t_lastError;
+}
+
+void SetLastError(DWORD error)
+{
+    t_lastError = error;
+}
+
+BSTR SysAllocStringLen(const OLECHAR* s, UINT cch)
+{
+    UINT32 cb = cch * sizeof(OLECHAR);
+    BYTE* block = static_cast<BYTE*>(::operator new(sizeof(UINT32) + cb + sizeof(OLECHAR), std::nothrow));
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    memcpy(block, &cb, sizeof(cb));
+    BSTR bstr = reinterpret_cast<BSTR>(block + sizeof(UINT32));
+    if (s != NULL)
+    {
+        memcpy(bstr, s, cb);
+    }
+    else
+    {
+        memset(bstr, 0, cb);
+    }
+    bstr[cch] = 0;
+    return bstr;
+}
+
+BSTR SysAllocString(const OLECHAR* s)
+{
+    return (s != NULL) ? SysAllocStringLen(s, static_cast<UINT>(wcslen(s))) : NULL;
+}
+
+void SysFreeString(BSTR s)
+{
+    if (s != NULL)
+    {
+        ::operator delete(reinterpret_cast<BYTE*>(s) - sizeof(UINT32));
+    }
+}
+
+UINT SysStringByteLen(BSTR s)
+{
+    if (s == NULL)
+    {
+        return 0;
+    }
+    UINT32 cb;
+    memcpy(&cb, reinterpret_cast<BYTE*>(s) - sizeof(UINT32), sizeof(cb));
+    return cb;
+}
+
+UINT SysStringLen(BSTR s)
+{
+    return SysStringByteLen(s) / sizeof(OLECHAR);
+}
+
+SAFEARRAY* SafeArrayCreateVector(VARTYPE vt, LONG lLbound, ULONG cElements)
+{
+    if (vt != VT_BSTR)
+    {
+        return NULL;
+    }
+    SAFEARRAY* psa = new (std::nothrow) SAFEARRAY();
+    BSTR* data = new (std::nothrow) BSTR[cElements > 0 ? cElements : 1]();
+    if (psa == NULL || data == NULL)
+    {
+        delete psa;
+        delete[] data;
+        return NULL;
+    }
+    psa->cDims = 1;
+    psa->cbElements = sizeof(BSTR);
+    psa->pvData = data;
+    psa->vt = vt;
+    psa->rgsabound[0].cElements = cElements;
+    psa->rgsabound[0].lLbound = lLbound;
+    return psa;
+}
+
+HRESULT SafeArrayDestroy(SAFEARRAY* psa)
+{
+    if (psa == NULL)
+    {
+        return S_OK;
+    }
+    BSTR* data = static_cast<BSTR*>(psa->pvData);
+    for (ULONG i = 0; i < psa->rgsabound[0].cElements; ++i)
+    {
+        SysFreeString(data[i]);
+    }
+    delete[] data;
+    delete psa;
+    return S_OK;
+}
+
+UINT SafeArrayGetDim(SAFEARRAY* psa)
+{
+    return psa->cDims;
+}
+
+HRESULT SafeArrayGetVartype(SAFEARRAY* psa, VARTYPE* pvt)
+{
+    *pvt = psa->vt;
+    return S_OK;
+}
+
+HRESULT SafeArrayGetLBound(SAFEARRAY* psa, UINT nDim, LONG* plLbound)
+{
+    if (nDim != 1)
+    {
+        return E_INVALIDARG;
+    }
+    *plLbound = psa->rgsabound[0].lLbound;
+    return S_OK;
+}
+
+HRESULT SafeArrayGetUBound(SAFEARRAY* psa, UINT nDim, LONG* plUbound)
+{
+    if (nDim != 1)
+    {
+        return E_INVALIDARG;
+    }
+    *plUbound = psa->rgsabound[0].lLbound + static_cast<LONG>(psa->rgsabound[0].cElements) - 1;
+    return S_OK;
+}
+
+HRESULT SafeArrayAccessData(SAFEARRAY* psa, void** ppvData)
+{
+    ++psa->cLocks;
+    *ppvData = psa->pvData;
+    return S_OK;
+}
+
+HRESULT SafeArrayUnaccessData(SAFEARRAY* psa)
+{
+    --psa->cLocks;
+    return S_OK;
+}
+
+void VariantInit(VARIANTARG* pvarg)
+{
+    memset(pvarg, 0, sizeof(*pvarg));
+}
+
+// Frees what the VARIANT owns. By-reference values belong to whoever passed them.
+HRESULT VariantClear(VARIANTARG* pvarg)
+{
+    if (V_VT(pvarg) == VT_BSTR)
+    {
+        SysFreeString(V_BSTR(pvarg));
+    }
+    else if ((V_VT(pvarg) & (VT_ARRAY | VT_BYREF)) == VT_ARRAY)
+    {
+        SafeArrayDestroy(V_ARRAY(pvarg));
+    }
+    VariantInit(pvarg);
+    return S_OK;
+}
+
+// Reads the value as a LONG, which every type we convert from fits in
+static HRESULT ToLong(VARTYPE vt, const void* value, LONG* result)
+{
+    switch (vt)
+    {
+    case VT_I2:
+        *result = *static_cast<const SHORT*>(value);
+        return S_OK;
+    case VT_I4:
+        *result = *static_cast<const LONG*>(value);
+        return S_OK;
+    case VT_BOOL:
+        *result = *static_cast<const VARIANT_BOOL*>(value);
+        return S_OK;
+    case VT_BSTR:
+    {
+        BSTR s = *static_cast<const BSTR*>(value);
+        if (s == NULL || *s == 0)
+        {
+            return DISP_E_TYPEMISMATCH;
+        }
+        wchar_t* end = NULL;
+        errno = 0;
+        long long number = wcstoll(s, &end, 10);
+        if (*end != 0 || errno != 0 || number < INT32_MIN || number > INT32_MAX)
+        {
+            return DISP_E_TYPEMISMATCH;
+        }
+        *result = static_cast<LONG>(number);
+        return S_OK;
+    }
+    default:
+        return DISP_E_TYPEMISMATCH;
+    }
+}
+
+HRESULT VariantChangeTypeEx(VARIANTARG* pvargDest, const VARIANTARG* pvarSrc, LCID, WORD, VARTYPE vt)
+{
+    const VARIANT* src = pvarSrc;
+    if (V_VT(src) == (VT_VARIANT | VT_BYREF))
+    {
+        src = V_VARIANTREF(src);
+    }
+    VARTYPE srcVt = V_VT(src) & ~VT_BYREF;
+    const void* value = (V_VT(src) & VT_BYREF) ? V_BYREF(src) : static_cast<const void*>(&src->lVal);
+
+    VARIANT result;
+    VariantInit(&result);
+    if (srcVt == VT_BSTR && vt == VT_BSTR)
+    {
+        V_BSTR(&result) = SysAllocString(*static_cast<const BSTR*>(value));
+    }
+    else
+    {
+        LONG number = 0;
+        HRESULT hr = ToLong(srcVt, value, &number);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        switch (vt)
+        {
+        case VT_I2:
+            if (number < INT16_MIN || number > INT16_MAX)
+            {
+                return DISP_E_TYPEMISMATCH;
+            }
+            V_I2(&result) = static_cast<SHORT>(number);
+            break;
+        case VT_I4:
+            V_I4(&result) = number;
+            break;
+        case VT_BOOL:
+            V_BOOL(&result) = (number != 0) ? -1 : 0;
+            break;
+        case VT_BSTR:
+        {
+            wchar_t text[16];
+            swprintf(text, ARRAYSIZE(text), L"%d", static_cast<int>(number));
+            V_BSTR(&result) = SysAllocString(text);
+            if (V_BSTR(&result) == NULL)
+            {
+                return E_OUTOFMEMORY;
+            }
+            break;
+        }
+        default:
+            return DISP_E_TYPEMISMATCH;
+        }
+    }
+    V_VT(&result) = vt;
+
+    VariantClear(pvargDest);
+    *pvargDest = result;
+    return S_OK;
+}
+
+// An SRWLOCK is a pointer-sized word initialized to zero: kWriter while it is held
+// exclusively, otherwise the number of shared holders in steps of kReader
+static const uintptr_t kWriter = 1;
+static const uintptr_t kReader = 2;
+
+static uintptr_t* LockWord(SRWLOCK* lock)
+{
+    return reinterpret_cast<uintptr_t*>(&lock->Ptr);
+}
+
+void InitializeSRWLock(SRWLOCK* lock)
+{
+    lock->Ptr = NULL;
+}
+
+BOOL TryAcquireSRWLockExclusive(SRWLOCK* lock)
+{
+    uintptr_t expected = 0;
+    return __atomic_compare_exchange_n(LockWord(lock), &expected, kWriter, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void AcquireSRWLockExclusive(SRWLOCK* lock)
+{
+    while (!TryAcquireSRWLockExclusive(lock))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void ReleaseSRWLockExclusive(SRWLOCK* lock)
+{
+    __atomic_store_n(LockWord(lock), static_cast<uintptr_t>(0), __ATOMIC_RELEASE);
+}
+
+void AcquireSRWLockShared(SRWLOCK* lock)
+{
+    uintptr_t word = __atomic_load_n(LockWord(lock), __ATOMIC_RELAXED);
+    for (;;)
+    {
+        if ((word & kWriter) != 0)
+        {
+            std::this_thread::yield();
+            word = __atomic_load_n(LockWord(lock), __ATOMIC_RELAXED);
+        }
+        else if (__atomic_compare_exchange_n(LockWord(lock), &word, word + kReader, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            return;
+        }
+    }
+}
+
+void ReleaseSRWLockShared(SRWLOCK* lock)
+{
+    __atomic_fetch_sub(LockWord(lock), kReader, __ATOMIC_RELEASE);
+}
+
+// Runs 'initFn' once, whichever thread gets here first; the others wait for it. If it fails,
+// the next caller tries again.
+BOOL InitOnceExecuteOnce(PINIT_ONCE initOnce, PINIT_ONCE_FN initFn, PVOID parameter, PVOID* context)
+{
+    static std::mutex s_lock;
+    if (__atomic_load_n(&initOnce->Ptr, __ATOMIC_ACQUIRE) != NULL)
+    {
+        return TRUE;
+    }
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (initOnce->Ptr != NULL)
+    {
+        return TRUE;
+    }
+    if (!initFn(initOnce, parameter, context))
+    {
+        return FALSE;
+    }
+    __atomic_store_n(&initOnce->Ptr, reinterpret_cast<void*>(1), __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+LCID ConvertDefaultLocale(LCID lcid)
+{
+    return (lcid == LOCALE_USER_DEFAULT || lcid == LOCALE_SYSTEM_DEFAULT || lcid == LOCALE_NEUTRAL) ? 0x0409 : lcid;
+}
+
+static std::string Narrow(LPCWSTR s)
+{
+    std::string narrow;
+    for (; *s != 0; ++s)
+    {
+        narrow += (*s < 0x80) ? static_cast<char>(*s) : '?';
+    }
+    return narrow;
+}
+
+DWORD GetEnvironmentVariableW(LPCWSTR name, LPWSTR buffer, DWORD size)
+{
+    const char* value = getenv(Narrow(name).c_str());
+    if (value == NULL)
+    {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return 0;
+    }
+    DWORD cch = static_cast<DWORD>(strlen(value));
+    if (cch >= size)
+    {
+        return cch + 1;
+    }
+    for (DWORD i = 0; i <= cch; ++i)
+    {
+        buffer[i] = static_cast<unsigned char>(value[i]);
+    }
+    return cch;
+}
+
+BOOL SetEnvironmentVariableW(LPCWSTR name, LPCWSTR value)
+{
+    int result = (value != NULL) ? setenv(Narrow(name).c_str(), Narrow(value).c_str(), 1) : unsetenv(Narrow(name).c_str());
+    return result == 0;
+}
+
+// With -1 for 'cbMultiByte' the terminating zero is converted and counted too
+int MultiByteToWideChar(UINT, DWORD, const char* multiByte, int cbMultiByte, LPWSTR wideChar, int cchWideChar)
+{
+    int cch = (cbMultiByte < 0) ? static_cast<int>(strlen(multiByte)) + 1 : cbMultiByte;
+    if (cchWideChar == 0)
+    {
+        return cch;
+    }
+    if (cch > cchWideChar)
+    {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+    }
+    for (int i = 0; i < cch; ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(multiByte[i]);
+        wideChar[i] = (c < 0x80) ? c : L'?';
+    }
+    return cch;
+}
+
+// The file the module was loaded from. 'module' is an address in it or a handle of dlopen's.
+// The file of the module, or of the executable if it is NULL
+static const char* ModulePath(HMODULE module, char (&executable)[PATH_MAX])
+{
+    Dl_info info;
+    struct link_map* map = NULL;
+    if (module == NULL)
+    {
+        // The executable, as on Windows
+        ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+        if (length > 0)
+        {
+            executable[length] = 0;
+            return executable;
+        }
+    }
+    else if (dladdr(module, &info) != 0)
+    {
+        return info.dli_fname;
+    }
+    else if (dlinfo(module, RTLD_DI_LINKMAP, &map) == 0)
+    {
+        return map->l_name;
+    }
+    return NULL;
+}
+
+template <class Char>
+static DWORD GetModuleFileNameT(HMODULE module, Char* path, DWORD size)
+{
+    char executable[PATH_MAX];
+    const char* name = ModulePath(module, executable);
+    if (name == NULL || size == 0)
+    {
+        SetLastError(ERROR_MOD_NOT_FOUND);
+        return 0;
+    }
+    DWORD cch = 0;
+    for (; name[cch] != 0 && cch < size - 1; ++cch)
+    {
+        path[cch] = static_cast<unsigned char>(name[cch]);
+    }
+    path[cch] = 0;
+    if (name[cch] != 0)
+    {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return size;
+    }
+    return cch;
+}
+
+DWORD GetModuleFileNameW(HMODULE module, LPWSTR path, DWORD size)
+{
+    return GetModuleFileNameT(module, path, size);
+}
+
+DWORD GetModuleFileNameA(HMODULE module, char* path, DWORD size)
+{
+    return GetModuleFileNameT(module, path, size);
+}
+
+HMODULE LoadLibraryExW(LPCWSTR path, HANDLE, DWORD)
+{
+    HMODULE module = dlopen(Narrow(path).c_str(), RTLD_NOW);
+    if (module == NULL)
+    {
+        SetLastError(ERROR_MOD_NOT_FOUND);
+    }
+    return module;
+}
+
+// Takes no reference, the module was loaded before and stays so
+HMODULE GetModuleHandleW(LPCWSTR name)
+{
+    HMODULE module = dlopen((name != NULL) ? Narrow(name).c_str() : NULL, RTLD_NOW | RTLD_NOLOAD);
+    if (module == NULL)
+    {
+        SetLastError(ERROR_MOD_NOT_FOUND);
+        return NULL;
+    }
+    dlclose(module);
+    return module;
+}
+
+FARPROC GetProcAddress(HMODULE module, const char* name)
+{
+    FARPROC proc = reinterpret_cast<FARPROC>(dlsym(module, name));
+    if (proc == NULL)
+    {
+        SetLastError(ERROR_PROC_NOT_FOUND);
+    }
+    return proc;
+}
+
+BOOL FreeLibrary(HMODULE module)
+{
+    if (dlclose(module) != 0)
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+LONG RegCreateKeyExW(HKEY, LPCWSTR, DWORD, LPWSTR, DWORD, DWORD, void*, HKEY* result, DWORD*)
+{
+    *result = NULL;
+    return ERROR_ACCESS_DENIED;
+}
+
+LONG RegSetValueExW(HKEY, LPCWSTR, DWORD, DWORD, const BYTE*, DWORD)
+{
+    return ERROR_ACCESS_DENIED;
+}
+
+LONG RegCloseKey(HKEY)
+{
+    return ERROR_SUCCESS;
+}
+
+LONG SHDeleteKeyW(HKEY, LPCWSTR)
+{
+    return ERROR_ACCESS_DENIED;
+}
@@ -0,0 +1,784 @@
+#pragma once
+// Just enough of the Windows SDK for com_hello to build and run its tests with any C++17
+// compiler: the dispatch engine and its VARIANTs, the dispatch name maps, the BSTR
+// allocator with its per-thread counters, the object pool, the class object table,
+// HelloWorld.dll itself with everything it calls of COM, the local server with its
+// transports and surrogate pool, and the activation database. Only what those use is
+// here, implemented in Windows.cpp, Threadpool.cpp, Kernel32.cpp and Ole32.cpp; winsock2.h
+// has the sockets.
+//
+// The COM runtime is a small one. There are apartments, but no marshaling: every thread
+// gets the raw pointer of every object, as it would from the free-threaded marshaler. The
+// global interface table and the system's ManualResetEvent are the only classes
+// CoCreateInstance knows, and there is no registry and no type library.
+//
+// Types have the sizes they have on Windows, but for wchar_t: it stays the compiler's, so
+// L"..." literals and the wcs functions keep working. OLECHAR, WCHAR and the characters of
+// a BSTR are all wchar_t, which is all the code under test assumes.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <stdlib.h>
+
+// The CRT's case-insensitive compare, which the name lookups were measured against
+#define _wcsicmp wcscasecmp
+
+#define WINAPI
+#define CALLBACK
+#define __stdcall
+#define STDMETHODCALLTYPE
+#define EXTERN_C extern "C"
+#define __declspec(attribute) __attribute__((attribute))
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef short SHORT;
+typedef unsigned int UINT;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t INT64;
+typedef uintptr_t UINT_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef int64_t LONGLONG;
+typedef int64_t LONG64;
+typedef uint64_t ULONGLONG;
+typedef int32_t HRESULT;
+typedef LONG DISPID;
+typedef DWORD LCID;
+typedef WORD LANGID;
+typedef unsigned short VARTYPE;
+typedef short VARIANT_BOOL;
+typedef wchar_t WCHAR;
+typedef wchar_t OLECHAR;
+typedef OLECHAR* BSTR;
+typedef OLECHAR* LPOLESTR;
+typedef WCHAR* LPWSTR;
+typedef const WCHAR* LPCWSTR;
+typedef void* LPVOID;
+typedef void* PVOID;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef void* HINSTANCE;
+typedef void (*FARPROC)();
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+#define TRUE 1
+#define FALSE 0
+#define INFINITE 0xFFFFFFFF
+#define MAXDWORD 0xFFFFFFFF
+#define MAX_PATH 260
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define swprintf_s swprintf
+#define sprintf_s snprintf
+#define _TRUNCATE (static_cast<size_t>(-1))
+
+// 'count' is only ever _TRUNCATE here: what doesn't fit is cut off, and the result is -1
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...);
+
+// Fails with ERANGE, leaving an empty string, if the source doesn't fit
+inline int strcpy_s(char* destination, size_t size, const char* source)
+{
+    size_t length = strlen(source);
+    if (length >= size)
+    {
+        if (size != 0)
+        {
+            destination[0] = 0;
+        }
+        return 34;
+    }
+    memcpy(destination, source, length + 1);
+    return 0;
+}
+
+// HRESULTs and Win32 error codes
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+#define S_OK static_cast<HRESULT>(0)
+#define S_FALSE static_cast<HRESULT>(1)
+#define E_UNEXPECTED static_cast<HRESULT>(0x8000FFFF)
+#define E_NOTIMPL static_cast<HRESULT>(0x80004001)
+#define E_PENDING static_cast<HRESULT>(0x8000000A)
+#define E_NOINTERFACE static_cast<HRESULT>(0x80004002)
+#define E_POINTER static_cast<HRESULT>(0x80004003)
+#define E_FAIL static_cast<HRESULT>(0x80004005)
+#define E_OUTOFMEMORY static_cast<HRESULT>(0x8007000E)
+#define E_INVALIDARG static_cast<HRESULT>(0x80070057)
+#define CLASS_E_NOAGGREGATION static_cast<HRESULT>(0x80040110)
+#define CLASS_E_CLASSNOTAVAILABLE static_cast<HRESULT>(0x80040111)
+#define REGDB_E_CLASSNOTREG static_cast<HRESULT>(0x80040154)
+#define CONNECT_E_NOCONNECTION static_cast<HRESULT>(0x80040200)
+#define CONNECT_E_CANNOTCONNECT static_cast<HRESULT>(0x80040202)
+#define CO_E_NOTINITIALIZED static_cast<HRESULT>(0x800401F0)
+#define CO_E_CLASSSTRING static_cast<HRESULT>(0x800401F3)
+#define CO_E_SERVER_EXEC_FAILURE static_cast<HRESULT>(0x80080005)
+#define RPC_E_CALL_CANCELED static_cast<HRESULT>(0x80010002)
+#define RPC_E_CHANGED_MODE static_cast<HRESULT>(0x80010106)
+#define RPC_E_DISCONNECTED static_cast<HRESULT>(0x80010108)
+#define RPC_E_INVALID_DATA static_cast<HRESULT>(0x8001010F)
+#define RPC_E_SERVER_TOO_BUSY static_cast<HRESULT>(0x80010110)
+#define RPC_S_CALLPENDING static_cast<HRESULT>(0x80010115)
+#define RPC_E_CALL_COMPLETE static_cast<HRESULT>(0x80010117)
+#define TYPE_E_CANTLOADLIBRARY static_cast<HRESULT>(0x80029C4A)
+#define DISP_E_UNKNOWNINTERFACE static_cast<HRESULT>(0x80020001)
+#define DISP_E_MEMBERNOTFOUND static_cast<HRESULT>(0x80020003)
+#define DISP_E_PARAMNOTFOUND static_cast<HRESULT>(0x80020004)
+#define DISP_E_TYPEMISMATCH static_cast<HRESULT>(0x80020005)
+#define DISP_E_UNKNOWNNAME static_cast<HRESULT>(0x80020006)
+#define DISP_E_BADINDEX static_cast<HRESULT>(0x8002000B)
+#define DISP_E_BADPARAMCOUNT static_cast<HRESULT>(0x8002000E)
+#define DISPID_UNKNOWN (-1)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_BAD_FORMAT 11L
+#define ERROR_NOT_READY 21L
+#define ERROR_BAD_LENGTH 24L
+#define ERROR_WRITE_FAULT 29L
+#define ERROR_CANNOT_MAKE 82L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_MOD_NOT_FOUND 126L
+#define ERROR_PROC_NOT_FOUND 127L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_INVALID_ADDRESS 487L
+#define ERROR_TIMEOUT 1460L
+#define HRESULT_FROM_WIN32(x) \
+    (static_cast<HRESULT>(x) <= 0 ? static_cast<HRESULT>(x) : static_cast<HRESULT>((static_cast<DWORD>(x) & 0x0000FFFF) | (7 << 16) | 0x80000000))
+
+DWORD GetLastError();
+void SetLastError(DWORD error);
+
+// GUIDs
+struct GUID
+{
+    DWORD Data1;
+    WORD Data2;
+    WORD Data3;
+    BYTE Data4[8];
+};
+typedef GUID CLSID;
+typedef GUID IID;
+typedef const GUID& REFGUID;
+typedef const CLSID& REFCLSID;
+typedef const IID& REFIID;
+
+inline bool operator==(REFGUID a, REFGUID b) { return memcmp(&a, &b, sizeof(GUID)) == 0; }
+inline int InlineIsEqualGUID(REFGUID a, REFGUID b) { return a == b; }
+inline bool operator!=(REFGUID a, REFGUID b) { return !(a == b); }
+
+extern const GUID IID_NULL;
+extern const GUID CLSID_NULL;
+extern const IID IID_IUnknown;
+extern const IID IID_IClassFactory;
+extern const IID IID_IDispatch;
+extern const IID IID_IMarshal;
+extern const IID IID_IConnectionPoint;
+extern const IID IID_IConnectionPointContainer;
+extern const IID IID_IGlobalInterfaceTable;
+extern const IID IID_IAgileObject;
+extern const IID IID_ISynchronize;
+extern const IID IID_ISynchronizeHandle;
+extern const IID IID_ICallFactory;
+extern const IID IID_ICancelMethodCalls;
+extern const CLSID CLSID_StdGlobalInterfaceTable;
+extern const CLSID CLSID_ManualResetEvent;
+extern const CLSID CLSID_InProcFreeMarshaler;
+
+struct IUnknown
+{
+    virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) = 0;
+    virtual ULONG __stdcall AddRef() = 0;
+    virtual ULONG __stdcall Release() = 0;
+};
+
+struct IClassFactory : public IUnknown
+{
+    virtual HRESULT __stdcall CreateInstance(IUnknown* pUnkOuter, REFIID riid, void** ppv) = 0;
+    virtual HRESULT __stdcall LockServer(BOOL fLock) = 0;
+};
+
+// BSTRs: the byte length in the 4 bytes before the characters, and a terminating 0
+BSTR SysAllocString(const OLECHAR* s);
+BSTR SysAllocStringLen(const OLECHAR* s, UINT cch);
+void SysFreeString(BSTR s);
+UINT SysStringLen(BSTR s);
+UINT SysStringByteLen(BSTR s);
+
+enum VARENUM
+{
+    VT_EMPTY = 0,
+    VT_I2 = 2,
+    VT_I4 = 3,
+    VT_BSTR = 8,
+    VT_ERROR = 10,
+    VT_BOOL = 11,
+    VT_VARIANT = 12,
+    VT_ARRAY = 0x2000,
+    VT_BYREF = 0x4000,
+};
+
+// One-dimensional SAFEARRAYs of BSTRs, which is all the server passes around
+struct SAFEARRAYBOUND
+{
+    ULONG cElements;
+    LONG lLbound;
+};
+
+struct SAFEARRAY
+{
+    WORD cDims;
+    WORD fFeatures;
+    ULONG cbElements;
+    ULONG cLocks;
+    void* pvData;
+    VARTYPE vt;
+    SAFEARRAYBOUND rgsabound[1];
+};
+
+SAFEARRAY* SafeArrayCreateVector(VARTYPE vt, LONG lLbound, ULONG cElements);
+HRESULT SafeArrayDestroy(SAFEARRAY* psa);
+UINT SafeArrayGetDim(SAFEARRAY* psa);
+HRESULT SafeArrayGetVartype(SAFEARRAY* psa, VARTYPE* pvt);
+HRESULT SafeArrayGetLBound(SAFEARRAY* psa, UINT nDim, LONG* plLbound);
+HRESULT SafeArrayGetUBound(SAFEARRAY* psa, UINT nDim, LONG* plUbound);
+HRESULT SafeArrayAccessData(SAFEARRAY* psa, void** ppvData);
+HRESULT SafeArrayUnaccessData(SAFEARRAY* psa);
+
+// VARIANTs with the fields the dispatch engine reads, laid out as on Windows
+struct VARIANT
+{
+    VARTYPE vt;
+    WORD wReserved1;
+    WORD wReserved2;
+    WORD wReserved3;
+    union
+    {
+        LONG lVal;
+        SHORT iVal;
+        VARIANT_BOOL boolVal;
+        HRESULT scode;
+        BSTR bstrVal;
+        SAFEARRAY* parray;
+        LONG* plVal;
+        BSTR* pbstrVal;
+        SAFEARRAY** pparray;
+        VARIANT* pvarVal;
+        void* byref;
+    };
+};
+typedef VARIANT VARIANTARG;
+
+#define V_VT(v) ((v)->vt)
+#define V_I2(v) ((v)->iVal)
+#define V_I4(v) ((v)->lVal)
+#define V_BOOL(v) ((v)->boolVal)
+#define V_BSTR(v) ((v)->bstrVal)
+#define V_ARRAY(v) ((v)->parray)
+#define V_I4REF(v) ((v)->plVal)
+#define V_BSTRREF(v) ((v)->pbstrVal)
+#define V_ARRAYREF(v) ((v)->pparray)
+#define V_VARIANTREF(v) ((v)->pvarVal)
+#define V_BYREF(v) ((v)->byref)
+
+void VariantInit(VARIANTARG* pvarg);
+HRESULT VariantClear(VARIANTARG* pvarg);
+
+// Converts between VT_I2, VT_I4, VT_BOOL and VT_BSTR, looking through VT_BYREF. Anything
+// else fails with DISP_E_TYPEMISMATCH, as would a BSTR that isn't a number. The LCID is
+// ignored, numbers are always written and read the C locale's way.
+HRESULT VariantChangeTypeEx(VARIANTARG* pvargDest, const VARIANTARG* pvarSrc, LCID lcid, WORD wFlags, VARTYPE vt);
+
+struct DISPPARAMS
+{
+    VARIANTARG* rgvarg;
+    DISPID* rgdispidNamedArgs;
+    UINT cArgs;
+    UINT cNamedArgs;
+};
+
+struct EXCEPINFO
+{
+    WORD wCode;
+    WORD wReserved;
+    BSTR bstrSource;
+    BSTR bstrDescription;
+    BSTR bstrHelpFile;
+    DWORD dwHelpContext;
+    void* pvReserved;
+    void* pfnDeferredFillIn;
+    HRESULT scode;
+};
+
+#define DISPATCH_METHOD 0x1
+#define DISPATCH_PROPERTYGET 0x2
+#define DISPATCH_PROPERTYPUT 0x4
+#define DISPATCH_PROPERTYPUTREF 0x8
+// IDispatch, with type information that has nothing in it off Windows
+struct ITypeInfo : public IUnknown
+{
+};
+
+struct ITypeLib : public IUnknown
+{
+    virtual HRESULT __stdcall GetTypeInfoOfGuid(REFGUID guid, ITypeInfo** ppTInfo) = 0;
+};
+
+struct IDispatch : public IUnknown
+{
+    virtual HRESULT __stdcall GetTypeInfoCount(UINT* pctinfo) = 0;
+    virtual HRESULT __stdcall GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo) = 0;
+    virtual HRESULT __stdcall GetIDsOfNames(REFIID riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId) = 0;
+    virtual HRESULT __stdcall Invoke(DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams,
+                                     VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr) = 0;
+};
+
+enum REGKIND
+{
+    REGKIND_DEFAULT,
+    REGKIND_REGISTER,
+    REGKIND_NONE,
+};
+
+// LoadTypeLibEx opens any file that exists as a type library, whose type infos are empty.
+// With no registry, LoadRegTypeLib fails with TYPE_E_CANTLOADLIBRARY.
+HRESULT LoadTypeLibEx(LPCWSTR path, REGKIND regkind, ITypeLib** ppTLib);
+HRESULT LoadRegTypeLib(REFGUID libid, WORD major, WORD minor, LCID lcid, ITypeLib** ppTLib);
+
+// Locales. There is one user locale, English (United States).
+#define LOCALE_USER_DEFAULT 0x0400
+#define LOCALE_SYSTEM_DEFAULT 0x0800
+#define LOCALE_NEUTRAL 0x0000
+#define LOCALE_INVARIANT 0x007F
+#define LANG_NEUTRAL 0x00
+#define LANG_GERMAN 0x07
+#define LANG_ENGLISH 0x09
+#define LANG_SPANISH 0x0A
+#define LANG_FRENCH 0x0C
+#define LANG_ITALIAN 0x10
+#define LANG_DUTCH 0x13
+#define LANG_POLISH 0x15
+#define LANG_PORTUGUESE 0x16
+#define LANGIDFROMLCID(lcid) static_cast<LANGID>(lcid)
+#define PRIMARYLANGID(langid) static_cast<WORD>((langid) & 0x3FF)
+
+LCID ConvertDefaultLocale(LCID lcid);
+
+// Interlocked operations, on 32-bit and 64-bit integers and on pointers. The type is the
+// target's, values convert to it as they would to Windows' LONG overloads.
+template <class T>
+struct InterlockedValue
+{
+    typedef T Type;
+};
+
+template <class T>
+inline T InterlockedIncrement(volatile T* addend)
+{
+    return __atomic_add_fetch(addend, 1, __ATOMIC_SEQ_CST);
+}
+
+template <class T>
+inline T InterlockedDecrement(volatile T* addend)
+{
+    return __atomic_sub_fetch(addend, 1, __ATOMIC_SEQ_CST);
+}
+
+template <class T>
+inline T InterlockedExchange(volatile T* target, typename InterlockedValue<T>::Type value)
+{
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+template <class T>
+inline T InterlockedCompareExchange(volatile T* destination, typename InterlockedValue<T>::Type exchange,
+                                    typename InterlockedValue<T>::Type comparand)
+{
+    __atomic_compare_exchange_n(destination, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline LONG64 InterlockedExchangeAdd64(volatile LONG64* addend, LONG64 value)
+{
+    return __atomic_fetch_add(addend, value, __ATOMIC_SEQ_CST);
+}
+
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile* destination, PVOID exchange, PVOID comparand)
+{
+    __atomic_compare_exchange_n(destination, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline LONG ReadAcquire(LONG const volatile* source)
+{
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+}
+
+inline PVOID ReadPointerAcquire(PVOID const volatile* source)
+{
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+}
+
+// Slim reader/writer locks. They spin, which is all the short critical sections here need.
+struct SRWLOCK
+{
+    void* Ptr;
+};
+#define SRWLOCK_INIT { NULL }
+
+void InitializeSRWLock(SRWLOCK* lock);
+void AcquireSRWLockExclusive(SRWLOCK* lock);
+BOOL TryAcquireSRWLockExclusive(SRWLOCK* lock);
+void ReleaseSRWLockExclusive(SRWLOCK* lock);
+void AcquireSRWLockShared(SRWLOCK* lock);
+void ReleaseSRWLockShared(SRWLOCK* lock);
+
+// Condition variables for SRW locks, see Threadpool.cpp
+struct CONDITION_VARIABLE
+{
+    void* Ptr;
+};
+#define CONDITION_VARIABLE_INIT { NULL }
+#define CONDITION_VARIABLE_LOCKMODE_SHARED 0x1
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition);
+BOOL SleepConditionVariableSRW(CONDITION_VARIABLE* condition, SRWLOCK* lock, DWORD milliseconds, ULONG flags);
+void WakeConditionVariable(CONDITION_VARIABLE* condition);
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition);
+
+// One-time initialization
+struct INIT_ONCE
+{
+    void* Ptr;
+};
+typedef INIT_ONCE* PINIT_ONCE;
+typedef BOOL (CALLBACK *PINIT_ONCE_FN)(PINIT_ONCE initOnce, PVOID parameter, PVOID* context);
+#define INIT_ONCE_STATIC_INIT { NULL }
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE initOnce, PINIT_ONCE_FN initFn, PVOID parameter, PVOID* context);
+
+// Threads, waiting and time, see Threadpool.cpp
+struct SYSTEM_INFO
+{
+    DWORD dwNumberOfProcessors;
+};
+
+void GetSystemInfo(SYSTEM_INFO* info);
+void Sleep(DWORD milliseconds);
+BOOL SwitchToThread();
+void YieldProcessor();
+void FlushProcessWriteBuffers();
+LONG64 CompatFlushProcessWriteBuffersCount();      // not Windows: the calls so far, for tests
+BOOL WaitOnAddress(volatile void* address, PVOID compareAddress, SIZE_T addressSize, DWORD milliseconds);
+void WakeByAddressSingle(PVOID address);
+void WakeByAddressAll(PVOID address);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count);
+ULONGLONG GetTickCount64();
+WORD CaptureStackBackTrace(DWORD framesToSkip, DWORD framesToCapture, PVOID* backTrace, DWORD* backTraceHash);
+
+// Kernel objects, see Kernel32.cpp: events, threads, processes, jobs, files and sections of
+// shared memory or of a file. Named ones are known to this process only, so a "Local\..." section or event
+// connects the threads of one process rather than two processes. A wait on several objects
+// returns when any of them is signaled, never only when all are.
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1)))
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_TIMEOUT 0x00000102L
+#define WAIT_FAILED 0xFFFFFFFF
+#define SYNCHRONIZE 0x00100000L
+#define EVENT_MODIFY_STATE 0x0002
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define FILE_MAP_WRITE 0x0002
+#define FILE_MAP_READ 0x0004
+#define MEM_COMMIT 0x00001000
+#define MEM_MAPPED 0x00040000
+#define PROCESS_TERMINATE 0x0001
+#define CREATE_SUSPENDED 0x00000004
+#define CREATE_NO_WINDOW 0x08000000
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 0x00000001
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE 0x00002000
+
+struct MEMORY_BASIC_INFORMATION
+{
+    PVOID BaseAddress;
+    PVOID AllocationBase;
+    DWORD AllocationProtect;
+    SIZE_T RegionSize;
+    DWORD State;
+    DWORD Protect;
+    DWORD Type;
+};
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID parameter);
+
+// A new process starts running the executable with the command line split into argv the
+// way the CRT splits it. CREATE_SUSPENDED holds it back until ResumeThread.
+struct STARTUPINFOA
+{
+    DWORD cb;
+};
+
+struct PROCESS_INFORMATION
+{
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+};
+
+// A job that kills its processes when its last handle is closed is the only kind there is
+enum JOBOBJECTINFOCLASS
+{
+    JobObjectExtendedLimitInformation = 9,
+};
+
+struct JOBOBJECT_BASIC_LIMIT_INFORMATION
+{
+    DWORD LimitFlags;
+};
+
+struct JOBOBJECT_EXTENDED_LIMIT_INFORMATION
+{
+    JOBOBJECT_BASIC_LIMIT_INFORMATION BasicLimitInformation;
+};
+
+BOOL CloseHandle(HANDLE handle);
+HANDLE CreateThread(void* security, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID parameter, DWORD flags, DWORD* threadId);
+BOOL CreateProcessA(const char* application, char* commandLine, void* processSecurity, void* threadSecurity, BOOL inheritHandles,
+                    DWORD flags, void* environment, const char* directory, STARTUPINFOA* startup, PROCESS_INFORMATION* info);
+DWORD ResumeThread(HANDLE thread);
+BOOL TerminateProcess(HANDLE process, UINT exitCode);
+HANDLE CreateJobObjectA(void* security, const char* name);
+BOOL SetInformationJobObject(HANDLE job, JOBOBJECTINFOCLASS infoClass, void* info, DWORD cbInfo);
+BOOL AssignProcessToJobObject(HANDLE job, HANDLE process);
+HANDLE CreateEventA(void* security, BOOL manualReset, BOOL initialState, const char* name);
+HANDLE CreateEventW(void* security, BOOL manualReset, BOOL initialState, LPCWSTR name);
+HANDLE OpenEventA(DWORD access, BOOL inherit, const char* name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds);
+DWORD GetCurrentProcessId();
+HANDLE OpenProcess(DWORD access, BOOL inherit, DWORD processId);
+HANDLE CreateFileW(LPCWSTR path, DWORD access, DWORD share, void* security, DWORD disposition, DWORD attributes, HANDLE templateFile);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+BOOL WriteFile(HANDLE file, const void* buffer, DWORD cb, DWORD* written, void* overlapped);
+HANDLE CreateFileMappingA(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const char* name);
+HANDLE CreateFileMappingW(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, LPCWSTR name);
+HANDLE OpenFileMappingA(DWORD access, BOOL inherit, const char* name);
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size);
+BOOL UnmapViewOfFile(const void* base);
+SIZE_T VirtualQuery(const void* address, MEMORY_BASIC_INFORMATION* info, SIZE_T length);
+
+// Thread pools. A pool starts a thread whenever a callback finds none idle, up to its
+// maximum, and keeps its threads until it is closed. Without a pool of their own,
+// callbacks run on the process's default pool of up to 500 threads.
+struct TP_POOL;
+struct TP_WORK;
+struct TP_CALLBACK_INSTANCE;
+typedef TP_POOL* PTP_POOL;
+typedef TP_WORK* PTP_WORK;
+typedef TP_CALLBACK_INSTANCE* PTP_CALLBACK_INSTANCE;
+typedef void (CALLBACK *PTP_SIMPLE_CALLBACK)(PTP_CALLBACK_INSTANCE instance, PVOID context);
+typedef void (CALLBACK *PTP_WORK_CALLBACK)(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WORK work);
+
+struct TP_CALLBACK_ENVIRON
+{
+    PTP_POOL Pool;
+    PVOID RaceDll;      // keeps nothing loaded here, modules are never unloaded under a callback
+};
+typedef TP_CALLBACK_ENVIRON* PTP_CALLBACK_ENVIRON;
+
+inline void InitializeThreadpoolEnvironment(PTP_CALLBACK_ENVIRON environment)
+{
+    environment->Pool = NULL;
+    environment->RaceDll = NULL;
+}
+
+inline void DestroyThreadpoolEnvironment(PTP_CALLBACK_ENVIRON)
+{
+}
+
+inline void SetThreadpoolCallbackPool(PTP_CALLBACK_ENVIRON environment, PTP_POOL pool)
+{
+    environment->Pool = pool;
+}
+
+inline void SetThreadpoolCallbackLibrary(PTP_CALLBACK_ENVIRON environment, PVOID module)
+{
+    environment->RaceDll = module;
+}
+
+PTP_POOL CreateThreadpool(PVOID reserved);
+void SetThreadpoolThreadMaximum(PTP_POOL pool, DWORD maximum);
+void CloseThreadpool(PTP_POOL pool);
+BOOL TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK callback, PVOID context, PTP_CALLBACK_ENVIRON environment);
+PTP_WORK CreateThreadpoolWork(PTP_WORK_CALLBACK callback, PVOID context, PTP_CALLBACK_ENVIRON environment);
+void SubmitThreadpoolWork(PTP_WORK work);
+void WaitForThreadpoolWorkCallbacks(PTP_WORK work, BOOL cancelPendingCallbacks);
+void CloseThreadpoolWork(PTP_WORK work);
+
+// Modules. HMODULE is an address in the module, as &__ImageBase is on Windows, or what
+// LoadLibraryExW returned. The linker's own symbol for the start of the module's image
+// stands in for __ImageBase.
+struct IMAGE_DOS_HEADER
+{
+    WORD e_magic;
+};
+#define __ImageBase __ehdr_start
+#define LOAD_WITH_ALTERED_SEARCH_PATH 0x8
+#define DLL_PROCESS_DETACH 0
+#define DLL_PROCESS_ATTACH 1
+
+DWORD GetModuleFileNameW(HMODULE module, LPWSTR path, DWORD size);
+DWORD GetModuleFileNameA(HMODULE module, char* path, DWORD size);
+
+// dlopen and dlsym. A path without a slash is looked for where dlopen looks, and a module
+// stays loaded until FreeLibrary was called once for every LoadLibraryExW. GetModuleHandleW
+// also finds a loaded module by its SONAME, so a library built as HelloWorld.dll answers
+// to that name as it does on Windows.
+HMODULE LoadLibraryExW(LPCWSTR path, HANDLE file, DWORD flags);
+HMODULE GetModuleHandleW(LPCWSTR name);
+FARPROC GetProcAddress(HMODULE module, const char* name);
+BOOL FreeLibrary(HMODULE module);
+
+// Files: the temp folder is $TMPDIR or /tmp, and always ends with a slash
+DWORD GetTempPathA(DWORD size, char* path);
+BOOL DeleteFileA(const char* path);
+
+// No registry: every change to it fails with ERROR_ACCESS_DENIED
+typedef struct HKEY__* HKEY;
+#define HKEY_CLASSES_ROOT reinterpret_cast<HKEY>(static_cast<ULONG_PTR>(0x80000000))
+#define REG_OPTION_NON_VOLATILE 0
+#define KEY_WRITE 0x20006
+#define REG_SZ 1
+
+LONG RegCreateKeyExW(HKEY key, LPCWSTR subKey, DWORD reserved, LPWSTR className, DWORD options, DWORD access,
+                     void* security, HKEY* result, DWORD* disposition);
+LONG RegSetValueExW(HKEY key, LPCWSTR name, DWORD reserved, DWORD type, const BYTE* data, DWORD cbData);
+LONG RegCloseKey(HKEY key);
+LONG SHDeleteKeyW(HKEY key, LPCWSTR subKey);
+
+// The environment
+DWORD GetEnvironmentVariableW(LPCWSTR name, LPWSTR buffer, DWORD size);
+BOOL SetEnvironmentVariableW(LPCWSTR name, LPCWSTR value);
+
+// Code pages. Only ASCII is converted, anything else becomes '?'.
+#define CP_ACP 0
+#define CP_UTF8 65001
+
+int MultiByteToWideChar(UINT codePage, DWORD flags, const char* multiByte, int cbMultiByte, LPWSTR wideChar, int cchWideChar);
+
+// COM, see Ole32.cpp
+#define COINIT_MULTITHREADED 0x0
+#define COINIT_APARTMENTTHREADED 0x2
+#define CLSCTX_INPROC_SERVER 0x1
+
+enum APTTYPE
+{
+    APTTYPE_CURRENT = -1,
+    APTTYPE_STA = 0,
+    APTTYPE_MTA = 1,
+    APTTYPE_NA = 2,
+    APTTYPE_MAINSTA = 3,
+};
+
+enum APTTYPEQUALIFIER
+{
+    APTTYPEQUALIFIER_NONE = 0,
+    APTTYPEQUALIFIER_IMPLICIT_MTA = 1,
+};
+
+typedef struct CO_MTA_USAGE_COOKIE__* CO_MTA_USAGE_COOKIE;
+
+// A thread is in the apartment it initialized, or in the implicit MTA while anybody holds
+// an MTA usage cookie. Nothing is ever marshaled between apartments.
+HRESULT CoInitializeEx(LPVOID reserved, DWORD coInit);
+void CoUninitialize();
+HRESULT CoGetApartmentType(APTTYPE* type, APTTYPEQUALIFIER* qualifier);
+HRESULT CoIncrementMTAUsage(CO_MTA_USAGE_COOKIE* cookie);
+HRESULT CoDecrementMTAUsage(CO_MTA_USAGE_COOKIE cookie);
+
+// CLSID_StdGlobalInterfaceTable and CLSID_ManualResetEvent, REGDB_E_CLASSNOTREG otherwise
+HRESULT CoCreateInstance(REFCLSID clsid, IUnknown* pUnkOuter, DWORD context, REFIID riid, void** ppv);
+
+// The marshaler is there to be aggregated and asked for; it has nothing to marshal into
+HRESULT CoCreateFreeThreadedMarshaler(IUnknown* pUnkOuter, IUnknown** ppUnkMarshal);
+
+// Interfaces with only the methods com_hello calls or implements
+#define MSHCTX_INPROC 3
+#define MSHLFLAGS_NORMAL 0
+
+struct IMarshal : public IUnknown
+{
+    virtual HRESULT __stdcall GetUnmarshalClass(REFIID riid, void* pv, DWORD dwDestContext, void* pvDestContext, DWORD mshlflags, CLSID* pCid) = 0;
+};
+
+struct IGlobalInterfaceTable : public IUnknown
+{
+    virtual HRESULT __stdcall RegisterInterfaceInGlobal(IUnknown* pUnk, REFIID riid, DWORD* pdwCookie) = 0;
+    virtual HRESULT __stdcall RevokeInterfaceFromGlobal(DWORD dwCookie) = 0;
+    virtual HRESULT __stdcall GetInterfaceFromGlobal(DWORD dwCookie, REFIID riid, void** ppv) = 0;
+};
+
+struct ISynchronize : public IUnknown
+{
+    virtual HRESULT __stdcall Wait(DWORD dwFlags, DWORD dwMilliseconds) = 0;
+    virtual HRESULT __stdcall Signal() = 0;
+    virtual HRESULT __stdcall Reset() = 0;
+};
+
+struct ICallFactory : public IUnknown
+{
+    virtual HRESULT __stdcall CreateCall(REFIID riid, IUnknown* pCtrlUnk, REFIID riid2, IUnknown** ppv) = 0;
+};
+
+struct ICancelMethodCalls : public IUnknown
+{
+    virtual HRESULT __stdcall Cancel(ULONG ulSeconds) = 0;
+    virtual HRESULT __stdcall TestCancel() = 0;
+};
+
+struct IEnumConnections;
+struct IEnumConnectionPoints;
+struct IConnectionPointContainer;
+
+struct IConnectionPoint : public IUnknown
+{
+    virtual HRESULT __stdcall GetConnectionInterface(IID* pIID) = 0;
+    virtual HRESULT __stdcall GetConnectionPointContainer(IConnectionPointContainer** ppCPC) = 0;
+    virtual HRESULT __stdcall Advise(IUnknown* pUnkSink, DWORD* pdwCookie) = 0;
+    virtual HRESULT __stdcall Unadvise(DWORD dwCookie) = 0;
+    virtual HRESULT __stdcall EnumConnections(IEnumConnections** ppEnum) = 0;
+};
+
+struct IConnectionPointContainer : public IUnknown
+{
+    virtual HRESULT __stdcall EnumConnectionPoints(IEnumConnectionPoints** ppEnum) = 0;
+    virtual HRESULT __stdcall FindConnectionPoint(REFIID riid, IConnectionPoint** ppCP) = 0;
+};
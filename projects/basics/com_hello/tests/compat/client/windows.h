@@ -0,0 +1,5 @@
+#pragma once
+// For the clients in com_hello_client, which include <windows.h> and
+// "../com_hello/midl/IHelloWorld.h": with compat/client as an include directory, both come
+// from compat.
+#include "../Windows.h"
@@ -0,0 +1,3 @@
+#pragma once
+// What com_hello_client finds as ../com_hello/midl/IHelloWorld.h, see compat/client/windows.h
+#include "../../midl/IHelloWorld.h"
@@ -0,0 +1,26 @@
+#pragma once
+// The two compiler intrinsics of <intrin.h> that LatencyBuckets.h and the activation probes
+// use, on top of the GCC and Clang builtins
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+
+// No time stamp counter, nanoseconds of the steady clock stand in for its ticks
+inline uint64_t __rdtsc()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+inline unsigned char _BitScanReverse(unsigned long* index, unsigned long mask)
+{
+    uint32_t value = static_cast<uint32_t>(mask);
+    if (value == 0)
+    {
+        return 0;
+    }
+    *index = 31 - __builtin_clz(value);
+    return 1;
+}
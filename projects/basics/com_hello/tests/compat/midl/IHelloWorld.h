@@ -0,0 +1,70 @@
+#pragma once
+// What MIDL generates from IHelloWorld.idl, for compilers without MIDL. Keep it in sync
+// with IHelloWorld.idl.
+#include "../Windows.h"
+
+typedef LONGLONG hyper;
+
+EXTERN_C const IID IID_IHelloWorld;
+EXTERN_C const IID IID_IHelloWorldGreeter;
+EXTERN_C const IID IID_AsyncIHelloWorldGreeter;
+EXTERN_C const IID IID_IHelloWorldEvents;
+EXTERN_C const IID IID_IHelloWorldStats;
+EXTERN_C const IID LIBID_HelloWorldLib;
+EXTERN_C const CLSID CLSID_HelloWorld;
+
+struct IHelloWorld : public IDispatch
+{
+    virtual HRESULT __stdcall SayHello() = 0;
+    virtual HRESULT __stdcall SayHelloStr(BSTR* greeting) = 0;
+    virtual HRESULT __stdcall SayHelloTo(BSTR name, BSTR* greeting) = 0;
+    virtual HRESULT __stdcall SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings) = 0;
+};
+
+struct IHelloWorldGreeter : public IUnknown
+{
+    virtual HRESULT __stdcall SayHelloTo(BSTR name, BSTR* greeting) = 0;
+};
+
+struct AsyncIHelloWorldGreeter : public IUnknown
+{
+    virtual HRESULT __stdcall Begin_SayHelloTo(BSTR name) = 0;
+    virtual HRESULT __stdcall Finish_SayHelloTo(BSTR* greeting) = 0;
+};
+
+struct IHelloWorldEvents : public IDispatch
+{
+    virtual HRESULT __stdcall OnGreeted(BSTR greeting) = 0;
+};
+
+enum HelloWorldMethod
+{
+    HelloWorldMethodSayHello,
+    HelloWorldMethodSayHelloStr,
+    HelloWorldMethodSayHelloTo,
+    HelloWorldMethodSayHelloToMany
+};
+
+enum HelloWorldCallPath
+{
+    HelloWorldCallVtable,
+    HelloWorldCallDispatch,
+    HelloWorldCallAsync
+};
+
+struct HelloWorldMethodStats
+{
+    hyper calls;
+    hyper failures;
+    hyper timed;
+    hyper p50;
+    hyper p90;
+    hyper p99;
+    hyper max;
+};
+
+struct IHelloWorldStats : public IUnknown
+{
+    virtual HRESULT __stdcall GetMethodStats(HelloWorldMethod method, HelloWorldCallPath path, HelloWorldMethodStats* stats) = 0;
+    virtual HRESULT __stdcall GetLatencyPercentile(HelloWorldMethod method, HelloWorldCallPath path, double percent, hyper* nanoseconds) = 0;
+};
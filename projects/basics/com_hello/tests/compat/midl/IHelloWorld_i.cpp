@@ -0,0 +1,10 @@
+// The IIDs and CLSIDs of IHelloWorld.idl, as MIDL puts them in IHelloWorld_i.c
+#include "IHelloWorld.h"
+
+EXTERN_C const IID IID_IHelloWorld = { 0xA851A7FE, 0x4903, 0x48AF, { 0xA6, 0x94, 0x51, 0xFE, 0xB7, 0x55, 0xEE, 0x5B } };
+EXTERN_C const IID IID_IHelloWorldGreeter = { 0x4CD5B843, 0x3199, 0x4831, { 0xBA, 0xF3, 0xF1, 0xC4, 0x01, 0x5E, 0x21, 0xE4 } };
+EXTERN_C const IID IID_AsyncIHelloWorldGreeter = { 0xC570028A, 0x936D, 0x4E2C, { 0x95, 0xDA, 0xE7, 0x81, 0xB3, 0x22, 0x8D, 0xB2 } };
+EXTERN_C const IID IID_IHelloWorldEvents = { 0xE1B26A50, 0x6450, 0x4BEE, { 0x8B, 0xF7, 0x90, 0x35, 0x1C, 0x48, 0xD9, 0xB1 } };
+EXTERN_C const IID IID_IHelloWorldStats = { 0x7D895865, 0xCB86, 0x4EC7, { 0xBE, 0x8F, 0x91, 0x79, 0xCC, 0x1C, 0xAC, 0x93 } };
+EXTERN_C const IID LIBID_HelloWorldLib = { 0x9EBDD250, 0x565C, 0x4182, { 0xB5, 0xE9, 0x70, 0xCF, 0x63, 0xA8, 0x96, 0xE1 } };
+EXTERN_C const CLSID CLSID_HelloWorld = { 0xDC0F3891, 0x93F3, 0x42E9, { 0xA1, 0x17, 0x72, 0x9B, 0x4F, 0x3C, 0x77, 0x5A } };
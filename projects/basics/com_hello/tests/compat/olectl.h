@@ -0,0 +1,3 @@
+#pragma once
+// Everything is in Windows.h
+#include "Windows.h"
@@ -0,0 +1,42 @@
+#pragma once
+// Winsock, for the AF_UNIX stream sockets of the local server: BSD sockets under their
+// Windows names. A SOCKET is pointer-sized, as on Windows, so it fits into an LPVOID.
+#include "Windows.h"
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef UINT_PTR SOCKET;
+#define INVALID_SOCKET (~static_cast<SOCKET>(0))
+#define SOCKET_ERROR (-1)
+#define SD_BOTH SHUT_RDWR
+#define MAKEWORD(low, high) static_cast<WORD>((static_cast<BYTE>(low)) | (static_cast<WORD>(static_cast<BYTE>(high)) << 8))
+
+struct WSADATA
+{
+    WORD wVersion;
+};
+
+// A send to a closed socket fails on Windows, it doesn't raise a signal
+inline int WSAStartup(WORD version, WSADATA* data)
+{
+    signal(SIGPIPE, SIG_IGN);
+    data->wVersion = version;
+    return 0;
+}
+
+inline int WSACleanup()
+{
+    return 0;
+}
+
+inline int WSAGetLastError()
+{
+    return errno;
+}
+
+inline int closesocket(SOCKET s)
+{
+    return close(static_cast<int>(s));
+}
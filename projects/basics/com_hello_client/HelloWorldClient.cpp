@@ -1,6 +1,7 @@
 #include <windows.h>
 #include <iostream>
 #include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationProbe.h"
 
 int main() {
     HRESULT hr;
@@ -13,14 +14,18 @@ int main() {
     }
 
     CLSID clsid;
+    HELLOWORLD_PROBE_BEGIN(progId);
     hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
     if (FAILED(hr)) {
         std::cerr << "CLSIDFromProgID error: " << hr;
         CoUninitialize();
         return hr;
     }
 
+    HELLOWORLD_PROBE_BEGIN(activation);
     hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
     if (FAILED(hr)) {
         std::cerr << "Failed to create HelloWorld instance. Error code = " << hr;
         CoUninitialize();
@@ -58,6 +63,7 @@ int main() {
     SysFreeString(genericGreeting); // don't forget to free the BSTR allocated for genericGreeting
 
     pHelloWorld->Release();
+    HELLOWORLD_PROBE_DUMP();
     CoUninitialize();
 
     return 0;
@@ -0,0 +1,105 @@
+#include <windows.h>
+#include <iostream>
+#include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationDb.h"
+
+// Activates HelloWorld from the activation database compile.ps1 writes next to the DLL,
+// and compares what the first activation costs with the registry's way.
+//
+// Usage: HelloWorldClient_activationdb [database]
+static const int kLookups = 1000000;
+
+static double Microseconds(const LARGE_INTEGER& start, const LARGE_INTEGER& end)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart;
+}
+
+int wmain(int argc, wchar_t** argv) {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    // Open the database, find the ProgID and create the object: everything a client does
+    // before its first call
+    LARGE_INTEGER start, opened, found, created;
+    QueryPerformanceCounter(&start);
+    ActivationDb* db = NULL;
+    hr = ActivationDb::Open(argc > 1 ? argv[1] : L"..\\com_hello\\HelloWorld.actdb", &db);
+    QueryPerformanceCounter(&opened);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to open the activation database. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+    QueryPerformanceCounter(&found);
+    if (FAILED(hr)) {
+        std::cerr << "FindProgId error: " << hr << "\n";
+        delete db;
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorld* pHelloWorld = NULL;
+    hr = db->CreateInstance(clsid, NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    QueryPerformanceCounter(&created);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        delete db;
+        CoUninitialize();
+        return hr;
+    }
+
+    std::cout << "database: open " << Microseconds(start, opened) << " us, ProgID " << Microseconds(opened, found)
+              << " us, first activation " << Microseconds(found, created) << " us (module load included)\n";
+
+    BSTR name = SysAllocString(L"John Doe");
+    BSTR greeting = NULL;
+    hr = pHelloWorld->SayHelloTo(name, &greeting);
+    if (SUCCEEDED(hr)) {
+        std::wcout << greeting << L"\n";
+    }
+    else {
+        std::cerr << "Failed to call SayHelloTo method. Error code = " << hr << "\n";
+    }
+    SysFreeString(greeting);
+    pHelloWorld->Release();
+
+    // The same through the registry, now that the DLL is loaded already
+    IHelloWorld* pRegistered = NULL;
+    QueryPerformanceCounter(&start);
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    QueryPerformanceCounter(&found);
+    if (SUCCEEDED(hr)) {
+        hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pRegistered);
+    }
+    QueryPerformanceCounter(&created);
+    if (SUCCEEDED(hr)) {
+        std::cout << "registry: ProgID " << Microseconds(start, found) << " us, first activation "
+                  << Microseconds(found, created) << " us\n";
+        pRegistered->Release();
+    }
+    else {
+        std::cerr << "Registry activation failed (is the DLL registered?). Error code = " << hr << "\n";
+    }
+
+    // And the lookup alone, over and over
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < kLookups; ++i) {
+        db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+    }
+    QueryPerformanceCounter(&found);
+    std::cout << "database: " << Microseconds(start, found) * 1000 / kLookups << " ns per ProgID lookup\n";
+
+    SysFreeString(name);
+    delete db;
+    CoUninitialize();
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <windows.h>
+#include <iostream>
+#include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationDb.h"
+#include "../com_hello/ClassManifest.h"
+#include "../com_hello/ActivationProbe.h"
+
+// Activates HelloWorld over and over through one of the ways the other clients do, and
+// prints where the time went, stage by stage, see ActivationProbe.h. Build the DLL with
+// /DHELLOWORLD_ACTIVATION_PROBES too to see the stages inside it.
+//
+// Usage: HelloWorldClient_activationprobe [registry|factory|database|manifest] [count]
+//
+// Set HELLOWORLD_PROBE_FORMAT=json for JSON.
+#ifndef HELLOWORLD_ACTIVATION_PROBES
+#error Build HelloWorldClient_activationprobe with /DHELLOWORLD_ACTIVATION_PROBES
+#endif
+
+enum ActivationPath
+{
+    ActivationPathRegistry,     // CLSIDFromProgID and CoCreateInstance
+    ActivationPathFactory,      // CLSIDFromProgID, CoGetClassObject and CreateInstance
+    ActivationPathDatabase,     // ActivationDb
+    ActivationPathManifest      // ClassManifestLoader
+};
+
+int wmain(int argc, wchar_t** argv) {
+    static const wchar_t* const paths[] = { L"registry", L"factory", L"database", L"manifest" };
+    int path = -1;
+    for (int i = 0; i < ARRAYSIZE(paths); ++i) {
+        if (_wcsicmp(argc > 1 ? argv[1] : L"registry", paths[i]) == 0) {
+            path = i;
+        }
+    }
+    int count = argc > 2 ? _wtoi(argv[2]) : 10000;
+    if (path < 0 || count <= 0) {
+        std::cerr << "Usage: HelloWorldClient_activationprobe [registry|factory|database|manifest] [count]\n";
+        return 1;
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    // Opening the database or loading the manifest is done once, like a client would
+    ActivationDb* db = NULL;
+    ClassManifestLoader* loader = NULL;
+    if (path == ActivationPathDatabase) {
+        hr = ActivationDb::Open(L"..\\com_hello\\HelloWorld.actdb", &db);
+    }
+    else if (path == ActivationPathManifest) {
+        LPCWSTR modules[] = { L"..\\com_hello\\HelloWorld.dll" };
+        hr = ClassManifestLoader::Create(modules, ARRAYSIZE(modules), &loader);
+    }
+    if (FAILED(hr)) {
+        std::cerr << "Failed to open the activation database or manifest. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    for (int i = 0; i < count && SUCCEEDED(hr); ++i) {
+        CLSID clsid;
+        HELLOWORLD_PROBE_BEGIN(progId);
+        if (path == ActivationPathDatabase)
+            hr = db->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+        else if (path == ActivationPathManifest)
+            hr = loader->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+        else
+            hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+        HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
+        if (FAILED(hr)) {
+            std::cerr << "ProgID lookup error: " << hr << "\n";
+            break;
+        }
+
+        IHelloWorld* pHelloWorld = NULL;
+        HELLOWORLD_PROBE_BEGIN(activation);
+        if (path == ActivationPathDatabase) {
+            hr = db->CreateInstance(clsid, NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+        }
+        else if (path == ActivationPathManifest) {
+            hr = loader->CreateInstance(clsid, NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+        }
+        else if (path == ActivationPathFactory) {
+            IClassFactory* pClassFactory = NULL;
+            hr = CoGetClassObject(clsid, CLSCTX_INPROC_SERVER, NULL, IID_IClassFactory, (void**)&pClassFactory);
+            if (SUCCEEDED(hr)) {
+                hr = pClassFactory->CreateInstance(NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+                pClassFactory->Release();
+            }
+        }
+        else {
+            hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+        }
+        HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
+        if (FAILED(hr)) {
+            std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+            break;
+        }
+        pHelloWorld->Release();
+    }
+
+    if (SUCCEEDED(hr)) {
+        HELLOWORLD_PROBE_DUMP();
+    }
+    delete loader;
+    delete db;
+    CoUninitialize();
+
+    return SUCCEEDED(hr) ? 0 : hr;
+}
@@ -3,6 +3,7 @@
 #include <atlbase.h>
 #include <atlstr.h>
 #include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationProbe.h"
 
 int main() {
     HRESULT hr = CoInitialize(NULL);
@@ -12,7 +13,9 @@ int main() {
     }
 
     CComPtr<IHelloWorld> pHelloWorld;
+    HELLOWORLD_PROBE_BEGIN(activation);
     hr = pHelloWorld.CoCreateInstance(__uuidof(HelloWorld));
+    HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
 
     if (FAILED(hr)) {
         std::cerr << "Failed to create HelloWorld instance. Error code = " << hr;
@@ -32,6 +35,8 @@ int main() {
         std::cerr << "Failed to call SayHelloTo method. Error code = " << hr;
     }
 
+    HELLOWORLD_PROBE_DUMP();
+
     // Remember to uninitialize when you're done.
     CoUninitialize();
     return 0;
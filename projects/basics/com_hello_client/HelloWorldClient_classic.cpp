@@ -2,6 +2,7 @@
 #include <objbase.h>
 #include <Windows.h>
 #include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationProbe.h"
 
 int main()
 {
@@ -14,7 +15,9 @@ int main()
     }
 
     CLSID clsid;
+    HELLOWORLD_PROBE_BEGIN(progId);
     hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
     if (FAILED(hr))
     {
         std::cout << "CLSIDFromProgID() failed. Error code = 0x" 
@@ -23,7 +26,9 @@ int main()
     }
 
     IHelloWorld* pHelloWorld;
+    HELLOWORLD_PROBE_BEGIN(activation);
     hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, IID_IHelloWorld, (LPVOID*)&pHelloWorld);
+    HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
     if (FAILED(hr))
     {
         std::cout << "CoCreateInstance() failed. Error code = 0x" 
@@ -46,6 +51,7 @@ int main()
 
     pHelloWorld->Release();
 
+    HELLOWORLD_PROBE_DUMP();
     CoUninitialize();
 
     return 0;
@@ -0,0 +1,139 @@
+#include "HelloWorldCoroutines.h"
+#include <iostream>
+#include <stdlib.h>
+
+// Thousands of coroutines greeting at the same time, on a handful of threads. Every
+// coroutine has one SayHelloTo in flight at a time. The object runs them on its own
+// thread pool, see HelloWorldGreeter.h.
+typedef HelloWorldAsyncClient<HelloWorldExecutor> AsyncHelloWorld;
+
+static std::atomic<long> s_running(0);
+static std::atomic<long> s_inFlight(0);
+static std::atomic<long> s_peakInFlight(0);
+static std::atomic<long> s_failed(0);
+static HANDLE s_done = NULL;
+
+static HelloWorldTask GreetMany(AsyncHelloWorld& helloWorld, BSTR name, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        long inFlight = s_inFlight.fetch_add(1) + 1;
+        long peak = s_peakInFlight.load();
+        while (inFlight > peak && !s_peakInFlight.compare_exchange_weak(peak, inFlight))
+        {
+        }
+
+        BSTR greeting = NULL;
+        HRESULT hr = co_await helloWorld.SayHelloTo(name, &greeting);
+        s_inFlight.fetch_sub(1);
+        SysFreeString(greeting);
+
+        if (hr == RPC_E_SERVER_TOO_BUSY)
+        {
+            // The object has more calls waiting than it accepts, let the others go first
+            co_await helloWorld.Schedule();
+            --i;
+        }
+        else if (FAILED(hr))
+        {
+            co_return hr;
+        }
+    }
+    co_return S_OK;
+}
+
+static HelloWorldTask Run(AsyncHelloWorld& helloWorld, BSTR name, int count)
+{
+    HRESULT hr = co_await GreetMany(helloWorld, name, count);
+    if (FAILED(hr))
+    {
+        s_failed.fetch_add(1);
+    }
+    if (s_running.fetch_sub(1) == 1)
+    {
+        SetEvent(s_done);
+    }
+    co_return hr;
+}
+
+// Usage: HelloWorldClient_coroutine [coroutines] [greetings per coroutine] [threads]
+int main(int argc, char** argv) {
+    int coroutines = (argc > 1) ? atoi(argv[1]) : 4000;
+    int greetings = (argc > 2) ? atoi(argv[2]) : 100;
+    UINT32 threads = (argc > 3) ? strtoul(argv[3], NULL, 10) : 4;
+    if (coroutines <= 0 || greetings <= 0) {
+        std::cerr << "Usage: HelloWorldClient_coroutine [coroutines] [greetings per coroutine] [threads]\n";
+        return 1;
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    if (FAILED(hr)) {
+        std::cerr << "CLSIDFromProgID error: " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorld* pHelloWorld = NULL;
+    hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    HelloWorldExecutor executor;
+    hr = executor.Start(threads);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to start the executor. Error code = " << hr << "\n";
+        pHelloWorld->Release();
+        CoUninitialize();
+        return hr;
+    }
+
+    s_done = CreateEvent(NULL, TRUE, FALSE, NULL);
+    BSTR name = SysAllocString(L"John Doe");
+    {
+        AsyncHelloWorld helloWorld(pHelloWorld, executor);
+        hr = helloWorld.Initialize();
+        if (FAILED(hr)) {
+            std::cerr << "HelloWorld can't make asynchronous calls. Error code = " << hr << "\n";
+        }
+        else {
+            LARGE_INTEGER frequency, start, end;
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&start);
+
+            s_running = coroutines;
+            for (int i = 0; i < coroutines; ++i) {
+                if (FAILED(Run(helloWorld, name, greetings).Start())) {
+                    s_failed.fetch_add(1);
+                    if (s_running.fetch_sub(1) == 1) {
+                        SetEvent(s_done);
+                    }
+                }
+            }
+            WaitForSingleObject(s_done, INFINITE);
+
+            QueryPerformanceCounter(&end);
+            double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+            double total = static_cast<double>(coroutines) * greetings;
+            std::cout << coroutines << " coroutines on " << threads << " threads: " << total / seconds << " greetings/s, "
+                      << s_peakInFlight.load() << " in flight at most, " << s_failed.load() << " failed\n";
+        }
+        executor.Stop();
+    }
+
+    CloseHandle(s_done);
+    SysFreeString(name);
+    pHelloWorld->Release();
+    CoUninitialize();
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <windows.h>
+#include <iostream>
+#include "../com_hello/midl/IHelloWorld.h"
+
+// Listens to OnGreeted with 1, 10 and 1000 sinks at once, and measures what firing the
+// event to all of them adds to a greeting.
+static const int kGreetings = 100000;
+
+// Counts the greetings it hears about. Only used on this thread, so nothing is interlocked.
+class GreetingCounter : public IHelloWorldEvents
+{
+    long m_cRef;
+
+public:
+    long m_greetings;
+
+    GreetingCounter() : m_cRef(1), m_greetings(0) {}
+
+    HRESULT __stdcall QueryInterface(const IID& riid, void** ppv)
+    {
+        if (riid == IID_IUnknown || riid == IID_IDispatch || riid == IID_IHelloWorldEvents)
+        {
+            *ppv = static_cast<IHelloWorldEvents*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    ULONG __stdcall AddRef() { return ++m_cRef; }
+    ULONG __stdcall Release()
+    {
+        long cRef = --m_cRef;
+        if (cRef == 0)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    // IHelloWorldEvents is dual. HelloWorld calls a sink that implements it through the
+    // vtable, so this is only for clients that look for the event by DISPID.
+    HRESULT __stdcall GetTypeInfoCount(UINT* pctinfo)
+    {
+        *pctinfo = 0;
+        return S_OK;
+    }
+    HRESULT __stdcall GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo)
+    {
+        *ppTInfo = NULL;
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall GetIDsOfNames(const IID& riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId)
+    {
+        return E_NOTIMPL;
+    }
+    HRESULT __stdcall Invoke(DISPID dispIdMember, const IID& riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams,
+                             VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr)
+    {
+        if (dispIdMember != 1)
+        {
+            return DISP_E_MEMBERNOTFOUND;
+        }
+        if (pDispParams->cArgs != 1 || V_VT(&pDispParams->rgvarg[0]) != VT_BSTR)
+        {
+            return DISP_E_BADPARAMCOUNT;
+        }
+        return OnGreeted(V_BSTR(&pDispParams->rgvarg[0]));
+    }
+
+    HRESULT __stdcall OnGreeted(BSTR greeting)
+    {
+        ++m_greetings;
+        return S_OK;
+    }
+};
+
+// Greets kGreetings times and returns the nanoseconds per greeting
+static double TimeGreetings(IHelloWorld* pHelloWorld, BSTR name)
+{
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < kGreetings; ++i) {
+        BSTR greeting = NULL;
+        pHelloWorld->SayHelloTo(name, &greeting);
+        SysFreeString(greeting);
+    }
+    QueryPerformanceCounter(&end);
+    return (end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart / kGreetings;
+}
+
+int main() {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    if (FAILED(hr)) {
+        std::cerr << "CLSIDFromProgID error: " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorld* pHelloWorld = NULL;
+    hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    BSTR name = SysAllocString(L"John Doe");
+    std::cout << "no sinks: " << TimeGreetings(pHelloWorld, name) << " ns per greeting\n";
+
+    IConnectionPointContainer* pContainer = NULL;
+    IConnectionPoint* pPoint = NULL;
+    hr = pHelloWorld->QueryInterface(IID_IConnectionPointContainer, (void**)&pContainer);
+    if (SUCCEEDED(hr)) {
+        hr = pContainer->FindConnectionPoint(IID_IHelloWorldEvents, &pPoint);
+    }
+    if (FAILED(hr)) {
+        std::cerr << "Failed to find the connection point. Error code = " << hr << "\n";
+    }
+
+    static const int fanOuts[] = { 1, 10, 1000 };
+    for (int f = 0; f < 3 && SUCCEEDED(hr); ++f) {
+        int count = fanOuts[f];
+        GreetingCounter** sinks = new GreetingCounter*[count];
+        DWORD* cookies = new DWORD[count];
+        for (int i = 0; i < count; ++i) {
+            sinks[i] = new GreetingCounter;
+            cookies[i] = 0;
+            if (SUCCEEDED(hr)) {
+                hr = pPoint->Advise(sinks[i], &cookies[i]);
+            }
+        }
+
+        if (SUCCEEDED(hr)) {
+            double ns = TimeGreetings(pHelloWorld, name);
+            std::cout << count << " sinks: " << ns << " ns per greeting, " << ns / count << " ns per sink, "
+                      << sinks[count - 1]->m_greetings << " greetings heard by the last sink\n";
+        }
+        else {
+            std::cerr << "Failed to advise a sink. Error code = " << hr << "\n";
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (cookies[i] != 0) {
+                pPoint->Unadvise(cookies[i]);
+            }
+            sinks[i]->Release();
+        }
+        delete[] cookies;
+        delete[] sinks;
+    }
+
+    if (pPoint != NULL) {
+        pPoint->Release();
+    }
+    if (pContainer != NULL) {
+        pContainer->Release();
+    }
+    SysFreeString(name);
+    pHelloWorld->Release();
+    CoUninitialize();
+
+    return 0;
+}
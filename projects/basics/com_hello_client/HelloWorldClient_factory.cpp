@@ -1,6 +1,7 @@
 #include <windows.h>
 #include <iostream>
 #include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ActivationProbe.h"
 
 int main() {
     HRESULT hr;
@@ -14,13 +15,17 @@ int main() {
     }
 
     CLSID clsid;
+    HELLOWORLD_PROBE_BEGIN(progId);
     hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    HELLOWORLD_PROBE_END(progId, ActivationStageProgId);
     if (FAILED(hr)) {
         std::cerr << "CLSIDFromProgID error: " << hr;
         CoUninitialize();
         return hr;
     }
 
+    // Activation here is getting the class object and creating the instance
+    HELLOWORLD_PROBE_BEGIN(activation);
     hr = CoGetClassObject(clsid, CLSCTX_INPROC_SERVER, NULL, IID_IClassFactory, (void**)&pClassFactory);
     if (FAILED(hr)) {
         std::cerr << "Failed to get ClassFactory. Error code = " << hr;
@@ -31,6 +36,7 @@ int main() {
     pClassFactory->LockServer(TRUE);
     
     hr = pClassFactory->CreateInstance(NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    HELLOWORLD_PROBE_END(activation, ActivationStageActivation);
     if (FAILED(hr)) {
         std::cerr << "Failed to create HelloWorld instance. Error code = " << hr;
         pClassFactory->LockServer(FALSE);
@@ -72,6 +78,7 @@ int main() {
     pHelloWorld->Release();
     pClassFactory->LockServer(FALSE);
     pClassFactory->Release();
+    HELLOWORLD_PROBE_DUMP();
     CoUninitialize();
 
     return 0;
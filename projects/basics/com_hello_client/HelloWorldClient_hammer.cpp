@@ -0,0 +1,161 @@
+#include <windows.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "../com_hello/midl/IHelloWorld.h"
+
+// Hammers one shared HelloWorld from many MTA threads at once: each thread takes its own
+// reference, greets and releases it again, over and over. Every greeting must come back
+// the same, and once the threads are done the object must hold exactly the one reference
+// main started with. Prints how the greetings per second scale from one thread up to the
+// number given on the command line, or one per processor.
+static const int kGreetingsPerThread = 200000;
+
+struct HammerResult
+{
+    LONGLONG greetings;
+    LONGLONG failures;      // failed calls, or greetings that came back different
+};
+
+static void Hammer(IHelloWorld* pHelloWorld, BSTR name, BSTR expected, HammerResult* result)
+{
+    result->greetings = 0;
+    result->failures = 0;
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        result->failures = kGreetingsPerThread;
+        return;
+    }
+
+    for (int i = 0; i < kGreetingsPerThread; ++i) {
+        pHelloWorld->AddRef();
+        BSTR greeting = NULL;
+        hr = pHelloWorld->SayHelloTo(name, &greeting);
+        if (FAILED(hr) || greeting == NULL || wcscmp(greeting, expected) != 0) {
+            ++result->failures;
+        }
+        else {
+            ++result->greetings;
+        }
+        SysFreeString(greeting);
+        pHelloWorld->Release();
+    }
+
+    CoUninitialize();
+}
+
+// Runs 'threads' threads against the object and returns the greetings per second, or a
+// negative number if any of them failed
+static double RunThreads(IHelloWorld* pHelloWorld, BSTR name, BSTR expected, unsigned threads)
+{
+    std::vector<HammerResult> results(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(Hammer, pHelloWorld, name, expected, &results[i]);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    QueryPerformanceCounter(&end);
+
+    LONGLONG greetings = 0;
+    LONGLONG failures = 0;
+    for (const HammerResult& result : results) {
+        greetings += result.greetings;
+        failures += result.failures;
+    }
+    if (failures != 0) {
+        std::cerr << failures << " of " << greetings + failures << " greetings on " << threads << " threads failed\n";
+        return -1;
+    }
+    return greetings * static_cast<double>(frequency.QuadPart) / (end.QuadPart - start.QuadPart);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned maxThreads = (argc > 1) ? static_cast<unsigned>(atoi(argv[1])) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    if (FAILED(hr)) {
+        std::cerr << "CLSIDFromProgID error: " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    // ThreadingModel=Both and the free-threaded marshaler: every MTA thread gets this very
+    // pointer, no proxy
+    IHelloWorld* pHelloWorld = NULL;
+    hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    // What every thread must get back
+    BSTR name = SysAllocString(L"John Doe");
+    BSTR expected = NULL;
+    hr = pHelloWorld->SayHelloTo(name, &expected);
+    if (FAILED(hr)) {
+        std::cerr << "SayHelloTo failed. Error code = " << hr << "\n";
+        SysFreeString(name);
+        pHelloWorld->Release();
+        CoUninitialize();
+        return hr;
+    }
+
+    int exitCode = 0;
+    double single = 0;
+    std::cout << "threads  greetings/s  speedup\n";
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate = RunThreads(pHelloWorld, name, expected, threads);
+        if (rate < 0) {
+            exitCode = 1;
+            break;
+        }
+        if (threads == 1) {
+            single = rate;
+        }
+        char line[64];
+        sprintf_s(line, sizeof(line), "%7u %12.0f %8.2f\n", threads, rate, rate / single);
+        std::cout << line;
+
+        // Ends with exactly maxThreads threads, whether it is a power of two or not
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;
+        }
+    }
+
+    // All threads have released what they took, so only main's reference is left. The
+    // return values of AddRef and Release are only meant for diagnostics like this one.
+    pHelloWorld->AddRef();
+    ULONG refs = pHelloWorld->Release();
+    if (refs != 1) {
+        std::cerr << "The object holds " << refs << " references instead of 1\n";
+        exitCode = 1;
+    }
+
+    SysFreeString(expected);
+    SysFreeString(name);
+    pHelloWorld->Release();
+    CoUninitialize();
+
+    return exitCode;
+}
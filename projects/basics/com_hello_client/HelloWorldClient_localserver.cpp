@@ -0,0 +1,106 @@
+#include "../com_hello/LocalServer.h"
+#include "../com_hello/gen/IHelloWorld_wire.h"
+#include "../com_hello/midl/IHelloWorld.h"
+#include "HelloWorldTimedCalls.h"
+#include <iostream>
+
+// Talks to HelloWorldLocalServer.exe, which must be running already.
+// A few threads share one connection, their calls are pipelined over it. Prints the calls
+// per second and the median and 99th percentile latency, then the same for the same calls
+// on an in-process HelloWorld, if one is registered.
+static const int kThreads = 4;
+static const int kCallsPerThread = 1000;
+
+static LocalServerConnection* s_connection = NULL;
+static IHelloWorld* s_pHelloWorld = NULL;
+
+static DWORD WINAPI GreetMany(LPVOID param)
+{
+    HelloWorldTimedThread* thread = static_cast<HelloWorldTimedThread*>(param);
+
+    // Every thread needs its own call object, the connection is shared
+    LocalServerCall call(s_connection);
+    IHelloWorldWireProxy helloWorld(&call);
+
+    BSTR name = SysAllocString(thread->name);
+    for (int i = 0; i < kCallsPerThread && SUCCEEDED(thread->hr); ++i)
+    {
+        BSTR greeting = NULL;
+        LONGLONG start = HelloWorldTimedThread::Now();
+        thread->Add(start, helloWorld.SayHelloTo(name, &greeting));
+        SysFreeString(greeting);
+    }
+    SysFreeString(name);
+    return 0;
+}
+
+// The same calls on the in-process object, which every MTA thread calls directly
+static DWORD WINAPI GreetManyInProc(LPVOID param)
+{
+    HelloWorldTimedThread* thread = static_cast<HelloWorldTimedThread*>(param);
+    thread->hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(thread->hr))
+    {
+        return 0;
+    }
+
+    BSTR name = SysAllocString(thread->name);
+    for (int i = 0; i < kCallsPerThread && SUCCEEDED(thread->hr); ++i)
+    {
+        BSTR greeting = NULL;
+        LONGLONG start = HelloWorldTimedThread::Now();
+        thread->Add(start, s_pHelloWorld->SayHelloTo(name, &greeting));
+        SysFreeString(greeting);
+    }
+    SysFreeString(name);
+    CoUninitialize();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed\n";
+        return 1;
+    }
+
+    // Optional: the socket path the server was started with
+    HRESULT hr = LocalServerConnection::Connect(argc > 1 ? argv[1] : NULL, &s_connection);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to connect to HelloWorldLocalServer. Error code = " << hr << "\n";
+        WSACleanup();
+        return hr;
+    }
+
+    static const OLECHAR* names[kThreads] = { L"John Doe", L"Jane Doe", L"Max Mustermann", L"Erika Mustermann" };
+    HelloWorldTimedThread threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        threads[i].name = names[i];
+    }
+
+    // The first round warms up the connection and the server's object
+    RunTimedThreads("warm-up", GreetMany, threads, kThreads);
+    hr = RunTimedThreads("local server", GreetMany, threads, kThreads);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to call SayHelloTo method. Error code = " << hr << "\n";
+    }
+    delete s_connection;
+    WSACleanup();
+
+    // The baseline: the same object in this process
+    hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (SUCCEEDED(hr)) {
+        CLSID clsid;
+        if (SUCCEEDED(CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid)) &&
+            SUCCEEDED(CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&s_pHelloWorld))) {
+            RunTimedThreads("warm-up", GreetManyInProc, threads, kThreads);
+            RunTimedThreads("in-process", GreetManyInProc, threads, kThreads);
+            s_pHelloWorld->Release();
+        }
+        else {
+            std::cout << "No in-process HelloWorld registered to compare with\n";
+        }
+        CoUninitialize();
+    }
+    return 0;
+}
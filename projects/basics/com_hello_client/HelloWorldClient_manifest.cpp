@@ -0,0 +1,82 @@
+#include <windows.h>
+#include <iostream>
+#include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ClassManifest.h"
+
+// Activates HelloWorld from the manifest HelloWorld.dll exports, without reading the
+// registry or any file besides the DLL itself. Works on a machine where the DLL was never
+// registered.
+//
+// Usage: HelloWorldClient_manifest [module]
+static double Microseconds(const LARGE_INTEGER& start, const LARGE_INTEGER& end)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart;
+}
+
+int wmain(int argc, wchar_t** argv) {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    // Load the module and index its manifest, find the ProgID and create the object:
+    // everything a client does before its first call
+    LARGE_INTEGER start, loaded, found, created;
+    LPCWSTR modules[] = { argc > 1 ? argv[1] : L"..\\com_hello\\HelloWorld.dll" };
+    QueryPerformanceCounter(&start);
+    ClassManifestLoader* loader = NULL;
+    hr = ClassManifestLoader::Create(modules, ARRAYSIZE(modules), &loader);
+    QueryPerformanceCounter(&loaded);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to load the class manifest. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = loader->FindProgId(L"HelloWorldLib.HelloWorld", &clsid);
+    QueryPerformanceCounter(&found);
+    if (FAILED(hr)) {
+        std::cerr << "FindProgId error: " << hr << "\n";
+        delete loader;
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorld* pHelloWorld = NULL;
+    hr = loader->CreateInstance(clsid, NULL, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    QueryPerformanceCounter(&created);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        delete loader;
+        CoUninitialize();
+        return hr;
+    }
+
+    const ClassManifestClass* info = loader->FindClsid(clsid);
+    std::wcout << info->progId << L" " << info->clsidString << L", ThreadingModel " << info->ThreadingModel()
+               << L", " << info->interfaceCount << L" interfaces\n";
+    std::cout << "load and index " << Microseconds(start, loaded) << " us (module load included), ProgID "
+              << Microseconds(loaded, found) << " us, first activation " << Microseconds(found, created) << " us\n";
+
+    BSTR name = SysAllocString(L"John Doe");
+    BSTR greeting = NULL;
+    hr = pHelloWorld->SayHelloTo(name, &greeting);
+    if (SUCCEEDED(hr)) {
+        std::wcout << greeting << L"\n";
+    }
+    else {
+        std::cerr << "Failed to call SayHelloTo method. Error code = " << hr << "\n";
+    }
+
+    SysFreeString(greeting);
+    SysFreeString(name);
+    pHelloWorld->Release();
+    delete loader;
+    CoUninitialize();
+
+    return 0;
+}
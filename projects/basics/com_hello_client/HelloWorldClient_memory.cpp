@@ -0,0 +1,134 @@
+#include <windows.h>
+#include <iostream>
+#include <stdio.h>
+#include "../com_hello/midl/IHelloWorld.h"
+#include "../com_hello/ModuleAccounting.h"
+
+// Creates HelloWorld objects and their tear-offs, forgets to release some of them, and
+// shows what HelloWorld.dll reports about its live objects and memory before and after the
+// rest are released, see ModuleAccounting.h. Run it with HELLOWORLD_ALLOC_SITES=1 to also
+// see where each of the forgotten objects was created.
+static const int kObjects = 1000;
+static const int kLeaked = 3;
+
+typedef HRESULT (__stdcall *GetMemoryStatsFunc)(ModuleMemoryStats* stats);
+typedef HRESULT (__stdcall *GetAllocationSitesFunc)(ModuleAllocationSite* sites, UINT32 capacity, UINT32* count);
+
+static void PrintMemoryStats(GetMemoryStatsFunc getMemoryStats, const char* title)
+{
+    ModuleMemoryStats stats;
+    HRESULT hr = getMemoryStats(&stats);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to read the memory statistics. Error code = " << hr << "\n";
+        return;
+    }
+
+    static const char* const kinds[] = { "HelloWorld", "factory references", "greeters", "greeter calls",
+                                         "stats tear-offs", "connection points", "event queues" };
+    std::cout << title << "\n";
+    std::cout << "class                     live  high water     created       bytes\n";
+    for (int kind = 0; kind < ModuleObjectKinds; ++kind) {
+        const ModuleObjectCounts& objects = stats.objects[kind];
+        char line[128];
+        sprintf_s(line, sizeof(line), "%-20s %9lld %11lld %11lld %11lld\n", kinds[kind],
+                  objects.live, objects.highWater, objects.created, objects.bytes);
+        std::cout << line;
+    }
+    std::cout << "module locks: " << stats.moduleLocks << "\n";
+    std::cout << "BSTRs allocated: " << stats.bstrs.allocations << " (" << stats.bstrs.bytes << " bytes), held by the server: "
+              << stats.bstrs.held << " (" << stats.bstrs.heldBytes << " bytes)\n";
+    std::cout << "allocation sites: " << stats.sites << ", dropped: " << stats.sitesDropped << "\n\n";
+}
+
+static void PrintAllocationSites(GetAllocationSitesFunc getAllocationSites)
+{
+    ModuleAllocationSite sites[16];
+    UINT32 count = 0;
+    HRESULT hr = getAllocationSites(sites, ARRAYSIZE(sites), &count);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to read the allocation sites. Error code = " << hr << "\n";
+        return;
+    }
+
+    // Look the addresses up in the debugger, e.g. 'ln <address>' in WinDbg
+    for (UINT32 i = 0; i < count && i < ARRAYSIZE(sites); ++i) {
+        std::cout << "object " << sites[i].object << " of kind " << sites[i].kind << ", created at tick " << sites[i].tick << ":\n";
+        for (UINT32 frame = 0; frame < sites[i].frameCount; ++frame) {
+            std::cout << "    " << sites[i].frames[frame] << "\n";
+        }
+    }
+    if (hr == S_FALSE) {
+        std::cout << "... and " << count - ARRAYSIZE(sites) << " more\n";
+    }
+    std::cout << "\n";
+}
+
+int main() {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    if (FAILED(hr)) {
+        std::cerr << "CLSIDFromProgID error: " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    // Creating the first object loads the DLL, and the statistics come from inside it
+    IHelloWorld* objects[kObjects] = {};
+    for (int i = 0; i < kObjects && SUCCEEDED(hr); ++i) {
+        hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&objects[i]);
+    }
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        for (int i = 0; i < kObjects && objects[i] != NULL; ++i) {
+            objects[i]->Release();
+        }
+        CoUninitialize();
+        return hr;
+    }
+
+    HMODULE hModule = GetModuleHandleW(L"HelloWorld.dll");
+    GetMemoryStatsFunc getMemoryStats = (GetMemoryStatsFunc)GetProcAddress(hModule, "DllGetMemoryStats");
+    GetAllocationSitesFunc getAllocationSites = (GetAllocationSitesFunc)GetProcAddress(hModule, "DllGetAllocationSites");
+    if (getMemoryStats == NULL || getAllocationSites == NULL) {
+        std::cerr << "HelloWorld.dll doesn't export DllGetMemoryStats and DllGetAllocationSites\n";
+        for (int i = 0; i < kObjects; ++i) {
+            objects[i]->Release();
+        }
+        CoUninitialize();
+        return E_NOTIMPL;
+    }
+
+    // Every object greets once and hands out a tear-off or two
+    BSTR name = SysAllocString(L"John Doe");
+    for (int i = 0; i < kObjects; ++i) {
+        BSTR greeting = NULL;
+        objects[i]->SayHelloTo(name, &greeting);
+        SysFreeString(greeting);
+
+        IHelloWorldStats* pStats = NULL;
+        if (SUCCEEDED(objects[i]->QueryInterface(IID_IHelloWorldStats, (void**)&pStats))) {
+            // The first kLeaked keep theirs, as if someone forgot to release it
+            if (i >= kLeaked) {
+                pStats->Release();
+            }
+        }
+    }
+    SysFreeString(name);
+    PrintMemoryStats(getMemoryStats, "With all objects alive:");
+
+    for (int i = 0; i < kObjects; ++i) {
+        objects[i]->Release();
+    }
+    PrintMemoryStats(getMemoryStats, "With all objects released, but for the leaked tear-offs and what they hold:");
+    PrintAllocationSites(getAllocationSites);
+
+    CoUninitialize();
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../com_hello/SharedMemory.h"
+#include "../com_hello/gen/IHelloWorld_wire.h"
+#include "../com_hello/midl/IHelloWorld.h"
+#include "HelloWorldTimedCalls.h"
+#include <iostream>
+
+// Talks to HelloWorldLocalServer.exe /shm, which must be running already.
+// Every thread opens a shared memory channel of its own. Prints the calls per second and the
+// median and 99th percentile latency, then the same for the same calls on an in-process
+// HelloWorld, if one is registered.
+static const int kThreads = 4;
+static const int kCallsPerThread = 1000;
+
+static const char* s_name = NULL;
+static IHelloWorld* s_pHelloWorld = NULL;
+
+static DWORD WINAPI GreetMany(LPVOID param)
+{
+    HelloWorldTimedThread* thread = static_cast<HelloWorldTimedThread*>(param);
+
+    // Opening the channel isn't timed, only the calls on it
+    SharedMemoryChannel* channel;
+    thread->hr = SharedMemoryChannel::Open(s_name, &channel);
+    if (FAILED(thread->hr))
+    {
+        return 0;
+    }
+    IHelloWorldWireProxy helloWorld(channel);
+
+    BSTR name = SysAllocString(thread->name);
+    for (int i = 0; i < kCallsPerThread && SUCCEEDED(thread->hr); ++i)
+    {
+        BSTR greeting = NULL;
+        LONGLONG start = HelloWorldTimedThread::Now();
+        thread->Add(start, helloWorld.SayHelloTo(name, &greeting));
+        SysFreeString(greeting);
+    }
+    SysFreeString(name);
+    delete channel;
+    return 0;
+}
+
+// The same calls on the in-process object, which every MTA thread calls directly
+static DWORD WINAPI GreetManyInProc(LPVOID param)
+{
+    HelloWorldTimedThread* thread = static_cast<HelloWorldTimedThread*>(param);
+    thread->hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(thread->hr))
+    {
+        return 0;
+    }
+
+    BSTR name = SysAllocString(thread->name);
+    for (int i = 0; i < kCallsPerThread && SUCCEEDED(thread->hr); ++i)
+    {
+        BSTR greeting = NULL;
+        LONGLONG start = HelloWorldTimedThread::Now();
+        thread->Add(start, s_pHelloWorld->SayHelloTo(name, &greeting));
+        SysFreeString(greeting);
+    }
+    SysFreeString(name);
+    CoUninitialize();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // Optional: the section name the server was started with
+    s_name = (argc > 1) ? argv[1] : NULL;
+
+    static const OLECHAR* names[kThreads] = { L"John Doe", L"Jane Doe", L"Max Mustermann", L"Erika Mustermann" };
+    HelloWorldTimedThread threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        threads[i].name = names[i];
+    }
+
+    // The first round warms up the channels and the server's objects
+    RunTimedThreads("warm-up", GreetMany, threads, kThreads);
+    HRESULT hr = RunTimedThreads("shared memory", GreetMany, threads, kThreads);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to call SayHelloTo method. Error code = " << hr << "\n";
+    }
+
+    // The baseline: the same object in this process
+    hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (SUCCEEDED(hr)) {
+        CLSID clsid;
+        if (SUCCEEDED(CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid)) &&
+            SUCCEEDED(CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&s_pHelloWorld))) {
+            RunTimedThreads("warm-up", GreetManyInProc, threads, kThreads);
+            RunTimedThreads("in-process", GreetManyInProc, threads, kThreads);
+            s_pHelloWorld->Release();
+        }
+        else {
+            std::cout << "No in-process HelloWorld registered to compare with\n";
+        }
+        CoUninitialize();
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <windows.h>
+#include <iostream>
+#include <stdio.h>
+#include "../com_hello/midl/IHelloWorld.h"
+
+// Greets through the vtable and through IDispatch::Invoke, then reads back what
+// IHelloWorldStats counted. Run it once more with HELLOWORLD_STATS_SAMPLE=0 to see what
+// a greeting costs without the statistics, and with HELLOWORLD_STATS_SAMPLE=1 to see what
+// timing every call costs.
+static const int kGreetings = 1000000;
+
+// Greets kGreetings times and returns the nanoseconds per greeting
+static double TimeGreetings(IHelloWorld* pHelloWorld, BSTR name, bool lateBound)
+{
+    VARIANT arg;
+    VariantInit(&arg);
+    V_VT(&arg) = VT_BSTR;
+    V_BSTR(&arg) = name;
+    DISPPARAMS params = { &arg, NULL, 1, 0 };
+
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < kGreetings; ++i) {
+        if (lateBound) {
+            VARIANT result;
+            VariantInit(&result);
+            pHelloWorld->Invoke(3, IID_NULL, LOCALE_USER_DEFAULT, DISPATCH_METHOD, &params, &result, NULL, NULL);
+            VariantClear(&result);
+        }
+        else {
+            BSTR greeting = NULL;
+            pHelloWorld->SayHelloTo(name, &greeting);
+            SysFreeString(greeting);
+        }
+    }
+    QueryPerformanceCounter(&end);
+    return (end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart / kGreetings;
+}
+
+int main() {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to initialize COM library. Error code = " << hr << "\n";
+        return hr;
+    }
+
+    CLSID clsid;
+    hr = CLSIDFromProgID(L"HelloWorldLib.HelloWorld", &clsid);
+    if (FAILED(hr)) {
+        std::cerr << "CLSIDFromProgID error: " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorld* pHelloWorld = NULL;
+    hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, __uuidof(IHelloWorld), (void**)&pHelloWorld);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create HelloWorld instance. Error code = " << hr << "\n";
+        CoUninitialize();
+        return hr;
+    }
+
+    IHelloWorldStats* pStats = NULL;
+    hr = pHelloWorld->QueryInterface(IID_IHelloWorldStats, (void**)&pStats);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get IHelloWorldStats. Error code = " << hr << "\n";
+        pHelloWorld->Release();
+        CoUninitialize();
+        return hr;
+    }
+
+    BSTR name = SysAllocString(L"John Doe");
+    std::cout << "vtable: " << TimeGreetings(pHelloWorld, name, false) << " ns per greeting\n";
+    std::cout << "Invoke: " << TimeGreetings(pHelloWorld, name, true) << " ns per greeting\n\n";
+
+    static const char* const methods[] = { "SayHello", "SayHelloStr", "SayHelloTo", "SayHelloToMany" };
+    static const char* const paths[] = { "vtable", "Invoke", "async" };
+    std::cout << "method          path        calls  failures     timed   p50 ns   p90 ns   p99 ns   max ns\n";
+    for (int method = HelloWorldMethodSayHello; method <= HelloWorldMethodSayHelloToMany; ++method) {
+        for (int path = HelloWorldCallVtable; path <= HelloWorldCallAsync; ++path) {
+            HelloWorldMethodStats stats;
+            hr = pStats->GetMethodStats(static_cast<HelloWorldMethod>(method), static_cast<HelloWorldCallPath>(path), &stats);
+            if (FAILED(hr)) {
+                std::cerr << "Failed to read the statistics. Error code = " << hr << "\n";
+                break;
+            }
+            char line[128];
+            sprintf_s(line, sizeof(line), "%-15s %-6s %10lld %9lld %9lld %8lld %8lld %8lld %8lld\n", methods[method], paths[path],
+                      stats.calls, stats.failures, stats.timed, stats.p50, stats.p90, stats.p99, stats.max);
+            std::cout << line;
+        }
+    }
+
+    SysFreeString(name);
+    pStats->Release();
+    pHelloWorld->Release();
+    CoUninitialize();
+
+    return 0;
+}
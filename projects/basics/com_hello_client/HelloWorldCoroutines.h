@@ -0,0 +1,659 @@
+#pragma once
+#include <windows.h>
+#include <coroutine>
+#include <atomic>
+#include <new>
+#include "../com_hello/midl/IHelloWorld.h"
+
+// HelloWorld calls as C++20 coroutines. Header-only, compile with /std:c++20.
+//
+//     HelloWorldTask Greet(HelloWorldAsyncClient<HelloWorldExecutor>& helloWorld, BSTR name)
+//     {
+//         BSTR greeting;
+//         HRESULT hr = co_await helloWorld.SayHelloTo(name, &greeting);
+//         ...
+//         co_return hr;
+//     }
+//
+// SayHelloTo is a real asynchronous call. It goes through AsyncIHelloWorldGreeter, and no
+// thread waits while the object works on it: the call object signals the completion and
+// the coroutine resumes on the executor. The other IHelloWorld methods only exist
+// synchronously, their awaitables move the coroutine to the executor and call them there.
+//
+// Nothing is allocated per call once things are warmed up. Coroutine frames come from
+// HelloWorldFramePool, the work items the executor queues live in the awaitables, and the
+// call objects are reused.
+
+// A coroutine waiting to be resumed by an executor. The executor may link items through
+// 'next' while it holds them.
+struct HelloWorldWork
+{
+    std::coroutine_handle<> handle;
+    HelloWorldWork* next;
+};
+
+// What HelloWorldAsyncClient needs from an executor. HelloWorldExecutor below is one, any
+// other thread pool can be adapted.
+template <class T>
+concept HelloWorldExecutorType = requires(T& executor, HelloWorldWork* work)
+{
+    { executor.Post(work) } noexcept;
+};
+
+// Recycles coroutine frames in size classes of 64 bytes. Every thread keeps the frames it
+// allocated, so allocating takes no lock. A coroutine that started on one thread and ended
+// on another, like every coroutine started on the main thread and finished on an executor,
+// hands its frame back to the thread it came from: a frame remembers its cache, and one
+// freed on another thread goes to that cache's list of returned frames, which its thread
+// takes over in one go once its own frames run out. The caches of threads that ended are
+// kept for the next threads, so frames returned late still have somewhere to go. Frames
+// larger than the largest class, and frames beyond what a thread may cache, go to the heap.
+class HelloWorldFramePool
+{
+    static const size_t kGranularity = 64;
+    static const size_t kClasses = 16;
+    static const UINT32 kMaxCached = 1024;
+
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    struct Cache
+    {
+        FreeFrame* frames[kClasses] = {};
+        UINT32 counts[kClasses] = {};
+        std::atomic<FreeFrame*> returned[kClasses] = {};   // freed on other threads
+        Cache* nextIdle = NULL;
+    };
+
+    // In front of every pooled frame, the size keeps the frame aligned like operator new
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header
+    {
+        Cache* owner;   // NULL if there was no cache, then the frame is the heap's
+    };
+
+    // The caches of threads that ended. They live as long as the process: a frame may be
+    // returned to one at any time.
+    static inline SRWLOCK s_idleLock = SRWLOCK_INIT;
+    static inline Cache* s_idle = NULL;
+
+    struct ThreadCacheHolder
+    {
+        Cache* cache;
+
+        ThreadCacheHolder()
+        {
+            AcquireSRWLockExclusive(&s_idleLock);
+            cache = s_idle;
+            if (cache != NULL)
+            {
+                s_idle = cache->nextIdle;
+            }
+            ReleaseSRWLockExclusive(&s_idleLock);
+            if (cache == NULL)
+            {
+                cache = new (std::nothrow) Cache;
+            }
+        }
+
+        ~ThreadCacheHolder()
+        {
+            if (cache != NULL)
+            {
+                AcquireSRWLockExclusive(&s_idleLock);
+                cache->nextIdle = s_idle;
+                s_idle = cache;
+                ReleaseSRWLockExclusive(&s_idleLock);
+            }
+        }
+    };
+
+    static Cache* ThreadCache()
+    {
+        thread_local ThreadCacheHolder holder;
+        return holder.cache;
+    }
+
+    static size_t ClassOf(size_t size) { return (size + sizeof(Header) + kGranularity - 1) / kGranularity - 1; }
+
+    static void* FrameOf(Header* header) { return header + 1; }
+    static Header* HeaderOf(void* p) { return static_cast<Header*>(p) - 1; }
+
+public:
+    static void* Allocate(size_t size) noexcept
+    {
+        size_t index = ClassOf(size);
+        if (index >= kClasses)
+        {
+            return ::operator new(size, std::nothrow);
+        }
+        Cache* cache = ThreadCache();
+        FreeFrame* frame = NULL;
+        if (cache != NULL)
+        {
+            frame = cache->frames[index];
+            if (frame == NULL && cache->returned[index].load(std::memory_order_relaxed) != NULL)
+            {
+                // Take back everything the other threads returned
+                frame = cache->returned[index].exchange(NULL, std::memory_order_acquire);
+                for (FreeFrame* counted = frame; counted != NULL; counted = counted->next)
+                {
+                    ++cache->counts[index];
+                }
+            }
+        }
+        if (frame == NULL)
+        {
+            Header* header = static_cast<Header*>(::operator new((index + 1) * kGranularity, std::nothrow));
+            if (header == NULL)
+            {
+                return NULL;
+            }
+            header->owner = cache;
+            return FrameOf(header);
+        }
+        cache->frames[index] = frame->next;
+        --cache->counts[index];
+        return frame;
+    }
+
+    static void Free(void* p, size_t size) noexcept
+    {
+        size_t index = ClassOf(size);
+        if (index >= kClasses)
+        {
+            ::operator delete(p);
+            return;
+        }
+        Header* header = HeaderOf(p);
+        Cache* owner = header->owner;
+        FreeFrame* frame = static_cast<FreeFrame*>(p);
+        if (owner == NULL)
+        {
+            ::operator delete(header);
+        }
+        else if (owner != ThreadCache())
+        {
+            // Only pushed here and only taken all at once, so no frame comes back under
+            // a push that is still looking at it
+            FreeFrame* head = owner->returned[index].load(std::memory_order_relaxed);
+            do
+            {
+                frame->next = head;
+            } while (!owner->returned[index].compare_exchange_weak(head, frame, std::memory_order_release, std::memory_order_relaxed));
+        }
+        else if (owner->counts[index] >= kMaxCached)
+        {
+            ::operator delete(header);
+        }
+        else
+        {
+            frame->next = owner->frames[index];
+            owner->frames[index] = frame;
+            ++owner->counts[index];
+        }
+    }
+};
+
+// A coroutine that produces an HRESULT. It starts when it is awaited, or with Start() when
+// nobody awaits it. Out of memory for its frame, awaiting it yields E_OUTOFMEMORY.
+class HelloWorldTask
+{
+public:
+    struct promise_type
+    {
+        HRESULT m_hr = S_OK;
+        std::coroutine_handle<> m_continuation;
+        bool m_detached = false;
+
+        static void* operator new(size_t size) noexcept { return HelloWorldFramePool::Allocate(size); }
+        static void operator delete(void* p, size_t size) noexcept { HelloWorldFramePool::Free(p, size); }
+        static HelloWorldTask get_return_object_on_allocation_failure() noexcept { return HelloWorldTask(NULL); }
+
+        HelloWorldTask get_return_object() noexcept { return HelloWorldTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Goes on with whoever awaited the task, without growing the stack
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                promise_type& promise = handle.promise();
+                if (promise.m_continuation)
+                {
+                    return promise.m_continuation;
+                }
+                if (promise.m_detached)
+                {
+                    handle.destroy();
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(HRESULT hr) noexcept { m_hr = hr; }
+        void unhandled_exception() noexcept { m_hr = E_UNEXPECTED; }
+    };
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit HelloWorldTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+public:
+    HelloWorldTask(HelloWorldTask&& other) noexcept : m_handle(other.m_handle) { other.m_handle = NULL; }
+    HelloWorldTask(const HelloWorldTask&) = delete;
+    HelloWorldTask& operator=(const HelloWorldTask&) = delete;
+
+    ~HelloWorldTask()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    // Runs the task on this thread until it first waits, it frees itself when it's done
+    HRESULT Start()
+    {
+        if (!m_handle)
+        {
+            return E_OUTOFMEMORY;
+        }
+        std::coroutine_handle<promise_type> handle = m_handle;
+        m_handle = NULL;
+        handle.promise().m_detached = true;
+        handle.resume();
+        return S_OK;
+    }
+
+    bool await_ready() const noexcept { return !m_handle; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+    {
+        m_handle.promise().m_continuation = continuation;
+        return m_handle;
+    }
+    HRESULT await_resume() const noexcept { return m_handle ? m_handle.promise().m_hr : E_OUTOFMEMORY; }
+};
+
+// A fixed number of threads in the multithreaded apartment that resume coroutines in the
+// order they were posted
+class HelloWorldExecutor
+{
+    SRWLOCK m_lock;
+    CONDITION_VARIABLE m_posted;
+    HelloWorldWork* m_head;
+    HelloWorldWork* m_tail;
+    bool m_stopping;
+    HANDLE* m_threads;
+    UINT32 m_threadCount;
+
+    HelloWorldExecutor(const HelloWorldExecutor&) = delete;
+    HelloWorldExecutor& operator=(const HelloWorldExecutor&) = delete;
+
+    static DWORD WINAPI Run(LPVOID param)
+    {
+        HelloWorldExecutor* executor = static_cast<HelloWorldExecutor*>(param);
+        CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        for (;;)
+        {
+            AcquireSRWLockExclusive(&executor->m_lock);
+            while (executor->m_head == NULL && !executor->m_stopping)
+            {
+                SleepConditionVariableSRW(&executor->m_posted, &executor->m_lock, INFINITE, 0);
+            }
+            HelloWorldWork* work = executor->m_head;
+            if (work != NULL)
+            {
+                executor->m_head = work->next;
+                if (executor->m_head == NULL)
+                {
+                    executor->m_tail = NULL;
+                }
+            }
+            ReleaseSRWLockExclusive(&executor->m_lock);
+
+            if (work == NULL)
+            {
+                break;
+            }
+            // The work item belongs to the coroutine, which may be gone after this
+            work->handle.resume();
+        }
+        CoUninitialize();
+        return 0;
+    }
+
+public:
+    HelloWorldExecutor() : m_head(NULL), m_tail(NULL), m_stopping(false), m_threads(NULL), m_threadCount(0)
+    {
+        InitializeSRWLock(&m_lock);
+        InitializeConditionVariable(&m_posted);
+    }
+
+    ~HelloWorldExecutor()
+    {
+        Stop();
+    }
+
+    HRESULT Start(UINT32 threads)
+    {
+        if (threads == 0 || m_threads != NULL)
+        {
+            return E_INVALIDARG;
+        }
+        m_threads = new (std::nothrow) HANDLE[threads];
+        if (m_threads == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        for (; m_threadCount < threads; ++m_threadCount)
+        {
+            m_threads[m_threadCount] = CreateThread(NULL, 0, Run, this, 0, NULL);
+            if (m_threads[m_threadCount] == NULL)
+            {
+                HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+                Stop();
+                return hr;
+            }
+        }
+        return S_OK;
+    }
+
+    // Lets the threads finish what was posted, then ends them
+    void Stop()
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        m_stopping = true;
+        ReleaseSRWLockExclusive(&m_lock);
+        WakeAllConditionVariable(&m_posted);
+
+        for (UINT32 i = 0; i < m_threadCount; ++i)
+        {
+            WaitForSingleObject(m_threads[i], INFINITE);
+            CloseHandle(m_threads[i]);
+        }
+        delete[] m_threads;
+        m_threads = NULL;
+        m_threadCount = 0;
+    }
+
+    void Post(HelloWorldWork* work) noexcept
+    {
+        work->next = NULL;
+        AcquireSRWLockExclusive(&m_lock);
+        if (m_tail != NULL)
+        {
+            m_tail->next = work;
+        }
+        else
+        {
+            m_head = work;
+        }
+        m_tail = work;
+        ReleaseSRWLockExclusive(&m_lock);
+        WakeConditionVariable(&m_posted);
+    }
+};
+
+// Awaitable IHelloWorld calls on one HelloWorld object. No call may be in flight when it
+// is destroyed.
+template <HelloWorldExecutorType Executor>
+class HelloWorldAsyncClient
+{
+    // One reusable asynchronous call. It aggregates the call object HelloWorld creates, and
+    // gives it the ISynchronize to signal: that posts the waiting coroutine to the executor.
+    class CallSlot : public ISynchronize
+    {
+        std::atomic<long> m_cRef;
+        std::atomic<bool> m_signaled;
+        Executor& m_executor;
+
+    public:
+        IUnknown* m_pInner;
+        AsyncIHelloWorldGreeter* m_pCall;   // part of the aggregate, so not a counted reference
+        HelloWorldWork m_work;
+        CallSlot* m_next;                   // in the free list of the client
+
+        explicit CallSlot(Executor& executor) : m_cRef(1), m_signaled(false), m_executor(executor), m_pInner(NULL), m_pCall(NULL), m_work(), m_next(NULL) {}
+        ~CallSlot()
+        {
+            if (m_pInner != NULL)
+            {
+                m_pInner->Release();
+            }
+        }
+
+        HRESULT __stdcall QueryInterface(const IID& riid, void** ppv)
+        {
+            if (ppv == NULL)
+            {
+                return E_POINTER;
+            }
+            if (riid == IID_IUnknown || riid == IID_ISynchronize)
+            {
+                *ppv = static_cast<ISynchronize*>(this);
+                AddRef();
+                return S_OK;
+            }
+            if (m_pInner == NULL)
+            {
+                *ppv = NULL;
+                return E_NOINTERFACE;
+            }
+            return m_pInner->QueryInterface(riid, ppv);
+        }
+        ULONG __stdcall AddRef() { return m_cRef.fetch_add(1, std::memory_order_relaxed) + 1; }
+        ULONG __stdcall Release()
+        {
+            long cRef = m_cRef.fetch_sub(1, std::memory_order_acq_rel) - 1;
+            if (cRef == 0)
+            {
+                delete this;
+            }
+            return cRef;
+        }
+
+        // ISynchronize methods. Finish_ is only called after Signal, so Wait doesn't block.
+        HRESULT __stdcall Wait(DWORD, DWORD dwMilliseconds)
+        {
+            while (!m_signaled.load(std::memory_order_acquire))
+            {
+                if (dwMilliseconds == 0)
+                {
+                    return RPC_S_CALLPENDING;
+                }
+                SwitchToThread();
+            }
+            return S_OK;
+        }
+        HRESULT __stdcall Signal()
+        {
+            m_signaled.store(true, std::memory_order_release);
+            m_executor.Post(&m_work);
+            return S_OK;
+        }
+        HRESULT __stdcall Reset()
+        {
+            m_signaled.store(false, std::memory_order_relaxed);
+            return S_OK;
+        }
+    };
+
+    IHelloWorld* m_pHelloWorld;
+    ICallFactory* m_pCallFactory;
+    Executor& m_executor;
+    SRWLOCK m_lock;             // guards the free list
+    CallSlot* m_freeSlots;
+
+    HelloWorldAsyncClient(const HelloWorldAsyncClient&) = delete;
+    HelloWorldAsyncClient& operator=(const HelloWorldAsyncClient&) = delete;
+
+    HRESULT AcquireSlot(CallSlot** ppSlot)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        CallSlot* slot = m_freeSlots;
+        if (slot != NULL)
+        {
+            m_freeSlots = slot->m_next;
+        }
+        ReleaseSRWLockExclusive(&m_lock);
+        if (slot != NULL)
+        {
+            *ppSlot = slot;
+            return S_OK;
+        }
+
+        // Short of call objects, make another one
+        slot = new (std::nothrow) CallSlot(m_executor);
+        if (slot == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        HRESULT hr = m_pCallFactory->CreateCall(IID_AsyncIHelloWorldGreeter, slot, IID_IUnknown, &slot->m_pInner);
+        if (SUCCEEDED(hr))
+        {
+            hr = slot->m_pInner->QueryInterface(IID_AsyncIHelloWorldGreeter, reinterpret_cast<void**>(&slot->m_pCall));
+        }
+        if (FAILED(hr))
+        {
+            slot->Release();
+            return hr;
+        }
+        // The interface of the inner object counts on the slot itself
+        slot->Release();
+        *ppSlot = slot;
+        return S_OK;
+    }
+
+    void ReleaseSlot(CallSlot* slot)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        slot->m_next = m_freeSlots;
+        m_freeSlots = slot;
+        ReleaseSRWLockExclusive(&m_lock);
+    }
+
+public:
+    class SayHelloToAwaiter
+    {
+        HelloWorldAsyncClient* m_client;
+        BSTR m_name;
+        BSTR* m_greeting;
+        CallSlot* m_slot;
+        HRESULT m_hr;
+
+    public:
+        SayHelloToAwaiter(HelloWorldAsyncClient* client, BSTR name, BSTR* greeting) : m_client(client), m_name(name), m_greeting(greeting), m_slot(NULL), m_hr(S_OK) {}
+
+        bool await_ready() noexcept
+        {
+            m_hr = m_client->AcquireSlot(&m_slot);
+            return FAILED(m_hr);
+        }
+
+        // Once Begin_ succeeded, the call may complete and the coroutine go on on another
+        // thread right away. The awaiter may be gone by then, don't touch it anymore.
+        bool await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            m_slot->m_work.handle = handle;
+            HRESULT hr = m_slot->m_pCall->Begin_SayHelloTo(m_name);
+            if (FAILED(hr))
+            {
+                m_hr = hr;
+                return false;
+            }
+            return true;
+        }
+
+        HRESULT await_resume() noexcept
+        {
+            if (m_slot == NULL)
+            {
+                return m_hr;
+            }
+            if (SUCCEEDED(m_hr))
+            {
+                m_hr = m_slot->m_pCall->Finish_SayHelloTo(m_greeting);
+            }
+            m_client->ReleaseSlot(m_slot);
+            return m_hr;
+        }
+    };
+
+    // Resumes the coroutine on the executor, then makes the call there
+    template <class Call>
+    class ExecutorAwaiter
+    {
+        Executor& m_executor;
+        Call m_call;
+        HelloWorldWork m_work;
+
+    public:
+        ExecutorAwaiter(Executor& executor, Call call) : m_executor(executor), m_call(call), m_work() {}
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            m_work.handle = handle;
+            m_executor.Post(&m_work);
+        }
+        HRESULT await_resume() noexcept { return m_call(); }
+    };
+
+    HelloWorldAsyncClient(IHelloWorld* pHelloWorld, Executor& executor)
+        : m_pHelloWorld(pHelloWorld), m_pCallFactory(NULL), m_executor(executor), m_freeSlots(NULL)
+    {
+        m_pHelloWorld->AddRef();
+        InitializeSRWLock(&m_lock);
+    }
+
+    ~HelloWorldAsyncClient()
+    {
+        while (m_freeSlots != NULL)
+        {
+            CallSlot* slot = m_freeSlots;
+            m_freeSlots = slot->m_next;
+            slot->Release();
+        }
+        if (m_pCallFactory != NULL)
+        {
+            m_pCallFactory->Release();
+        }
+        m_pHelloWorld->Release();
+    }
+
+    // Fails with E_NOINTERFACE if the object can't make asynchronous calls
+    HRESULT Initialize()
+    {
+        return m_pHelloWorld->QueryInterface(IID_ICallFactory, reinterpret_cast<void**>(&m_pCallFactory));
+    }
+
+    // [in] 'name' only needs to live until the call has started, like with Begin_SayHelloTo
+    SayHelloToAwaiter SayHelloTo(BSTR name, BSTR* greeting)
+    {
+        return SayHelloToAwaiter(this, name, greeting);
+    }
+
+    auto SayHelloStr(BSTR* greeting)
+    {
+        IHelloWorld* pHelloWorld = m_pHelloWorld;
+        return ExecutorAwaiter(m_executor, [=]() { return pHelloWorld->SayHelloStr(greeting); });
+    }
+
+    auto SayHelloToMany(SAFEARRAY* names, SAFEARRAY** greetings)
+    {
+        IHelloWorld* pHelloWorld = m_pHelloWorld;
+        return ExecutorAwaiter(m_executor, [=]() { return pHelloWorld->SayHelloToMany(names, greetings); });
+    }
+
+    // Just moves the coroutine to the executor, e.g. to try again after RPC_E_SERVER_TOO_BUSY
+    auto Schedule()
+    {
+        return ExecutorAwaiter(m_executor, []() { return S_OK; });
+    }
+};
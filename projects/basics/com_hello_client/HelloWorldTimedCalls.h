@@ -0,0 +1,85 @@
+#pragma once
+#include <windows.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+// Runs the same calls on a few threads at once, timing every call, and prints the calls per
+// second of the whole run with the median and 99th percentile of one call. The transport
+// clients run their calls this way over the transport and then in-process, so one line can
+// be read against the other.
+//
+//     static DWORD WINAPI Greet(LPVOID param)
+//     {
+//         HelloWorldTimedThread* thread = static_cast<HelloWorldTimedThread*>(param);
+//         for (...) {
+//             LONGLONG start = HelloWorldTimedThread::Now();
+//             hr = ...;
+//             thread->Add(start, hr);
+//         }
+//     }
+//     RunTimedThreads("local server", Greet, threads, count);
+struct HelloWorldTimedThread
+{
+    const OLECHAR* name;            // to greet, set by the caller
+    std::vector<LONGLONG> ticks;    // of every call that succeeded
+    HRESULT hr = S_OK;              // the first failure
+
+    static LONGLONG Now()
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return now.QuadPart;
+    }
+
+    void Add(LONGLONG start, HRESULT result)
+    {
+        if (SUCCEEDED(result)) {
+            ticks.push_back(Now() - start);
+        }
+        else if (SUCCEEDED(hr)) {
+            hr = result;
+        }
+    }
+};
+
+// Returns the first failure of any thread, after printing the line
+inline HRESULT RunTimedThreads(const char* label, LPTHREAD_START_ROUTINE routine, HelloWorldTimedThread* threads, int count)
+{
+    std::vector<HANDLE> handles(count);
+    LONGLONG start = HelloWorldTimedThread::Now();
+    for (int i = 0; i < count; ++i) {
+        threads[i].ticks.clear();
+        threads[i].hr = S_OK;
+        handles[i] = CreateThread(NULL, 0, routine, &threads[i], 0, NULL);
+    }
+    for (int i = 0; i < count; ++i) {
+        if (handles[i] != NULL) {
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+        }
+    }
+    LONGLONG elapsed = HelloWorldTimedThread::Now() - start;
+
+    HRESULT hr = S_OK;
+    std::vector<LONGLONG> all;
+    for (int i = 0; i < count; ++i) {
+        all.insert(all.end(), threads[i].ticks.begin(), threads[i].ticks.end());
+        if (SUCCEEDED(hr) && (FAILED(threads[i].hr) || handles[i] == NULL)) {
+            hr = (handles[i] == NULL) ? HRESULT_FROM_WIN32(GetLastError()) : threads[i].hr;
+        }
+    }
+    if (all.empty()) {
+        printf("%-16s no call succeeded, error code = 0x%08lX\n", label, static_cast<unsigned long>(hr));
+        return FAILED(hr) ? hr : E_FAIL;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    double microseconds = 1e6 / static_cast<double>(frequency.QuadPart);
+    std::sort(all.begin(), all.end());
+    printf("%-16s %10.0f calls/s   p50 %8.1f us   p99 %8.1f us\n", label,
+           all.size() / (elapsed / static_cast<double>(frequency.QuadPart)),
+           all[all.size() / 2] * microseconds, all[(all.size() * 99) / 100] * microseconds);
+    return hr;
+}
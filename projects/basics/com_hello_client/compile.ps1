@@ -1 +1,12 @@
+# The header and IIDs come from ../com_hello/midl, which building ../com_hello generates
 cl /EHsc HelloWorldClient.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc /std:c++17 HelloWorldClient_localserver.cpp ../com_hello/LocalServerChannel.cpp ../com_hello/midl/IHelloWorld_i.c /link Ws2_32.lib Ole32.lib OleAut32.lib
+cl /EHsc /std:c++17 HelloWorldClient_sharedmemory.cpp ../com_hello/SharedMemory.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc /std:c++20 HelloWorldClient_coroutine.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc HelloWorldClient_events.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc /std:c++17 HelloWorldClient_activationdb.cpp ../com_hello/ActivationDb.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc /std:c++17 HelloWorldClient_manifest.cpp ../com_hello/ClassManifest.cpp ../com_hello/ActivationDb.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc /std:c++17 /DHELLOWORLD_ACTIVATION_PROBES HelloWorldClient_activationprobe.cpp ../com_hello/ActivationDb.cpp ../com_hello/ClassManifest.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc HelloWorldClient_stats.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc HelloWorldClient_memory.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
+cl /EHsc HelloWorldClient_hammer.cpp ../com_hello/midl/IHelloWorld_i.c /link Ole32.lib OleAut32.lib
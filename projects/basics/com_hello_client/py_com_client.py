@@ -12,6 +12,11 @@ def main():
         greeting = hw.SayHelloTo("John Doe")
         print(greeting)
 
+        # one call for many greetings, win32com passes the list as a SAFEARRAY
+        greetings = hw.SayHelloToMany(["Jane Doe", "Max Mustermann"])
+        for greeting in greetings:
+            print(greeting)
+
     except Exception as e:
         print("An error occurred: {0}".format(e))
 